@@ -27,6 +27,7 @@
 #include "thread.h"
 #include "queue.h"
 #include "filter.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -180,6 +181,156 @@ bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 }
 
 
+/*
+ * Adj-RIB-In entries are allocated in chunks per peer, as a peer usually
+ * sends many paths and they are all freed together when the session goes
+ * down.  Each chunk keeps its own free entries, linked through their next
+ * pointer, and is released as soon as all of its entries are free, except
+ * for the last one of a peer that still has entries.
+ *
+ * Chunks are aligned to their size, so that the chunk of an entry is found
+ * from its address and entries need no pointer back to it.
+ */
+#define BGP_ADJ_IN_CHUNK_BYTES 8192
+
+PREDECL_DLIST(bgp_adj_in_chunks);
+
+struct bgp_adj_in_chunk {
+	struct bgp_adj_in_chunks_item item;
+
+	/* Freed entries */
+	struct bgp_adj_in *free;
+
+	/* Entries in use, and handed out at least once */
+	uint16_t used;
+	uint16_t carved;
+
+	struct bgp_adj_in entries[];
+};
+
+DECLARE_DLIST(bgp_adj_in_chunks, struct bgp_adj_in_chunk, item);
+
+#define BGP_ADJ_IN_CHUNK_ENTRIES                                               \
+	((BGP_ADJ_IN_CHUNK_BYTES - sizeof(struct bgp_adj_in_chunk))            \
+	 / sizeof(struct bgp_adj_in))
+
+struct bgp_adj_in_pool {
+	/* Chunks with free entries, and those without */
+	struct bgp_adj_in_chunks_head partial;
+	struct bgp_adj_in_chunks_head full;
+
+	/* Entries in use */
+	unsigned long count;
+};
+
+static unsigned long bgp_adj_in_count;
+static unsigned long bgp_adj_in_chunks;
+
+static struct bgp_adj_in_chunk *bgp_adj_in_chunk_of(struct bgp_adj_in *adj)
+{
+	return (struct bgp_adj_in_chunk *)((uintptr_t)adj
+					   & ~(uintptr_t)(BGP_ADJ_IN_CHUNK_BYTES
+							  - 1));
+}
+
+static struct bgp_adj_in_chunk *
+bgp_adj_in_chunk_new(struct bgp_adj_in_pool *pool)
+{
+	struct bgp_adj_in_chunk *chunk;
+	void *ptr;
+
+	if (posix_memalign(&ptr, BGP_ADJ_IN_CHUNK_BYTES,
+			   BGP_ADJ_IN_CHUNK_BYTES))
+		memory_oom(BGP_ADJ_IN_CHUNK_BYTES, MTYPE_BGP_ADJ_IN->name);
+	qcountalloc_size(MTYPE_BGP_ADJ_IN, BGP_ADJ_IN_CHUNK_BYTES);
+	bgp_adj_in_chunks++;
+
+	chunk = ptr;
+	memset(chunk, 0, sizeof(*chunk));
+	bgp_adj_in_chunks_add_head(&pool->partial, chunk);
+
+	return chunk;
+}
+
+static void bgp_adj_in_chunk_free(struct bgp_adj_in_pool *pool,
+				  struct bgp_adj_in_chunk *chunk)
+{
+	bgp_adj_in_chunks_del(&pool->partial, chunk);
+	qcountfree_size(MTYPE_BGP_ADJ_IN, BGP_ADJ_IN_CHUNK_BYTES);
+	bgp_adj_in_chunks--;
+	free(chunk);
+}
+
+static struct bgp_adj_in *bgp_adj_in_alloc(struct peer *peer)
+{
+	struct bgp_adj_in_pool *pool = peer->adj_in_pool;
+	struct bgp_adj_in_chunk *chunk;
+	struct bgp_adj_in *adj;
+
+	if (!pool) {
+		pool = peer->adj_in_pool =
+			XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(*pool));
+		bgp_adj_in_chunks_init(&pool->partial);
+		bgp_adj_in_chunks_init(&pool->full);
+	}
+
+	chunk = bgp_adj_in_chunks_first(&pool->partial);
+	if (!chunk)
+		chunk = bgp_adj_in_chunk_new(pool);
+
+	if (chunk->free) {
+		adj = chunk->free;
+		chunk->free = adj->next;
+	} else
+		adj = &chunk->entries[chunk->carved++];
+
+	if (++chunk->used == BGP_ADJ_IN_CHUNK_ENTRIES) {
+		bgp_adj_in_chunks_del(&pool->partial, chunk);
+		bgp_adj_in_chunks_add_head(&pool->full, chunk);
+	}
+
+	pool->count++;
+	bgp_adj_in_count++;
+
+	memset(adj, 0, sizeof(*adj));
+	return adj;
+}
+
+static void bgp_adj_in_free(struct peer *peer, struct bgp_adj_in *adj)
+{
+	struct bgp_adj_in_pool *pool = peer->adj_in_pool;
+	struct bgp_adj_in_chunk *chunk = bgp_adj_in_chunk_of(adj);
+	size_t nchunks;
+
+	bgp_adj_in_count--;
+	pool->count--;
+
+	if (chunk->used-- == BGP_ADJ_IN_CHUNK_ENTRIES) {
+		bgp_adj_in_chunks_del(&pool->full, chunk);
+		bgp_adj_in_chunks_add_head(&pool->partial, chunk);
+	}
+
+	adj->next = chunk->free;
+	chunk->free = adj;
+
+	nchunks = bgp_adj_in_chunks_count(&pool->partial)
+		  + bgp_adj_in_chunks_count(&pool->full);
+	if (!chunk->used && (!pool->count || nchunks > 1))
+		bgp_adj_in_chunk_free(pool, chunk);
+
+	if (!pool->count) {
+		bgp_adj_in_chunks_fini(&pool->partial);
+		bgp_adj_in_chunks_fini(&pool->full);
+		XFREE(MTYPE_BGP_ADJ_IN, peer->adj_in_pool);
+	}
+}
+
+void bgp_adj_in_stats(unsigned long *count, size_t *bytes)
+{
+	*count = bgp_adj_in_count;
+	*bytes = bgp_adj_in_chunks * BGP_ADJ_IN_CHUNK_BYTES;
+}
+
 void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
 		    uint32_t addpath_id)
 {
@@ -194,42 +345,55 @@ void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer, struct attr *attr,
 			return;
 		}
 	}
-	adj = XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(struct bgp_adj_in));
+	adj = bgp_adj_in_alloc(peer);
 	adj->peer = peer_lock(peer); /* adj_in peer reference */
 	adj->attr = bgp_attr_intern(attr);
 	adj->uptime = monotime(NULL);
 	adj->addpath_rx_id = addpath_id;
-	BGP_ADJ_IN_ADD(dest, adj);
+	adj->next = dest->adj_in;
+	dest->adj_in = adj;
 	bgp_dest_lock_node(dest);
 }
 
-void bgp_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *bai)
+/* Unlink the entry *link points to and free it */
+static void bgp_adj_in_unlink(struct bgp_dest *dest, struct bgp_adj_in **link)
 {
+	struct bgp_adj_in *bai = *link;
+	struct peer *peer = bai->peer;
+
+	*link = bai->next;
 	bgp_attr_unintern(&bai->attr);
-	BGP_ADJ_IN_DEL(dest, bai);
+	bgp_adj_in_free(peer, bai);
 	bgp_dest_unlock_node(dest);
-	peer_unlock(bai->peer); /* adj_in peer reference */
-	XFREE(MTYPE_BGP_ADJ_IN, bai);
+	peer_unlock(peer); /* adj_in peer reference */
+}
+
+void bgp_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *bai)
+{
+	struct bgp_adj_in **link;
+
+	for (link = &dest->adj_in; *link; link = &(*link)->next)
+		if (*link == bai) {
+			bgp_adj_in_unlink(dest, link);
+			return;
+		}
 }
 
 bool bgp_adj_in_unset(struct bgp_dest *dest, struct peer *peer,
 		      uint32_t addpath_id)
 {
-	struct bgp_adj_in *adj;
-	struct bgp_adj_in *adj_next;
+	struct bgp_adj_in **link;
 
-	adj = dest->adj_in;
-
-	if (!adj)
+	if (!dest->adj_in)
 		return false;
 
-	while (adj) {
-		adj_next = adj->next;
-
-		if (adj->peer == peer && adj->addpath_rx_id == addpath_id)
-			bgp_adj_in_remove(dest, adj);
-
-		adj = adj_next;
+	link = &dest->adj_in;
+	while (*link) {
+		if ((*link)->peer == peer
+		    && (*link)->addpath_rx_id == addpath_id)
+			bgp_adj_in_unlink(dest, link);
+		else
+			link = &(*link)->next;
 	}
 
 	return true;
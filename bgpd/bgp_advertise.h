@@ -92,11 +92,14 @@ RB_HEAD(bgp_adj_out_rb, bgp_adj_out);
 RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
 	     bgp_adj_out_compare);
 
-/* BGP adjacency in. */
+/*
+ * BGP adjacency in.  There is one of these for every path received with
+ * soft-reconfiguration inbound, so they are kept small and allocated from
+ * chunks owned by the peer, see bgp_adj_in_set().
+ */
 struct bgp_adj_in {
 	/* Linked list pointer.  */
 	struct bgp_adj_in *next;
-	struct bgp_adj_in *prev;
 
 	/* Received peer.  */
 	struct peer *peer;
@@ -105,7 +108,7 @@ struct bgp_adj_in {
 	struct attr *attr;
 
 	/* timestamp (monotime) */
-	time_t uptime;
+	uint32_t uptime;
 
 	/* Addpath identifier */
 	uint32_t addpath_rx_id;
@@ -138,9 +141,6 @@ struct bgp_synchronize {
 			(N)->TYPE = (A)->next;                                 \
 	} while (0)
 
-#define BGP_ADJ_IN_ADD(N, A) BGP_PATH_INFO_ADD(N, A, adj_in)
-#define BGP_ADJ_IN_DEL(N, A) BGP_PATH_INFO_DEL(N, A, adj_in)
-
 /* Prototypes.  */
 extern bool bgp_adj_out_lookup(struct peer *peer, struct bgp_dest *dest,
 			       uint32_t addpath_tx_id);
@@ -149,6 +149,8 @@ extern void bgp_adj_in_set(struct bgp_dest *dest, struct peer *peer,
 extern bool bgp_adj_in_unset(struct bgp_dest *dest, struct peer *peer,
 			     uint32_t addpath_id);
 extern void bgp_adj_in_remove(struct bgp_dest *dest, struct bgp_adj_in *bai);
+/* Number of Adj-RIB-In entries, and memory used for them */
+extern void bgp_adj_in_stats(unsigned long *count, size_t *bytes);
 
 extern void bgp_sync_init(struct peer *peer);
 extern void bgp_sync_delete(struct peer *peer);
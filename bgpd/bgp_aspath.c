@@ -668,6 +668,24 @@ void aspath_str_update(struct aspath *as, bool make_json)
 	aspath_make_str_count(as, make_json);
 }
 
+static uint32_t aspath_hash_compute(const struct aspath *aspath)
+{
+	if (!aspath->str)
+		aspath_str_update((struct aspath *)aspath, false);
+
+	return jhash(aspath->str, aspath->str_len, 2334325);
+}
+
+/* Next serial number of interned AS paths, 0 is never used */
+static uint32_t aspath_serial_next(void)
+{
+	static uint32_t serial;
+
+	if (++serial == 0)
+		serial = 1;
+	return serial;
+}
+
 /* Intern allocated AS path. */
 struct aspath *aspath_intern(struct aspath *aspath)
 {
@@ -679,9 +697,12 @@ struct aspath *aspath_intern(struct aspath *aspath)
 	assert(aspath->str);
 
 	/* Check AS path hash. */
+	aspath->hash = aspath_hash_compute(aspath);
 	find = hash_get(ashash, aspath, hash_alloc_intern);
 	if (find != aspath)
 		aspath_free(aspath);
+	else
+		aspath->serial = aspath_serial_next();
 
 	find->refcnt++;
 
@@ -733,6 +754,8 @@ static void *aspath_hash_alloc(void *arg)
 	new->str = aspath->str;
 	new->str_len = aspath->str_len;
 	new->json = aspath->json;
+	new->hash = aspath->hash;
+	new->serial = aspath_serial_next();
 
 	return new;
 }
@@ -859,6 +882,7 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		return NULL;
 
 	/* If already same aspath exist then return it. */
+	as.hash = aspath_hash_compute(&as);
 	find = hash_get(ashash, &as, aspath_hash_alloc);
 
 	/* if the aspath was already hashed free temporary memory. */
@@ -877,6 +901,57 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 	return find;
 }
 
+/* Decode an AS path into a standalone, not yet interned structure.
+ *
+ * This only touches the given stream and newly allocated memory, so unlike
+ * aspath_parse() it may be called from any pthread.  The result is either
+ * handed to aspath_intern_prepared() or released with aspath_free().
+ *
+ * On error NULL is returned.
+ */
+struct aspath *aspath_parse_prepare(struct stream *s, size_t length,
+				    int use32bit)
+{
+	struct aspath *as;
+
+	if (length % AS16_VALUE_SIZE)
+		return NULL;
+
+	as = aspath_new();
+	if (assegments_parse(s, length, &as->segments, use32bit) < 0) {
+		XFREE(MTYPE_AS_PATH, as);
+		return NULL;
+	}
+
+	/* this is the expensive part of hashing an aspath */
+	aspath_str_update(as, false);
+
+	return as;
+}
+
+/* Intern an aspath built by aspath_parse_prepare(), consuming it. */
+struct aspath *aspath_intern_prepared(struct aspath *as)
+{
+	struct aspath *find;
+
+	assert(as->refcnt == 0);
+
+	as->hash = aspath_hash_compute(as);
+	find = hash_get(ashash, as, aspath_hash_alloc);
+
+	/* segments and string are either owned by the hash entry now, or
+	 * an identical aspath was already interned.
+	 */
+	if (find->refcnt)
+		aspath_free(as);
+	else
+		XFREE(MTYPE_AS_PATH, as);
+
+	find->refcnt++;
+
+	return find;
+}
+
 static void assegment_data_put(struct stream *s, as_t *as, int num,
 			       int use32bit)
 {
@@ -2038,14 +2113,11 @@ struct aspath *aspath_str2aspath(const char *str)
 unsigned int aspath_key_make(const void *p)
 {
 	const struct aspath *aspath = p;
-	unsigned int key = 0;
 
-	if (!aspath->str)
-		aspath_str_update((struct aspath *)aspath, false);
-
-	key = jhash(aspath->str, aspath->str_len, 2334325);
+	if (aspath->hash)
+		return aspath->hash;
 
-	return key;
+	return aspath_hash_compute(aspath);
 }
 
 /* If two aspath have same value then return 1 else return 0 */
@@ -2054,6 +2126,9 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 	const struct assegment *seg1 = ((const struct aspath *)arg1)->segments;
 	const struct assegment *seg2 = ((const struct aspath *)arg2)->segments;
 
+	if (arg1 == arg2)
+		return true;
+
 	while (seg1 || seg2) {
 		int i;
 		if ((!seg1 && seg2) || (seg1 && !seg2))
@@ -72,6 +72,14 @@ struct aspath {
 	   and AS path regular expression match.  */
 	char *str;
 	unsigned short str_len;
+
+	/* Hash of the AS path, cached while it is interned, 0 otherwise */
+	uint32_t hash;
+
+	/* Number given to the AS path when it is interned, 0 otherwise.
+	   Unlike the address, it is not soon reused for another AS path
+	   once this one is freed, so it can key caches of match results.  */
+	uint32_t serial;
 };
 
 #define ASPATH_STR_DEFAULT_LEN 32
@@ -81,6 +89,9 @@ extern void aspath_init(void);
 extern void aspath_finish(void);
 extern struct aspath *aspath_parse(struct stream *s, size_t length,
 				   int use32bit);
+extern struct aspath *aspath_parse_prepare(struct stream *s, size_t length,
+					   int use32bit);
+extern struct aspath *aspath_intern_prepared(struct aspath *as);
 extern struct aspath *aspath_dup(struct aspath *aspath);
 extern struct aspath *aspath_aggregate(struct aspath *as1, struct aspath *as2);
 extern struct aspath *aspath_prepend(struct aspath *as1, struct aspath *as2);
@@ -33,6 +33,7 @@
 #include "filter.h"
 #include "command.h"
 #include "srv6.h"
+#include "thread.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_attr.h"
@@ -47,6 +48,7 @@
 #include "bgpd/bgp_lcommunity.h"
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_encap_types.h"
+#include "bgpd/bgp_preparse.h"
 #ifdef ENABLE_BGP_VNC
 #include "bgpd/rfapi/bgp_rfapi_cfg.h"
 #include "bgp_encap_types.h"
@@ -96,6 +98,11 @@ static const struct message attr_flag_str[] = {
 
 static struct hash *cluster_hash;
 
+static uint32_t cluster_hash_compute(const struct cluster_list *cluster)
+{
+	return jhash(cluster->list, cluster->length, 0);
+}
+
 static void *cluster_hash_alloc(void *p)
 {
 	const struct cluster_list *val = (const struct cluster_list *)p;
@@ -103,6 +110,7 @@ static void *cluster_hash_alloc(void *p)
 
 	cluster = XMALLOC(MTYPE_CLUSTER, sizeof(struct cluster_list));
 	cluster->length = val->length;
+	cluster->hash = val->hash;
 
 	if (cluster->length) {
 		cluster->list = XMALLOC(MTYPE_CLUSTER_VAL, val->length);
@@ -123,6 +131,7 @@ static struct cluster_list *cluster_parse(struct in_addr *pnt, int length)
 
 	tmp.length = length;
 	tmp.list = length == 0 ? NULL : pnt;
+	tmp.hash = cluster_hash_compute(&tmp);
 
 	cluster = hash_get(cluster_hash, &tmp, cluster_hash_alloc);
 	cluster->refcnt++;
@@ -143,7 +152,10 @@ static unsigned int cluster_hash_key_make(const void *p)
 {
 	const struct cluster_list *cluster = p;
 
-	return jhash(cluster->list, cluster->length, 0);
+	if (cluster->hash)
+		return cluster->hash;
+
+	return cluster_hash_compute(cluster);
 }
 
 static bool cluster_hash_cmp(const void *p1, const void *p2)
@@ -173,6 +185,7 @@ static struct cluster_list *cluster_intern(struct cluster_list *cluster)
 {
 	struct cluster_list *find;
 
+	cluster->hash = cluster_hash_compute(cluster);
 	find = hash_get(cluster_hash, cluster, cluster_hash_alloc);
 	find->refcnt++;
 
@@ -396,17 +409,140 @@ static void encap_finish(void)
 #endif
 }
 
-static bool overlay_index_same(const struct attr *a1, const struct attr *a2)
+/* EVPN attributes. */
+static struct hash *evpn_hash;
+static struct list *evpn_reap_list;
+static struct thread *t_evpn_reap;
+
+const struct bgp_attr_evpn bgp_attr_evpn_none;
+
+static unsigned int evpn_hash_key_make(const void *p)
 {
-	if (!a1 && a2)
-		return false;
-	if (!a2 && a1)
-		return false;
-	if (!a1 && !a2)
-		return true;
+	const struct bgp_attr_evpn *evpn = p;
+	const struct ipaddr *gw_ip = &evpn->overlay.gw_ip;
+	uint32_t key;
+
+	key = jhash(&evpn->esi, sizeof(esi_t), 0);
+	key = jhash(&evpn->rmac, sizeof(struct ethaddr), key);
+	key = jhash_3words(evpn->mm_seqnum, evpn->mm_sync_seqnum,
+			   evpn->df_pref | evpn->df_alg << 16, key);
+	key = jhash_3words(evpn->sticky | evpn->default_gw << 8
+				   | evpn->router_flag << 16,
+			   evpn->overlay.type, gw_ip->ipa_type, key);
+	key = jhash(&evpn->overlay.eth_s_id, sizeof(esi_t), key);
+	if (IS_IPADDR_V4(gw_ip))
+		key = jhash_1word(gw_ip->ipaddr_v4.s_addr, key);
+	else if (IS_IPADDR_V6(gw_ip))
+		key = jhash(&gw_ip->ipaddr_v6, sizeof(struct in6_addr), key);
+
+	return key;
+}
+
+static bool evpn_hash_cmp(const void *p1, const void *p2)
+{
+	const struct bgp_attr_evpn *evpn1 = p1;
+	const struct bgp_attr_evpn *evpn2 = p2;
+
+	return bgp_route_evpn_same(&evpn1->overlay, &evpn2->overlay)
+	       && !memcmp(&evpn1->esi, &evpn2->esi, sizeof(esi_t))
+	       && !memcmp(&evpn1->rmac, &evpn2->rmac, sizeof(struct ethaddr))
+	       && evpn1->mm_seqnum == evpn2->mm_seqnum
+	       && evpn1->mm_sync_seqnum == evpn2->mm_sync_seqnum
+	       && evpn1->df_pref == evpn2->df_pref
+	       && evpn1->df_alg == evpn2->df_alg
+	       && evpn1->sticky == evpn2->sticky
+	       && evpn1->default_gw == evpn2->default_gw
+	       && evpn1->router_flag == evpn2->router_flag;
+}
+
+static void evpn_free(struct bgp_attr_evpn *evpn)
+{
+	XFREE(MTYPE_BGP_EVPN_ATTR, evpn);
+}
+
+static void evpn_reap(struct thread *thread)
+{
+	struct bgp_attr_evpn *evpn;
+
+	while ((evpn = listnode_head(evpn_reap_list))) {
+		list_delete_node(evpn_reap_list, listhead(evpn_reap_list));
+		evpn->reap = false;
+
+		if (!evpn->refcnt) {
+			hash_release(evpn_hash, evpn);
+			evpn_free(evpn);
+		}
+	}
+}
+
+/*
+ * Entries without references are not freed right away, struct attrs that
+ * are being worked on may still point at them.  Nothing holds on to such
+ * an attr across events, so they can go once the current event is done.
+ */
+static void evpn_reap_queue(struct bgp_attr_evpn *evpn)
+{
+	if (evpn->reap)
+		return;
+
+	evpn->reap = true;
+	listnode_add(evpn_reap_list, evpn);
+
+	if (bm && bm->master)
+		thread_add_event(bm->master, evpn_reap, NULL, 0, &t_evpn_reap);
+}
+
+static void *evpn_hash_alloc(void *p)
+{
+	struct bgp_attr_evpn *evpn;
+
+	evpn = XMALLOC(MTYPE_BGP_EVPN_ATTR, sizeof(struct bgp_attr_evpn));
+	memcpy(evpn, p, sizeof(struct bgp_attr_evpn));
+	evpn->refcnt = 0;
+	evpn->reap = false;
+	evpn->key = evpn_hash_key_make(evpn);
+	evpn_reap_queue(evpn);
+
+	return evpn;
+}
+
+void bgp_attr_set_evpn(struct attr *attr, const struct bgp_attr_evpn *evpn)
+{
+	if (evpn_hash_cmp(evpn, &bgp_attr_evpn_none)) {
+		attr->evpn = NULL;
+		return;
+	}
+
+	attr->evpn = hash_get(evpn_hash, (void *)evpn, evpn_hash_alloc);
+}
+
+static void evpn_unintern(struct bgp_attr_evpn *evpn)
+{
+	assert(evpn->refcnt);
 
-	return bgp_route_evpn_same(bgp_attr_get_evpn_overlay(a1),
-				   bgp_attr_get_evpn_overlay(a2));
+	if (!--evpn->refcnt)
+		evpn_reap_queue(evpn);
+}
+
+unsigned long int attr_evpn_count(void)
+{
+	return evpn_hash->count;
+}
+
+static void evpn_init(void)
+{
+	evpn_hash = hash_create(evpn_hash_key_make, evpn_hash_cmp,
+				"BGP EVPN attributes");
+	evpn_reap_list = list_new();
+}
+
+static void evpn_finish(void)
+{
+	THREAD_OFF(t_evpn_reap);
+	list_delete(&evpn_reap_list);
+	hash_clean(evpn_hash, (void (*)(void *))evpn_free);
+	hash_free(evpn_hash);
+	evpn_hash = NULL;
 }
 
 /* Unknown transit attribute. */
@@ -424,10 +560,16 @@ static void *transit_hash_alloc(void *p)
 	return p;
 }
 
+static uint32_t transit_hash_compute(const struct transit *transit)
+{
+	return jhash(transit->val, transit->length, 0);
+}
+
 static struct transit *transit_intern(struct transit *transit)
 {
 	struct transit *find;
 
+	transit->hash = transit_hash_compute(transit);
 	find = hash_get(transit_hash, transit, transit_hash_alloc);
 	if (find != transit)
 		transit_free(transit);
@@ -616,7 +758,10 @@ static unsigned int transit_hash_key_make(const void *p)
 {
 	const struct transit *transit = p;
 
-	return jhash(transit->val, transit->length, 0);
+	if (transit->hash)
+		return transit->hash;
+
+	return transit_hash_compute(transit);
 }
 
 static bool transit_hash_cmp(const void *p1, const void *p2)
@@ -624,6 +769,9 @@ static bool transit_hash_cmp(const void *p1, const void *p2)
 	const struct transit *transit1 = p1;
 	const struct transit *transit2 = p2;
 
+	if (transit1 == transit2)
+		return true;
+
 	return (transit1->length == transit2->length
 		&& memcmp(transit1->val, transit2->val, transit1->length) == 0);
 }
@@ -699,6 +847,9 @@ unsigned int attrhash_key_make(const void *p)
 	key = jhash(attr->mp_nexthop_local.s6_addr, IPV6_MAX_BYTELEN, key);
 	MIX3(attr->nh_ifindex, attr->nh_lla_ifindex, attr->distance);
 	MIX(attr->rmap_table_id);
+	/* interned, so equal entries are the same, see attrhash_cmp() */
+	if (attr->evpn)
+		MIX(attr->evpn->key);
 	MIX(attr->nh_type);
 	MIX(attr->bh_type);
 	MIX(attr->otc);
@@ -751,12 +902,8 @@ bool attrhash_cmp(const void *p1, const void *p2)
 				      &attr2->mp_nexthop_global_in)
 		    && IPV4_ADDR_SAME(&attr1->originator_id,
 				      &attr2->originator_id)
-		    && overlay_index_same(attr1, attr2)
-		    && !memcmp(&attr1->esi, &attr2->esi, sizeof(esi_t))
+		    && attr1->evpn == attr2->evpn
 		    && attr1->es_flags == attr2->es_flags
-		    && attr1->mm_sync_seqnum == attr2->mm_sync_seqnum
-		    && attr1->df_pref == attr2->df_pref
-		    && attr1->df_alg == attr2->df_alg
 		    && attr1->nh_ifindex == attr2->nh_ifindex
 		    && attr1->nh_lla_ifindex == attr2->nh_lla_ifindex
 		    && attr1->distance == attr2->distance
@@ -819,6 +966,16 @@ void attr_show_all(struct vty *vty)
 		     vty);
 }
 
+/* Next serial number of interned attributes, 0 is never used */
+static uint32_t bgp_attr_serial_next(void)
+{
+	static uint32_t serial;
+
+	if (++serial == 0)
+		serial = 1;
+	return serial;
+}
+
 static void *bgp_attr_hash_alloc(void *p)
 {
 	struct attr *val = (struct attr *)p;
@@ -838,9 +995,16 @@ static void *bgp_attr_hash_alloc(void *p)
 #endif
 
 	attr->refcnt = 0;
+	attr->serial = bgp_attr_serial_next();
+	attr->interned = attr;
 	return attr;
 }
 
+const struct attr *bgp_attr_lookup(const struct attr *attr)
+{
+	return hash_lookup(attrhash, (void *)attr);
+}
+
 /* Internet argument attribute. */
 struct attr *bgp_attr_intern(struct attr *attr)
 {
@@ -927,6 +1091,13 @@ struct attr *bgp_attr_intern(struct attr *attr)
 		else
 			attr->srv6_vpn->refcnt++;
 	}
+	if (attr->evpn) {
+		/* An unreferenced entry is only kept until the end of the
+		 * event, see struct bgp_attr_evpn.
+		 */
+		assert(attr->evpn->refcnt || attr->evpn->reap);
+		attr->evpn->refcnt++;
+	}
 #ifdef ENABLE_BGP_VNC
 	struct bgp_attr_encap_subtlv *vnc_subtlvs =
 		bgp_attr_get_vnc_subtlvs(attr);
@@ -1166,6 +1337,10 @@ void bgp_attr_unintern(struct attr **pattr)
 		*pattr = NULL;
 	}
 
+	/* only interned attrs hold a reference, see struct bgp_attr_evpn */
+	if (tmp.evpn)
+		evpn_unintern(tmp.evpn);
+
 	bgp_attr_unintern_sub(&tmp);
 }
 
@@ -1501,10 +1676,15 @@ static int bgp_attr_aspath(struct bgp_attr_parser_args *args)
 	 * peer with AS4 => will get 4Byte ASnums
 	 * otherwise, will get 16 Bit
 	 */
-	attr->aspath = aspath_parse(
-		peer->curr, length,
-		CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV)
-			&& CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV));
+	bool use32bit = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV)
+			&& CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	/* may have been decoded already by a pre-parse pthread */
+	attr->aspath = bgp_preparse_aspath(peer, length, use32bit);
+	if (attr->aspath)
+		stream_forward_getp(peer->curr, length);
+	else
+		attr->aspath = aspath_parse(peer->curr, length, use32bit);
 
 	/* In case of IBGP, length will be zero. */
 	if (!attr->aspath) {
@@ -1974,9 +2154,12 @@ bgp_attr_community(struct bgp_attr_parser_args *args)
 					  args->total);
 	}
 
-	bgp_attr_set_community(
-		attr,
-		community_parse((uint32_t *)stream_pnt(peer->curr), length));
+	struct community *community = bgp_preparse_community(peer, length);
+
+	if (!community)
+		community = community_parse((uint32_t *)stream_pnt(peer->curr),
+					    length);
+	bgp_attr_set_community(attr, community);
 
 	/* XXX: fix community_parse to use stream API and remove this */
 	stream_forward_getp(peer->curr, length);
@@ -2330,6 +2513,7 @@ bgp_attr_ext_communities(struct bgp_attr_parser_args *args)
 	uint8_t sticky = 0;
 	bool proxy = false;
 	struct ecommunity *ecomm;
+	struct bgp_attr_evpn evpn;
 
 	if (length == 0) {
 		bgp_attr_set_ecommunity(attr, NULL);
@@ -2353,36 +2537,40 @@ bgp_attr_ext_communities(struct bgp_attr_parser_args *args)
 		return bgp_attr_malformed(args, BGP_NOTIFY_UPDATE_OPT_ATTR_ERR,
 					  args->total);
 
+	evpn = *bgp_attr_get_evpn(attr);
+
 	/* Extract DF election preference and  mobility sequence number */
-	attr->df_pref = bgp_attr_df_pref_from_ec(attr, &attr->df_alg);
+	evpn.df_pref = bgp_attr_df_pref_from_ec(attr, &evpn.df_alg);
 
 	/* Extract MAC mobility sequence number, if any. */
-	attr->mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
-	attr->sticky = sticky;
+	evpn.mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
+	evpn.sticky = sticky;
 
 	/* Check if this is a Gateway MAC-IP advertisement */
-	attr->default_gw = bgp_attr_default_gw(attr);
+	evpn.default_gw = bgp_attr_default_gw(attr);
 
 	/* Handle scenario where router flag ecommunity is not
 	 * set but default gw ext community is present.
 	 * Use default gateway, set and propogate R-bit.
 	 */
-	if (attr->default_gw)
-		attr->router_flag = 1;
+	if (evpn.default_gw)
+		evpn.router_flag = 1;
 
 	/* Check EVPN Neighbor advertisement flags, R-bit */
-	bgp_attr_evpn_na_flag(attr, &attr->router_flag, &proxy);
+	bgp_attr_evpn_na_flag(attr, &evpn.router_flag, &proxy);
 	if (proxy)
 		attr->es_flags |= ATTR_ES_PROXY_ADVERT;
 
 	/* Extract the Rmac, if any */
-	if (bgp_attr_rmac(attr, &attr->rmac)) {
+	if (bgp_attr_rmac(attr, &evpn.rmac)) {
 		if (bgp_debug_update(peer, NULL, NULL, 1)
-		    && bgp_mac_exist(&attr->rmac))
+		    && bgp_mac_exist(&evpn.rmac))
 			zlog_debug("%s: router mac %pEA is self mac", __func__,
-				   &attr->rmac);
+				   &evpn.rmac);
 	}
 
+	bgp_attr_set_evpn(attr, &evpn);
+
 	/* Get the tunnel type from encap extended community */
 	bgp_attr_extcom_tunnel_type(attr,
 		(bgp_encap_types *)&attr->encap_tunneltype);
@@ -4524,6 +4712,7 @@ void bgp_attr_init(void)
 	transit_init();
 	encap_init();
 	srv6_init();
+	evpn_init();
 }
 
 void bgp_attr_finish(void)
@@ -4537,6 +4726,7 @@ void bgp_attr_finish(void)
 	transit_finish();
 	encap_finish();
 	srv6_finish();
+	evpn_finish();
 }
 
 /* Make attribute packet. */
@@ -159,6 +159,63 @@ struct bgp_attr_srv6_l3vpn {
 	uint8_t transposition_offset;
 };
 
+/*
+ * Attributes that only EVPN routes carry.  They are kept out of struct attr
+ * so that the common case does not pay for them, and are interned so that
+ * routes with the same values share one copy.
+ *
+ * Unlike the other interned sub-structures, these are only referenced by
+ * interned attrs; a struct attr that is being built merely points at one.
+ * Entries nobody holds on to any more are freed from the event loop, which
+ * makes it safe to keep working on such a copy until the current event is
+ * done.
+ *
+ * This relies on a non-interned struct attr (a copy on the stack, a
+ * route-map scratch attr, ...) never outliving the event it was made in
+ * with its evpn pointer still set: it must be interned or dropped before
+ * returning to the event loop. bgp_attr_intern() asserts that the entry
+ * is still referenced or pending reaping, which catches most violations.
+ */
+struct bgp_attr_evpn {
+	unsigned long refcnt;
+	/* queued for freeing once the current event is done */
+	bool reap;
+	/* hash of the values below, for the attr hash */
+	unsigned int key;
+
+	/* overlay index */
+	struct bgp_route_evpn overlay;
+
+	/* ES */
+	esi_t esi;
+
+	/* local router-mac */
+	struct ethaddr rmac;
+
+	/* MAC Mobility sequence number, if any. */
+	uint32_t mm_seqnum;
+	/* highest MM sequence number rxed in a MAC-IP route from an
+	 * ES peer (this includes both proxy and non-proxy MAC-IP
+	 * advertisements from ES peers).
+	 * This is only applicable to local paths in the VNI routing
+	 * table and derived from other imported/non-best paths.
+	 */
+	uint32_t mm_sync_seqnum;
+
+	/* DF preference and algorithm for DF election on local ESs */
+	uint16_t df_pref;
+	uint8_t df_alg;
+
+	/* Static MAC */
+	uint8_t sticky;
+
+	/* Flag for default gateway extended community */
+	uint8_t default_gw;
+
+	/* NA router flag (R-bit) support */
+	uint8_t router_flag;
+};
+
 /* BGP core attribute structure. */
 struct attr {
 	/* AS Path structure */
@@ -231,15 +288,6 @@ struct attr {
 	/* MP Nexthop preference */
 	uint8_t mp_nexthop_prefer_global;
 
-	/* Static MAC for EVPN */
-	uint8_t sticky;
-
-	/* Flag for default gateway extended community in EVPN */
-	uint8_t default_gw;
-
-	/* NA router flag (R-bit) support in EVPN */
-	uint8_t router_flag;
-
 	/* ES info */
 	uint8_t es_flags;
 	/* Path is not "locally-active" on the advertising VTEP. This is
@@ -273,6 +321,9 @@ struct attr {
 #define ATTR_ES_L3_NHG_ACTIVE (1 << 6)
 #define ATTR_ES_L3_NHG (ATTR_ES_L3_NHG_USE | ATTR_ES_L3_NHG_ACTIVE)
 
+	/* Distance as applied by Route map */
+	uint8_t distance;
+
 	/* route tag */
 	route_tag_t tag;
 
@@ -289,29 +340,20 @@ struct attr {
 	struct bgp_attr_srv6_l3vpn *srv6_l3vpn;
 
 	uint16_t encap_tunneltype;		     /* grr */
+
+	/* Serial number of the interned attribute, set when interning */
+	uint32_t serial;
+
+	/* The interned attribute, copies of it keep pointing to it */
+	const struct attr *interned;
+
 	struct bgp_attr_encap_subtlv *encap_subtlvs; /* rfc5512 */
 
 #ifdef ENABLE_BGP_VNC
 	struct bgp_attr_encap_subtlv *vnc_subtlvs; /* VNC-specific */
 #endif
-	/* EVPN */
-	struct bgp_route_evpn evpn_overlay;
-
-	/* EVPN MAC Mobility sequence number, if any. */
-	uint32_t mm_seqnum;
-	/* highest MM sequence number rxed in a MAC-IP route from an
-	 * ES peer (this includes both proxy and non-proxy MAC-IP
-	 * advertisements from ES peers).
-	 * This is only applicable to local paths in the VNI routing
-	 * table and derived from other imported/non-best paths.
-	 */
-	uint32_t mm_sync_seqnum;
-
-	/* EVPN local router-mac */
-	struct ethaddr rmac;
-
-	/* Distance as applied by Route map */
-	uint8_t distance;
+	/* EVPN attributes, NULL if the route has none of them */
+	struct bgp_attr_evpn *evpn;
 
 	/* rmap set table */
 	uint32_t rmap_table_id;
@@ -319,16 +361,9 @@ struct attr {
 	/* Link bandwidth value, if any. */
 	uint32_t link_bw;
 
-	/* EVPN ES */
-	esi_t esi;
-
 	/* SR-TE Color */
 	uint32_t srte_color;
 
-	/* EVPN DF preference and algorithm for DF election on local ESs */
-	uint16_t df_pref;
-	uint8_t df_alg;
-
 	/* Nexthop type */
 	enum nexthop_types_t nh_type;
 
@@ -354,6 +389,8 @@ struct attr {
 struct cluster_list {
 	unsigned long refcnt;
 	int length;
+	/* hash of the value, cached while interned, 0 otherwise */
+	uint32_t hash;
 	struct in_addr *list;
 };
 
@@ -361,6 +398,8 @@ struct cluster_list {
 struct transit {
 	unsigned long refcnt;
 	int length;
+	/* hash of the value, cached while interned, 0 otherwise */
+	uint32_t hash;
 	uint8_t *val;
 };
 
@@ -396,6 +435,8 @@ bgp_attr_parse(struct peer *peer, struct attr *attr, bgp_size_t size,
 extern struct attr *bgp_attr_intern(struct attr *attr);
 extern void bgp_attr_unintern_sub(struct attr *attr);
 extern void bgp_attr_unintern(struct attr **pattr);
+/* The interned attribute equal to attr, NULL if there is none */
+extern const struct attr *bgp_attr_lookup(const struct attr *attr);
 extern void bgp_attr_flush(struct attr *attr);
 extern struct attr *bgp_attr_default_set(struct attr *attr, struct bgp *bgp,
 					 uint8_t origin);
@@ -419,6 +460,7 @@ extern unsigned int attrhash_key_make(const void *p);
 extern void attr_show_all(struct vty *vty);
 extern unsigned long int attr_count(void);
 extern unsigned long int attr_unknown_count(void);
+extern unsigned long int attr_evpn_count(void);
 
 /* Cluster list prototypes. */
 extern bool cluster_loop_check(struct cluster_list *cluster,
@@ -480,6 +522,12 @@ extern void bgp_packet_mpunreach_end(struct stream *s, size_t attrlen_pnt);
 extern enum bgp_attr_parse_ret bgp_attr_nexthop_valid(struct peer *peer,
 						      struct attr *attr);
 
+/* attr is an interned attribute, not a copy of one */
+static inline bool bgp_attr_is_interned(const struct attr *attr)
+{
+	return attr->refcnt && attr->interned == attr;
+}
+
 static inline int bgp_rmap_nhop_changed(uint32_t out_rmap_flags,
 					uint32_t in_rmap_flags)
 {
@@ -496,9 +544,32 @@ static inline int bgp_rmap_nhop_changed(uint32_t out_rmap_flags,
 			: 0);
 }
 
+extern const struct bgp_attr_evpn bgp_attr_evpn_none;
+
+/* Never NULL, an attr without EVPN attributes returns all zeroes */
+static inline const struct bgp_attr_evpn *
+bgp_attr_get_evpn(const struct attr *attr)
+{
+	return attr->evpn ? attr->evpn : &bgp_attr_evpn_none;
+}
+
+/*
+ * Replaces attr's EVPN attributes with a copy of evpn.  The usual way to
+ * change them is
+ *
+ *     struct bgp_attr_evpn evpn = *bgp_attr_get_evpn(attr);
+ *
+ *     evpn.sticky = 1;
+ *     bgp_attr_set_evpn(attr, &evpn);
+ *
+ * Must not be used on interned attrs.
+ */
+extern void bgp_attr_set_evpn(struct attr *attr,
+			      const struct bgp_attr_evpn *evpn);
+
 static inline uint32_t mac_mobility_seqnum(struct attr *attr)
 {
-	return (attr) ? attr->mm_seqnum : 0;
+	return (attr) ? bgp_attr_get_evpn(attr)->mm_seqnum : 0;
 }
 
 static inline enum pta_type bgp_attr_get_pmsi_tnl_type(struct attr *attr)
@@ -607,13 +678,16 @@ static inline void bgp_attr_set_cluster(struct attr *attr,
 static inline const struct bgp_route_evpn *
 bgp_attr_get_evpn_overlay(const struct attr *attr)
 {
-	return &attr->evpn_overlay;
+	return &bgp_attr_get_evpn(attr)->overlay;
 }
 
 static inline void bgp_attr_set_evpn_overlay(struct attr *attr,
-					     struct bgp_route_evpn *eo)
+					     const struct bgp_route_evpn *eo)
 {
-	memcpy(&attr->evpn_overlay, eo, sizeof(struct bgp_route_evpn));
+	struct bgp_attr_evpn evpn = *bgp_attr_get_evpn(attr);
+
+	memcpy(&evpn.overlay, eo, sizeof(struct bgp_route_evpn));
+	bgp_attr_set_evpn(attr, &evpn);
 }
 
 static inline struct bgp_attr_encap_subtlv *
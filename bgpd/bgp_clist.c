@@ -28,6 +28,7 @@
 #include "stream.h"
 #include "jhash.h"
 #include "frrstr.h"
+#include "typesafe.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_community.h"
@@ -38,6 +39,212 @@
 #include "bgpd/bgp_regex.h"
 #include "bgpd/bgp_clist.h"
 
+DEFINE_MTYPE_STATIC(BGPD, COMMUNITY_LIST_COMPILED, "community-list compiled");
+
+PREDECL_HASH(clist_values);
+
+/* Standard entry indexed by its first community value */
+struct clist_value {
+	struct clist_values_item item;
+
+	/* Next entry with the same first value, further down the list */
+	struct clist_value *next;
+
+	/* Position of the entry in the list */
+	unsigned int pos;
+
+	/* The entry only has this value, so it matches when it is present */
+	bool single;
+
+	uint8_t len;
+	uint8_t val[LCOMMUNITY_SIZE];
+};
+
+static int clist_values_cmp(const struct clist_value *a,
+			    const struct clist_value *b)
+{
+	if (a->len != b->len)
+		return numcmp(a->len, b->len);
+	return memcmp(a->val, b->val, a->len);
+}
+
+static uint32_t clist_values_hash(const struct clist_value *value)
+{
+	return jhash(value->val, value->len, 0x5a7e1d3c);
+}
+
+DECLARE_HASH(clist_values, struct clist_value, item, clist_values_cmp,
+	     clist_values_hash);
+
+/*
+ * A community-list is matched by finding the first entry that matches.
+ * Standard entries can only match if the attribute contains their first
+ * value, so they are found by looking up the values of the attribute.
+ * Only the entries that cannot be looked up this way, like expanded ones,
+ * are tried one by one, and only if they come before the entry found.
+ */
+struct community_list_compiled {
+	/* Entries in list order, up to the first one matching anything */
+	struct community_entry **entries;
+	unsigned int count;
+
+	/* Position of the entry matching anything, count if none */
+	unsigned int always;
+
+	/* Positions of the entries to try one by one, in order */
+	unsigned int *slow;
+	unsigned int slow_count;
+
+	struct clist_values_head values;
+	struct clist_value *value_array;
+
+	/* Size of one community value */
+	size_t unit_size;
+};
+
+static void community_list_compiled_free(struct community_list *list)
+{
+	struct community_list_compiled *cl = list->compiled;
+
+	if (!cl)
+		return;
+
+	while (clist_values_pop(&cl->values))
+		;
+	clist_values_fini(&cl->values);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, cl->entries);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, cl->slow);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, cl->value_array);
+	XFREE(MTYPE_COMMUNITY_LIST_COMPILED, list->compiled);
+}
+
+static struct community_list_compiled *
+community_list_compile(struct community_list *list, size_t unit_size)
+{
+	struct community_list_compiled *cl;
+	struct community_entry *entry;
+	struct clist_value *value, *prev;
+	const uint8_t *first;
+	unsigned int n = 0;
+	int size;
+
+	for (entry = list->head; entry; entry = entry->next)
+		n++;
+
+	cl = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED, sizeof(*cl));
+	cl->entries = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED,
+			      n * sizeof(*cl->entries));
+	cl->slow = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED,
+			   n * sizeof(*cl->slow));
+	cl->value_array = XCALLOC(MTYPE_COMMUNITY_LIST_COMPILED,
+				  n * sizeof(*cl->value_array));
+	clist_values_init(&cl->values);
+	cl->unit_size = unit_size;
+	cl->always = n;
+
+	for (entry = list->head; entry; entry = entry->next) {
+		cl->entries[cl->count] = entry;
+
+		if (entry->any) {
+			cl->always = cl->count++;
+			break;
+		}
+
+		first = NULL;
+		size = 0;
+		switch (entry->style) {
+		case COMMUNITY_LIST_STANDARD:
+			if (community_include(entry->u.com,
+					      COMMUNITY_INTERNET)) {
+				cl->always = cl->count;
+				break;
+			}
+			first = (const uint8_t *)entry->u.com->val;
+			size = entry->u.com->size;
+			break;
+		case LARGE_COMMUNITY_LIST_STANDARD:
+			first = entry->u.lcom->val;
+			size = entry->u.lcom->size;
+			break;
+		case EXTCOMMUNITY_LIST_STANDARD:
+			if (entry->u.ecom->unit_size != unit_size)
+				break;
+			first = entry->u.ecom->val;
+			size = entry->u.ecom->size;
+			break;
+		default:
+			break;
+		}
+
+		if (cl->always == cl->count) {
+			cl->count++;
+			break;
+		}
+
+		if (!first || size <= 0) {
+			cl->slow[cl->slow_count++] = cl->count++;
+			continue;
+		}
+
+		value = &cl->value_array[cl->count];
+		value->pos = cl->count++;
+		value->single = size == 1;
+		value->len = unit_size;
+		memcpy(value->val, first, unit_size);
+
+		prev = clist_values_add(&cl->values, value);
+		if (prev) {
+			while (prev->next)
+				prev = prev->next;
+			prev->next = value;
+		}
+	}
+
+	return cl;
+}
+
+/*
+ * Find the first entry of list matching an attribute, whose count values
+ * of unit_size are in vals.  entry_match() tells whether an entry matches.
+ */
+static struct community_entry *community_list_first_match(
+	struct community_list *list, const uint8_t *vals, int count,
+	size_t unit_size,
+	bool (*entry_match)(const void *attr, struct community_entry *entry),
+	const void *attr)
+{
+	struct community_list_compiled *cl;
+	struct clist_value lookup, *value;
+	unsigned int best, i;
+	int j;
+
+	if (!list->compiled)
+		list->compiled = community_list_compile(list, unit_size);
+	cl = list->compiled;
+
+	best = cl->always;
+
+	lookup.len = unit_size;
+	for (j = 0; j < count; j++) {
+		memcpy(lookup.val, vals + j * unit_size, unit_size);
+		for (value = clist_values_find(&cl->values, &lookup);
+		     value && value->pos < best; value = value->next)
+			if (value->single
+			    || entry_match(attr, cl->entries[value->pos])) {
+				best = value->pos;
+				break;
+			}
+	}
+
+	for (i = 0; i < cl->slow_count && cl->slow[i] < best; i++)
+		if (entry_match(attr, cl->entries[cl->slow[i]])) {
+			best = cl->slow[i];
+			break;
+		}
+
+	return best < cl->count ? cl->entries[best] : NULL;
+}
+
 /* Calculate new sequential number. */
 static int64_t bgp_clist_new_seq_get(struct community_list *list)
 {
@@ -291,6 +498,8 @@ static void community_list_delete(struct community_list_master *cm,
 	struct community_list_list *clist;
 	struct community_entry *entry, *next;
 
+	community_list_compiled_free(list);
+
 	for (entry = list->head; entry; entry = next) {
 		next = entry->next;
 		community_entry_free(entry);
@@ -322,6 +531,8 @@ static void community_list_entry_delete(struct community_list_master *cm,
 					struct community_list *list,
 					struct community_entry *entry)
 {
+	community_list_compiled_free(list);
+
 	if (entry->next)
 		entry->next->prev = entry->prev;
 	else
@@ -346,6 +557,8 @@ static void community_list_entry_replace(struct community_list *list,
 					 struct community_entry *replace,
 					 struct community_entry *entry)
 {
+	community_list_compiled_free(list);
+
 	if (replace->next) {
 		entry->next = replace->next;
 		replace->next->prev = entry;
@@ -374,6 +587,8 @@ static void community_list_entry_add(struct community_list *list,
 	struct community_entry *replace;
 	struct community_entry *point;
 
+	community_list_compiled_free(list);
+
 	/* Automatic assignment of seq no. */
 	if (entry->seq == COMMUNITY_SEQ_NUMBER_AUTO)
 		entry->seq = bgp_clist_new_seq_get(list);
@@ -665,25 +880,48 @@ static bool ecommunity_regexp_match(struct ecommunity *ecom, regex_t *reg)
 
 /* When given community attribute matches to the community-list return
    1 else return 0.  */
+static bool community_entry_match(const void *attr,
+				  struct community_entry *entry)
+{
+	struct community *com = (struct community *)attr;
+
+	if (entry->any)
+		return true;
+
+	if (entry->style == COMMUNITY_LIST_STANDARD)
+		return community_include(entry->u.com, COMMUNITY_INTERNET)
+		       || community_match(com, entry->u.com);
+	else if (entry->style == COMMUNITY_LIST_EXPANDED)
+		return community_regexp_match(com, entry->reg);
+
+	return false;
+}
+
 bool community_list_match(struct community *com, struct community_list *list)
 {
 	struct community_entry *entry;
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
+	entry = community_list_first_match(
+		list, com ? (const uint8_t *)com->val : NULL,
+		com ? com->size : 0, COMMUNITY_SIZE, community_entry_match,
+		com);
 
-		if (entry->style == COMMUNITY_LIST_STANDARD) {
-			if (community_include(entry->u.com, COMMUNITY_INTERNET))
-				return entry->direct == COMMUNITY_PERMIT;
+	return entry && entry->direct == COMMUNITY_PERMIT;
+}
+
+static bool lcommunity_entry_match(const void *attr,
+				   struct community_entry *entry)
+{
+	struct lcommunity *lcom = (struct lcommunity *)attr;
+
+	if (entry->any)
+		return true;
+
+	if (entry->style == LARGE_COMMUNITY_LIST_STANDARD)
+		return lcommunity_match(lcom, entry->u.lcom);
+	else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED)
+		return lcommunity_regexp_match(lcom, entry->reg);
 
-			if (community_match(com, entry->u.com))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == COMMUNITY_LIST_EXPANDED) {
-			if (community_regexp_match(com, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
-		}
-	}
 	return false;
 }
 
@@ -691,19 +929,11 @@ bool lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
 {
 	struct community_entry *entry;
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
+	entry = community_list_first_match(
+		list, lcom ? lcom->val : NULL, lcom ? lcom->size : 0,
+		LCOMMUNITY_SIZE, lcommunity_entry_match, lcom);
 
-		if (entry->style == LARGE_COMMUNITY_LIST_STANDARD) {
-			if (lcommunity_match(lcom, entry->u.lcom))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED) {
-			if (lcommunity_regexp_match(lcom, entry->reg))
-				return entry->direct == COMMUNITY_PERMIT;
-		}
-	}
-	return false;
+	return entry && entry->direct == COMMUNITY_PERMIT;
 }
 
 
@@ -730,23 +960,41 @@ bool lcommunity_list_exact_match(struct lcommunity *lcom,
 	return false;
 }
 
+static bool ecommunity_entry_match(const void *attr,
+				   struct community_entry *entry)
+{
+	struct ecommunity *ecom = (struct ecommunity *)attr;
+
+	if (entry->any)
+		return true;
+
+	if (entry->style == EXTCOMMUNITY_LIST_STANDARD)
+		return ecommunity_match(ecom, entry->u.ecom);
+	else if (entry->style == EXTCOMMUNITY_LIST_EXPANDED)
+		return ecommunity_regexp_match(ecom, entry->reg);
+
+	return false;
+}
+
 bool ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
 {
 	struct community_entry *entry;
 
-	for (entry = list->head; entry; entry = entry->next) {
-		if (entry->any)
-			return entry->direct == COMMUNITY_PERMIT;
-
-		if (entry->style == EXTCOMMUNITY_LIST_STANDARD) {
-			if (ecommunity_match(ecom, entry->u.ecom))
-				return entry->direct == COMMUNITY_PERMIT;
-		} else if (entry->style == EXTCOMMUNITY_LIST_EXPANDED) {
-			if (ecommunity_regexp_match(ecom, entry->reg))
+	/* Values of another size are compared differently, and not looked
+	 * up.
+	 */
+	if (ecom && ecom->unit_size != ECOMMUNITY_SIZE) {
+		for (entry = list->head; entry; entry = entry->next)
+			if (ecommunity_entry_match(ecom, entry))
 				return entry->direct == COMMUNITY_PERMIT;
-		}
+		return false;
 	}
-	return false;
+
+	entry = community_list_first_match(
+		list, ecom ? ecom->val : NULL, ecom ? ecom->size : 0,
+		ECOMMUNITY_SIZE, ecommunity_entry_match, ecom);
+
+	return entry && entry->direct == COMMUNITY_PERMIT;
 }
 
 /* Perform exact matching.  In case of expanded community-list, do
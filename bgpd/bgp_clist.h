@@ -67,6 +67,11 @@ struct community_list {
 	/* Community-list entry in this community-list.  */
 	struct community_entry *head;
 	struct community_entry *tail;
+
+	/* Entries prepared for matching, built when first needed and
+	 * dropped when the list changes.
+	 */
+	struct community_list_compiled *compiled;
 };
 
 /* Each entry in community-list.  */
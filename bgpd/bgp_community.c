@@ -469,6 +469,11 @@ static void set_community_string(struct community *com, bool make_json,
 	com->str = str;
 }
 
+static uint32_t community_hash_compute(const struct community *com)
+{
+	return jhash2(com->val, com->size, 0x43ea96c1);
+}
+
 /* Intern communities attribute.  */
 struct community *community_intern(struct community *com)
 {
@@ -478,6 +483,7 @@ struct community *community_intern(struct community *com)
 	assert(com->refcnt == 0);
 
 	/* Lookup community hash. */
+	com->hash = community_hash_compute(com);
 	find = (struct community *)hash_get(comhash, com, hash_alloc_intern);
 
 	/* Arguemnt com is allocated temporary.  So when it is not used in
@@ -535,6 +541,23 @@ struct community *community_parse(uint32_t *pnt, unsigned short length)
 	return community_intern(new);
 }
 
+/* Like community_parse(), but leaves the result un-interned so that it can
+ * be built outside of the main pthread.  Hand it to community_intern() or
+ * community_free() afterwards.
+ */
+struct community *community_parse_prepare(uint32_t *pnt, unsigned short length)
+{
+	struct community tmp;
+
+	if (!length || length % COMMUNITY_SIZE)
+		return NULL;
+
+	tmp.size = length / COMMUNITY_SIZE;
+	tmp.val = pnt;
+
+	return community_uniq_sort(&tmp);
+}
+
 struct community *community_dup(struct community *com)
 {
 	struct community *new;
@@ -568,9 +591,10 @@ char *community_str(struct community *com, bool make_json, bool translate_alias)
    hash package.*/
 unsigned int community_hash_make(const struct community *com)
 {
-	uint32_t *pnt = com->val;
+	if (com->hash)
+		return com->hash;
 
-	return jhash2(pnt, com->size, 0x43ea96c1);
+	return community_hash_compute(com);
 }
 
 bool community_match(const struct community *com1, const struct community *com2)
@@ -602,7 +626,7 @@ bool community_match(const struct community *com1, const struct community *com2)
 
 bool community_cmp(const struct community *com1, const struct community *com2)
 {
-	if (com1 == NULL && com2 == NULL)
+	if (com1 == com2)
 		return true;
 	if (com1 == NULL || com2 == NULL)
 		return false;
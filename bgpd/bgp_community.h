@@ -32,6 +32,9 @@ struct community {
 	/* Communities value size.  */
 	int size;
 
+	/* Hash of the value, cached while interned, 0 otherwise.  */
+	uint32_t hash;
+
 	/* Communities value.  */
 	uint32_t *val;
 
@@ -74,6 +77,8 @@ extern void community_finish(void);
 extern void community_free(struct community **comm);
 extern struct community *community_uniq_sort(struct community *com);
 extern struct community *community_parse(uint32_t *pnt, unsigned short length);
+extern struct community *community_parse_prepare(uint32_t *pnt,
+						 unsigned short length);
 extern struct community *community_intern(struct community *com);
 extern void community_unintern(struct community **com);
 extern char *community_str(struct community *com, bool make_json,
@@ -2659,7 +2659,7 @@ const char *bgp_debug_rdpfxpath2str(afi_t afi, safi_t safi,
 				    union prefixconstptr pu,
 				    mpls_label_t *label, uint32_t num_labels,
 				    int addpath_valid, uint32_t addpath_id,
-				    struct bgp_route_evpn *overlay_index,
+				    const struct bgp_route_evpn *overlay_index,
 				    char *str, int size)
 {
 	char rd_buf[RD_ADDRSTRLEN];
@@ -301,12 +301,18 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 	return ecom1;
 }
 
+static uint32_t ecommunity_hash_compute(const struct ecommunity *ecom)
+{
+	return jhash(ecom->val, ecom->size * ecom->unit_size, 0x564321ab);
+}
+
 /* Intern Extended Communities Attribute.  */
 struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 {
 	struct ecommunity *find;
 
 	assert(ecom->refcnt == 0);
+	ecom->hash = ecommunity_hash_compute(ecom);
 	find = (struct ecommunity *)hash_get(ecomhash, ecom, hash_alloc_intern);
 	if (find != ecom)
 		ecommunity_free(&ecom);
@@ -345,9 +351,11 @@ void ecommunity_unintern(struct ecommunity **ecom)
 unsigned int ecommunity_hash_make(const void *arg)
 {
 	const struct ecommunity *ecom = arg;
-	int size = ecom->size * ecom->unit_size;
 
-	return jhash(ecom->val, size, 0x564321ab);
+	if (ecom->hash)
+		return ecom->hash;
+
+	return ecommunity_hash_compute(ecom);
 }
 
 /* Compare two Extended Communities Attribute structure.  */
@@ -356,7 +364,7 @@ bool ecommunity_cmp(const void *arg1, const void *arg2)
 	const struct ecommunity *ecom1 = arg1;
 	const struct ecommunity *ecom2 = arg2;
 
-	if (ecom1 == NULL && ecom2 == NULL)
+	if (ecom1 == ecom2)
 		return true;
 
 	if (ecom1 == NULL || ecom2 == NULL)
@@ -119,6 +119,9 @@ struct ecommunity {
 	/* Size of Extended Communities attribute.  */
 	uint32_t size;
 
+	/* Hash of the value, cached while interned, 0 otherwise.  */
+	uint32_t hash;
+
 	/* Extended Communities value.  */
 	uint8_t *val;
 
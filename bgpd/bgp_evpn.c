@@ -469,8 +469,10 @@ static void bgp_evpn_get_rmac_nexthop(struct bgpevpn *vpn,
 				      struct attr *attr, uint8_t flags)
 {
 	struct bgp *bgp_vrf = vpn->bgp_vrf;
+	struct bgp_attr_evpn evpn = *bgp_attr_get_evpn(attr);
 
-	memset(&attr->rmac, 0, sizeof(struct ethaddr));
+	memset(&evpn.rmac, 0, sizeof(struct ethaddr));
+	bgp_attr_set_evpn(attr, &evpn);
 	if (!bgp_vrf)
 		return;
 
@@ -488,13 +490,15 @@ static void bgp_evpn_get_rmac_nexthop(struct bgpevpn *vpn,
 	    && bgp_vrf->evpn_info->advertise_pip &&
 	    bgp_vrf->evpn_info->is_anycast_mac) {
 		/* copy sys rmac */
-		memcpy(&attr->rmac, &bgp_vrf->evpn_info->pip_rmac,
+		memcpy(&evpn.rmac, &bgp_vrf->evpn_info->pip_rmac,
 		       ETH_ALEN);
 		attr->nexthop = bgp_vrf->evpn_info->pip_ip;
 		attr->mp_nexthop_global_in =
 			bgp_vrf->evpn_info->pip_ip;
 	} else
-		memcpy(&attr->rmac, &bgp_vrf->rmac, ETH_ALEN);
+		memcpy(&evpn.rmac, &bgp_vrf->rmac, ETH_ALEN);
+
+	bgp_attr_set_evpn(attr, &evpn);
 }
 
 /*
@@ -755,8 +759,8 @@ static void build_evpn_type5_route_extcomm(struct bgp *bgp_vrf,
 			ecommunity_merge(bgp_attr_get_ecommunity(attr), ecom));
 
 	/* add the router mac extended community */
-	if (!is_zero_mac(&attr->rmac)) {
-		encode_rmac_extcomm(&eval_rmac, &attr->rmac);
+	if (!is_zero_mac(&bgp_attr_get_evpn(attr)->rmac)) {
+		encode_rmac_extcomm(&eval_rmac, &bgp_attr_get_evpn(attr)->rmac);
 		ecommunity_add_val(bgp_attr_get_ecommunity(attr), &eval_rmac,
 				   true, true);
 	}
@@ -827,7 +831,7 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 	}
 
 	/* Add MAC mobility (sticky) if needed. */
-	if (attr->sticky) {
+	if (bgp_attr_get_evpn(attr)->sticky) {
 		seqnum = 0;
 		memset(&ecom_sticky, 0, sizeof(ecom_sticky));
 		encode_mac_mobility_extcomm(1, seqnum, &eval_sticky);
@@ -841,13 +845,13 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 
 	/* Add RMAC, if told to. */
 	if (add_l3_ecomm) {
-		encode_rmac_extcomm(&eval_rmac, &attr->rmac);
+		encode_rmac_extcomm(&eval_rmac, &bgp_attr_get_evpn(attr)->rmac);
 		ecommunity_add_val(bgp_attr_get_ecommunity(attr), &eval_rmac,
 				   true, true);
 	}
 
 	/* Add default gateway, if needed. */
-	if (attr->default_gw) {
+	if (bgp_attr_get_evpn(attr)->default_gw) {
 		memset(&ecom_default_gw, 0, sizeof(ecom_default_gw));
 		encode_default_gw_extcomm(&eval_default_gw);
 		ecom_default_gw.size = 1;
@@ -859,9 +863,11 @@ static void build_evpn_route_extcomm(struct bgpevpn *vpn, struct attr *attr,
 	}
 
 	proxy = !!(attr->es_flags & ATTR_ES_PROXY_ADVERT);
-	if (attr->router_flag || proxy) {
+	if (bgp_attr_get_evpn(attr)->router_flag || proxy) {
 		memset(&ecom_na, 0, sizeof(ecom_na));
-		encode_na_flag_extcomm(&eval_na, attr->router_flag, proxy);
+		encode_na_flag_extcomm(&eval_na,
+				       bgp_attr_get_evpn(attr)->router_flag,
+				       proxy);
 		ecom_na.size = 1;
 		ecom_na.unit_size = ECOMMUNITY_SIZE;
 		ecom_na.val = (uint8_t *)eval_na.val;
@@ -941,12 +947,12 @@ static int evpn_zebra_install(struct bgp *bgp, struct bgpevpn *vpn,
 		flags = 0;
 
 		if (pi->sub_type == BGP_ROUTE_IMPORTED) {
-			if (pi->attr->sticky)
+			if (bgp_attr_get_evpn(pi->attr)->sticky)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY);
-			if (pi->attr->default_gw)
+			if (bgp_attr_get_evpn(pi->attr)->default_gw)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_GW);
 			if (is_evpn_prefix_ipaddr_v6(p) &&
-					pi->attr->router_flag)
+			    bgp_attr_get_evpn(pi->attr)->router_flag)
 				SET_FLAG(flags, ZEBRA_MACIP_TYPE_ROUTER_FLAG);
 
 			seq = mac_mobility_seqnum(pi->attr);
@@ -1050,9 +1056,10 @@ static void evpn_delete_old_local_route(struct bgp *bgp, struct bgpevpn *vpn,
 			(struct prefix_evpn *)bgp_dest_get_prefix(dest);
 
 		zlog_debug("local path deleted %pFX es %s; new-path-es %s", evp,
-			   esi_to_str(&old_local->attr->esi, esi_buf,
-				      sizeof(esi_buf)),
-			   new_select ? esi_to_str(&new_select->attr->esi,
+			   esi_to_str(bgp_evpn_attr_get_esi(old_local->attr),
+				      esi_buf, sizeof(esi_buf)),
+			   new_select ? esi_to_str(bgp_evpn_attr_get_esi(
+							   new_select->attr),
 						   esi_buf2, sizeof(esi_buf2))
 				      : "");
 	}
@@ -1287,6 +1294,7 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 	afi_t afi = AFI_L2VPN;
 	safi_t safi = SAFI_EVPN;
 	struct attr attr;
+	struct bgp_attr_evpn evpn;
 	struct bgp_dest *dest = NULL;
 	struct bgp *bgp_evpn = NULL;
 	int route_changed = 0;
@@ -1304,6 +1312,7 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 		memset(&attr, 0, sizeof(attr));
 		bgp_attr_default_set(&attr, bgp_vrf, BGP_ORIGIN_IGP);
 	}
+	evpn = *bgp_attr_get_evpn(&attr);
 
 	/* Advertise Primary IP (PIP) is enabled, send individual
 	 * IP (default instance router-id) as nexthop.
@@ -1314,10 +1323,10 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 	    (!bgp_vrf->evpn_info->is_anycast_mac)) {
 		attr.nexthop = bgp_vrf->originator_ip;
 		attr.mp_nexthop_global_in = bgp_vrf->originator_ip;
-		memcpy(&attr.rmac, &bgp_vrf->rmac, ETH_ALEN);
+		memcpy(&evpn.rmac, &bgp_vrf->rmac, ETH_ALEN);
 	} else {
 		/* copy sys rmac */
-		memcpy(&attr.rmac, &bgp_vrf->evpn_info->pip_rmac, ETH_ALEN);
+		memcpy(&evpn.rmac, &bgp_vrf->evpn_info->pip_rmac, ETH_ALEN);
 		if (bgp_vrf->evpn_info->pip_ip.s_addr != INADDR_ANY) {
 			attr.nexthop = bgp_vrf->evpn_info->pip_ip;
 			attr.mp_nexthop_global_in = bgp_vrf->evpn_info->pip_ip;
@@ -1331,7 +1340,7 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 	if (bgp_debug_zebra(NULL))
 		zlog_debug(
 			"VRF %s type-5 route evp %pFX RMAC %pEA nexthop %pI4",
-			vrf_id_to_name(bgp_vrf->vrf_id), evp, &attr.rmac,
+			vrf_id_to_name(bgp_vrf->vrf_id), evp, &evpn.rmac,
 			&attr.nexthop);
 
 	attr.mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
@@ -1341,9 +1350,9 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 		       BGP_L2VPN_EVPN_ADV_IPV6_UNICAST_GW_IP)) {
 		if (src_attr &&
 		    !IN6_IS_ADDR_UNSPECIFIED(&src_attr->mp_nexthop_global)) {
-			attr.evpn_overlay.type = OVERLAY_INDEX_GATEWAY_IP;
-			SET_IPADDR_V6(&attr.evpn_overlay.gw_ip);
-			memcpy(&attr.evpn_overlay.gw_ip.ipaddr_v6,
+			evpn.overlay.type = OVERLAY_INDEX_GATEWAY_IP;
+			SET_IPADDR_V6(&evpn.overlay.gw_ip);
+			memcpy(&evpn.overlay.gw_ip.ipaddr_v6,
 			       &src_attr->mp_nexthop_global,
 			       sizeof(struct in6_addr));
 		}
@@ -1351,13 +1360,15 @@ static int update_evpn_type5_route(struct bgp *bgp_vrf, struct prefix_evpn *evp,
 		   CHECK_FLAG(bgp_vrf->af_flags[AFI_L2VPN][SAFI_EVPN],
 			      BGP_L2VPN_EVPN_ADV_IPV4_UNICAST_GW_IP)) {
 		if (src_attr && src_attr->nexthop.s_addr != 0) {
-			attr.evpn_overlay.type = OVERLAY_INDEX_GATEWAY_IP;
-			SET_IPADDR_V4(&attr.evpn_overlay.gw_ip);
-			memcpy(&attr.evpn_overlay.gw_ip.ipaddr_v4,
+			evpn.overlay.type = OVERLAY_INDEX_GATEWAY_IP;
+			SET_IPADDR_V4(&evpn.overlay.gw_ip);
+			memcpy(&evpn.overlay.gw_ip.ipaddr_v4,
 			       &src_attr->nexthop, sizeof(struct in_addr));
 		}
 	}
 
+	bgp_attr_set_evpn(&attr, &evpn);
+
 	/* Setup RT and encap extended community */
 	build_evpn_type5_route_extcomm(bgp_vrf, &attr);
 
@@ -1428,7 +1439,7 @@ static void bgp_evpn_get_sync_info(struct bgp *bgp, esi_t *esi,
 			*active_on_peer = true;
 		}
 
-		if (second_best_path->attr->router_flag)
+		if (bgp_attr_get_evpn(second_best_path->attr)->router_flag)
 			*peer_router = true;
 
 		/* we use both proxy and non-proxy imports to
@@ -1450,6 +1461,7 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 					      uint32_t loc_seq, bool setup_sync)
 {
 	esi_t *esi;
+	struct bgp_attr_evpn evpn;
 	struct prefix_evpn *evp =
 		(struct prefix_evpn *)bgp_dest_get_prefix(dest);
 
@@ -1467,7 +1479,9 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 			bgp_evpn_get_sync_info(bgp, esi, dest, loc_seq,
 					       &max_sync_seq, &active_on_peer,
 					       &peer_router, &proxy_from_peer);
-			attr->mm_sync_seqnum = max_sync_seq;
+			evpn = *bgp_attr_get_evpn(attr);
+			evpn.mm_sync_seqnum = max_sync_seq;
+			bgp_attr_set_evpn(attr, &evpn);
 			if (active_on_peer)
 				attr->es_flags |= ATTR_ES_PEER_ACTIVE;
 			else
@@ -1502,7 +1516,9 @@ static void update_evpn_route_entry_sync_info(struct bgp *bgp,
 			}
 		}
 	} else {
-		attr->mm_sync_seqnum = 0;
+		evpn = *bgp_attr_get_evpn(attr);
+		evpn.mm_sync_seqnum = 0;
+		bgp_attr_set_evpn(attr, &evpn);
 		attr->es_flags &= ~ATTR_ES_PEER_ACTIVE;
 		attr->es_flags &= ~ATTR_ES_PEER_PROXY;
 	}
@@ -1526,6 +1542,7 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	uint32_t num_labels = 1;
 	int route_change = 1;
 	uint8_t sticky = 0;
+	struct bgp_attr_evpn evpn;
 	const struct prefix_evpn *evp;
 
 	*pi = NULL;
@@ -1554,15 +1571,16 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	if (seq && !CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW))
 		add_mac_mobility_to_attr(seq, attr);
 
+	/* Extract MAC mobility sequence number, if any. */
+	evpn = *bgp_attr_get_evpn(attr);
+	evpn.mm_seqnum = bgp_attr_mac_mobility_seqnum(attr, &sticky);
+	evpn.sticky = sticky;
+	bgp_attr_set_evpn(attr, &evpn);
+
 	if (!local_pi) {
 		/* Add (or update) attribute to hash. */
 		attr_new = bgp_attr_intern(attr);
 
-		/* Extract MAC mobility sequence number, if any. */
-		attr_new->mm_seqnum =
-			bgp_attr_mac_mobility_seqnum(attr_new, &sticky);
-		attr_new->sticky = sticky;
-
 		/* Create new route with its attribute. */
 		tmp_pi = info_make(ZEBRA_ROUTE_BGP, BGP_ROUTE_STATIC, 0,
 				   bgp->peer_self, attr_new, dest);
@@ -1624,11 +1642,6 @@ static int update_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 			bgp_path_info_set_flag(dest, tmp_pi,
 					       BGP_PATH_ATTR_CHANGED);
 
-			/* Extract MAC mobility sequence number, if any. */
-			attr_new->mm_seqnum =
-				bgp_attr_mac_mobility_seqnum(attr_new, &sticky);
-			attr_new->sticky = sticky;
-
 			/* Restore route, if needed. */
 			if (CHECK_FLAG(tmp_pi->flags, BGP_PATH_REMOVED))
 				bgp_path_info_restore(dest, tmp_pi);
@@ -1730,6 +1743,7 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 {
 	struct bgp_dest *dest;
 	struct attr attr;
+	struct bgp_attr_evpn evpn;
 	struct attr *attr_new;
 	int add_l3_ecomm = 0;
 	struct bgp_path_info *pi;
@@ -1745,17 +1759,19 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 	attr.nexthop = vpn->originator_ip;
 	attr.mp_nexthop_global_in = vpn->originator_ip;
 	attr.mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
-	attr.sticky = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY) ? 1 : 0;
-	attr.default_gw = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW) ? 1 : 0;
-	attr.router_flag = CHECK_FLAG(flags,
+	memset(&evpn, 0, sizeof(evpn));
+	evpn.sticky = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_STICKY) ? 1 : 0;
+	evpn.default_gw = CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_GW) ? 1 : 0;
+	evpn.router_flag = CHECK_FLAG(flags,
 				      ZEBRA_MACIP_TYPE_ROUTER_FLAG) ? 1 : 0;
 	if (CHECK_FLAG(flags, ZEBRA_MACIP_TYPE_PROXY_ADVERT))
 		attr.es_flags |= ATTR_ES_PROXY_ADVERT;
 
 	if (esi && bgp_evpn_is_esi_valid(esi)) {
-		memcpy(&attr.esi, esi, sizeof(esi_t));
+		memcpy(&evpn.esi, esi, sizeof(esi_t));
 		attr.es_flags |= ATTR_ES_IS_LOCAL;
 	}
+	bgp_attr_set_evpn(&attr, &evpn);
 
 	/* PMSI is only needed for type-3 routes */
 	if (p->prefix.route_type == BGP_EVPN_IMET_ROUTE) {
@@ -1780,7 +1796,8 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 			"VRF %s vni %u type-2 route evp %pFX RMAC %pEA nexthop %pI4 esi %s",
 			vpn->bgp_vrf ? vrf_id_to_name(vpn->bgp_vrf->vrf_id)
 				     : " ",
-			vpn->vni, p, &attr.rmac, &attr.mp_nexthop_global_in,
+			vpn->vni, p, &bgp_attr_get_evpn(&attr)->rmac,
+			&attr.mp_nexthop_global_in,
 			esi_to_str(esi, buf3, sizeof(buf3)));
 	}
 
@@ -1791,7 +1808,10 @@ static int update_evpn_route(struct bgp *bgp, struct bgpevpn *vpn,
 	 * these routes.
 	 */
 	add_l3_ecomm = bgp_evpn_route_add_l3_ecomm_ok(
-		vpn, p, (attr.es_flags & ATTR_ES_IS_LOCAL) ? &attr.esi : NULL);
+		vpn, p,
+		(attr.es_flags & ATTR_ES_IS_LOCAL)
+			? bgp_evpn_attr_get_esi(&attr)
+			: NULL);
 
 	/* Set up extended community. */
 	build_evpn_route_extcomm(vpn, &attr, add_l3_ecomm);
@@ -1988,6 +2008,8 @@ void bgp_evpn_update_type2_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	struct bgp_path_info *pi;
 	struct attr attr;
 	struct attr *attr_new;
+	struct bgp_attr_evpn evpn;
+	const struct bgp_attr_evpn *local_evpn;
 	uint32_t seq;
 	int add_l3_ecomm = 0;
 	struct bgp_dest *global_dest;
@@ -2009,15 +2031,18 @@ void bgp_evpn_update_type2_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	attr.nexthop = vpn->originator_ip;
 	attr.mp_nexthop_global_in = vpn->originator_ip;
 	attr.mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
-	attr.sticky = (local_pi->attr->sticky) ? 1 : 0;
-	attr.router_flag = (local_pi->attr->router_flag) ? 1 : 0;
+	local_evpn = bgp_attr_get_evpn(local_pi->attr);
+	memset(&evpn, 0, sizeof(evpn));
+	evpn.sticky = (local_evpn->sticky) ? 1 : 0;
+	evpn.router_flag = (local_evpn->router_flag) ? 1 : 0;
 	attr.es_flags = local_pi->attr->es_flags;
-	if (local_pi->attr->default_gw) {
-		attr.default_gw = 1;
+	if (local_evpn->default_gw) {
+		evpn.default_gw = 1;
 		if (is_evpn_prefix_ipaddr_v6(evp))
-			attr.router_flag = 1;
+			evpn.router_flag = 1;
 	}
-	memcpy(&attr.esi, &local_pi->attr->esi, sizeof(esi_t));
+	memcpy(&evpn.esi, &local_evpn->esi, sizeof(esi_t));
+	bgp_attr_set_evpn(&attr, &evpn);
 	bgp_evpn_get_rmac_nexthop(vpn, evp, &attr,
 			local_pi->extra->af_flags);
 	vni2label(vpn->vni, &(attr.label));
@@ -2026,7 +2051,9 @@ void bgp_evpn_update_type2_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 	 */
 	add_l3_ecomm = bgp_evpn_route_add_l3_ecomm_ok(
 		vpn, evp,
-		(attr.es_flags & ATTR_ES_IS_LOCAL) ? &attr.esi : NULL);
+		(attr.es_flags & ATTR_ES_IS_LOCAL)
+			? bgp_evpn_attr_get_esi(&attr)
+			: NULL);
 
 	/* Set up extended community. */
 	build_evpn_route_extcomm(vpn, &attr, add_l3_ecomm);
@@ -2039,8 +2066,10 @@ void bgp_evpn_update_type2_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 			"VRF %s vni %u evp %pFX RMAC %pEA nexthop %pI4 esi %s esf 0x%x from %s",
 			vpn->bgp_vrf ? vrf_id_to_name(vpn->bgp_vrf->vrf_id)
 				     : " ",
-			vpn->vni, evp, &attr.rmac, &attr.mp_nexthop_global_in,
-			esi_to_str(&attr.esi, buf3, sizeof(buf3)),
+			vpn->vni, evp, &bgp_attr_get_evpn(&attr)->rmac,
+			&attr.mp_nexthop_global_in,
+			esi_to_str(bgp_evpn_attr_get_esi(&attr), buf3,
+				   sizeof(buf3)),
 			attr.es_flags, caller);
 	}
 
@@ -2425,6 +2454,7 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 	bool use_l3nhg = false;
 	bool is_l3nhg_active = false;
 	char buf1[INET6_ADDRSTRLEN];
+	const struct bgp_route_evpn *eo;
 
 	memset(pp, 0, sizeof(struct prefix));
 	ip_prefix_from_evpn_prefix(evp, pp);
@@ -2455,7 +2485,8 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 	 * make sure to set the flag for next hop attribute.
 	 */
 	attr = *parent_pi->attr;
-	if (attr.evpn_overlay.type != OVERLAY_INDEX_GATEWAY_IP) {
+	eo = bgp_attr_get_evpn_overlay(&attr);
+	if (eo->type != OVERLAY_INDEX_GATEWAY_IP) {
 		if (afi == AFI_IP6)
 			evpn_convert_nexthop_to_ipv6(&attr);
 		else {
@@ -2472,24 +2503,24 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 		if (bgp_debug_zebra(NULL)) {
 			zlog_debug(
 				"Install gateway IP %s as nexthop for prefix %pFX in vrf %s",
-				inet_ntop(pp->family, &attr.evpn_overlay.gw_ip,
+				inet_ntop(pp->family, &eo->gw_ip,
 					  buf1, sizeof(buf1)), pp,
 					  vrf_id_to_name(bgp_vrf->vrf_id));
 		}
 
 		if (afi == AFI_IP6) {
 			memcpy(&attr.mp_nexthop_global,
-			       &attr.evpn_overlay.gw_ip.ipaddr_v6,
+			       &eo->gw_ip.ipaddr_v6,
 			       sizeof(struct in6_addr));
 			attr.mp_nexthop_len = IPV6_MAX_BYTELEN;
 		} else {
-			attr.nexthop = attr.evpn_overlay.gw_ip.ipaddr_v4;
+			attr.nexthop = eo->gw_ip.ipaddr_v4;
 			attr.flag |= ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP);
 		}
 	}
 
-	bgp_evpn_es_vrf_use_nhg(bgp_vrf, &parent_pi->attr->esi, &use_l3nhg,
-				&is_l3nhg_active, NULL);
+	bgp_evpn_es_vrf_use_nhg(bgp_vrf, bgp_evpn_attr_get_esi(parent_pi->attr),
+				&use_l3nhg, &is_l3nhg_active, NULL);
 	if (use_l3nhg)
 		attr.es_flags |= ATTR_ES_L3_NHG_USE;
 	if (is_l3nhg_active)
@@ -2534,15 +2565,14 @@ static int install_evpn_route_entry_in_vrf(struct bgp *bgp_vrf,
 	}
 
 	/* Gateway IP nexthop should be resolved */
-	if (attr.evpn_overlay.type == OVERLAY_INDEX_GATEWAY_IP) {
+	if (eo->type == OVERLAY_INDEX_GATEWAY_IP) {
 		if (bgp_find_or_add_nexthop(bgp_vrf, bgp_vrf, afi, safi, pi,
 					    NULL, 0, NULL))
 			bgp_path_info_set_flag(dest, pi, BGP_PATH_VALID);
 		else {
 			if (BGP_DEBUG(nht, NHT)) {
-				inet_ntop(pp->family,
-					  &attr.evpn_overlay.gw_ip,
-					  buf1, sizeof(buf1));
+				inet_ntop(pp->family, &eo->gw_ip, buf1,
+					  sizeof(buf1));
 				zlog_debug("%s: gateway IP NH unresolved",
 					   buf1);
 			}
@@ -2639,8 +2669,8 @@ static int install_evpn_route_entry(struct bgp *bgp, struct bgpevpn *vpn,
 		 * need to reinstall the path in zebra
 		 */
 		if ((old_local_es != new_local_es)
-		    || memcmp(&pi->attr->esi, &attr_new->esi,
-			      sizeof(attr_new->esi))) {
+		    || memcmp(bgp_evpn_attr_get_esi(pi->attr),
+			      bgp_evpn_attr_get_esi(attr_new), sizeof(esi_t))) {
 
 			if (BGP_DEBUG(evpn_mh, EVPN_MH_RT))
 				zlog_debug("VNI %d path %pFX chg to %s es",
@@ -2963,7 +2993,8 @@ static int bgp_evpn_route_rmac_self_check(struct bgp *bgp_vrf,
 	 * SVI comes up with MAC and stored in hash, triggers
 	 * bgp_mac_rescan_all_evpn_tables.
 	 */
-	if (memcmp(&bgp_vrf->rmac, &pi->attr->rmac, ETH_ALEN) == 0) {
+	if (memcmp(&bgp_vrf->rmac, &bgp_attr_get_evpn(pi->attr)->rmac,
+		   ETH_ALEN) == 0) {
 		if (bgp_debug_update(pi->peer, NULL, NULL, 1)) {
 			char attr_str[BUFSIZ] = {0};
 
@@ -3864,9 +3895,12 @@ static int process_type2_route(struct peer *peer, afi_t afi, safi_t safi,
 
 	/* Copy Ethernet Seg Identifier */
 	if (attr) {
-		STREAM_GET(&attr->esi, pkt, sizeof(esi_t));
+		struct bgp_attr_evpn evpn = *bgp_attr_get_evpn(attr);
+
+		STREAM_GET(&evpn.esi, pkt, sizeof(esi_t));
+		bgp_attr_set_evpn(attr, &evpn);
 
-		if (bgp_evpn_is_esi_local_and_non_bypass(&attr->esi))
+		if (bgp_evpn_is_esi_local_and_non_bypass(&evpn.esi))
 			attr->es_flags |= ATTR_ES_IS_LOCAL;
 		else
 			attr->es_flags &= ~ATTR_ES_IS_LOCAL;
@@ -4137,7 +4171,7 @@ static int process_type5_route(struct peer *peer, afi_t afi, safi_t safi,
 	else if (!ipaddr_is_zero(&evpn.gw_ip))
 		evpn.type = OVERLAY_INDEX_GATEWAY_IP;
 	if (attr) {
-		if (is_zero_mac(&attr->rmac) &&
+		if (is_zero_mac(&bgp_attr_get_evpn(attr)->rmac) &&
 		    !bgp_evpn_is_esi_valid(&evpn.eth_s_id) &&
 		    ipaddr_is_zero(&evpn.gw_ip) && label == 0) {
 			flog_err(EC_BGP_EVPN_ROUTE_INVALID,
@@ -4146,7 +4180,8 @@ static int process_type5_route(struct peer *peer, afi_t afi, safi_t safi,
 			is_valid_update = false;
 		}
 
-		if (is_mcast_mac(&attr->rmac) || is_bcast_mac(&attr->rmac))
+		if (is_mcast_mac(&bgp_attr_get_evpn(attr)->rmac)
+		    || is_bcast_mac(&bgp_attr_get_evpn(attr)->rmac))
 			is_valid_update = false;
 	}
 
@@ -4197,8 +4232,8 @@ static void evpn_mpattr_encode_type5(struct stream *s, const struct prefix *p,
 	/* Prefix contains RD, ESI, EthTag, IP length, IP, GWIP and VNI */
 	stream_putc(s, 8 + 10 + 4 + 1 + len + 3);
 	stream_put(s, prd->val, 8);
-	if (attr && attr->evpn_overlay.type == OVERLAY_INDEX_ESI)
-		stream_put(s, &attr->esi, sizeof(esi_t));
+	if (attr && bgp_attr_get_evpn(attr)->overlay.type == OVERLAY_INDEX_ESI)
+		stream_put(s, &bgp_attr_get_evpn(attr)->esi, sizeof(esi_t));
 	else
 		stream_put(s, 0, sizeof(esi_t));
 	stream_putl(s, p_evpn_p->prefix_addr.eth_tag);
@@ -4207,7 +4242,9 @@ static void evpn_mpattr_encode_type5(struct stream *s, const struct prefix *p,
 		stream_put_ipv4(s, p_evpn_p->prefix_addr.ip.ipaddr_v4.s_addr);
 	else
 		stream_put(s, &p_evpn_p->prefix_addr.ip.ipaddr_v6, 16);
-	if (attr && attr->evpn_overlay.type == OVERLAY_INDEX_GATEWAY_IP) {
+	if (attr
+	    && bgp_attr_get_evpn_overlay(attr)->type
+		       == OVERLAY_INDEX_GATEWAY_IP) {
 		const struct bgp_route_evpn *evpn_overlay =
 			bgp_attr_get_evpn_overlay(attr);
 
@@ -4926,7 +4963,7 @@ void bgp_evpn_encode_prefix(struct stream *s, const struct prefix *p,
 		stream_putc(s, len);
 		stream_put(s, prd->val, 8);   /* RD */
 		if (attr)
-			stream_put(s, &attr->esi, ESI_BYTES);
+			stream_put(s, &bgp_attr_get_evpn(attr)->esi, ESI_BYTES);
 		else
 			stream_put(s, 0, 10);
 		stream_putl(s, evp->prefix.macip_addr.eth_tag);	/* Ethernet Tag ID */
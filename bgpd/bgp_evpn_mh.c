@@ -128,10 +128,12 @@ static int bgp_evpn_es_route_select_install(struct bgp *bgp,
 	    && !CHECK_FLAG(old_select->flags, BGP_PATH_ATTR_CHANGED)
 	    && !bgp_addpath_is_addpath_used(&bgp->tx_addpath, afi, safi)) {
 		if (bgp_zebra_has_route_changed(old_select)) {
+			const struct bgp_attr_evpn *evpn =
+				bgp_attr_get_evpn(old_select->attr);
+
 			bgp_evpn_es_vtep_add(bgp, es, old_select->attr->nexthop,
-					     true /*esr*/,
-					     old_select->attr->df_alg,
-					     old_select->attr->df_pref);
+					     true /*esr*/, evpn->df_alg,
+					     evpn->df_pref);
 		}
 		UNSET_FLAG(old_select->flags, BGP_PATH_MULTIPATH_CHG);
 		bgp_zebra_clear_route_change_flags(dest);
@@ -158,9 +160,12 @@ static int bgp_evpn_es_route_select_install(struct bgp *bgp,
 
 	if (new_select && new_select->type == ZEBRA_ROUTE_BGP
 			&& new_select->sub_type == BGP_ROUTE_IMPORTED) {
+		const struct bgp_attr_evpn *evpn =
+			bgp_attr_get_evpn(new_select->attr);
+
 		bgp_evpn_es_vtep_add(bgp, es, new_select->attr->nexthop,
-				     true /*esr */, new_select->attr->df_alg,
-				     new_select->attr->df_pref);
+				     true /*esr */, evpn->df_alg,
+				     evpn->df_pref);
 	} else {
 		if (old_select && old_select->type == ZEBRA_ROUTE_BGP
 				&& old_select->sub_type == BGP_ROUTE_IMPORTED)
@@ -4519,7 +4524,7 @@ static struct bgp_evpn_nh *bgp_evpn_nh_add(struct bgp *bgp_vrf,
 	/* Setup ref_pi when the nh is created */
 	if (CHECK_FLAG(pi->flags, BGP_PATH_VALID) && pi->attr) {
 		n->ref_pi = pi;
-		memcpy(&n->rmac, &pi->attr->rmac, ETH_ALEN);
+		memcpy(&n->rmac, &bgp_attr_get_evpn(pi->attr)->rmac, ETH_ALEN);
 	}
 
 	if (BGP_DEBUG(evpn_mh, EVPN_MH_ES))
@@ -4643,8 +4648,11 @@ static void bgp_evpn_nh_update_ref_pi(struct bgp_evpn_nh *nh)
 		/* If we have a new pi copy rmac from it and update
 		 * zebra if the new rmac is different
 		 */
-		if (memcmp(&nh->rmac, &nh->ref_pi->attr->rmac, ETH_ALEN)) {
-			memcpy(&nh->rmac, &nh->ref_pi->attr->rmac, ETH_ALEN);
+		const struct ethaddr *rmac =
+			&bgp_attr_get_evpn(nh->ref_pi->attr)->rmac;
+
+		if (memcmp(&nh->rmac, rmac, ETH_ALEN)) {
+			memcpy(&nh->rmac, rmac, ETH_ALEN);
 			bgp_evpn_nh_zebra_update(nh, true);
 		}
 		break;
@@ -356,14 +356,15 @@ static inline int bgp_evpn_is_es_local(struct bgp_evpn_es *es)
 }
 
 extern esi_t *zero_esi;
-static inline bool bgp_evpn_is_esi_valid(esi_t *esi)
+static inline bool bgp_evpn_is_esi_valid(const esi_t *esi)
 {
 	return !!memcmp(esi, zero_esi, sizeof(esi_t));
 }
 
 static inline esi_t *bgp_evpn_attr_get_esi(struct attr *attr)
 {
-	return attr ? &attr->esi : zero_esi;
+	/* callers only read it, but take a non-const esi_t */
+	return attr ? (esi_t *)&bgp_attr_get_evpn(attr)->esi : zero_esi;
 }
 
 static inline bool bgp_evpn_attr_is_sync(struct attr *attr)
@@ -374,7 +375,7 @@ static inline bool bgp_evpn_attr_is_sync(struct attr *attr)
 
 static inline uint32_t bgp_evpn_attr_get_sync_seq(struct attr *attr)
 {
-	return attr ?  attr->mm_sync_seqnum : 0;
+	return attr ? bgp_attr_get_evpn(attr)->mm_sync_seqnum : 0;
 }
 
 static inline bool bgp_evpn_attr_is_active_on_peer(struct attr *attr)
@@ -401,7 +402,7 @@ static inline bool bgp_evpn_attr_is_local_es(struct attr *attr)
 
 static inline uint32_t bgp_evpn_attr_get_df_pref(struct attr *attr)
 {
-	return (attr) ? attr->df_pref : 0;
+	return (attr) ? bgp_attr_get_evpn(attr)->df_pref : 0;
 }
 
 static inline bool bgp_evpn_local_es_is_active(struct bgp_evpn_es *es)
@@ -55,6 +55,7 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_preparse.h"
 #include "bgpd/bgp_zebra.h"
 #include "bgpd/bgp_vty.h"
 
@@ -127,6 +128,8 @@ static void peer_xfer_stats(struct peer *peer_dst, struct peer *peer_src)
 	peer_dst->notify_out += peer_src->notify_out;
 	peer_dst->dynamic_cap_in += peer_src->dynamic_cap_in;
 	peer_dst->dynamic_cap_out += peer_src->dynamic_cap_out;
+	peer_dst->write_calls += peer_src->write_calls;
+	peer_dst->write_bytes += peer_src->write_bytes;
 }
 
 static struct peer *peer_xfer_conn(struct peer *from_peer)
@@ -200,7 +203,8 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 		from_peer->fd = fd;
 
 		stream_fifo_clean(peer->ibuf);
-		stream_fifo_clean(peer->obuf);
+		bgp_obuf_clean(peer->obuf);
+		bgp_preparse_flush(peer);
 
 		/*
 		 * this should never happen, since bgp_process_packet() is the
@@ -222,15 +226,23 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 		}
 
 		// copy each packet from old peer's output queue to new peer
-		while (from_peer->obuf->head)
-			stream_fifo_push(peer->obuf,
-					 stream_fifo_pop(from_peer->obuf));
+		while (bgp_obuf_head(from_peer->obuf))
+			bgp_obuf_push(peer->obuf,
+				      bgp_obuf_pop(from_peer->obuf));
 
 		// copy each packet from old peer's input queue to new peer
 		while (from_peer->ibuf->head)
 			stream_fifo_push(peer->ibuf,
 					 stream_fifo_pop(from_peer->ibuf));
 
+		/* pre-parse results are not carried over, the packets they
+		 * belong to get parsed in full instead.
+		 */
+		while (from_peer->ibuf_preparse->head)
+			stream_fifo_push(peer->ibuf,
+					 stream_fifo_pop(from_peer->ibuf_preparse));
+		bgp_preparse_flush(from_peer);
+
 		ringbuf_wipe(peer->ibuf_work);
 		ringbuf_copy(peer->ibuf_work, from_peer->ibuf_work,
 			     ringbuf_remain(from_peer->ibuf_work));
@@ -1509,7 +1521,8 @@ int bgp_stop(struct peer *peer)
 		if (peer->ibuf)
 			stream_fifo_clean(peer->ibuf);
 		if (peer->obuf)
-			stream_fifo_clean(peer->obuf);
+			bgp_obuf_clean(peer->obuf);
+		bgp_preparse_flush(peer);
 
 		if (peer->ibuf_work)
 			ringbuf_wipe(peer->ibuf_work);
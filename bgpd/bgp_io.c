@@ -38,7 +38,9 @@
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
 #include "bgpd/bgp_packet.h"	// for bgp_notify_send_with_data, bgp_notify...
+#include "bgpd/bgp_preparse.h"	// for bgp_preparse_schedule, bgp_preparse_off
 #include "bgpd/bgp_trace.h"	// for frrtraces
+#include "bgpd/bgp_updgrp.h"	// for bpacket_body, bpacket_body_unref
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
 
@@ -53,6 +55,125 @@ static bool validate_header(struct peer *);
 #define BGP_IO_TRANS_ERR (1 << 0) // EAGAIN or similar occurred
 #define BGP_IO_FATAL_ERR (1 << 1) // some kind of fatal TCP error
 
+/* most iovecs passed to a single writev() */
+#ifdef IOV_MAX
+#define BGP_IOV_MAX IOV_MAX
+#else
+#define BGP_IOV_MAX 1024
+#endif
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_OBUF, "BGP output queue");
+DEFINE_MTYPE_STATIC(BGPD, BGP_OPKT, "BGP output packet");
+
+/* Output queue ------------------------------------------------------------ */
+
+struct bgp_opkt *bgp_opkt_new(struct stream *s)
+{
+	struct bgp_opkt *opkt;
+
+	opkt = XCALLOC(MTYPE_BGP_OPKT, sizeof(struct bgp_opkt));
+	opkt->s = s;
+
+	return opkt;
+}
+
+struct bgp_opkt *bgp_opkt_new_shared(struct bpacket_body *body)
+{
+	struct bgp_opkt *opkt;
+
+	opkt = XCALLOC(MTYPE_BGP_OPKT, sizeof(struct bgp_opkt));
+	opkt->body = body;
+
+	return opkt;
+}
+
+void bgp_opkt_free(struct bgp_opkt *opkt)
+{
+	if (opkt->s)
+		stream_free(opkt->s);
+	if (opkt->body)
+		bpacket_body_unref(opkt->body);
+
+	XFREE(MTYPE_BGP_OPKT, opkt);
+}
+
+void bgp_opkt_patch(struct bgp_opkt *opkt, size_t offset, const void *data,
+		    size_t len)
+{
+	struct bgp_opkt_patch *patch;
+	unsigned int i;
+
+	assert(opkt->body && opkt->npatch < BGP_OPKT_PATCH_MAX);
+	assert(len <= sizeof(patch->data));
+	assert(offset + len <= stream_get_endp(opkt->body->s));
+
+	/* keep patches sorted by offset */
+	for (i = opkt->npatch; i > 0 && opkt->patch[i - 1].offset > offset;
+	     i--)
+		opkt->patch[i] = opkt->patch[i - 1];
+
+	patch = &opkt->patch[i];
+	patch->offset = offset;
+	patch->len = len;
+	memcpy(patch->data, data, len);
+	opkt->npatch++;
+}
+
+uint8_t bgp_opkt_type(struct bgp_opkt *opkt)
+{
+	struct stream *s = opkt->s ? opkt->s : opkt->body->s;
+
+	return stream_getc_from(s, BGP_MARKER_SIZE + 2);
+}
+
+struct bgp_obuf *bgp_obuf_new(void)
+{
+	return XCALLOC(MTYPE_BGP_OBUF, sizeof(struct bgp_obuf));
+}
+
+void bgp_obuf_free(struct bgp_obuf *obuf)
+{
+	bgp_obuf_clean(obuf);
+	XFREE(MTYPE_BGP_OBUF, obuf);
+}
+
+void bgp_obuf_push(struct bgp_obuf *obuf, struct bgp_opkt *opkt)
+{
+	if (obuf->tail)
+		obuf->tail->next = opkt;
+	else
+		obuf->head = opkt;
+
+	obuf->tail = opkt;
+	opkt->next = NULL;
+	atomic_fetch_add_explicit(&obuf->count, 1, memory_order_release);
+}
+
+struct bgp_opkt *bgp_obuf_pop(struct bgp_obuf *obuf)
+{
+	struct bgp_opkt *opkt = obuf->head;
+
+	if (opkt) {
+		obuf->head = opkt->next;
+		if (!obuf->head)
+			obuf->tail = NULL;
+
+		atomic_fetch_sub_explicit(&obuf->count, 1,
+					  memory_order_release);
+		opkt->next = NULL;
+	}
+
+	return opkt;
+}
+
+void bgp_obuf_clean(struct bgp_obuf *obuf)
+{
+	struct bgp_opkt *opkt;
+
+	while ((opkt = bgp_obuf_pop(obuf)))
+		bgp_opkt_free(opkt);
+}
+
 /* Thread external API ----------------------------------------------------- */
 
 void bgp_writes_on(struct peer *peer)
@@ -98,6 +219,10 @@ void bgp_reads_on(struct peer *peer)
 	assert(!peer->t_connect_check_w);
 	assert(peer->fd);
 
+	/* keep the pre-parse pthread stable while reads are on */
+	if (!CHECK_FLAG(peer->thread_flags, PEER_THREAD_READS_ON))
+		bgp_preparse_peer_assign(peer);
+
 	thread_add_read(fpt->master, bgp_process_reads, peer, peer->fd,
 			&peer->t_read);
 
@@ -110,6 +235,7 @@ void bgp_reads_off(struct peer *peer)
 	assert(fpt->running);
 
 	thread_cancel_async(fpt->master, &peer->t_read, NULL);
+	bgp_preparse_off(peer);
 	THREAD_OFF(peer->t_process_packet);
 	THREAD_OFF(peer->t_process_packet_error);
 
@@ -136,7 +262,7 @@ static void bgp_process_writes(struct thread *thread)
 
 	frr_with_mutex (&peer->io_mtx) {
 		status = bgp_write(peer);
-		reschedule = (stream_fifo_head(peer->obuf) != NULL);
+		reschedule = (bgp_obuf_head(peer->obuf) != NULL);
 	}
 
 	/* no problem */
@@ -248,7 +374,14 @@ static void bgp_process_reads(struct thread *thread)
 
 			frrtrace(2, frr_bgp, packet_read, peer, pkt);
 			frr_with_mutex (&peer->io_mtx) {
-				stream_fifo_push(peer->ibuf, pkt);
+				if (!peer->preparse_fpt)
+					stream_fifo_push(peer->ibuf, pkt);
+				else {
+					if (!peer->ibuf_preparse->count)
+						monotime(&peer->preparse_enqueued);
+					stream_fifo_push(peer->ibuf_preparse,
+							 pkt);
+				}
 			}
 
 			added_pkt = true;
@@ -265,18 +398,75 @@ static void bgp_process_reads(struct thread *thread)
 
 		thread_add_read(fpt->master, bgp_process_reads, peer, peer->fd,
 				&peer->t_read);
-		if (added_pkt)
+		if (added_pkt && peer->preparse_fpt)
+			bgp_preparse_schedule(peer);
+		else if (added_pkt)
 			thread_add_event(bm->master, bgp_process_packet,
 					 peer, 0, &peer->t_process_packet);
 	}
 }
 
+/*
+ * Fills iov with the unwritten part of opkt.
+ *
+ * Regions of a shared body that were patched for the peer are taken from
+ * opkt->patch[], everything else straight from the body.
+ *
+ * Returns the number of iovecs used, or 0 if more than max would be needed.
+ */
+static unsigned int bgp_opkt_iov(struct bgp_opkt *opkt, struct iovec *iov,
+				 unsigned int max)
+{
+	struct stream *s = opkt->s ? opkt->s : opkt->body->s;
+	uint8_t *data = STREAM_DATA(s);
+	size_t skip = opkt->written;
+	size_t pos = 0;
+	unsigned int n = 0;
+	unsigned int i;
+	struct iovec seg[BGP_OPKT_PATCH_MAX * 2 + 1];
+	unsigned int nseg = 0;
+
+	for (i = 0; i < opkt->npatch; i++) {
+		seg[nseg].iov_base = data + pos;
+		seg[nseg++].iov_len = opkt->patch[i].offset - pos;
+		seg[nseg].iov_base = opkt->patch[i].data;
+		seg[nseg++].iov_len = opkt->patch[i].len;
+		pos = opkt->patch[i].offset + opkt->patch[i].len;
+	}
+	seg[nseg].iov_base = data + pos;
+	seg[nseg++].iov_len = stream_get_endp(s) - pos;
+
+	for (i = 0; i < nseg; i++) {
+		if (skip >= seg[i].iov_len) {
+			skip -= seg[i].iov_len;
+			continue;
+		}
+		if (n == max)
+			return 0;
+
+		iov[n].iov_base = (uint8_t *)seg[i].iov_base + skip;
+		iov[n++].iov_len = seg[i].iov_len - skip;
+		skip = 0;
+	}
+
+	return n;
+}
+
+static size_t bgp_opkt_remaining(struct bgp_opkt *opkt)
+{
+	struct stream *s = opkt->s ? opkt->s : opkt->body->s;
+
+	return stream_get_endp(s) - opkt->written;
+}
+
 /*
  * Flush peer output buffer.
  *
  * This function pops packets off of peer->obuf and writes them to peer->fd.
  * The amount of packets written is equal to the minimum of peer->wpkt_quanta
  * and the number of packets on the output buffer, unless an error occurs.
+ * If write-batch is configured, further packets are coalesced into the same
+ * writev() until the configured number of bytes is reached.
  *
  * If write() returns an error, the appropriate FSM event is generated.
  *
@@ -286,47 +476,69 @@ static void bgp_process_reads(struct thread *thread)
 static uint16_t bgp_write(struct peer *peer)
 {
 	uint8_t type;
-	struct stream *s;
+	struct bgp_opkt *opkt;
 	int update_last_write = 0;
 	unsigned int count;
 	uint32_t uo = 0;
 	uint16_t status = 0;
 	uint32_t wpkt_quanta_old;
+	uint32_t wbatch_bytes;
+	unsigned int maxpkts;
 
-	int writenum = 0;
-	int num;
+	size_t writenum;
+	ssize_t num;
 	unsigned int iovsz;
-	unsigned int strmsz;
-	unsigned int total_written;
+	unsigned int n;
 	time_t now;
 
 	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 					       memory_order_relaxed);
-	struct stream *ostreams[wpkt_quanta_old];
-	struct stream **streams = ostreams;
-	struct iovec iov[wpkt_quanta_old];
+	wbatch_bytes = atomic_load_explicit(&peer->bgp->wbatch_bytes,
+					    memory_order_relaxed);
+	maxpkts = wbatch_bytes ? BGP_WRITE_BATCH_PACKET_MAX : wpkt_quanta_old;
+	struct iovec iov[MIN(maxpkts * (BGP_OPKT_PATCH_MAX * 2 + 1),
+			     BGP_IOV_MAX)];
 
-	s = stream_fifo_head(peer->obuf);
+	opkt = bgp_obuf_head(peer->obuf);
 
-	if (!s)
+	if (!opkt)
 		goto done;
 
+	/* Size the batch */
 	count = iovsz = 0;
-	while (count < wpkt_quanta_old && iovsz < array_size(iov) && s) {
-		ostreams[iovsz] = s;
-		iov[iovsz].iov_base = stream_pnt(s);
-		iov[iovsz].iov_len = STREAM_READABLE(s);
-		writenum += STREAM_READABLE(s);
-		s = s->next;
-		++iovsz;
+	writenum = 0;
+	while (opkt
+	       && bgp_write_batch_room(count, writenum, wpkt_quanta_old,
+				       wbatch_bytes)) {
+		n = bgp_opkt_iov(opkt, &iov[iovsz], array_size(iov) - iovsz);
+		if (!n)
+			break;
+
+		iovsz += n;
+		writenum += bgp_opkt_remaining(opkt);
+		opkt = opkt->next;
 		++count;
 	}
 
-	strmsz = iovsz;
-	total_written = 0;
+	/* Write it, retrying after partial writes */
+	while (count) {
+		if (!iovsz) {
+			unsigned int i = 0;
+
+			for (opkt = bgp_obuf_head(peer->obuf); i < count;
+			     opkt = opkt->next, i++)
+				iovsz += bgp_opkt_iov(opkt, &iov[iovsz],
+						      array_size(iov) - iovsz);
+		}
 
-	do {
 		num = writev(peer->fd, iov, iovsz);
+		iovsz = 0;
+
+		atomic_fetch_add_explicit(&peer->write_calls, 1,
+					  memory_order_relaxed);
+		if (num > 0)
+			atomic_fetch_add_explicit(&peer->write_bytes, num,
+						  memory_order_relaxed);
 
 		if (num < 0) {
 			if (!ERRNO_IO_RETRY(errno)) {
@@ -337,97 +549,73 @@ static uint16_t bgp_write(struct peer *peer)
 			}
 
 			break;
-		} else if (num != writenum) {
-			unsigned int msg_written = 0;
-			unsigned int ic = iovsz;
-
-			for (unsigned int i = 0; i < ic; i++) {
-				size_t ss = iov[i].iov_len;
-
-				if (ss > (unsigned int) num)
-					break;
-
-				msg_written++;
-				iovsz--;
-				writenum -= ss;
-				num -= ss;
-			}
-
-			total_written += msg_written;
-
-			assert(total_written < count);
-
-			memmove(&iov, &iov[msg_written],
-				sizeof(iov[0]) * iovsz);
-			streams = &streams[msg_written];
-			stream_forward_getp(streams[0], num);
-			iov[0].iov_base = stream_pnt(streams[0]);
-			iov[0].iov_len = STREAM_READABLE(streams[0]);
-
-			writenum -= num;
-			num = 0;
-			assert(writenum > 0);
-		} else {
-			total_written = strmsz;
 		}
 
-	} while (num != writenum);
-
-	/* Handle statistics */
-	for (unsigned int i = 0; i < total_written; i++) {
-		s = stream_fifo_pop(peer->obuf);
+		if (num == 0)
+			break;
 
-		assert(s == ostreams[i]);
+		/* Handle statistics for each packet written completely */
+		while (num > 0) {
+			opkt = bgp_obuf_head(peer->obuf);
 
-		/* Retrieve BGP packet type. */
-		stream_set_getp(s, BGP_MARKER_SIZE + 2);
-		type = stream_getc(s);
+			if ((size_t)num < bgp_opkt_remaining(opkt)) {
+				opkt->written += num;
+				break;
+			}
 
-		switch (type) {
-		case BGP_MSG_OPEN:
-			atomic_fetch_add_explicit(&peer->open_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_UPDATE:
-			atomic_fetch_add_explicit(&peer->update_out, 1,
-						  memory_order_relaxed);
-			uo++;
-			break;
-		case BGP_MSG_NOTIFY:
-			atomic_fetch_add_explicit(&peer->notify_out, 1,
-						  memory_order_relaxed);
-			/* Double start timer. */
-			peer->v_start *= 2;
-
-			/* Overflow check. */
-			if (peer->v_start >= (60 * 2))
-				peer->v_start = (60 * 2);
-
-			/*
-			 * Handle Graceful Restart case where the state changes
-			 * to Connect instead of Idle.
-			 */
-			BGP_EVENT_ADD(peer, BGP_Stop);
-			goto done;
-
-		case BGP_MSG_KEEPALIVE:
-			atomic_fetch_add_explicit(&peer->keepalive_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_ROUTE_REFRESH_NEW:
-		case BGP_MSG_ROUTE_REFRESH_OLD:
-			atomic_fetch_add_explicit(&peer->refresh_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_CAPABILITY:
-			atomic_fetch_add_explicit(&peer->dynamic_cap_out, 1,
-						  memory_order_relaxed);
-			break;
+			num -= bgp_opkt_remaining(opkt);
+			bgp_obuf_pop(peer->obuf);
+			count--;
+
+			/* Retrieve BGP packet type. */
+			type = bgp_opkt_type(opkt);
+			bgp_opkt_free(opkt);
+			update_last_write = 1;
+
+			switch (type) {
+			case BGP_MSG_OPEN:
+				atomic_fetch_add_explicit(&peer->open_out, 1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_UPDATE:
+				atomic_fetch_add_explicit(&peer->update_out, 1,
+							  memory_order_relaxed);
+				uo++;
+				break;
+			case BGP_MSG_NOTIFY:
+				atomic_fetch_add_explicit(&peer->notify_out, 1,
+							  memory_order_relaxed);
+				/* Double start timer. */
+				peer->v_start *= 2;
+
+				/* Overflow check. */
+				if (peer->v_start >= (60 * 2))
+					peer->v_start = (60 * 2);
+
+				/*
+				 * Handle Graceful Restart case where the state
+				 * changes to Connect instead of Idle.
+				 */
+				BGP_EVENT_ADD(peer, BGP_Stop);
+				goto done;
+
+			case BGP_MSG_KEEPALIVE:
+				atomic_fetch_add_explicit(&peer->keepalive_out,
+							  1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_ROUTE_REFRESH_NEW:
+			case BGP_MSG_ROUTE_REFRESH_OLD:
+				atomic_fetch_add_explicit(&peer->refresh_out, 1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_CAPABILITY:
+				atomic_fetch_add_explicit(
+					&peer->dynamic_cap_out, 1,
+					memory_order_relaxed);
+				break;
+			}
 		}
-
-		stream_free(s);
-		ostreams[i] = NULL;
-		update_last_write = 1;
 	}
 
 done : {
@@ -25,9 +25,78 @@
 #define BGP_WRITE_PACKET_MAX 64U
 #define BGP_READ_PACKET_MAX  10U
 
+/* most packets coalesced into one write if write-batch is set */
+#define BGP_WRITE_BATCH_PACKET_MAX 1024U
+
 #include "bgpd/bgpd.h"
 #include "frr_pthread.h"
 
+/* most regions of a shared packet that may differ for a peer */
+#define BGP_OPKT_PATCH_MAX 2
+
+/*
+ * A packet on peer->obuf.
+ *
+ * Either the packet was built for this peer alone and is held in s, or it is
+ * the body of a bpacket shared with all peers of the subgroup.  In the latter
+ * case the few bytes that differ for this peer (the nexthop addresses located
+ * through bpacket_attr_vec_arr) are held in patch[] and written in place of
+ * the corresponding regions of the body.
+ */
+struct bgp_opkt {
+	struct bgp_opkt *next;
+
+	struct stream *s;
+	struct bpacket_body *body;
+
+	uint8_t npatch;
+	struct bgp_opkt_patch {
+		size_t offset;
+		size_t len;
+		uint8_t data[IPV6_MAX_BYTELEN];
+	} patch[BGP_OPKT_PATCH_MAX];
+
+	/* bytes already written to the socket */
+	size_t written;
+};
+
+/* peer->obuf, modelled after struct stream_fifo */
+struct bgp_obuf {
+	struct bgp_opkt *head;
+	struct bgp_opkt *tail;
+	_Atomic size_t count;
+};
+
+extern struct bgp_opkt *bgp_opkt_new(struct stream *s);
+extern struct bgp_opkt *bgp_opkt_new_shared(struct bpacket_body *body);
+extern void bgp_opkt_free(struct bgp_opkt *opkt);
+
+/**
+ * Replaces len bytes at offset in the shared body of opkt with data for this
+ * peer only.  Patches must not overlap.
+ */
+extern void bgp_opkt_patch(struct bgp_opkt *opkt, size_t offset,
+			   const void *data, size_t len);
+
+/* Returns the BGP message type of opkt. */
+extern uint8_t bgp_opkt_type(struct bgp_opkt *opkt);
+
+extern struct bgp_obuf *bgp_obuf_new(void);
+extern void bgp_obuf_free(struct bgp_obuf *obuf);
+extern void bgp_obuf_push(struct bgp_obuf *obuf, struct bgp_opkt *opkt);
+extern struct bgp_opkt *bgp_obuf_pop(struct bgp_obuf *obuf);
+extern void bgp_obuf_clean(struct bgp_obuf *obuf);
+
+static inline struct bgp_opkt *bgp_obuf_head(struct bgp_obuf *obuf)
+{
+	return obuf->head;
+}
+
+static inline size_t bgp_obuf_count(struct bgp_obuf *obuf)
+{
+	return atomic_load_explicit(&obuf->count, memory_order_acquire);
+}
+
 /**
  * Start function for write thread.
  *
@@ -100,4 +169,26 @@ extern void bgp_reads_on(struct peer *peer);
  */
 extern void bgp_reads_off(struct peer *peer);
 
+/**
+ * Whether another packet may be added to a write batch.
+ *
+ * Batches always take up to write-quanta packets.  If write-batch is set,
+ * small packets keep being added until the byte budget is used up, so that a
+ * burst of small UPDATEs still goes out in few large writes.
+ *
+ * @param packets - packets in the batch so far
+ * @param bytes - bytes in the batch so far
+ * @param quanta - bgp->wpkt_quanta
+ * @param batch_bytes - bgp->wbatch_bytes, 0 if write-batch is off
+ */
+static inline bool bgp_write_batch_room(uint32_t packets, size_t bytes,
+					uint32_t quanta, uint32_t batch_bytes)
+{
+	if (packets < quanta)
+		return true;
+
+	return batch_bytes && bytes < batch_bytes
+	       && packets < BGP_WRITE_BATCH_PACKET_MAX;
+}
+
 #endif /* _FRR_BGP_IO_H */
@@ -251,6 +251,11 @@ static void set_lcommunity_string(struct lcommunity *lcom, bool make_json,
 	lcom->str = str_buf;
 }
 
+static uint32_t lcommunity_hash_compute(const struct lcommunity *lcom)
+{
+	return jhash(lcom->val, lcom_length(lcom), 0xab125423);
+}
+
 /* Intern Large Communities Attribute.  */
 struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 {
@@ -258,6 +263,7 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 
 	assert(lcom->refcnt == 0);
 
+	lcom->hash = lcommunity_hash_compute(lcom);
 	find = (struct lcommunity *)hash_get(lcomhash, lcom, hash_alloc_intern);
 
 	if (find != lcom)
@@ -312,9 +318,11 @@ char *lcommunity_str(struct lcommunity *lcom, bool make_json,
 unsigned int lcommunity_hash_make(const void *arg)
 {
 	const struct lcommunity *lcom = arg;
-	int size = lcom_length(lcom);
 
-	return jhash(lcom->val, size, 0xab125423);
+	if (lcom->hash)
+		return lcom->hash;
+
+	return lcommunity_hash_compute(lcom);
 }
 
 /* Compare two Large Communities Attribute structure.  */
@@ -323,7 +331,7 @@ bool lcommunity_cmp(const void *arg1, const void *arg2)
 	const struct lcommunity *lcom1 = arg1;
 	const struct lcommunity *lcom2 = arg2;
 
-	if (lcom1 == NULL && lcom2 == NULL)
+	if (lcom1 == lcom2)
 		return true;
 
 	if (lcom1 == NULL || lcom2 == NULL)
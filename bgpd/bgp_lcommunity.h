@@ -36,6 +36,9 @@ struct lcommunity {
 	/* Size of Extended Communities attribute.  */
 	int size;
 
+	/* Hash of the value, cached while interned, 0 otherwise.  */
+	uint32_t hash;
+
 	/* Large Communities value.  */
 	uint8_t *val;
 
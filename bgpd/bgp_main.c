@@ -62,7 +62,10 @@
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_script.h"
 #include "bgpd/bgp_evpn_mh.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_preparse.h"
+#include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_routemap_nb.h"
 #include "bgpd/bgp_community_alias.h"
 
@@ -80,6 +83,8 @@ static const struct option longopts[] = {
 	{"int_num", required_argument, NULL, 'I'},
 	{"no_zebra", no_argument, NULL, 'Z'},
 	{"socket_size", required_argument, NULL, 's'},
+	{"parse_threads", required_argument, NULL, 'j'},
+	{"encode_threads", required_argument, NULL, 'E'},
 	{0}};
 
 /* signal definitions */
@@ -212,6 +217,7 @@ static __attribute__((__noreturn__)) void bgp_exit(int status)
 		bgp_delete(bgp_default);
 
 	bgp_evpn_mh_finish();
+	bgp_nhg_finish();
 	bgp_l3nhg_finish();
 
 	/* reverse bgp_dump_init */
@@ -396,6 +402,8 @@ int main(int argc, char **argv)
 	int skip_runas = 0;
 	int instance = 0;
 	int buffer_size = BGP_SOCKET_SNDBUF_SIZE;
+	int parse_threads = 0;
+	int encode_threads = 0;
 	char *address;
 	struct listnode *node;
 
@@ -403,7 +411,7 @@ int main(int argc, char **argv)
 
 	frr_preinit(&bgpd_di, argc, argv);
 	frr_opt_add(
-		"p:l:SnZe:I:s:" DEPRECATED_OPTIONS, longopts,
+		"p:l:SnZe:I:s:j:E:" DEPRECATED_OPTIONS, longopts,
 		"  -p, --bgp_port     Set BGP listen port number (0 means do not listen).\n"
 		"  -l, --listenon     Listen on specified address (implies -n)\n"
 		"  -n, --no_kernel    Do not install route to kernel.\n"
@@ -411,7 +419,9 @@ int main(int argc, char **argv)
 		"  -S, --skip_runas   Skip capabilities checks, and changing user and group IDs.\n"
 		"  -e, --ecmp         Specify ECMP to use.\n"
 		"  -I, --int_num      Set instance number (label-manager)\n"
-		"  -s, --socket_size  Set BGP peer socket send buffer size\n");
+		"  -s, --socket_size  Set BGP peer socket send buffer size\n"
+		"  -j, --parse_threads Number of UPDATE pre-parse threads\n"
+		"  -E, --encode_threads Number of UPDATE encode threads\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -473,6 +483,26 @@ int main(int argc, char **argv)
 		case 's':
 			buffer_size = atoi(optarg);
 			break;
+		case 'j':
+			parse_threads = atoi(optarg);
+			if (parse_threads < 0
+			    || parse_threads > BGP_PREPARSE_THREADS_MAX) {
+				zlog_err(
+					"Number of parse threads must be between 0 and %u",
+					BGP_PREPARSE_THREADS_MAX);
+				return 1;
+			}
+			break;
+		case 'E':
+			encode_threads = atoi(optarg);
+			if (encode_threads < 0
+			    || encode_threads > BGP_ENCODE_THREADS_MAX) {
+				zlog_err(
+					"Number of encode threads must be between 0 and %u",
+					BGP_ENCODE_THREADS_MAX);
+				return 1;
+			}
+			break;
 		default:
 			frr_help_exit(1);
 		}
@@ -483,6 +513,8 @@ int main(int argc, char **argv)
 	/* BGP master init. */
 	bgp_master_init(frr_init(), buffer_size, addresses);
 	bm->port = bgp_port;
+	bm->parse_threads = parse_threads;
+	bm->encode_threads = encode_threads;
 	if (bgp_port == 0)
 		bgp_option_set(BGP_OPT_NO_LISTEN);
 	if (no_fib_flag || no_zebra_flag)
@@ -89,6 +89,7 @@ DEFINE_MTYPE(BGPD, BGP_CLEAR_NODE_QUEUE, "BGP node clear queue");
 
 DEFINE_MTYPE(BGPD, TRANSIT, "BGP transit attr");
 DEFINE_MTYPE(BGPD, TRANSIT_VAL, "BGP transit val");
+DEFINE_MTYPE(BGPD, BGP_EVPN_ATTR, "BGP EVPN attributes");
 
 DEFINE_MTYPE(BGPD, BGP_DEBUG_FILTER, "BGP debug filter");
 DEFINE_MTYPE(BGPD, BGP_DEBUG_STR, "BGP debug filter string");
@@ -85,6 +85,7 @@ DECLARE_MTYPE(BGP_CLEAR_NODE_QUEUE);
 
 DECLARE_MTYPE(TRANSIT);
 DECLARE_MTYPE(TRANSIT_VAL);
+DECLARE_MTYPE(BGP_EVPN_ATTR);
 
 DECLARE_MTYPE(BGP_DEBUG_FILTER);
 DECLARE_MTYPE(BGP_DEBUG_STR);
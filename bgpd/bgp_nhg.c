@@ -0,0 +1,555 @@
+/*
+ * BGP nexthop-groups for route installation
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "jhash.h"
+#include "memory.h"
+#include "nexthop.h"
+#include "typesafe.h"
+#include "vty.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_debug.h"
+#include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_nhg.h"
+#include "bgpd/bgp_nht.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+#include "bgpd/bgp_zebra.h"
+
+extern struct zclient *zclient;
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_NHG, "BGP nexthop-group");
+
+PREDECL_HASH(bgp_nhg_cache);
+PREDECL_HASH(bgp_nhg_ids);
+
+struct bgp_nhg {
+	/*
+	 * All groups are kept by id, only those that can still be handed out
+	 * to routes by BGP nexthops.
+	 */
+	struct bgp_nhg_cache_item cache_item;
+	struct bgp_nhg_ids_item ids_item;
+
+	uint32_t id;
+
+	/* Number of routes using the group */
+	uint32_t refcnt;
+
+	uint16_t flags;
+/* Not handed out anymore, only used until its routes are sent again */
+#define BGP_NHG_FLAG_STALE (1 << 0)
+#define BGP_NHG_FLAG_SENT (1 << 1)
+#define BGP_NHG_FLAG_INSTALLED (1 << 2)
+/*
+ * zebra could not install it, routes with these nexthops are sent with
+ * the nexthops themselves for as long as the group exists
+ */
+#define BGP_NHG_FLAG_FAILED (1 << 3)
+
+	uint16_t nexthop_num;
+	struct bgp_nhg_nexthop nexthops[MULTIPATH_NUM];
+};
+
+static int bgp_nhg_cache_cmp(const struct bgp_nhg *a, const struct bgp_nhg *b)
+{
+	unsigned int i;
+
+	if (a->nexthop_num != b->nexthop_num)
+		return 1;
+
+	for (i = 0; i < a->nexthop_num; i++)
+		if (a->nexthops[i].bnc != b->nexthops[i].bnc
+		    || a->nexthops[i].weight != b->nexthops[i].weight)
+			return 1;
+
+	return 0;
+}
+
+static uint32_t bgp_nhg_cache_hash(const struct bgp_nhg *nhg)
+{
+	uint32_t key = nhg->nexthop_num;
+	unsigned int i;
+
+	for (i = 0; i < nhg->nexthop_num; i++)
+		key = jhash_2words((uint32_t)(uintptr_t)nhg->nexthops[i].bnc,
+				   nhg->nexthops[i].weight, key);
+
+	return key;
+}
+
+DECLARE_HASH(bgp_nhg_cache, struct bgp_nhg, cache_item, bgp_nhg_cache_cmp,
+	     bgp_nhg_cache_hash);
+
+static int bgp_nhg_ids_cmp(const struct bgp_nhg *a, const struct bgp_nhg *b)
+{
+	return numcmp(a->id, b->id);
+}
+
+static uint32_t bgp_nhg_ids_hash(const struct bgp_nhg *nhg)
+{
+	return jhash_1word(nhg->id, 0);
+}
+
+DECLARE_HASH(bgp_nhg_ids, struct bgp_nhg, ids_item, bgp_nhg_ids_cmp,
+	     bgp_nhg_ids_hash);
+
+static struct bgp_nhg_cache_head bgp_nhg_cache;
+static struct bgp_nhg_ids_head bgp_nhg_ids;
+
+static int bgp_nhg_nexthop_cmp(const void *a, const void *b)
+{
+	const struct bgp_nhg_nexthop *na = a, *nb = b;
+
+	if (na->bnc != nb->bnc)
+		return na->bnc < nb->bnc ? -1 : 1;
+
+	return numcmp(na->weight, nb->weight);
+}
+
+bool bgp_nhg_nexthop_usable(const struct bgp_nexthop_cache *bnc,
+			    const struct zapi_nexthop *api_nh)
+{
+	if (!bnc || !CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID)
+	    || bnc->is_evpn_gwip_nexthop || bnc->srte_color)
+		return false;
+
+	if (CHECK_FLAG(api_nh->flags, ZAPI_NEXTHOP_FLAG_LABEL)
+	    || CHECK_FLAG(api_nh->flags, ZAPI_NEXTHOP_FLAG_SEG6)
+	    || CHECK_FLAG(api_nh->flags, ZAPI_NEXTHOP_FLAG_EVPN)
+	    || api_nh->srte_color)
+		return false;
+
+	return api_nh->vrf_id == bnc->bgp->vrf_id;
+}
+
+static void bgp_nhg_add_zapi(struct zapi_nhg *api_nhg,
+			     const struct zapi_nexthop *api_nh)
+{
+	unsigned int i;
+
+	for (i = 0; i < api_nhg->nexthop_num; i++)
+		if (!memcmp(&api_nhg->nexthops[i], api_nh, sizeof(*api_nh)))
+			return;
+
+	if (api_nhg->nexthop_num < MULTIPATH_NUM)
+		api_nhg->nexthops[api_nhg->nexthop_num++] = *api_nh;
+}
+
+/*
+ * Add what a BGP nexthop resolves to to the group.  zebra only accepts
+ * gateways with an interface in groups given by daemons, so directly
+ * connected nexthops get the BGP nexthop as gateway.
+ */
+static bool bgp_nhg_add_resolved(struct zapi_nhg *api_nhg,
+				 const struct bgp_nhg_nexthop *nhgnh)
+{
+	const struct bgp_nexthop_cache *bnc = nhgnh->bnc;
+	struct zapi_nexthop api_nh;
+	struct nexthop *nh;
+
+	for (nh = bnc->nexthop; nh || bnc->ifindex; nh = nh->next) {
+		memset(&api_nh, 0, sizeof(api_nh));
+
+		/* interface based nexthops have no resolution */
+		if (bnc->ifindex || nh->type == NEXTHOP_TYPE_IFINDEX) {
+			api_nh.vrf_id = bnc->bgp->vrf_id;
+			api_nh.ifindex = bnc->ifindex ? bnc->ifindex
+						      : nh->ifindex;
+			if (bnc->prefix.family == AF_INET) {
+				api_nh.type = NEXTHOP_TYPE_IPV4_IFINDEX;
+				api_nh.gate.ipv4 = bnc->prefix.u.prefix4;
+			} else {
+				api_nh.type = NEXTHOP_TYPE_IPV6_IFINDEX;
+				api_nh.gate.ipv6 = bnc->prefix.u.prefix6;
+			}
+		} else if (nh->type == NEXTHOP_TYPE_IPV4_IFINDEX
+			   || nh->type == NEXTHOP_TYPE_IPV6_IFINDEX)
+			zapi_nexthop_from_nexthop(&api_nh, nh);
+		else
+			return false;
+
+		if (!api_nh.ifindex)
+			return false;
+
+		api_nh.weight = nhgnh->weight;
+		bgp_nhg_add_zapi(api_nhg, &api_nh);
+
+		if (bnc->ifindex)
+			break;
+	}
+
+	return true;
+}
+
+static void bgp_nhg_zebra_del(struct bgp_nhg *nhg)
+{
+	struct zapi_nhg api_nhg = {};
+
+	if (!zclient || zclient->sock < 0)
+		return;
+
+	api_nhg.id = nhg->id;
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("Tx nexthop-group delete id %u", nhg->id);
+
+	zclient_nhg_send(zclient, ZEBRA_NHG_DEL, &api_nhg);
+}
+
+/*
+ * Send the current resolution of the group's nexthops to zebra, creating or
+ * replacing the group there.
+ */
+static bool bgp_nhg_update(struct bgp_nhg *nhg)
+{
+	struct zapi_nhg api_nhg = {};
+	unsigned int i;
+
+	if (!zclient || zclient->sock < 0)
+		return false;
+
+	api_nhg.id = nhg->id;
+
+	for (i = 0; i < nhg->nexthop_num; i++) {
+		if (!nhg->nexthops[i].bnc
+		    || !CHECK_FLAG(nhg->nexthops[i].bnc->flags,
+				   BGP_NEXTHOP_VALID))
+			continue;
+
+		if (!bgp_nhg_add_resolved(&api_nhg, &nhg->nexthops[i]))
+			return false;
+	}
+
+	if (!api_nhg.nexthop_num)
+		return false;
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("Tx nexthop-group add id %u, %u BGP nexthops resolving to %u nexthops",
+			   nhg->id, nhg->nexthop_num, api_nhg.nexthop_num);
+
+	if (zclient_nhg_send(zclient, ZEBRA_NHG_ADD, &api_nhg)
+	    == ZCLIENT_SEND_FAILURE)
+		return false;
+
+	SET_FLAG(nhg->flags, BGP_NHG_FLAG_SENT);
+	return true;
+}
+
+static void bgp_nhg_stale(struct bgp_nhg *nhg)
+{
+	if (CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_STALE))
+		return;
+
+	bgp_nhg_cache_del(&bgp_nhg_cache, nhg);
+	SET_FLAG(nhg->flags, BGP_NHG_FLAG_STALE);
+}
+
+static void bgp_nhg_free(struct bgp_nhg *nhg)
+{
+	if (!CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_STALE))
+		bgp_nhg_cache_del(&bgp_nhg_cache, nhg);
+	bgp_nhg_ids_del(&bgp_nhg_ids, nhg);
+	bgp_l3nhg_id_free(nhg->id);
+	XFREE(MTYPE_BGP_NHG, nhg);
+}
+
+struct bgp_nhg *bgp_nhg_get(struct bgp_nhg_nexthop *nexthops,
+			    unsigned int nexthop_num)
+{
+	struct bgp_nhg lookup, *nhg;
+
+	if (!nexthop_num || nexthop_num > MULTIPATH_NUM)
+		return NULL;
+
+	qsort(nexthops, nexthop_num, sizeof(*nexthops), bgp_nhg_nexthop_cmp);
+
+	memset(&lookup, 0, sizeof(lookup));
+	lookup.nexthop_num = nexthop_num;
+	memcpy(lookup.nexthops, nexthops, nexthop_num * sizeof(*nexthops));
+
+	nhg = bgp_nhg_cache_find(&bgp_nhg_cache, &lookup);
+	if (nhg && CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED))
+		return NULL;
+	if (!nhg) {
+		uint32_t id = bgp_l3nhg_id_alloc();
+
+		if (!id)
+			return NULL;
+
+		nhg = XCALLOC(MTYPE_BGP_NHG, sizeof(*nhg));
+		nhg->id = id;
+		nhg->nexthop_num = nexthop_num;
+		memcpy(nhg->nexthops, nexthops,
+		       nexthop_num * sizeof(*nexthops));
+		bgp_nhg_cache_add(&bgp_nhg_cache, nhg);
+		bgp_nhg_ids_add(&bgp_nhg_ids, nhg);
+	}
+
+	if (!CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_SENT)
+	    && !bgp_nhg_update(nhg)) {
+		if (!nhg->refcnt)
+			bgp_nhg_free(nhg);
+		return NULL;
+	}
+
+	nhg->refcnt++;
+	return nhg;
+}
+
+void bgp_nhg_put(struct bgp_nhg *nhg)
+{
+	if (!nhg)
+		return;
+
+	assert(nhg->refcnt);
+	if (--nhg->refcnt)
+		return;
+
+	if (CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_SENT))
+		bgp_nhg_zebra_del(nhg);
+
+	bgp_nhg_free(nhg);
+}
+
+uint32_t bgp_nhg_id(const struct bgp_nhg *nhg)
+{
+	return nhg->id;
+}
+
+bool bgp_nhg_has_nexthop(const struct bgp_nhg *nhg,
+			 const struct bgp_nexthop_cache *bnc)
+{
+	unsigned int i;
+
+	if (!nhg)
+		return false;
+
+	for (i = 0; i < nhg->nexthop_num; i++)
+		if (nhg->nexthops[i].bnc == bnc)
+			return true;
+
+	return false;
+}
+
+bool bgp_nhg_nexthop_changed(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_nhg *nhg;
+	bool updated = true;
+
+	frr_each_safe (bgp_nhg_cache, &bgp_nhg_cache, nhg) {
+		if (!CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_SENT)
+		    || CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED)
+		    || !bgp_nhg_has_nexthop(nhg, bnc))
+			continue;
+
+		/*
+		 * If the group cannot be updated, e.g. none of its nexthops
+		 * is left, the routes using it have to be sent again and
+		 * must not get it back.
+		 */
+		if (!bgp_nhg_update(nhg)) {
+			bgp_nhg_stale(nhg);
+			updated = false;
+		}
+	}
+
+	return updated;
+}
+
+void bgp_nhg_nexthop_free(struct bgp_nexthop_cache *bnc)
+{
+	struct bgp_nhg *nhg;
+	unsigned int i;
+
+	/*
+	 * The routes using these groups are going to be sent again with other
+	 * nexthops, they are kept as they are until then.
+	 */
+	frr_each (bgp_nhg_ids, &bgp_nhg_ids, nhg) {
+		if (!bgp_nhg_has_nexthop(nhg, bnc))
+			continue;
+
+		bgp_nhg_stale(nhg);
+		for (i = 0; i < nhg->nexthop_num; i++)
+			if (nhg->nexthops[i].bnc == bnc)
+				nhg->nexthops[i].bnc = NULL;
+	}
+}
+
+void bgp_nhg_zebra_reset(void)
+{
+	struct bgp_nhg *nhg;
+
+	frr_each (bgp_nhg_ids, &bgp_nhg_ids, nhg)
+		UNSET_FLAG(nhg->flags, BGP_NHG_FLAG_SENT
+					       | BGP_NHG_FLAG_INSTALLED
+					       | BGP_NHG_FLAG_FAILED);
+}
+
+/*
+ * Send the routes using a group zebra failed to install again.  Each of
+ * them has a path through one of the group's BGP nexthops, and gets the
+ * nexthops themselves as the group is not handed out while it is failed.
+ */
+static void bgp_nhg_resend(struct bgp_nhg *nhg)
+{
+	struct bgp_nexthop_cache *bnc;
+	struct bgp_path_info *path, *pi;
+	struct bgp_dest *dest;
+	struct bgp_table *table;
+	unsigned int i;
+
+	/* the last route moving off it must not free it under us */
+	nhg->refcnt++;
+
+	for (i = 0; i < nhg->nexthop_num; i++) {
+		bnc = nhg->nexthops[i].bnc;
+		if (!bnc)
+			continue;
+
+		LIST_FOREACH (path, &(bnc->paths), nh_thread) {
+			dest = path->net;
+			if (!dest || dest->nhg != nhg)
+				continue;
+
+			for (pi = bgp_dest_get_bgp_path_info(dest); pi;
+			     pi = pi->next)
+				if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+					break;
+			if (!pi)
+				continue;
+
+			table = bgp_dest_table(dest);
+			bgp_zebra_announce(dest, bgp_dest_get_prefix(dest), pi,
+					   table->bgp, table->afi, table->safi);
+		}
+	}
+
+	bgp_nhg_put(nhg);
+}
+
+void bgp_nhg_notify(uint32_t id, enum zapi_nhg_notify_owner note)
+{
+	struct bgp_nhg lookup = { .id = id }, *nhg;
+
+	/* may be one of EVPN's */
+	nhg = bgp_nhg_ids_find(&bgp_nhg_ids, &lookup);
+	if (!nhg)
+		return;
+
+	if (BGP_DEBUG(zebra, ZEBRA))
+		zlog_debug("Rx nexthop-group id %u %s", id,
+			   zapi_nhg_notify_owner2str(note));
+
+	switch (note) {
+	case ZAPI_NHG_INSTALLED:
+		SET_FLAG(nhg->flags, BGP_NHG_FLAG_INSTALLED);
+		UNSET_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED);
+		break;
+	case ZAPI_NHG_FAIL_INSTALL:
+		UNSET_FLAG(nhg->flags, BGP_NHG_FLAG_INSTALLED);
+		if (CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED))
+			break;
+		SET_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED);
+		bgp_nhg_resend(nhg);
+		break;
+	case ZAPI_NHG_REMOVED:
+	case ZAPI_NHG_REMOVE_FAIL:
+		break;
+	}
+}
+
+static void bgp_nhg_show(struct vty *vty, struct bgp_nhg *nhg)
+{
+	struct bgp_nexthop_cache *bnc;
+	unsigned int i;
+
+	vty_out(vty, "ID %u, %u route(s), %s%s\n", nhg->id, nhg->refcnt,
+		CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_INSTALLED)
+			? "installed"
+			: CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_FAILED)
+				  ? "failed"
+				  : "not installed",
+		CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_STALE) ? ", stale" : "");
+
+	for (i = 0; i < nhg->nexthop_num; i++) {
+		bnc = nhg->nexthops[i].bnc;
+		if (!bnc)
+			continue;
+
+		vty_out(vty, "  via %pFX", &bnc->prefix);
+		if (bnc->ifindex)
+			vty_out(vty, " if %u", bnc->ifindex);
+		vty_out(vty, " %s, %s", bnc->bgp->name_pretty,
+			CHECK_FLAG(bnc->flags, BGP_NEXTHOP_VALID) ? "valid"
+								  : "invalid");
+		if (nhg->nexthops[i].weight)
+			vty_out(vty, ", weight %u", nhg->nexthops[i].weight);
+		vty_out(vty, "\n");
+	}
+}
+
+DEFUN (show_bgp_nexthop_group,
+       show_bgp_nexthop_group_cmd,
+       "show [ip] bgp nexthop-group",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       "Nexthop-groups routes are installed through\n")
+{
+	struct bgp_nhg *nhg;
+
+	vty_out(vty, "Nexthop-groups: %zu\n", bgp_nhg_ids_count(&bgp_nhg_ids));
+
+	frr_each (bgp_nhg_ids, &bgp_nhg_ids, nhg)
+		bgp_nhg_show(vty, nhg);
+
+	return CMD_SUCCESS;
+}
+
+void bgp_nhg_vty_init(void)
+{
+	install_element(VIEW_NODE, &show_bgp_nexthop_group_cmd);
+}
+
+void bgp_nhg_init(void)
+{
+	bgp_nhg_cache_init(&bgp_nhg_cache);
+	bgp_nhg_ids_init(&bgp_nhg_ids);
+}
+
+void bgp_nhg_finish(void)
+{
+	struct bgp_nhg *nhg;
+
+	while ((nhg = bgp_nhg_ids_pop(&bgp_nhg_ids))) {
+		if (!CHECK_FLAG(nhg->flags, BGP_NHG_FLAG_STALE))
+			bgp_nhg_cache_del(&bgp_nhg_cache, nhg);
+		XFREE(MTYPE_BGP_NHG, nhg);
+	}
+
+	bgp_nhg_cache_fini(&bgp_nhg_cache);
+	bgp_nhg_ids_fini(&bgp_nhg_ids);
+}
@@ -0,0 +1,91 @@
+/*
+ * BGP nexthop-groups for route installation
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _BGP_NHG_H
+#define _BGP_NHG_H
+
+#include "zclient.h"
+
+struct bgp_nexthop_cache;
+struct bgp_nhg;
+
+/*
+ * With "bgp install nexthop-group", routes are sent to zebra referencing
+ * a nexthop-group owned by bgpd instead of carrying their own nexthops.
+ * A group is identified by the BGP nexthops of the paths installed, so all
+ * routes using the same set of BGP nexthops share it, and it contains what
+ * those nexthops currently resolve to.  When the resolution of a BGP nexthop
+ * changes, the groups using it are updated in place and the routes do not
+ * need to be sent again.
+ */
+struct bgp_nhg_nexthop {
+	struct bgp_nexthop_cache *bnc;
+	uint32_t weight;
+};
+
+extern void bgp_nhg_init(void);
+extern void bgp_nhg_finish(void);
+extern void bgp_nhg_vty_init(void);
+
+/*
+ * Can a path resolving through bnc, sent to zebra as api_nh, be installed
+ * through a nexthop-group?
+ */
+extern bool bgp_nhg_nexthop_usable(const struct bgp_nexthop_cache *bnc,
+				   const struct zapi_nexthop *api_nh);
+
+/*
+ * Find or create the nexthop-group for a set of BGP nexthops and take a
+ * reference on it.  A new group is sent to zebra right away.
+ *
+ * @return the group, or NULL if none can be used
+ */
+extern struct bgp_nhg *bgp_nhg_get(struct bgp_nhg_nexthop *nexthops,
+				   unsigned int nexthop_num);
+
+/*
+ * Drop a reference taken with bgp_nhg_get().  The group is removed from
+ * zebra when no route uses it anymore.
+ */
+extern void bgp_nhg_put(struct bgp_nhg *nhg);
+
+extern uint32_t bgp_nhg_id(const struct bgp_nhg *nhg);
+
+/* Does nhg contain bnc? nhg may be NULL. */
+extern bool bgp_nhg_has_nexthop(const struct bgp_nhg *nhg,
+				const struct bgp_nexthop_cache *bnc);
+
+/*
+ * The resolution of bnc changed, update the groups containing it in zebra.
+ *
+ * @return true if all of them were updated, so the routes using them do
+ * not need to be sent again
+ */
+extern bool bgp_nhg_nexthop_changed(struct bgp_nexthop_cache *bnc);
+
+/* bnc is about to be freed */
+extern void bgp_nhg_nexthop_free(struct bgp_nexthop_cache *bnc);
+
+/* zebra (re)connected, the groups have to be sent again */
+extern void bgp_nhg_zebra_reset(void);
+
+extern void bgp_nhg_notify(uint32_t id, enum zapi_nhg_notify_owner note);
+
+#endif /* _BGP_NHG_H */
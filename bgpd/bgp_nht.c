@@ -40,6 +40,7 @@
 #include "bgpd/bgp_nexthop.h"
 #include "bgpd/bgp_debug.h"
 #include "bgpd/bgp_errors.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_fsm.h"
 #include "bgpd/bgp_zebra.h"
@@ -1073,6 +1074,7 @@ void evaluate_paths(struct bgp_nexthop_cache *bnc)
 	safi_t safi;
 	struct bgp *bgp_path;
 	const struct prefix *p;
+	bool nhg_updated = false;
 
 	if (BGP_DEBUG(nht, NHT)) {
 		char bnc_buf[BNC_FLAG_DUMP_SIZE];
@@ -1088,6 +1090,13 @@ void evaluate_paths(struct bgp_nexthop_cache *bnc)
 							  sizeof(bnc_buf)));
 	}
 
+	/*
+	 * The nexthop-groups routes are installed through follow the new
+	 * resolution themselves, these routes need not be sent again.
+	 */
+	if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
+		nhg_updated = bgp_nhg_nexthop_changed(bnc);
+
 	LIST_FOREACH (path, &(bnc->paths), nh_thread) {
 		if (!(path->type == ZEBRA_ROUTE_BGP
 		      && ((path->sub_type == BGP_ROUTE_NORMAL)
@@ -1126,7 +1135,7 @@ void evaluate_paths(struct bgp_nexthop_cache *bnc)
 
 		if (safi == SAFI_UNICAST && path->sub_type == BGP_ROUTE_IMPORTED
 		    && path->extra && path->extra->num_labels
-		    && (path->attr->evpn_overlay.type
+		    && (bgp_attr_get_evpn(path->attr)->overlay.type
 			!= OVERLAY_INDEX_GATEWAY_IP)) {
 			bnc_is_valid_nexthop =
 				bgp_isvalid_nexthop_for_mpls(bnc, path) ? true
@@ -1175,7 +1184,9 @@ void evaluate_paths(struct bgp_nexthop_cache *bnc)
 			path->extra->igpmetric = 0;
 
 		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
-		    || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
+		    || (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED)
+			&& !(nhg_updated
+			     && bgp_nhg_has_nexthop(dest->nhg, bnc)))
 		    || path->attr->srte_color != 0)
 			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
 
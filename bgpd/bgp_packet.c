@@ -63,6 +63,7 @@
 #include "bgpd/bgp_io.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
+#include "bgpd/bgp_preparse.h"
 #include "bgpd/bgp_trace.h"
 
 DEFINE_HOOK(bgp_packet_dump,
@@ -120,7 +121,7 @@ void bgp_packet_set_size(struct stream *s)
  * Push a packet onto the beginning of the peer's output queue.
  * This function acquires the peer's write mutex before proceeding.
  */
-static void bgp_packet_add(struct peer *peer, struct stream *s)
+static void bgp_opkt_add(struct peer *peer, struct bgp_opkt *opkt)
 {
 	intmax_t delta;
 	uint32_t holdtime;
@@ -130,10 +131,10 @@ static void bgp_packet_add(struct peer *peer, struct stream *s)
 		 * now, otherwise if we write another packet immediately
 		 * after it'll get confused
 		 */
-		if (!stream_fifo_count_safe(peer->obuf))
+		if (!bgp_obuf_count(peer->obuf))
 			peer->last_sendq_ok = monotime(NULL);
 
-		stream_fifo_push(peer->obuf, s);
+		bgp_obuf_push(peer->obuf, opkt);
 
 		delta = monotime(NULL) - peer->last_sendq_ok;
 		holdtime = atomic_load_explicit(&peer->holdtime,
@@ -166,6 +167,11 @@ static void bgp_packet_add(struct peer *peer, struct stream *s)
 	}
 }
 
+static void bgp_packet_add(struct peer *peer, struct stream *s)
+{
+	bgp_opkt_add(peer, bgp_opkt_new(s));
+}
+
 static struct stream *bgp_update_packet_eor(struct peer *peer, afi_t afi,
 					    safi_t safi)
 {
@@ -430,15 +436,20 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 	struct peer *peer = THREAD_ARG(thread);
 
 	struct stream *s;
+	struct bgp_opkt *opkt;
 	struct peer_af *paf;
 	struct bpacket *next_pkt;
 	uint32_t wpq;
+	uint32_t wbatch;
 	uint32_t generated = 0;
+	size_t generated_bytes = 0;
 	afi_t afi;
 	safi_t safi;
 
 	wpq = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 				   memory_order_relaxed);
+	wbatch = atomic_load_explicit(&peer->bgp->wbatch_bytes,
+				      memory_order_relaxed);
 
 	/*
 	 * The code beyond this part deals with update packets, proceed only
@@ -567,14 +578,20 @@ void bgp_generate_updgrp_packets(struct thread *thread)
 			/* Update packet send time */
 			peer->pkt_stime[afi][safi] = monotime(NULL);
 
-			/* Found a packet template to send, overwrite
-			 * packet with appropriate attributes from peer
+			/* Found a packet template to send, queue it with
+			 * the appropriate attributes from peer patched in
 			 * and advance peer */
-			s = bpacket_reformat_for_peer(next_pkt, paf);
-			bgp_packet_add(peer, s);
+			opkt = bpacket_reformat_for_peer(next_pkt, paf);
+			s = NULL;
+			if (opkt) {
+				s = next_pkt->buffer;
+				generated_bytes += stream_get_endp(s);
+				bgp_opkt_add(peer, opkt);
+			}
 			bpacket_queue_advance_peer(paf);
 		}
-	} while (s && (++generated < wpq));
+	} while (s && bgp_write_batch_room(++generated, generated_bytes, wpq,
+					   wbatch));
 
 	if (generated)
 		bgp_writes_on(peer);
@@ -682,7 +699,7 @@ void bgp_open_send(struct peer *peer)
  * Writes NOTIFICATION message directly to a peer socket without waiting for
  * the I/O thread.
  *
- * There must be exactly one stream on the peer->obuf FIFO, and the data within
+ * There must be exactly one packet on peer->obuf, and the data within
  * this stream must match the format of a BGP NOTIFICATION message.
  * Transmission is best-effort.
  *
@@ -694,14 +711,21 @@ static void bgp_write_notify(struct peer *peer)
 {
 	int ret, val;
 	uint8_t type;
+	struct bgp_opkt *opkt;
 	struct stream *s;
 
 	/* There should be at least one packet. */
-	s = stream_fifo_pop(peer->obuf);
+	opkt = bgp_obuf_pop(peer->obuf);
 
-	if (!s)
+	if (!opkt)
 		return;
 
+	/* NOTIFICATIONs are never shared */
+	s = opkt->s;
+	opkt->s = NULL;
+	bgp_opkt_free(opkt);
+	assert(s);
+
 	assert(stream_get_endp(s) >= BGP_HEADER_SIZE);
 
 	/*
@@ -911,7 +935,7 @@ void bgp_notify_send_with_data(struct peer *peer, uint8_t code,
 	bgp_packet_set_size(s);
 
 	/* wipe output buffer */
-	stream_fifo_clean(peer->obuf);
+	bgp_obuf_clean(peer->obuf);
 
 	/*
 	 * If possible, store last packet for debugging purposes. This check is
@@ -980,7 +1004,7 @@ void bgp_notify_send_with_data(struct peer *peer, uint8_t code,
 		peer->last_reset = PEER_DOWN_NOTIFY_SEND;
 
 	/* Add packet to peer's output queue */
-	stream_fifo_push(peer->obuf, s);
+	bgp_obuf_push(peer->obuf, bgp_opkt_new(s));
 
 	bgp_peer_gr_flags_update(peer);
 	BGP_GR_ROUTER_DETECT_AND_SEND_CAPABILITY_TO_ZEBRA(peer->bgp,
@@ -2819,7 +2843,9 @@ void bgp_process_packet(struct thread *thread)
 			atomic_fetch_add_explicit(&peer->update_in, 1,
 						  memory_order_relaxed);
 			peer->readtime = monotime(NULL);
+			bgp_preparse_begin(peer);
 			mprc = bgp_update_receive(peer, size);
+			bgp_preparse_end(peer);
 			if (mprc == BGP_Stop)
 				flog_err(
 					EC_BGP_UPDATE_RCV,
@@ -0,0 +1,434 @@
+/* BGP UPDATE pre-parse.
+ * Decodes parts of received UPDATEs on a pool of pthreads before they are
+ * processed by the main pthread.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "frr_pthread.h"
+#include "frratomic.h"
+#include "memory.h"
+#include "monotime.h"
+#include "stream.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_preparse.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PREPARSE, "BGP UPDATE pre-parse result");
+
+static struct frr_pthread *bgp_pth_preparse[BGP_PREPARSE_THREADS_MAX];
+static unsigned int bgp_preparse_nthreads;
+static unsigned int bgp_preparse_next;
+
+/*
+ * Per-stage latency statistics, only covering packets that went through the
+ * pre-parse pthreads.
+ *
+ * queue:   packet framed on the I/O pthread until picked up for pre-parsing
+ * parse:   pre-parsing of a batch of packets
+ * handoff: UPDATE pre-parsed until picked up by the main pthread
+ * process: UPDATE processing on the main pthread
+ */
+enum bgp_preparse_stage {
+	BGP_PREPARSE_STAGE_QUEUE = 0,
+	BGP_PREPARSE_STAGE_PARSE,
+	BGP_PREPARSE_STAGE_HANDOFF,
+	BGP_PREPARSE_STAGE_PROCESS,
+	BGP_PREPARSE_STAGE_MAX,
+};
+
+static struct bgp_preparse_stat {
+	const char *name;
+	_Atomic uint64_t count;
+	_Atomic uint64_t total_usec;
+	_Atomic uint64_t max_usec;
+} bgp_preparse_stats[BGP_PREPARSE_STAGE_MAX] = {
+	[BGP_PREPARSE_STAGE_QUEUE] = {.name = "queue"},
+	[BGP_PREPARSE_STAGE_PARSE] = {.name = "parse"},
+	[BGP_PREPARSE_STAGE_HANDOFF] = {.name = "handoff"},
+	[BGP_PREPARSE_STAGE_PROCESS] = {.name = "process"},
+};
+
+static void bgp_preparse_stat_add(enum bgp_preparse_stage stage,
+				  int64_t usec)
+{
+	struct bgp_preparse_stat *stat = &bgp_preparse_stats[stage];
+	uint64_t max;
+
+	if (usec < 0)
+		usec = 0;
+
+	atomic_fetch_add_explicit(&stat->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stat->total_usec, usec,
+				  memory_order_relaxed);
+
+	max = atomic_load_explicit(&stat->max_usec, memory_order_relaxed);
+	while ((uint64_t)usec > max
+	       && !atomic_compare_exchange_weak_explicit(
+		       &stat->max_usec, &max, usec, memory_order_relaxed,
+		       memory_order_relaxed))
+		;
+}
+
+static void bgp_preparse_free(struct bgp_preparse *pp)
+{
+	aspath_free(pp->aspath);
+	if (pp->community)
+		community_free(&pp->community);
+	XFREE(MTYPE_BGP_PREPARSE, pp);
+}
+
+/*
+ * Walks the attributes of an UPDATE and decodes the ones whose decoding is
+ * expensive but independent of shared state.
+ *
+ * Only framing needed to find the attributes is checked here, all actual
+ * validation is left to bgp_update_receive() on the main pthread.  Returns
+ * NULL if there was nothing to prepare.
+ */
+static struct bgp_preparse *bgp_update_preparse(struct stream *pkt, bool as4)
+{
+	const uint8_t *data = STREAM_DATA(pkt);
+	size_t end = stream_get_endp(pkt);
+	size_t pos = BGP_HEADER_SIZE;
+	size_t attr_end;
+	struct bgp_preparse *pp = NULL;
+
+	if (end < BGP_HEADER_SIZE
+	    || data[BGP_MARKER_SIZE + 2] != BGP_MSG_UPDATE)
+		return NULL;
+
+	/* skip withdrawn routes */
+	if (pos + 2 > end)
+		return NULL;
+	pos += 2 + ((data[pos] << 8) | data[pos + 1]);
+
+	if (pos + 2 > end)
+		return NULL;
+	attr_end = pos + 2 + ((data[pos] << 8) | data[pos + 1]);
+	pos += 2;
+	if (attr_end > end)
+		return NULL;
+
+	while (pos + 3 <= attr_end) {
+		uint8_t flag = data[pos];
+		uint8_t type = data[pos + 1];
+		bgp_size_t length;
+
+		if (CHECK_FLAG(flag, BGP_ATTR_FLAG_EXTLEN)) {
+			if (pos + 4 > attr_end)
+				break;
+			length = (data[pos + 2] << 8) | data[pos + 3];
+			pos += 4;
+		} else {
+			length = data[pos + 2];
+			pos += 3;
+		}
+
+		if (pos + length > attr_end)
+			break;
+
+		switch (type) {
+		case BGP_ATTR_AS_PATH:
+			if (pp && pp->aspath)
+				break;
+			if (!pp)
+				pp = XCALLOC(MTYPE_BGP_PREPARSE, sizeof(*pp));
+
+			stream_set_getp(pkt, pos);
+			pp->aspath = aspath_parse_prepare(pkt, length, as4);
+			pp->aspath_off = pos;
+			pp->aspath_len = length;
+			pp->aspath_as4 = as4;
+			break;
+		case BGP_ATTR_COMMUNITIES:
+			if (pp && pp->community)
+				break;
+			if (!pp)
+				pp = XCALLOC(MTYPE_BGP_PREPARSE, sizeof(*pp));
+
+			pp->community = community_parse_prepare(
+				(uint32_t *)(data + pos), length);
+			pp->community_off = pos;
+			pp->community_len = length;
+			break;
+		}
+
+		pos += length;
+	}
+
+	stream_set_getp(pkt, 0);
+
+	if (pp && !pp->aspath && !pp->community) {
+		XFREE(MTYPE_BGP_PREPARSE, pp);
+		return NULL;
+	}
+	if (pp)
+		pp->pkt = pkt;
+
+	return pp;
+}
+
+/*
+ * Called from a pre-parse pthread when packets have been placed on
+ * peer->ibuf_preparse.
+ */
+static void bgp_preparse_packets(struct thread *thread)
+{
+	struct peer *peer = THREAD_ARG(thread);
+	struct bgp_preparse_list_head done;
+	struct stream_fifo pkts;
+	struct bgp_preparse *pp;
+	struct stream *pkt;
+	struct timeval enqueued, start, parsed;
+	bool as4;
+
+	stream_fifo_init(&pkts);
+	bgp_preparse_list_init(&done);
+
+	frr_with_mutex (&peer->io_mtx) {
+		while ((pkt = stream_fifo_pop(peer->ibuf_preparse)))
+			stream_fifo_push(&pkts, pkt);
+		enqueued = peer->preparse_enqueued;
+	}
+
+	if (!pkts.count) {
+		stream_fifo_deinit(&pkts);
+		return;
+	}
+
+	bgp_preparse_stat_add(BGP_PREPARSE_STAGE_QUEUE,
+			      monotime_since(&enqueued, NULL));
+	monotime(&start);
+
+	/* capabilities are fixed once the session is established; if an OPEN
+	 * is still pending in this batch the result is simply not used.
+	 */
+	as4 = CHECK_FLAG(peer->cap, PEER_CAP_AS4_RCV)
+	      && CHECK_FLAG(peer->cap, PEER_CAP_AS4_ADV);
+
+	for (pkt = stream_fifo_head(&pkts); pkt; pkt = pkt->next) {
+		pp = bgp_update_preparse(pkt, as4);
+		if (pp)
+			bgp_preparse_list_add_tail(&done, pp);
+	}
+
+	bgp_preparse_stat_add(BGP_PREPARSE_STAGE_PARSE,
+			      monotime_since(&start, &parsed));
+	timeradd(&start, &parsed, &parsed);
+
+	frr_with_mutex (&peer->io_mtx) {
+		while ((pkt = stream_fifo_pop(&pkts)))
+			stream_fifo_push(peer->ibuf, pkt);
+		while ((pp = bgp_preparse_list_pop(&done))) {
+			pp->t_parsed = parsed;
+			bgp_preparse_list_add_tail(&peer->preparsed, pp);
+		}
+	}
+
+	stream_fifo_deinit(&pkts);
+	bgp_preparse_list_fini(&done);
+
+	thread_add_event(bm->master, bgp_process_packet, peer, 0,
+			 &peer->t_process_packet);
+}
+
+void bgp_preparse_init(unsigned int nthreads)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	char name[32], os_name[OS_THREAD_NAMELEN];
+	unsigned int i;
+
+	bgp_preparse_nthreads = MIN(nthreads, BGP_PREPARSE_THREADS_MAX);
+
+	for (i = 0; i < bgp_preparse_nthreads; i++) {
+		snprintf(name, sizeof(name), "BGP pre-parse thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_parse%u", i);
+		bgp_pth_preparse[i] = frr_pthread_new(&attr, name, os_name);
+	}
+}
+
+void bgp_preparse_run(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < bgp_preparse_nthreads; i++)
+		frr_pthread_run(bgp_pth_preparse[i], NULL);
+
+	/* Wait until threads are ready. */
+	for (i = 0; i < bgp_preparse_nthreads; i++)
+		frr_pthread_wait_running(bgp_pth_preparse[i]);
+}
+
+void bgp_preparse_peer_assign(struct peer *peer)
+{
+	if (!bgp_preparse_nthreads) {
+		peer->preparse_fpt = NULL;
+		return;
+	}
+
+	peer->preparse_fpt =
+		bgp_pth_preparse[bgp_preparse_next++ % bgp_preparse_nthreads];
+}
+
+void bgp_preparse_schedule(struct peer *peer)
+{
+	thread_add_event(peer->preparse_fpt->master, bgp_preparse_packets,
+			 peer, 0, &peer->t_preparse);
+}
+
+void bgp_preparse_off(struct peer *peer)
+{
+	if (!peer->preparse_fpt)
+		return;
+
+	assert(peer->preparse_fpt->running);
+	thread_cancel_async(peer->preparse_fpt->master, &peer->t_preparse,
+			    NULL);
+}
+
+void bgp_preparse_flush(struct peer *peer)
+{
+	struct bgp_preparse *pp;
+
+	if (peer->ibuf_preparse)
+		stream_fifo_clean(peer->ibuf_preparse);
+
+	while ((pp = bgp_preparse_list_pop(&peer->preparsed)))
+		bgp_preparse_free(pp);
+}
+
+void bgp_preparse_begin(struct peer *peer)
+{
+	struct bgp_preparse *pp;
+
+	peer->curr_preparse = NULL;
+	if (!peer->preparse_fpt)
+		return;
+
+	frr_with_mutex (&peer->io_mtx) {
+		pp = bgp_preparse_list_first(&peer->preparsed);
+		if (pp && pp->pkt == peer->curr)
+			bgp_preparse_list_pop(&peer->preparsed);
+		else
+			pp = NULL;
+	}
+
+	if (pp) {
+		bgp_preparse_stat_add(BGP_PREPARSE_STAGE_HANDOFF,
+				      monotime_since(&pp->t_parsed, NULL));
+		monotime(&pp->t_process);
+	}
+
+	peer->curr_preparse = pp;
+}
+
+void bgp_preparse_end(struct peer *peer)
+{
+	struct bgp_preparse *pp = peer->curr_preparse;
+
+	if (!pp)
+		return;
+
+	bgp_preparse_stat_add(BGP_PREPARSE_STAGE_PROCESS,
+			      monotime_since(&pp->t_process, NULL));
+
+	peer->curr_preparse = NULL;
+	bgp_preparse_free(pp);
+}
+
+struct aspath *bgp_preparse_aspath(struct peer *peer, bgp_size_t length,
+				   bool as4)
+{
+	struct bgp_preparse *pp = peer->curr_preparse;
+	struct aspath *aspath;
+
+	if (!pp || !pp->aspath || pp->aspath_as4 != as4
+	    || pp->aspath_len != length
+	    || pp->aspath_off != stream_get_getp(peer->curr))
+		return NULL;
+
+	aspath = pp->aspath;
+	pp->aspath = NULL;
+
+	return aspath_intern_prepared(aspath);
+}
+
+struct community *bgp_preparse_community(struct peer *peer,
+					 bgp_size_t length)
+{
+	struct bgp_preparse *pp = peer->curr_preparse;
+	struct community *community;
+
+	if (!pp || !pp->community || pp->community_len != length
+	    || pp->community_off != stream_get_getp(peer->curr))
+		return NULL;
+
+	community = pp->community;
+	pp->community = NULL;
+
+	return community_intern(community);
+}
+
+DEFUN (show_bgp_update_parse_statistics,
+       show_bgp_update_parse_statistics_cmd,
+       "show bgp update-parse statistics",
+       SHOW_STR
+       BGP_STR
+       "UPDATE pre-parse pthreads\n"
+       "Per-stage latency statistics\n")
+{
+	unsigned int i;
+
+	vty_out(vty, "UPDATE pre-parse threads: %u\n\n",
+		bgp_preparse_nthreads);
+	vty_out(vty, "%-10s %12s %12s %12s\n", "Stage", "Count", "Avg (us)",
+		"Max (us)");
+
+	for (i = 0; i < BGP_PREPARSE_STAGE_MAX; i++) {
+		struct bgp_preparse_stat *stat = &bgp_preparse_stats[i];
+		uint64_t count, total, max;
+
+		count = atomic_load_explicit(&stat->count,
+					     memory_order_relaxed);
+		total = atomic_load_explicit(&stat->total_usec,
+					     memory_order_relaxed);
+		max = atomic_load_explicit(&stat->max_usec,
+					   memory_order_relaxed);
+
+		vty_out(vty, "%-10s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 "\n",
+			stat->name, count, count ? total / count : 0, max);
+	}
+
+	return CMD_SUCCESS;
+}
+
+void bgp_preparse_vty_init(void)
+{
+	install_element(VIEW_NODE, &show_bgp_update_parse_statistics_cmd);
+}
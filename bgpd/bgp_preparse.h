@@ -0,0 +1,134 @@
+/* BGP UPDATE pre-parse.
+ * Decodes parts of received UPDATEs on a pool of pthreads before they are
+ * processed by the main pthread.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_PREPARSE_H
+#define _FRR_BGP_PREPARSE_H
+
+#include "frr_pthread.h"
+#include "typesafe.h"
+#include "bgpd/bgpd.h"
+
+#define BGP_PREPARSE_THREADS_MAX 16
+
+/*
+ * Work done ahead of time for one UPDATE sitting on peer->ibuf.
+ *
+ * Everything in here is built without touching shared state (in particular
+ * the attribute intern hashes), the main pthread only has to intern the
+ * prepared objects.  Anything that does not match what the main pthread
+ * finds while parsing is simply ignored and parsed the usual way.
+ */
+struct bgp_preparse {
+	struct bgp_preparse_list_item item;
+
+	/* packet this was built for */
+	struct stream *pkt;
+
+	/* decoded, un-interned AS_PATH and its position in pkt */
+	struct aspath *aspath;
+	size_t aspath_off;
+	bgp_size_t aspath_len;
+	bool aspath_as4;
+
+	/* sorted, un-interned COMMUNITIES and its position in pkt */
+	struct community *community;
+	size_t community_off;
+	bgp_size_t community_len;
+
+	/* stage timestamps for statistics */
+	struct timeval t_parsed;
+	struct timeval t_process;
+};
+
+DECLARE_LIST(bgp_preparse_list, struct bgp_preparse, item);
+
+/**
+ * Creates the pre-parse pthreads.
+ *
+ * @param nthreads - number of pthreads, 0 disables pre-parsing
+ */
+extern void bgp_preparse_init(unsigned int nthreads);
+
+/**
+ * Starts the pre-parse pthreads created by bgp_preparse_init().
+ */
+extern void bgp_preparse_run(void);
+
+/**
+ * Picks the pre-parse pthread for a peer's new session.
+ *
+ * Called from bgp_reads_on(); all packets of a peer go through the same
+ * pthread so that their order is preserved.  Sets peer->preparse_fpt to NULL
+ * if pre-parsing is disabled.
+ */
+extern void bgp_preparse_peer_assign(struct peer *peer);
+
+/**
+ * Hands framed packets on peer->ibuf_preparse to the peer's pre-parse
+ * pthread.
+ *
+ * Called from the I/O pthread; the pre-parse pthread moves the packets on to
+ * peer->ibuf and schedules bgp_process_packet() once it is done.
+ */
+extern void bgp_preparse_schedule(struct peer *peer);
+
+/**
+ * Stops pre-parsing for a peer.
+ *
+ * After this returns the pre-parse pthread no longer accesses the peer.
+ */
+extern void bgp_preparse_off(struct peer *peer);
+
+/**
+ * Drops all pre-parse results and packets not yet pre-parsed.
+ *
+ * Must be called with peer->io_mtx held, whenever peer->ibuf is flushed.
+ */
+extern void bgp_preparse_flush(struct peer *peer);
+
+/**
+ * Sets peer->curr_preparse for the UPDATE in peer->curr, if any.
+ */
+extern void bgp_preparse_begin(struct peer *peer);
+
+/**
+ * Releases peer->curr_preparse after the UPDATE has been processed.
+ */
+extern void bgp_preparse_end(struct peer *peer);
+
+/**
+ * Returns the interned AS_PATH for the attribute at the current position of
+ * peer->curr if it was prepared, NULL otherwise.  Does not move the stream.
+ */
+extern struct aspath *bgp_preparse_aspath(struct peer *peer,
+					  bgp_size_t length, bool as4);
+
+/**
+ * Returns the interned COMMUNITIES for the attribute at the current position
+ * of peer->curr if it was prepared, NULL otherwise.  Does not move the
+ * stream.
+ */
+extern struct community *bgp_preparse_community(struct peer *peer,
+						bgp_size_t length);
+
+extern void bgp_preparse_vty_init(void);
+
+#endif /* _FRR_BGP_PREPARSE_H */
@@ -26,10 +26,16 @@
 #include "queue.h"
 #include "filter.h"
 
+#include "jhash.h"
+#include "hash.h"
+
 #include "bgpd.h"
 #include "bgp_aspath.h"
 #include "bgp_regex.h"
 
+DEFINE_MTYPE_STATIC(BGPD, BGP_ASPATH_REGEX, "BGP AS path regex");
+DEFINE_MTYPE_STATIC(BGPD, BGP_ASPATH_REGEX_STATE, "BGP AS path regex state");
+
 /* Character `_' has special mean.  It represents [,{}() ] and the
    beginning of the line(^) and the end of the line ($).
 
@@ -77,13 +83,866 @@ regex_t *bgp_regcomp(const char *regstr)
 	return regex;
 }
 
-int bgp_regexec(regex_t *regex, struct aspath *aspath)
-{
-	return regexec(regex, aspath->str, 0, NULL, 0);
-}
-
 void bgp_regex_free(regex_t *regex)
 {
 	regfree(regex);
 	XFREE(MTYPE_BGP_REGEXP, regex);
 }
+
+/*
+ * AS path regular expressions
+ *
+ * The regex is parsed into a tree, which is compiled into an NFA and then
+ * turned into a DFA one state at a time, as the states are reached while
+ * matching.  Only the characters that can appear in the string form of an
+ * AS path are distinct symbols for the automaton, every other character
+ * is ASRE_SYM_OTHER, so the DFA transition table stays small.
+ *
+ * The parser takes the POSIX extended syntax that as-path access-lists
+ * allow, with '_' meaning (^|[,{}() ]|$) as in bgp_regcomp().  Anything
+ * it is not sure to interpret the same way as regcomp() is left to
+ * regexec() on aspath->str, which is also used if the DFA grows too large.
+ */
+
+enum asre_sym {
+	/* 0 to 9 are the digits */
+	ASRE_SYM_SPACE = 10,
+	ASRE_SYM_COMMA,
+	ASRE_SYM_SET_START,
+	ASRE_SYM_SET_END,
+	ASRE_SYM_CONFED_SEQ_START,
+	ASRE_SYM_CONFED_SEQ_END,
+	ASRE_SYM_CONFED_SET_START,
+	ASRE_SYM_CONFED_SET_END,
+	ASRE_SYM_OTHER,
+	ASRE_NSYMS,
+};
+
+/* The characters of the symbols above, in order */
+static const char asre_chars[] = "0123456789 ,{}()[]";
+
+#define ASRE_SYMS_ALL ((1U << ASRE_NSYMS) - 1)
+
+/* Limits beyond which regexec() is used instead */
+#define ASRE_MAX_NODES 512
+#define ASRE_MAX_STATES 2048
+#define ASRE_MAX_DSTATES 1024
+/* RE_DUP_MAX */
+#define ASRE_MAX_REPEAT 255
+
+#define ASRE_CACHE_SIZE 256
+
+enum asre_node_type {
+	ASRE_EMPTY,
+	ASRE_SYMS,
+	ASRE_BOL,
+	ASRE_EOL,
+	ASRE_CAT,
+	ASRE_ALT,
+	ASRE_REPEAT,
+};
+
+struct asre_node {
+	enum asre_node_type type;
+	/* ASRE_SYMS: bitmask of the symbols matched */
+	uint32_t syms;
+	/* ASRE_REPEAT: repetitions of left, max < 0 for no limit */
+	int min, max;
+	struct asre_node *left, *right;
+};
+
+struct asre_parser {
+	const char *p;
+	bool unsupported;
+	int nnodes;
+	struct asre_node nodes[ASRE_MAX_NODES];
+};
+
+enum asre_state_type {
+	ASRE_ST_SYMS,
+	ASRE_ST_SPLIT,
+	ASRE_ST_BOL,
+	ASRE_ST_EOL,
+	ASRE_ST_MATCH,
+};
+
+/* NFA state */
+struct asre_state {
+	enum asre_state_type type;
+	uint32_t syms;
+	int out, out1;
+};
+
+/* DFA state, standing for a set of NFA states */
+struct asre_dstate {
+	unsigned int index;
+	unsigned int nset;
+	int set[];
+};
+
+/*
+ * The DFA transitions are a table with a row per state, indexed by symbol.
+ * The last column holds the flags of the state.
+ */
+#define ASRE_DCOLS (ASRE_NSYMS + 1)
+#define ASRE_DFLAGS ASRE_NSYMS
+/* the NFA has matched */
+#define ASRE_DMATCH 0x1
+/* the NFA matches if the string ends here */
+#define ASRE_DMATCH_EOL 0x2
+/* the NFA can't match anymore */
+#define ASRE_DDEAD 0x4
+/* the result is known */
+#define ASRE_DFINAL (ASRE_DMATCH | ASRE_DDEAD)
+/* transition not computed yet */
+#define ASRE_DNONE UINT16_MAX
+
+struct asre_cache_entry {
+	const struct aspath *aspath;
+	uint32_t serial;
+	bool match;
+};
+
+struct bgp_aspath_regex {
+	/* Always compiled, used when the automaton isn't */
+	regex_t *posix;
+	bool use_posix;
+
+	struct asre_state *states;
+	int nstates, states_size;
+	int start, match;
+
+	/* DFA, the start state is the first one */
+	uint16_t (*dtable)[ASRE_DCOLS];
+	struct asre_dstate **dstates;
+	unsigned int ndstates;
+	struct hash *dstate_hash;
+
+	/* Scratch space for computing DFA states */
+	uint32_t *mark;
+	uint32_t gen;
+	int *stack;
+	int nstack;
+	struct asre_dstate *key;
+
+	/* Results by interned AS path */
+	struct asre_cache_entry cache[ASRE_CACHE_SIZE];
+};
+
+static unsigned int asre_sym(char c)
+{
+	const char *pos = c ? strchr(asre_chars, c) : NULL;
+
+	return pos ? (unsigned int)(pos - asre_chars) : ASRE_SYM_OTHER;
+}
+
+static struct asre_node *asre_node(struct asre_parser *ps,
+				   enum asre_node_type type,
+				   struct asre_node *left,
+				   struct asre_node *right)
+{
+	struct asre_node *node;
+
+	if (ps->nnodes == ASRE_MAX_NODES) {
+		ps->unsupported = true;
+		return NULL;
+	}
+
+	node = &ps->nodes[ps->nnodes++];
+	node->type = type;
+	node->left = left;
+	node->right = right;
+	return node;
+}
+
+static struct asre_node *asre_syms(struct asre_parser *ps, uint32_t syms)
+{
+	struct asre_node *node = asre_node(ps, ASRE_SYMS, NULL, NULL);
+
+	if (node)
+		node->syms = syms;
+	return node;
+}
+
+static struct asre_node *asre_unsupported(struct asre_parser *ps)
+{
+	ps->unsupported = true;
+	return NULL;
+}
+
+static struct asre_node *asre_parse_alt(struct asre_parser *ps);
+
+static struct asre_node *asre_parse_bracket(struct asre_parser *ps)
+{
+	uint32_t syms = 0;
+	bool negate = false, first = true;
+	int c, last;
+
+	if (*ps->p == '^') {
+		negate = true;
+		ps->p++;
+	}
+
+	/* a ']' right after the opening bracket is a literal */
+	while (first || *ps->p != ']') {
+		first = false;
+		c = (unsigned char)*ps->p++;
+
+		/* classes, and characters regex libraries disagree on */
+		if (c == '\0' || c == '\\' || c == '_'
+		    || (c == '[' && *ps->p && strchr(":.=", *ps->p)))
+			return asre_unsupported(ps);
+
+		last = c;
+		if (ps->p[0] == '-' && ps->p[1] && ps->p[1] != ']') {
+			last = (unsigned char)ps->p[1];
+			if (last == '\\' || last == '_' || last == '['
+			    || last < c)
+				return asre_unsupported(ps);
+			ps->p += 2;
+		}
+
+		for (; c <= last; c++)
+			syms |= 1U << asre_sym(c);
+	}
+	ps->p++;
+
+	if (negate)
+		syms = ~syms & ASRE_SYMS_ALL;
+	return asre_syms(ps, syms);
+}
+
+static struct asre_node *asre_parse_atom(struct asre_parser *ps)
+{
+	struct asre_node *node;
+	char c = *ps->p++;
+
+	switch (c) {
+	case '(':
+		node = asre_parse_alt(ps);
+		if (ps->unsupported || *ps->p != ')')
+			return asre_unsupported(ps);
+		ps->p++;
+		return node;
+	case '[':
+		return asre_parse_bracket(ps);
+	case '.':
+		return asre_syms(ps, ASRE_SYMS_ALL);
+	case '^':
+		return asre_node(ps, ASRE_BOL, NULL, NULL);
+	case '$':
+		return asre_node(ps, ASRE_EOL, NULL, NULL);
+	case '_':
+		/* (^|[,{}() ]|$) */
+		node = asre_syms(ps, 1U << ASRE_SYM_SPACE | 1U << ASRE_SYM_COMMA
+					     | 1U << ASRE_SYM_SET_START
+					     | 1U << ASRE_SYM_SET_END
+					     | 1U << ASRE_SYM_CONFED_SEQ_START
+					     | 1U << ASRE_SYM_CONFED_SEQ_END);
+		node = asre_node(ps, ASRE_ALT, node,
+				 asre_node(ps, ASRE_EOL, NULL, NULL));
+		return asre_node(ps, ASRE_ALT,
+				 asre_node(ps, ASRE_BOL, NULL, NULL), node);
+	case '\\':
+		c = *ps->p++;
+		/* back references, and '_' which bgp_regcomp() expands */
+		if (c == '\0' || isdigit((unsigned char)c) || c == '_')
+			return asre_unsupported(ps);
+		return asre_syms(ps, 1U << asre_sym(c));
+	case '*':
+	case '+':
+	case '?':
+	case '{':
+		/* nothing to repeat */
+		return asre_unsupported(ps);
+	default:
+		return asre_syms(ps, 1U << asre_sym(c));
+	}
+}
+
+static bool asre_parse_number(struct asre_parser *ps, int *val)
+{
+	if (!isdigit((unsigned char)*ps->p))
+		return false;
+
+	*val = 0;
+	while (isdigit((unsigned char)*ps->p)) {
+		*val = *val * 10 + *ps->p++ - '0';
+		if (*val > ASRE_MAX_REPEAT)
+			return false;
+	}
+	return true;
+}
+
+/* {n}, {n,} or {n,m} */
+static bool asre_parse_interval(struct asre_parser *ps, int *min, int *max)
+{
+	ps->p++;
+	if (!asre_parse_number(ps, min))
+		return false;
+
+	*max = *min;
+	if (*ps->p == ',') {
+		ps->p++;
+		if (*ps->p == '}')
+			*max = -1;
+		else if (!asre_parse_number(ps, max) || *max < *min)
+			return false;
+	}
+
+	if (*ps->p != '}')
+		return false;
+	ps->p++;
+	return true;
+}
+
+static struct asre_node *asre_parse_piece(struct asre_parser *ps)
+{
+	struct asre_node *node;
+	int min, max;
+
+	node = asre_parse_atom(ps);
+
+	while (!ps->unsupported) {
+		switch (*ps->p) {
+		case '*':
+			min = 0;
+			max = -1;
+			ps->p++;
+			break;
+		case '+':
+			min = 1;
+			max = -1;
+			ps->p++;
+			break;
+		case '?':
+			min = 0;
+			max = 1;
+			ps->p++;
+			break;
+		case '{':
+			if (!asre_parse_interval(ps, &min, &max))
+				return asre_unsupported(ps);
+			break;
+		default:
+			return node;
+		}
+
+		if (node->type == ASRE_BOL || node->type == ASRE_EOL)
+			return asre_unsupported(ps);
+
+		node = asre_node(ps, ASRE_REPEAT, node, NULL);
+		if (node) {
+			node->min = min;
+			node->max = max;
+		}
+	}
+	return NULL;
+}
+
+static struct asre_node *asre_parse_branch(struct asre_parser *ps)
+{
+	struct asre_node *node, *piece;
+
+	node = asre_node(ps, ASRE_EMPTY, NULL, NULL);
+	while (!ps->unsupported && *ps->p && *ps->p != '|' && *ps->p != ')') {
+		piece = asre_parse_piece(ps);
+		node = asre_node(ps, ASRE_CAT, node, piece);
+	}
+	return node;
+}
+
+static struct asre_node *asre_parse_alt(struct asre_parser *ps)
+{
+	struct asre_node *node, *branch;
+
+	node = asre_parse_branch(ps);
+	while (!ps->unsupported && *ps->p == '|') {
+		ps->p++;
+		branch = asre_parse_branch(ps);
+		node = asre_node(ps, ASRE_ALT, node, branch);
+	}
+	return node;
+}
+
+static int asre_state_new(struct bgp_aspath_regex *re,
+			  enum asre_state_type type, int out)
+{
+	struct asre_state *st;
+
+	if (re->nstates == ASRE_MAX_STATES)
+		return -1;
+
+	if (re->nstates == re->states_size) {
+		re->states_size = re->states_size ? re->states_size * 2 : 32;
+		re->states = XREALLOC(MTYPE_BGP_ASPATH_REGEX, re->states,
+				      re->states_size * sizeof(*re->states));
+	}
+
+	st = &re->states[re->nstates];
+	st->type = type;
+	st->syms = 0;
+	st->out = out;
+	st->out1 = -1;
+	return re->nstates++;
+}
+
+static int asre_compile(struct bgp_aspath_regex *re, struct asre_node *node,
+			int next);
+
+static int asre_compile_repeat(struct bgp_aspath_regex *re,
+			       struct asre_node *node, int next)
+{
+	int tail = next;
+	int i, s, x;
+
+	if (node->max < 0) {
+		/* a split looping back through the repeated node */
+		s = asre_state_new(re, ASRE_ST_SPLIT, -1);
+		if (s < 0)
+			return -1;
+		x = asre_compile(re, node->left, s);
+		if (x < 0)
+			return -1;
+		re->states[s].out = x;
+		re->states[s].out1 = next;
+		tail = s;
+	} else {
+		/* each optional repetition may be followed by another one */
+		for (i = node->min; i < node->max; i++) {
+			x = asre_compile(re, node->left, tail);
+			if (x < 0)
+				return -1;
+			s = asre_state_new(re, ASRE_ST_SPLIT, x);
+			if (s < 0)
+				return -1;
+			re->states[s].out1 = next;
+			tail = s;
+		}
+	}
+
+	for (i = 0; i < node->min; i++)
+		tail = asre_compile(re, node->left, tail);
+	return tail;
+}
+
+/* Compile node into NFA states continuing with next, return the first one */
+static int asre_compile(struct bgp_aspath_regex *re, struct asre_node *node,
+			int next)
+{
+	int s, x;
+
+	if (next < 0)
+		return -1;
+
+	switch (node->type) {
+	case ASRE_EMPTY:
+		return next;
+	case ASRE_SYMS:
+		s = asre_state_new(re, ASRE_ST_SYMS, next);
+		if (s >= 0)
+			re->states[s].syms = node->syms;
+		return s;
+	case ASRE_BOL:
+		return asre_state_new(re, ASRE_ST_BOL, next);
+	case ASRE_EOL:
+		return asre_state_new(re, ASRE_ST_EOL, next);
+	case ASRE_CAT:
+		return asre_compile(re, node->left,
+				    asre_compile(re, node->right, next));
+	case ASRE_ALT:
+		x = asre_compile(re, node->left, next);
+		if (x < 0)
+			return -1;
+		s = asre_state_new(re, ASRE_ST_SPLIT, x);
+		if (s < 0)
+			return -1;
+		x = asre_compile(re, node->right, next);
+		if (x < 0)
+			return -1;
+		re->states[s].out1 = x;
+		return s;
+	case ASRE_REPEAT:
+		return asre_compile_repeat(re, node, next);
+	}
+	return -1;
+}
+
+static void asre_closure_add(struct bgp_aspath_regex *re, int s)
+{
+	if (re->mark[s] == re->gen)
+		return;
+	re->mark[s] = re->gen;
+	re->stack[re->nstack++] = s;
+}
+
+static void asre_closure_start(struct bgp_aspath_regex *re)
+{
+	if (++re->gen == 0) {
+		memset(re->mark, 0, re->nstates * sizeof(*re->mark));
+		re->gen = 1;
+	}
+	re->nstack = 0;
+}
+
+/* Mark the states reachable from the added ones without a symbol */
+static void asre_closure(struct bgp_aspath_regex *re, bool bol, bool eol)
+{
+	struct asre_state *st;
+
+	while (re->nstack) {
+		st = &re->states[re->stack[--re->nstack]];
+
+		switch (st->type) {
+		case ASRE_ST_SPLIT:
+			asre_closure_add(re, st->out);
+			asre_closure_add(re, st->out1);
+			break;
+		case ASRE_ST_BOL:
+			if (bol)
+				asre_closure_add(re, st->out);
+			break;
+		case ASRE_ST_EOL:
+			if (eol)
+				asre_closure_add(re, st->out);
+			break;
+		case ASRE_ST_SYMS:
+		case ASRE_ST_MATCH:
+			break;
+		}
+	}
+}
+
+static unsigned int asre_dstate_key(const void *arg)
+{
+	const struct asre_dstate *ds = arg;
+
+	return jhash(ds->set, ds->nset * sizeof(ds->set[0]), 0x5e7c0de);
+}
+
+static bool asre_dstate_cmp(const void *arg1, const void *arg2)
+{
+	const struct asre_dstate *ds1 = arg1, *ds2 = arg2;
+
+	return ds1->nset == ds2->nset
+	       && !memcmp(ds1->set, ds2->set, ds1->nset * sizeof(ds1->set[0]));
+}
+
+/*
+ * Find or create the DFA state for the closure just computed.  Only the
+ * NFA states that still matter are kept: those consuming a symbol, the
+ * match and end of line assertions not passed yet.
+ *
+ * The start state is kept apart since it is the only one where ^ holds.
+ * States that decide the result loop back to themselves, so the result
+ * only needs to be checked once in a while.
+ *
+ * @return the index of the state, -1 if there are too many
+ */
+static int asre_dstate_get(struct bgp_aspath_regex *re, bool start)
+{
+	struct asre_dstate *key = re->key, *ds;
+	uint16_t *row;
+	unsigned int i;
+	int s;
+
+	key->nset = 0;
+	for (s = 0; s < re->nstates; s++) {
+		if (re->mark[s] != re->gen)
+			continue;
+		if (re->states[s].type == ASRE_ST_SYMS
+		    || re->states[s].type == ASRE_ST_EOL
+		    || re->states[s].type == ASRE_ST_MATCH)
+			key->set[key->nset++] = s;
+	}
+
+	if (!start) {
+		ds = hash_lookup(re->dstate_hash, key);
+		if (ds)
+			return ds->index;
+	}
+	if (re->ndstates == ASRE_MAX_DSTATES)
+		return -1;
+
+	ds = XMALLOC(MTYPE_BGP_ASPATH_REGEX_STATE,
+		     sizeof(*ds) + key->nset * sizeof(ds->set[0]));
+	ds->index = re->ndstates++;
+	ds->nset = key->nset;
+	memcpy(ds->set, key->set, key->nset * sizeof(ds->set[0]));
+
+	re->dstates = XREALLOC(MTYPE_BGP_ASPATH_REGEX, re->dstates,
+			       re->ndstates * sizeof(*re->dstates));
+	re->dtable = XREALLOC(MTYPE_BGP_ASPATH_REGEX, re->dtable,
+			      re->ndstates * sizeof(*re->dtable));
+	re->dstates[ds->index] = ds;
+
+	row = re->dtable[ds->index];
+	row[ASRE_DFLAGS] = 0;
+	if (re->mark[re->match] == re->gen)
+		row[ASRE_DFLAGS] |= ASRE_DMATCH;
+	else if (!ds->nset && !start)
+		/* not even the start of a new match is possible here */
+		row[ASRE_DFLAGS] |= ASRE_DDEAD;
+	for (i = 0; i < ASRE_NSYMS; i++)
+		row[i] = (row[ASRE_DFLAGS] & ASRE_DFINAL) ? ds->index
+							  : ASRE_DNONE;
+
+	asre_closure_start(re);
+	for (i = 0; i < ds->nset; i++)
+		asre_closure_add(re, ds->set[i]);
+	asre_closure(re, start, true);
+	if (re->mark[re->match] == re->gen)
+		row[ASRE_DFLAGS] |= ASRE_DMATCH_EOL;
+
+	if (!start)
+		hash_get(re->dstate_hash, ds, hash_alloc_intern);
+	return ds->index;
+}
+
+static int asre_dfa_step(struct bgp_aspath_regex *re, unsigned int ds,
+			 unsigned int sym)
+{
+	struct asre_dstate *from = re->dstates[ds];
+	struct asre_state *st;
+	unsigned int i;
+	int next;
+
+	asre_closure_start(re);
+	for (i = 0; i < from->nset; i++) {
+		st = &re->states[from->set[i]];
+		if (st->type == ASRE_ST_SYMS && (st->syms & (1U << sym)))
+			asre_closure_add(re, st->out);
+	}
+	/* the match may begin anywhere */
+	asre_closure_add(re, re->start);
+	asre_closure(re, false, false);
+
+	next = asre_dstate_get(re, false);
+	if (next >= 0)
+		re->dtable[ds][sym] = next;
+	return next;
+}
+
+/* Feed symbols to the DFA, -1 if it grew too large */
+static int asre_dfa_run(struct bgp_aspath_regex *re, int ds,
+			const uint8_t *syms, unsigned int n)
+{
+	unsigned int i;
+	int next;
+
+	for (i = 0; i < n; i++) {
+		next = re->dtable[ds][syms[i]];
+		if (next == ASRE_DNONE) {
+			next = asre_dfa_step(re, ds, syms[i]);
+			if (next < 0)
+				return -1;
+		}
+		ds = next;
+	}
+	return ds;
+}
+
+/*
+ * Run the DFA over the AS path as aspath_make_str_count() prints it.
+ *
+ * @return 1 on match, 0 if not, -1 if the DFA grew too large
+ */
+static int asre_dfa_exec(struct bgp_aspath_regex *re,
+			 const struct aspath *aspath)
+{
+	const struct assegment *seg;
+	int ds = 0;
+	uint8_t syms[16], digits[10];
+	unsigned int n, d, i;
+	unsigned int start, end, sep;
+	as_t asn;
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		switch (seg->type) {
+		case AS_SEQUENCE:
+			start = end = ASRE_SYM_OTHER;
+			sep = ASRE_SYM_SPACE;
+			break;
+		case AS_SET:
+			start = ASRE_SYM_SET_START;
+			end = ASRE_SYM_SET_END;
+			sep = ASRE_SYM_COMMA;
+			break;
+		case AS_CONFED_SEQUENCE:
+			start = ASRE_SYM_CONFED_SEQ_START;
+			end = ASRE_SYM_CONFED_SEQ_END;
+			sep = ASRE_SYM_SPACE;
+			break;
+		case AS_CONFED_SET:
+			start = ASRE_SYM_CONFED_SET_START;
+			end = ASRE_SYM_CONFED_SET_END;
+			sep = ASRE_SYM_COMMA;
+			break;
+		default:
+			/* no string form, as for regexec() there is no match */
+			return 0;
+		}
+
+		n = 0;
+		if (seg->type != AS_SEQUENCE)
+			syms[n++] = start;
+
+		for (i = 0; i < seg->length; i++) {
+			asn = seg->as[i];
+			d = sizeof(digits);
+			do {
+				digits[--d] = asn % 10;
+				asn /= 10;
+			} while (asn);
+			memcpy(syms + n, digits + d, sizeof(digits) - d);
+			n += sizeof(digits) - d;
+
+			if (i + 1 < seg->length)
+				syms[n++] = sep;
+
+			ds = asre_dfa_run(re, ds, syms, n);
+			if (ds < 0)
+				return -1;
+			if (re->dtable[ds][ASRE_DFLAGS] & ASRE_DFINAL)
+				goto done;
+			n = 0;
+		}
+
+		if (seg->type != AS_SEQUENCE)
+			syms[n++] = end;
+		if (seg->next)
+			syms[n++] = ASRE_SYM_SPACE;
+
+		ds = asre_dfa_run(re, ds, syms, n);
+		if (ds < 0)
+			return -1;
+	}
+
+done:
+	return !!(re->dtable[ds][ASRE_DFLAGS]
+		  & (ASRE_DMATCH | ASRE_DMATCH_EOL));
+}
+
+static void asre_automaton_free(struct bgp_aspath_regex *re)
+{
+	unsigned int i;
+
+	if (re->dstate_hash) {
+		hash_clean(re->dstate_hash, NULL);
+		hash_free(re->dstate_hash);
+		re->dstate_hash = NULL;
+	}
+	for (i = 0; i < re->ndstates; i++)
+		XFREE(MTYPE_BGP_ASPATH_REGEX_STATE, re->dstates[i]);
+	re->ndstates = 0;
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->dstates);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->dtable);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->key);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->stack);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->mark);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re->states);
+	re->nstates = re->states_size = 0;
+}
+
+static bool asre_automaton_build(struct bgp_aspath_regex *re,
+				 const char *regstr)
+{
+	struct asre_parser *ps;
+	struct asre_node *root;
+
+	ps = XCALLOC(MTYPE_TMP, sizeof(*ps));
+	ps->p = regstr;
+	root = asre_parse_alt(ps);
+	if (*ps->p)
+		/* unbalanced ')' */
+		ps->unsupported = true;
+
+	if (!ps->unsupported) {
+		re->match = asre_state_new(re, ASRE_ST_MATCH, -1);
+		re->start = asre_compile(re, root, re->match);
+	}
+	XFREE(MTYPE_TMP, ps);
+
+	if (!re->nstates || re->start < 0)
+		return false;
+
+	re->mark = XCALLOC(MTYPE_BGP_ASPATH_REGEX,
+			   re->nstates * sizeof(*re->mark));
+	re->stack = XCALLOC(MTYPE_BGP_ASPATH_REGEX,
+			    re->nstates * sizeof(*re->stack));
+	re->key = XCALLOC(MTYPE_BGP_ASPATH_REGEX,
+			  sizeof(*re->key) + re->nstates * sizeof(int));
+	re->dstate_hash = hash_create_size(64, asre_dstate_key,
+					   asre_dstate_cmp,
+					   "BGP AS path regex states");
+
+	asre_closure_start(re);
+	asre_closure_add(re, re->start);
+	asre_closure(re, true, false);
+	asre_dstate_get(re, true);
+	return true;
+}
+
+struct bgp_aspath_regex *bgp_aspath_regcomp(const char *regstr)
+{
+	struct bgp_aspath_regex *re;
+	regex_t *posix;
+
+	/* this also checks the syntax */
+	posix = bgp_regcomp(regstr);
+	if (!posix)
+		return NULL;
+
+	re = XCALLOC(MTYPE_BGP_ASPATH_REGEX, sizeof(*re));
+	re->posix = posix;
+
+	if (!asre_automaton_build(re, regstr)) {
+		asre_automaton_free(re);
+		re->use_posix = true;
+	}
+
+	return re;
+}
+
+bool bgp_aspath_regexec(struct bgp_aspath_regex *re, struct aspath *aspath)
+{
+	struct asre_cache_entry *entry = NULL;
+	int ret = -1;
+
+	/* only interned AS paths have a serial */
+	if (aspath->serial) {
+		entry = &re->cache[aspath->serial % ASRE_CACHE_SIZE];
+		if (entry->serial == aspath->serial && entry->aspath == aspath)
+			return entry->match;
+	}
+
+	if (!re->use_posix) {
+		ret = asre_dfa_exec(re, aspath);
+		if (ret < 0) {
+			asre_automaton_free(re);
+			re->use_posix = true;
+		}
+	}
+	if (ret < 0)
+		ret = regexec(re->posix, aspath->str, 0, NULL, 0)
+		      != REG_NOMATCH;
+
+	if (entry) {
+		entry->aspath = aspath;
+		entry->serial = aspath->serial;
+		entry->match = ret;
+	}
+	return ret;
+}
+
+bool bgp_aspath_regex_is_posix(const struct bgp_aspath_regex *re)
+{
+	return re->use_posix;
+}
+
+void bgp_aspath_regex_free(struct bgp_aspath_regex *re)
+{
+	asre_automaton_free(re);
+	bgp_regex_free(re->posix);
+	XFREE(MTYPE_BGP_ASPATH_REGEX, re);
+}
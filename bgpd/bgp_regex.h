@@ -31,6 +31,25 @@
 
 extern void bgp_regex_free(regex_t *regex);
 extern regex_t *bgp_regcomp(const char *str);
-extern int bgp_regexec(regex_t *regex, struct aspath *aspath);
+
+/*
+ * AS path regular expressions, as used by as-path access-lists.
+ *
+ * The expression is matched against the AS path as it is printed, but
+ * without looking at aspath->str when it can be avoided: it is compiled
+ * into an automaton that is fed the characters of the AS path straight
+ * from its segments, and results are cached per interned AS path.
+ *
+ * Matching updates the automaton and the cache, so a regex must only be
+ * used from one pthread.
+ */
+struct bgp_aspath_regex;
+
+extern struct bgp_aspath_regex *bgp_aspath_regcomp(const char *regstr);
+extern bool bgp_aspath_regexec(struct bgp_aspath_regex *regex,
+			       struct aspath *aspath);
+extern void bgp_aspath_regex_free(struct bgp_aspath_regex *regex);
+/* Is the regex run by regexec() rather than the automaton? */
+extern bool bgp_aspath_regex_is_posix(const struct bgp_aspath_regex *regex);
 
 #endif /* _QUAGGA_BGP_REGEX_H */
@@ -27,6 +27,7 @@
 #include "prefix.h"
 #include "linklist.h"
 #include "memory.h"
+#include "mempool.h"
 #include "command.h"
 #include "stream.h"
 #include "filter.h"
@@ -201,12 +202,40 @@ struct bgp_dest *bgp_afi_node_lookup(struct bgp_table *table, afi_t afi,
 	return dest;
 }
 
+/* Pools for paths that have no peer, or a peer without pools */
+static struct mempool *bgp_path_pool;
+static struct mempool *bgp_path_extra_pool;
+
+static struct mempool *bgp_path_pool_get(struct peer *peer)
+{
+	if (peer && peer->path_pool)
+		return peer->path_pool;
+
+	if (!bgp_path_pool)
+		bgp_path_pool = mempool_new(MTYPE_BGP_ROUTE,
+					    sizeof(struct bgp_path_info));
+	return bgp_path_pool;
+}
+
+static struct mempool *bgp_path_extra_pool_get(struct peer *peer)
+{
+	if (peer && peer->path_extra_pool)
+		return peer->path_extra_pool;
+
+	if (!bgp_path_extra_pool)
+		bgp_path_extra_pool =
+			mempool_new(MTYPE_BGP_ROUTE_EXTRA,
+				    sizeof(struct bgp_path_info_extra));
+	return bgp_path_extra_pool;
+}
+
 /* Allocate bgp_path_info_extra */
-static struct bgp_path_info_extra *bgp_path_info_extra_new(void)
+static struct bgp_path_info_extra *
+bgp_path_info_extra_new(struct bgp_path_info *pi)
 {
 	struct bgp_path_info_extra *new;
-	new = XCALLOC(MTYPE_BGP_ROUTE_EXTRA,
-		      sizeof(struct bgp_path_info_extra));
+
+	new = mempool_alloc(bgp_path_extra_pool_get(pi->peer));
 	new->label[0] = MPLS_INVALID_LABEL;
 	new->num_labels = 0;
 	new->bgp_fs_pbr = NULL;
@@ -268,7 +297,7 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 		list_delete(&((*extra)->bgp_fs_iprule));
 	if ((*extra)->bgp_fs_pbr)
 		list_delete(&((*extra)->bgp_fs_pbr));
-	XFREE(MTYPE_BGP_ROUTE_EXTRA, *extra);
+	MEMPOOL_FREE(*extra);
 }
 
 /* Get bgp_path_info extra information for the given bgp_path_info, lazy
@@ -277,7 +306,7 @@ void bgp_path_info_extra_free(struct bgp_path_info_extra **extra)
 struct bgp_path_info_extra *bgp_path_info_extra_get(struct bgp_path_info *pi)
 {
 	if (!pi->extra)
-		pi->extra = bgp_path_info_extra_new();
+		pi->extra = bgp_path_info_extra_new(pi);
 	return pi->extra;
 }
 
@@ -295,7 +324,7 @@ static void bgp_path_info_free(struct bgp_path_info *path)
 
 	peer_unlock(path->peer); /* bgp_path_info peer reference */
 
-	XFREE(MTYPE_BGP_ROUTE, path);
+	MEMPOOL_FREE(path);
 }
 
 struct bgp_path_info *bgp_path_info_lock(struct bgp_path_info *path)
@@ -577,6 +606,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 	uint32_t new_weight;
 	uint32_t exist_weight;
 	uint32_t newm, existm;
+	uint8_t new_sticky, exist_sticky;
 	struct in_addr new_id;
 	struct in_addr exist_id;
 	int new_cluster;
@@ -681,7 +711,9 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 		 * with the
 		 * sticky flag.
 		 */
-		if (newattr->sticky != existattr->sticky) {
+		new_sticky = bgp_attr_get_evpn(newattr)->sticky;
+		exist_sticky = bgp_attr_get_evpn(existattr)->sticky;
+		if (new_sticky != exist_sticky) {
 			if (!debug) {
 				prefix2str(new_p, pfx_buf,
 					   sizeof(*pfx_buf)
@@ -692,7 +724,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 					exist, exist_buf, sizeof(exist_buf));
 			}
 
-			if (newattr->sticky && !existattr->sticky) {
+			if (new_sticky && !exist_sticky) {
 				*reason = bgp_path_selection_evpn_sticky_mac;
 				if (debug)
 					zlog_debug(
@@ -701,7 +733,7 @@ static int bgp_path_info_cmp(struct bgp *bgp, struct bgp_path_info *new,
 				return 1;
 			}
 
-			if (!newattr->sticky && existattr->sticky) {
+			if (!new_sticky && exist_sticky) {
 				*reason = bgp_path_selection_evpn_sticky_mac;
 				if (debug)
 					zlog_debug(
@@ -3358,8 +3390,11 @@ void bgp_process_queue_init(struct bgp *bgp)
 	bgp->process_queue->spec.del_item_data = &bgp_processq_del;
 	bgp->process_queue->spec.max_retries = 0;
 	bgp->process_queue->spec.hold = 50;
-	/* Use a higher yield value of 50ms for main queue processing */
+	/* Use a higher yield value of 50ms for main queue processing, and
+	 * size the runs based on how long processing actually takes.
+	 */
 	bgp->process_queue->spec.yield = 50 * 1000L;
+	bgp->process_queue->spec.max_latency = 50 * 1000L;
 }
 
 static struct bgp_process_queue *bgp_processq_alloc(struct bgp *bgp)
@@ -3691,7 +3726,7 @@ struct bgp_path_info *info_make(int type, int sub_type, unsigned short instance,
 	struct bgp_path_info *new;
 
 	/* Make new BGP info. */
-	new = XCALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+	new = mempool_alloc(bgp_path_pool_get(peer));
 	new->type = type;
 	new->instance = instance;
 	new->sub_type = sub_type;
@@ -3869,8 +3904,7 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 
 	/* Update overlay index of the attribute */
 	if (afi == AFI_L2VPN && evpn)
-		memcpy(&attr->evpn_overlay, evpn,
-		       sizeof(struct bgp_route_evpn));
+		bgp_attr_set_evpn_overlay(attr, evpn);
 
 	/* When peer's soft reconfiguration enabled.  Record input packet in
 	   Adj-RIBs-In.  */
@@ -4049,7 +4083,8 @@ int bgp_update(struct peer *peer, const struct prefix *p, uint32_t addpath_id,
 		goto filtered;
 	}
 
-	if (bgp_mac_entry_exists(p) || bgp_mac_exist(&attr->rmac)) {
+	if (bgp_mac_entry_exists(p)
+	    || bgp_mac_exist(&bgp_attr_get_evpn(attr)->rmac)) {
 		peer->stat_pfx_nh_invalid++;
 		reason = "self mac;";
 		bgp_attr_flush(&new_attr);
@@ -4971,6 +5006,74 @@ static int bgp_soft_reconfig_table_update(struct peer *peer,
 			  &evpn);
 }
 
+/*
+ * Can the changes of the inbound route-map peer is reprocessed for apply
+ * differently to the path received in ain?  The match clauses are run on
+ * the attributes as bgp_input_modifier() passes them to the route-map.
+ */
+static bool bgp_soft_reconfig_changed(struct peer *peer, afi_t afi,
+				      safi_t safi, struct bgp_dest *dest,
+				      struct bgp_adj_in *ain)
+{
+	struct route_map_changes *changes;
+	struct bgp_filter *filter = &peer->filter[afi][safi];
+	struct bgp_path_info rmap_path = {};
+	struct bgp_path_info_extra extra = {};
+	struct bgp_path_info *pi;
+	struct attr attr;
+	bool changed;
+
+	changes = peer->soft_reconfig_changes[afi][safi];
+	if (!changes || !ROUTE_MAP_IN(filter)) {
+		peer->soft_reconfig_evaluated[afi][safi]++;
+		return true;
+	}
+
+	attr = *ain->attr;
+	if (peer->weight[afi][safi])
+		attr.weight = peer->weight[afi][safi];
+
+	for (pi = bgp_dest_get_bgp_path_info(dest); pi; pi = pi->next)
+		if (pi->peer == peer)
+			break;
+
+	if (pi && pi->extra && pi->extra->num_labels
+	    && pi->extra->num_labels <= BGP_MAX_LABELS) {
+		extra.num_labels = pi->extra->num_labels;
+		memcpy(extra.label, pi->extra->label,
+		       extra.num_labels * sizeof(mpls_label_t));
+	}
+
+	rmap_path.peer = peer;
+	rmap_path.attr = &attr;
+	rmap_path.extra = &extra;
+	rmap_path.net = dest;
+
+	SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_IN);
+	changed = route_map_changes_match(changes, ROUTE_MAP_IN(filter),
+					  bgp_dest_get_prefix(dest), &rmap_path);
+	peer->rmap_type = 0;
+
+	if (changed)
+		peer->soft_reconfig_evaluated[afi][safi]++;
+	else
+		peer->soft_reconfig_skipped[afi][safi]++;
+	return changed;
+}
+
+/* The Adj-RIB-In of peer for afi/safi has been reprocessed */
+static void bgp_soft_reconfig_done(struct peer *peer, afi_t afi, safi_t safi)
+{
+	route_map_changes_free(&peer->soft_reconfig_changes[afi][safi]);
+
+	if (bgp_debug_update(peer, NULL, NULL, 1))
+		zlog_debug(
+			"%s(%s:%s) inbound soft reconfiguration done, %u prefixes re-evaluated, %u skipped",
+			peer->host, afi2str(afi), safi2str(safi),
+			peer->soft_reconfig_evaluated[afi][safi],
+			peer->soft_reconfig_skipped[afi][safi]);
+}
+
 static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 				    struct bgp_table *table,
 				    struct prefix_rd *prd)
@@ -4987,6 +5090,10 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 			if (ain->peer != peer)
 				continue;
 
+			if (!bgp_soft_reconfig_changed(peer, afi, safi, dest,
+						       ain))
+				continue;
+
 			ret = bgp_soft_reconfig_table_update(peer, dest, ain,
 							     afi, safi, prd);
 
@@ -5041,16 +5148,23 @@ static void bgp_soft_reconfig_table_task(struct thread *thread)
 				if (ain->peer != peer)
 					continue;
 
+				iter++;
+				if (!bgp_soft_reconfig_changed(peer, table->afi,
+							       table->safi,
+							       dest, ain))
+					continue;
+
 				ret = bgp_soft_reconfig_table_update(
 					peer, dest, ain, table->afi,
 					table->safi, prd);
-				iter++;
 
 				if (ret < 0) {
 					bgp_dest_unlock_node(dest);
 					listnode_delete(
 						table->soft_reconfig_peers,
 						peer);
+					bgp_soft_reconfig_done(peer, table->afi,
+							       table->safi);
 					bgp_announce_route(peer, table->afi,
 							   table->safi, false);
 					if (list_isempty(
@@ -5080,6 +5194,7 @@ static void bgp_soft_reconfig_table_task(struct thread *thread)
 	*/
 	for (ALL_LIST_ELEMENTS(table->soft_reconfig_peers, node, nnode, peer)) {
 		listnode_delete(table->soft_reconfig_peers, peer);
+		bgp_soft_reconfig_done(peer, table->afi, table->safi);
 		bgp_announce_route(peer, table->afi, table->safi, false);
 	}
 
@@ -5119,6 +5234,8 @@ void bgp_soft_reconfig_table_task_cancel(const struct bgp *bgp,
 			if (peer && peer != npeer)
 				continue;
 			listnode_delete(ntable->soft_reconfig_peers, npeer);
+			route_map_changes_free(
+				&npeer->soft_reconfig_changes[afi][safi]);
 		}
 
 		if (!ntable->soft_reconfig_peers
@@ -5131,7 +5248,10 @@ void bgp_soft_reconfig_table_task_cancel(const struct bgp *bgp,
 	}
 }
 
-void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
+/* Reprocess the Adj-RIB-In of peer for changes, all of it if NULL */
+static void bgp_soft_reconfig_start(struct peer *peer, afi_t afi,
+				    safi_t safi,
+				    struct route_map_changes *changes)
 {
 	struct bgp_dest *dest;
 	struct bgp_table *table;
@@ -5139,14 +5259,21 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 	struct peer *npeer;
 	struct peer_af *paf;
 
-	if (!peer_established(peer))
+	if (!peer_established(peer)) {
+		route_map_changes_free(&changes);
 		return;
+	}
+
+	peer->soft_reconfig_evaluated[afi][safi] = 0;
+	peer->soft_reconfig_skipped[afi][safi] = 0;
 
 	if ((safi != SAFI_MPLS_VPN) && (safi != SAFI_ENCAP)
 	    && (safi != SAFI_EVPN)) {
 		table = peer->bgp->rib[afi][safi];
-		if (!table)
+		if (!table) {
+			route_map_changes_free(&changes);
 			return;
+		}
 
 		table->soft_reconfig_init = true;
 
@@ -5161,8 +5288,23 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 			if (peer == npeer)
 				break;
 		}
-		if (peer != npeer)
+		if (peer != npeer) {
 			listnode_add(table->soft_reconfig_peers, peer);
+			route_map_changes_free(
+				&peer->soft_reconfig_changes[afi][safi]);
+			peer->soft_reconfig_changes[afi][safi] = changes;
+		} else if (!changes) {
+			/* Everything has to be reprocessed now */
+			route_map_changes_free(
+				&peer->soft_reconfig_changes[afi][safi]);
+		} else {
+			/* Everything already is if there are no changes */
+			if (peer->soft_reconfig_changes[afi][safi])
+				route_map_changes_merge(
+					&peer->soft_reconfig_changes[afi][safi],
+					changes);
+			route_map_changes_free(&changes);
+		}
 
 		/* (re)flag all bgp_dest in table. Existing soft_reconfig_in job
 		 * on table would start back at the beginning.
@@ -5189,7 +5331,10 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 		paf = peer_af_find(peer, afi, safi);
 		if (paf)
 			bgp_stop_announce_route_timer(paf);
-	} else
+	} else {
+		route_map_changes_free(&peer->soft_reconfig_changes[afi][safi]);
+		peer->soft_reconfig_changes[afi][safi] = changes;
+
 		for (dest = bgp_table_top(peer->bgp->rib[afi][safi]); dest;
 		     dest = bgp_route_next(dest)) {
 			table = bgp_dest_get_bgp_table_info(dest);
@@ -5206,6 +5351,21 @@ void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
 
 			bgp_soft_reconfig_table(peer, afi, safi, table, &prd);
 		}
+
+		bgp_soft_reconfig_done(peer, afi, safi);
+	}
+}
+
+void bgp_soft_reconfig_in(struct peer *peer, afi_t afi, safi_t safi)
+{
+	bgp_soft_reconfig_start(peer, afi, safi, NULL);
+}
+
+void bgp_soft_reconfig_in_changed(struct peer *peer, afi_t afi, safi_t safi,
+				  struct route_map *map)
+{
+	bgp_soft_reconfig_start(peer, afi, safi,
+				map ? route_map_changes_get(map) : NULL);
 }
 
 
@@ -6270,18 +6430,22 @@ static void bgp_static_update_safi(struct bgp *bgp, const struct prefix *p,
 		}
 	}
 	if (afi == AFI_L2VPN) {
+		struct bgp_attr_evpn evpn;
+
+		memset(&evpn, 0, sizeof(evpn));
 		if (bgp_static->gatewayIp.family == AF_INET) {
-			SET_IPADDR_V4(&attr.evpn_overlay.gw_ip);
-			memcpy(&attr.evpn_overlay.gw_ip.ipaddr_v4,
+			SET_IPADDR_V4(&evpn.overlay.gw_ip);
+			memcpy(&evpn.overlay.gw_ip.ipaddr_v4,
 			       &bgp_static->gatewayIp.u.prefix4,
 			       IPV4_MAX_BYTELEN);
 		} else if (bgp_static->gatewayIp.family == AF_INET6) {
-			SET_IPADDR_V6(&attr.evpn_overlay.gw_ip);
-			memcpy(&attr.evpn_overlay.gw_ip.ipaddr_v6,
+			SET_IPADDR_V6(&evpn.overlay.gw_ip);
+			memcpy(&evpn.overlay.gw_ip.ipaddr_v6,
 			       &bgp_static->gatewayIp.u.prefix6,
 			       IPV6_MAX_BYTELEN);
 		}
-		memcpy(&attr.esi, bgp_static->eth_s_id, sizeof(esi_t));
+		memcpy(&evpn.esi, bgp_static->eth_s_id, sizeof(esi_t));
+		bgp_attr_set_evpn(&attr, &evpn);
 		if (bgp_static->encap_tunneltype == BGP_ENCAP_TYPE_VXLAN) {
 			struct bgp_encap_type_vxlan bet;
 			memset(&bet, 0, sizeof(bet));
@@ -9301,9 +9465,9 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 		vty_out(vty, "%s", bgp_origin_str[attr->origin]);
 
 	if (json_paths) {
-		if (bgp_evpn_is_esi_valid(&attr->esi)) {
+		if (bgp_evpn_is_esi_valid(bgp_evpn_attr_get_esi(attr))) {
 			json_object_string_add(json_path, "esi",
-					esi_to_str(&attr->esi,
+					esi_to_str(bgp_evpn_attr_get_esi(attr),
 					esi_buf, sizeof(esi_buf)));
 		}
 		if (safi == SAFI_EVPN &&
@@ -9352,12 +9516,12 @@ void route_vty_out(struct vty *vty, const struct prefix *p,
 		vty_out(vty, "\n");
 
 		if (safi == SAFI_EVPN) {
-			if (bgp_evpn_is_esi_valid(&attr->esi)) {
+			if (bgp_evpn_is_esi_valid(bgp_evpn_attr_get_esi(attr))) {
 				/* XXX - add these params to the json out */
 				vty_out(vty, "%*s", 20, " ");
 				vty_out(vty, "ESI:%s",
-					esi_to_str(&attr->esi, esi_buf,
-						   sizeof(esi_buf)));
+					esi_to_str(bgp_evpn_attr_get_esi(attr),
+						   esi_buf, sizeof(esi_buf)));
 
 				vty_out(vty, "\n");
 			}
@@ -9941,7 +10105,7 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 			ATTR_ES_PEER_ACTIVE);
 	bool peer_proxy = !!CHECK_FLAG(attr->es_flags,
 			ATTR_ES_PEER_PROXY);
-	esi_to_str(&attr->esi, esi_buf, sizeof(esi_buf));
+	esi_to_str(&bgp_attr_get_evpn(attr)->esi, esi_buf, sizeof(esi_buf));
 	if (json_path) {
 		json_object *json_es_info = NULL;
 
@@ -9962,10 +10126,10 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 			if (peer_router)
 				json_object_boolean_true_add(
 						json_es_info, "peerRouter");
-			if (attr->mm_sync_seqnum)
+			if (bgp_evpn_attr_get_sync_seq(attr))
 				json_object_int_add(
 						json_es_info, "peerSeq",
-						attr->mm_sync_seqnum);
+						bgp_evpn_attr_get_sync_seq(attr));
 			json_object_object_add(
 					json_path, "es_info",
 					json_es_info);
@@ -9979,7 +10143,7 @@ static void route_vty_out_detail_es_info(struct vty *vty,
 					peer_proxy ? "proxy " : "",
 					peer_active ? "active ":"",
 					peer_router ? "router ":"",
-					attr->mm_sync_seqnum);
+					bgp_evpn_attr_get_sync_seq(attr));
 		else
 			vty_out(vty, "      ESI %s %s\n",
 					esi_buf,
@@ -10099,10 +10263,11 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 	}
 
 	if (safi == SAFI_EVPN
-	    && attr->evpn_overlay.type == OVERLAY_INDEX_GATEWAY_IP) {
+	    && bgp_attr_get_evpn_overlay(attr)->type
+		       == OVERLAY_INDEX_GATEWAY_IP) {
 		char gwip_buf[INET6_ADDRSTRLEN];
 
-		ipaddr2str(&attr->evpn_overlay.gw_ip, gwip_buf,
+		ipaddr2str(&bgp_attr_get_evpn(attr)->overlay.gw_ip, gwip_buf,
 			   sizeof(gwip_buf));
 
 		if (json_paths)
@@ -10470,7 +10635,7 @@ void route_vty_out_detail(struct vty *vty, struct bgp *bgp, struct bgp_dest *bn,
 	}
 
 	if (safi == SAFI_EVPN &&
-			bgp_evpn_is_esi_valid(&attr->esi)) {
+			bgp_evpn_is_esi_valid(&bgp_attr_get_evpn(attr)->esi)) {
 		route_vty_out_detail_es_info(vty, path, attr, json_path);
 	}
 
@@ -11131,10 +11296,10 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 					continue;
 			}
 			if (type == bgp_show_type_regexp) {
-				regex_t *regex = output_arg;
+				struct bgp_aspath_regex *regex = output_arg;
 
-				if (bgp_regexec(regex, pi->attr->aspath)
-				    == REG_NOMATCH)
+				if (!bgp_aspath_regexec(regex,
+							pi->attr->aspath))
 					continue;
 			}
 			if (type == bgp_show_type_prefix_list) {
@@ -12886,7 +13051,7 @@ static int bgp_show_regexp(struct vty *vty, struct bgp *bgp, const char *regstr,
 			   afi_t afi, safi_t safi, enum bgp_show_type type,
 			   bool use_json)
 {
-	regex_t *regex;
+	struct bgp_aspath_regex *regex;
 	int rc;
 	uint16_t show_flags = 0;
 
@@ -12899,7 +13064,7 @@ static int bgp_show_regexp(struct vty *vty, struct bgp *bgp, const char *regstr,
 		return CMD_WARNING_CONFIG_FAILED;
 	}
 
-	regex = bgp_regcomp(regstr);
+	regex = bgp_aspath_regcomp(regstr);
 	if (!regex) {
 		vty_out(vty, "Can't compile regexp %s\n", regstr);
 		return CMD_WARNING;
@@ -12907,7 +13072,7 @@ static int bgp_show_regexp(struct vty *vty, struct bgp *bgp, const char *regstr,
 
 	rc = bgp_show(vty, bgp, afi, safi, type, regex, show_flags,
 		      RPKI_NOT_BEING_USED);
-	bgp_regex_free(regex);
+	bgp_aspath_regex_free(regex);
 	return rc;
 }
 
@@ -15559,4 +15724,8 @@ void bgp_route_finish(void)
 		bgp_table_unlock(bgp_distance_table[afi][safi]);
 		bgp_distance_table[afi][safi] = NULL;
 	}
+
+	mempool_release(&bgp_path_pool);
+	mempool_release(&bgp_path_extra_pool);
+	bgp_dest_pool_finish();
 }
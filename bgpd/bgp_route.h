@@ -660,6 +660,12 @@ extern void bgp_soft_reconfig_table_task_cancel(const struct bgp *bgp,
 						const struct bgp_table *table,
 						const struct peer *peer);
 extern void bgp_soft_reconfig_in(struct peer *, afi_t, safi_t);
+/*
+ * Reprocess the Adj-RIB-In of peer after its inbound route-map map changed,
+ * only for the paths the changes can apply differently to.
+ */
+extern void bgp_soft_reconfig_in_changed(struct peer *peer, afi_t afi,
+					 safi_t safi, struct route_map *map);
 extern void bgp_clear_route(struct peer *, afi_t, safi_t);
 extern void bgp_clear_route_all(struct peer *);
 extern void bgp_clear_adj_in(struct peer *, afi_t, safi_t);
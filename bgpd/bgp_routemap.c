@@ -1134,6 +1134,7 @@ route_set_evpn_gateway_ip(void *rule, const struct prefix *prefix, void *object)
 	struct ipaddr *gw_ip = rule;
 	struct bgp_path_info *path;
 	struct prefix_evpn *evp;
+	struct bgp_route_evpn eo;
 
 	if (prefix->family != AF_EVPN)
 		return RMAP_OKAY;
@@ -1149,9 +1150,10 @@ route_set_evpn_gateway_ip(void *rule, const struct prefix *prefix, void *object)
 	path = object;
 
 	/* Set gateway-ip value. */
-	path->attr->evpn_overlay.type = OVERLAY_INDEX_GATEWAY_IP;
-	memcpy(&path->attr->evpn_overlay.gw_ip, &gw_ip->ip.addr,
-	       IPADDRSZ(gw_ip));
+	eo = *bgp_attr_get_evpn_overlay(path->attr);
+	eo.type = OVERLAY_INDEX_GATEWAY_IP;
+	memcpy(&eo.gw_ip, &gw_ip->ip.addr, IPADDRSZ(gw_ip));
+	bgp_attr_set_evpn_overlay(path->attr, &eo);
 
 	return RMAP_OKAY;
 }
@@ -1354,7 +1356,9 @@ static const struct route_map_rule_cmd route_match_local_pref_cmd = {
 	"local-preference",
 	route_match_local_pref,
 	route_match_local_pref_compile,
-	route_match_local_pref_free
+	route_match_local_pref_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* `match metric METRIC' */
@@ -1377,6 +1381,8 @@ static const struct route_map_rule_cmd route_match_metric_cmd = {
 	route_match_metric,
 	route_value_compile,
 	route_value_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* `match as-path ASPATH' */
@@ -1418,7 +1424,9 @@ static const struct route_map_rule_cmd route_match_aspath_cmd = {
 	"as-path",
 	route_match_aspath,
 	route_match_aspath_compile,
-	route_match_aspath_free
+	route_match_aspath_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* `match community COMMUNIY' */
@@ -1512,7 +1520,8 @@ static const struct route_map_rule_cmd route_match_community_cmd = {
 	route_match_community,
 	route_match_community_compile,
 	route_match_community_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* Match function for lcommunity match. */
@@ -1582,7 +1591,8 @@ static const struct route_map_rule_cmd route_match_lcommunity_cmd = {
 	route_match_lcommunity,
 	route_match_lcommunity_compile,
 	route_match_lcommunity_free,
-	route_match_get_community_key
+	route_match_get_community_key,
+	RMAP_RULE_ATTR_ONLY
 };
 
 
@@ -1633,7 +1643,9 @@ static const struct route_map_rule_cmd route_match_ecommunity_cmd = {
 	"extcommunity",
 	route_match_ecommunity,
 	route_match_ecommunity_compile,
-	route_match_ecommunity_free
+	route_match_ecommunity_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* `match nlri` and `set nlri` are replaced by `address-family ipv4`
@@ -1682,7 +1694,9 @@ static const struct route_map_rule_cmd route_match_origin_cmd = {
 	"origin",
 	route_match_origin,
 	route_match_origin_compile,
-	route_match_origin_free
+	route_match_origin_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 /* match probability  { */
@@ -1807,6 +1821,8 @@ static const struct route_map_rule_cmd route_match_tag_cmd = {
 	route_match_tag,
 	route_map_rule_tag_compile,
 	route_map_rule_tag_free,
+	NULL,
+	RMAP_RULE_ATTR_ONLY
 };
 
 static enum route_map_cmd_result_t
@@ -3820,7 +3836,8 @@ static void bgp_route_map_process_peer(const char *rmap_name,
 						rmap_name, afi2str(afi),
 						safi2str(safi), peer->host);
 
-				bgp_soft_reconfig_in(peer, afi, safi);
+				bgp_soft_reconfig_in_changed(peer, afi, safi,
+							     map);
 			} else if (CHECK_FLAG(peer->cap,
 					      PEER_CAP_REFRESH_OLD_RCV)
 				   || CHECK_FLAG(peer->cap,
@@ -6792,6 +6809,33 @@ DEFUN_YANG (no_set_originator_id,
 	return nb_cli_apply_changes(vty, NULL);
 }
 
+/*
+ * Identify the attributes of a route by the interned attribute equal to
+ * them, so the results of the matches are shared between all routes with
+ * the same attributes.  Routes are mostly matched on copies of their
+ * attributes, which may have been modified since: only those are looked up
+ * in the attribute hash.
+ */
+static bool bgp_route_map_attr_key(void *object, const void **key,
+				   uint32_t *serial)
+{
+	struct bgp_path_info *path = object;
+	const struct attr *attr = path->attr;
+
+	if (!attr)
+		return false;
+
+	if (!bgp_attr_is_interned(attr)) {
+		attr = bgp_attr_lookup(attr);
+		if (!attr)
+			return false;
+	}
+
+	*key = attr;
+	*serial = attr->serial;
+	return true;
+}
+
 /* Initialization of route map. */
 void bgp_route_map_init(void)
 {
@@ -6800,6 +6844,7 @@ void bgp_route_map_init(void)
 	route_map_add_hook(bgp_route_map_add);
 	route_map_delete_hook(bgp_route_map_delete);
 	route_map_event_hook(bgp_route_map_event);
+	route_map_attr_key_hook(bgp_route_map_attr_key);
 
 	route_map_match_interface_hook(generic_match_add);
 	route_map_no_match_interface_hook(generic_match_delete);
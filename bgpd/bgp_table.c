@@ -22,6 +22,7 @@
 
 #include "prefix.h"
 #include "memory.h"
+#include "mempool.h"
 #include "sockunion.h"
 #include "queue.h"
 #include "filter.h"
@@ -31,6 +32,7 @@
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
 #include "bgp_addpath.h"
+#include "bgp_nhg.h"
 #include "bgp_trace.h"
 
 void bgp_table_lock(struct bgp_table *rt)
@@ -50,6 +52,8 @@ void bgp_table_unlock(struct bgp_table *rt)
 	route_table_finish(rt->route_table);
 	rt->route_table = NULL;
 
+	mempool_release(&rt->dest_pool);
+
 	XFREE(MTYPE_BGP_TABLE, rt);
 }
 
@@ -97,6 +101,40 @@ const char *bgp_dest_get_prefix_str(struct bgp_dest *dest)
 	return NULL;
 }
 
+/*
+ * Tables keep their dests in a pool shared by all tables until they have
+ * this many, and in one of their own after that.  Most tables (those of an
+ * RD or a VNI) only ever hold a few dests and would not fill the first slab
+ * of a pool.
+ */
+#define BGP_TABLE_DEST_POOL_MIN 64
+
+static struct mempool *bgp_dest_pool;
+
+void bgp_dest_pool_finish(void)
+{
+	mempool_release(&bgp_dest_pool);
+}
+
+static struct mempool *bgp_dest_pool_get(struct route_table *table)
+{
+	struct bgp_table *rt = table->info;
+
+	if (rt->dest_pool)
+		return rt->dest_pool;
+
+	if (table->count >= BGP_TABLE_DEST_POOL_MIN) {
+		rt->dest_pool =
+			mempool_new(MTYPE_BGP_NODE, sizeof(struct bgp_node));
+		return rt->dest_pool;
+	}
+
+	if (!bgp_dest_pool)
+		bgp_dest_pool =
+			mempool_new(MTYPE_BGP_NODE, sizeof(struct bgp_node));
+	return bgp_dest_pool;
+}
+
 /*
  * bgp_node_create
  */
@@ -104,7 +142,8 @@ static struct route_node *bgp_node_create(route_table_delegate_t *delegate,
 					  struct route_table *table)
 {
 	struct bgp_node *node;
-	node = XCALLOC(MTYPE_BGP_NODE, sizeof(struct bgp_node));
+
+	node = mempool_alloc(bgp_dest_pool_get(table));
 
 	RB_INIT(bgp_adj_out_rb, &node->adj_out);
 	return bgp_dest_to_rnode(node);
@@ -127,7 +166,9 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
 					 rt->afi, rt->safi);
 	}
 
-	XFREE(MTYPE_BGP_NODE, bgp_node);
+	bgp_nhg_put(bgp_node->nhg);
+
+	MEMPOOL_FREE(bgp_node);
 }
 
 /*
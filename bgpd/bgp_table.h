@@ -51,6 +51,9 @@ struct bgp_table {
 
 	struct route_table *route_table;
 	uint64_t version;
+
+	/* allocator for this table's bgp_dests, once it has enough of them */
+	struct mempool *dest_pool;
 };
 
 enum bgp_path_selection_reason {
@@ -117,6 +120,9 @@ struct bgp_node {
 	struct bgp_addpath_node_data tx_addpath;
 
 	enum bgp_path_selection_reason reason;
+
+	/* Nexthop-group the route is installed through, if any */
+	struct bgp_nhg *nhg;
 };
 
 extern void bgp_delete_listnode(struct bgp_dest *dest);
@@ -134,6 +140,7 @@ extern struct bgp_table *bgp_table_init(struct bgp *bgp, afi_t, safi_t);
 extern void bgp_table_lock(struct bgp_table *);
 extern void bgp_table_unlock(struct bgp_table *);
 extern void bgp_table_finish(struct bgp_table **);
+extern void bgp_dest_pool_finish(void);
 extern void bgp_dest_unlock_node(struct bgp_dest *dest);
 extern struct bgp_dest *bgp_dest_lock_node(struct bgp_dest *dest);
 extern const char *bgp_dest_get_prefix_str(struct bgp_dest *dest);
@@ -56,6 +56,7 @@
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgp_filter.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_vty.h"
 
 /********************
  * PRIVATE FUNCTIONS
@@ -927,6 +928,7 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 
 	THREAD_OFF(subgrp->t_merge_check);
 	THREAD_OFF(subgrp->t_coalesce);
+	subgroup_encode_cancel(subgrp);
 
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
@@ -1711,6 +1713,29 @@ void update_group_show(struct bgp *bgp, afi_t afi, safi_t safi, struct vty *vty,
 	update_group_af_walk(bgp, afi, safi, update_group_show_walkcb, &ctx);
 }
 
+static int update_group_show_build_stats_walkcb(struct update_group *updgrp,
+						void *arg)
+{
+	struct vty *vty = arg;
+	struct update_subgroup *subgrp;
+	char name[32];
+
+	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
+		snprintf(name, sizeof(name), "u%" PRIu64 ":s%" PRIu64,
+			 updgrp->id, subgrp->id);
+		vty_out(vty, "  %-20s %-16s %10" PRIu64 " %10" PRIu64
+			     " %10" PRIu64 "\n",
+			name, get_afi_safi_str(updgrp->afi, updgrp->safi, false),
+			subgrp->build_count,
+			subgrp->build_count
+				? subgrp->build_usec_total / subgrp->build_count
+				: 0,
+			subgrp->build_usec_max);
+	}
+
+	return UPDWALK_CONTINUE;
+}
+
 /*
  * update_group_show_stats
  *
@@ -1739,6 +1764,12 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "UPDATE encode threads: %u\n", subgroup_encode_threads());
+
+	vty_out(vty, "\nUPDATE build time per subgroup:\n");
+	vty_out(vty, "  %-20s %-16s %10s %10s %10s\n", "Subgroup",
+		"AFI/SAFI", "Packets", "Avg (us)", "Max (us)");
+	update_group_walk(bgp, update_group_show_build_stats_walkcb, vty);
 }
 
 /*
@@ -2025,6 +2056,9 @@ void subgroup_trigger_write(struct update_subgroup *subgrp)
 				bm->master, bgp_generate_updgrp_packets,
 				paf->peer, 0,
 				&paf->peer->t_generate_updgrp_packets);
+
+	/* prebuild the packets on the encode pthreads, if any */
+	subgroup_encode_schedule(subgrp);
 }
 
 int update_group_clear_update_dbg(struct update_group *updgrp, void *arg)
@@ -51,6 +51,9 @@
 #define BGP_MAX_SUBGROUP_COALESCE_TIME 10000
 #define BGP_PEER_ADJUST_SUBGROUP_COALESCE_TIME 50
 
+/* Upper bound for the number of UPDATE encode pthreads */
+#define BGP_ENCODE_THREADS_MAX 16
+
 #define PEER_UPDGRP_FLAGS                                                      \
 	(PEER_FLAG_LOCAL_AS_NO_PREPEND | PEER_FLAG_LOCAL_AS_REPLACE_AS)
 
@@ -93,6 +96,18 @@ typedef struct bpacket_attr_vec_arr {
 	bpacket_attr_vec entries[BGP_ATTR_VEC_MAX];
 } bpacket_attr_vec_arr;
 
+/*
+ * Refcounted holder of a bpacket's buffer.
+ *
+ * Peers queue references to the buffer rather than copies of it (see
+ * struct bgp_opkt), so it may outlive the bpacket until the I/O pthread has
+ * written it to every peer.  The buffer is never modified once shared.
+ */
+struct bpacket_body {
+	_Atomic unsigned int refcnt;
+	struct stream *s;
+};
+
 struct bpacket {
 	/* for being part of an update subgroup's message list */
 	TAILQ_ENTRY(bpacket) pkt_train;
@@ -103,6 +118,9 @@ struct bpacket {
 	struct stream *buffer;
 	bpacket_attr_vec_arr arr;
 
+	/* holds buffer once it has been queued to a peer, else NULL */
+	struct bpacket_body *body;
+
 	unsigned int ver;
 };
 
@@ -169,6 +187,8 @@ struct update_group {
  */
 #define UPDGRP_INCR_STAT(subgrp, stat) UPDGRP_INCR_STAT_BY(subgrp, stat, 1)
 
+PREDECL_DLIST(subgroup_encode_queue);
+
 struct update_subgroup {
 	/* back pointer to the parent update group */
 	struct update_group *update_group;
@@ -180,6 +200,9 @@ struct update_subgroup {
 	/* for being part of an update group's subgroup list */
 	LIST_ENTRY(update_subgroup) updgrp_train;
 
+	/* for being queued for the UPDATE encoding pool */
+	struct subgroup_encode_queue_item encode_item;
+
 	struct bpacket_queue pkt_queue;
 
 	/*
@@ -246,6 +269,11 @@ struct update_subgroup {
 	uint32_t split_events;
 	uint32_t merge_checks_triggered;
 
+	/* UPDATE build time */
+	uint64_t build_count;
+	uint64_t build_usec_total;
+	uint64_t build_usec_max;
+
 	uint64_t id;
 
 	uint16_t sflags;
@@ -264,6 +292,8 @@ struct update_subgroup {
 #define SUBGRP_FLAG_NEEDS_REFRESH (1 << 0)
 };
 
+DECLARE_DLIST(subgroup_encode_queue, struct update_subgroup, encode_item);
+
 /*
  * Add the given value to the specified counter on a subgroup and its
  * parent structures.
@@ -413,8 +443,14 @@ extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 bool subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
-extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
-						struct peer_af *paf);
+extern void subgroup_encode_init(unsigned int nthreads);
+extern void subgroup_encode_run(void);
+extern void subgroup_encode_schedule(struct update_subgroup *subgrp);
+extern void subgroup_encode_cancel(struct update_subgroup *subgrp);
+extern unsigned int subgroup_encode_threads(void);
+extern struct bgp_opkt *bpacket_reformat_for_peer(struct bpacket *pkt,
+						  struct peer_af *paf);
+extern void bpacket_body_unref(struct bpacket_body *body);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
 extern void bpacket_attr_vec_arr_set_vec(struct bpacket_attr_vec_arr *vecarr,
 					 enum bpacket_attr_vec_type type,
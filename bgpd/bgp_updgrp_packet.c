@@ -43,6 +43,8 @@
 #include "hash.h"
 #include "queue.h"
 #include "mpls.h"
+#include "frr_pthread.h"
+#include "frratomic.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -57,11 +59,46 @@
 #include "bgpd/bgp_mplsvpn.h"
 #include "bgpd/bgp_label.h"
 #include "bgpd/bgp_addpath.h"
+#include "bgpd/bgp_io.h"
+
+DEFINE_MTYPE_STATIC(BGPD, BGP_PACKET_BODY, "BGP shared packet body");
 
 /********************
  * PRIVATE FUNCTIONS
  ********************/
 
+/* One UPDATE being built for a subgroup */
+struct subgroup_encode {
+	struct update_subgroup *subgrp;
+
+	/* results of subgroup_update_packet_encode() */
+	struct bpacket_attr_vec_arr vecarr;
+	struct stream *packet;
+	int num_pfx;
+	bool attr_too_long;
+};
+
+/* A set of subgroups being encoded concurrently */
+struct subgroup_encode_batch {
+	struct subgroup_encode *items;
+	unsigned int count;
+
+	/* next item to be picked up by a participant */
+	_Atomic unsigned int next;
+
+	/* number of pool pthreads still working on the batch */
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int pending;
+};
+
+static struct frr_pthread *subgroup_encode_pth[BGP_ENCODE_THREADS_MAX];
+static unsigned int subgroup_encode_nthreads;
+static struct thread *t_subgroup_encode;
+
+/* subgroups with advertisements to be encoded by the pool */
+static struct subgroup_encode_queue_head subgroup_encode_queue;
+
 /********************
  * PUBLIC FUNCTIONS
  ********************/
@@ -76,12 +113,47 @@ struct bpacket *bpacket_alloc(void)
 
 void bpacket_free(struct bpacket *pkt)
 {
-	if (pkt->buffer)
+	if (pkt->body)
+		bpacket_body_unref(pkt->body);
+	else if (pkt->buffer)
 		stream_free(pkt->buffer);
+	pkt->body = NULL;
 	pkt->buffer = NULL;
 	XFREE(MTYPE_BGP_PACKET, pkt);
 }
 
+/*
+ * Returns a new reference to the body of pkt, creating it on first use.
+ * Main pthread only.
+ */
+static struct bpacket_body *bpacket_body_get(struct bpacket *pkt)
+{
+	if (!pkt->body) {
+		pkt->body = XCALLOC(MTYPE_BGP_PACKET_BODY,
+				    sizeof(struct bpacket_body));
+		pkt->body->s = pkt->buffer;
+		atomic_store_explicit(&pkt->body->refcnt, 1,
+				      memory_order_relaxed);
+	}
+
+	atomic_fetch_add_explicit(&pkt->body->refcnt, 1, memory_order_relaxed);
+	return pkt->body;
+}
+
+/*
+ * Drops a reference to a packet body.  Called from both the main pthread
+ * (bpacket freed) and the I/O pthread (packet written).
+ */
+void bpacket_body_unref(struct bpacket_body *body)
+{
+	if (atomic_fetch_sub_explicit(&body->refcnt, 1, memory_order_acq_rel)
+	    > 1)
+		return;
+
+	stream_free(body->s);
+	XFREE(MTYPE_BGP_PACKET_BODY, body);
+}
+
 void bpacket_queue_init(struct bpacket_queue *q)
 {
 	TAILQ_INIT(&(q->pkts));
@@ -344,21 +416,29 @@ void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty)
 	return;
 }
 
-struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
-					 struct peer_af *paf)
+/*
+ * Returns the packet to queue to a peer for pkt.
+ *
+ * The packet refers to the buffer of pkt, which is shared by all peers of the
+ * subgroup; only the nexthop addresses that differ for this peer are held by
+ * the returned packet itself.
+ */
+struct bgp_opkt *bpacket_reformat_for_peer(struct bpacket *pkt,
+					   struct peer_af *paf)
 {
-	struct stream *s = NULL;
+	struct stream *s = pkt->buffer;
+	struct bgp_opkt *opkt;
 	bpacket_attr_vec *vec;
 	struct peer *peer;
 	struct bgp_filter *filter;
 
-	s = stream_dup(pkt->buffer);
+	opkt = bgp_opkt_new_shared(bpacket_body_get(pkt));
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
 
 	if (!CHECK_FLAG(vec->flags, BPKT_ATTRVEC_FLAGS_UPDATED))
-		return s;
+		return opkt;
 
 	uint8_t nhlen;
 	afi_t nhafi;
@@ -396,7 +476,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
+			bgp_opkt_free(opkt);
 			return NULL;
 		}
 
@@ -446,7 +526,8 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		}
 
 		if (nh_modified) /* allow for VPN RD */
-			stream_put_in_addr_at(s, offset_nh, mod_v4nh);
+			bgp_opkt_patch(opkt, offset_nh, mod_v4nh,
+				       IPV4_MAX_BYTELEN);
 
 		if (bgp_debug_update(peer, NULL, NULL, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64
@@ -498,7 +579,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				EC_BGP_INVALID_NEXTHOP_LENGTH,
 				"%s: %s: invalid MP nexthop length (AFI IP6): %u",
 				__func__, peer->host, nhlen);
-			stream_free(s);
+			bgp_opkt_free(opkt);
 			return NULL;
 		}
 
@@ -558,9 +639,11 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		}
 
 		if (gnh_modified)
-			stream_put_in6_addr_at(s, offset_nhglobal, mod_v6nhg);
+			bgp_opkt_patch(opkt, offset_nhglobal, mod_v6nhg,
+				       IPV6_MAX_BYTELEN);
 		if (lnh_modified)
-			stream_put_in6_addr_at(s, offset_nhlocal, mod_v6nhl);
+			bgp_opkt_patch(opkt, offset_nhlocal, mod_v6nhl,
+				       IPV6_MAX_BYTELEN);
 
 		if (bgp_debug_update(peer, NULL, NULL, 0)) {
 			if (nhlen == BGP_ATTR_NHLEN_IPV6_GLOBAL_AND_LL
@@ -599,7 +682,8 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 		}
 
 		if (nh_modified)
-			stream_put_in_addr_at(s, vec->offset + 1, mod_v4nh);
+			bgp_opkt_patch(opkt, vec->offset + 1, mod_v4nh,
+				       IPV4_MAX_BYTELEN);
 
 		if (bgp_debug_update(peer, NULL, NULL, 0))
 			zlog_debug("u%" PRIu64 ":s%" PRIu64
@@ -608,7 +692,7 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 				   PAF_SUBGRP(paf)->id, peer->host, mod_v4nh);
 	}
 
-	return s;
+	return opkt;
 }
 
 /*
@@ -648,17 +732,43 @@ bool subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return false;
 }
 
-/* Make BGP update packet.  */
-struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+/*
+ * Next advertisement to go into the UPDATE started with 'first', without
+ * modifying any of the advertisement lists: the remaining advertisements
+ * sharing first's attribute, in the order bgp_advertise_clean_subgroup()
+ * hands them out once the previous one has been synchronized.
+ */
+static struct bgp_advertise *subgroup_update_next_adv(struct bgp_advertise *first,
+						      struct bgp_advertise *cur)
 {
-	struct bpacket_attr_vec_arr vecarr;
-	struct bpacket *pkt;
+	struct bgp_advertise *next;
+
+	next = (cur == first) ? first->baa->adv : cur->next;
+	if (next == first)
+		next = first->next;
+
+	return next;
+}
+
+/*
+ * Encode the next UPDATE for a subgroup into enc->packet.
+ *
+ * This only reads the subgroup's advertisement lists and the attributes,
+ * and writes to the subgroup's private work streams, so encoding of
+ * different subgroups may run concurrently as long as the main pthread is
+ * not modifying routing state meanwhile.  The advertisements that went into
+ * the packet are synchronized by subgroup_update_packet_commit().
+ */
+static void subgroup_update_packet_encode(struct subgroup_encode *enc)
+{
+	struct update_subgroup *subgrp = enc->subgrp;
+	struct bpacket_attr_vec_arr *vecarr = &enc->vecarr;
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
 	struct stream *packet;
 	struct bgp_adj_out *adj;
-	struct bgp_advertise *adv;
+	struct bgp_advertise *adv, *first;
 	struct bgp_dest *dest = NULL;
 	struct bgp_path_info *path = NULL;
 	bgp_size_t total_attr_len = 0;
@@ -678,12 +788,14 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	struct prefix_rd *prd = NULL;
 	mpls_label_t label = MPLS_INVALID_LABEL, *label_pnt = NULL;
 	uint32_t num_labels = 0;
+	struct timeval start;
+	uint64_t usec;
 
-	if (!subgrp)
-		return NULL;
+	monotime(&start);
 
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
+	enc->packet = NULL;
+	enc->num_pfx = 0;
+	enc->attr_too_long = false;
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -693,12 +805,12 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	snlri = subgrp->scratch;
 	stream_reset(snlri);
 
-	bpacket_attr_vec_arr_reset(&vecarr);
+	bpacket_attr_vec_arr_reset(vecarr);
 
 	addpath_capable = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_capable ? BGP_ADDPATH_ID_LEN : 0;
 
-	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+	first = adv = bgp_adv_fifo_first(&subgrp->sync->update);
 	while (adv) {
 		const struct prefix *dest_p;
 
@@ -751,7 +863,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			/* 5: Encode all the attributes, except MP_REACH_NLRI
 			 * attr. */
 			total_attr_len = bgp_packet_attribute(
-				NULL, peer, s, adv->baa->attr, &vecarr, NULL,
+				NULL, peer, s, adv->baa->attr, vecarr, NULL,
 				afi, safi, from, NULL, NULL, 0, 0, 0);
 
 			space_remaining =
@@ -770,11 +882,9 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 					"u%" PRIu64 ":s%" PRIu64" attributes too long, cannot send UPDATE",
 					subgrp->update_group->id, subgrp->id);
 
-				/* Flush the FIFO update queue */
-				while (adv)
-					adv = bgp_advertise_clean_subgroup(
-						subgrp, adj);
-				return NULL;
+				enc->attr_too_long = true;
+				stream_reset(s);
+				return;
 			}
 
 			if (BGP_DEBUG(update, UPDATE_OUT)
@@ -808,7 +918,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 			if (stream_empty(snlri))
 				mpattrlen_pos = bgp_packet_mpattr_start(
-					snlri, peer, afi, safi, &vecarr,
+					snlri, peer, afi, safi, vecarr,
 					adv->baa->attr);
 
 			bgp_packet_mpattr_prefix(snlri, afi, safi, dest_p, prd,
@@ -847,13 +957,77 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			bgp_debug_rdpfxpath2str(afi, safi, prd, dest_p,
 						label_pnt, num_labels,
 						addpath_capable, addpath_tx_id,
-						&adv->baa->attr->evpn_overlay,
+						bgp_attr_get_evpn_overlay(
+							adv->baa->attr),
 						pfx_buf, sizeof(pfx_buf));
 			zlog_debug("u%" PRIu64 ":s%" PRIu64 " send UPDATE %s",
 				   subgrp->update_group->id, subgrp->id,
 				   pfx_buf);
 		}
 
+		adv = subgroup_update_next_adv(first, adv);
+	}
+
+	if (stream_empty(s))
+		return;
+
+	if (!stream_empty(snlri)) {
+		bgp_packet_mpattr_end(snlri, mpattrlen_pos);
+		total_attr_len += stream_get_endp(snlri);
+	}
+
+	/* set the total attribute length correctly */
+	stream_putw_at(s, attrlen_pos, total_attr_len);
+
+	if (!stream_empty(snlri)) {
+		packet = stream_dupcat(s, snlri, mpattr_pos);
+		bpacket_attr_vec_arr_update(vecarr, mpattr_pos);
+	} else
+		packet = stream_dup(s);
+	bgp_packet_set_size(packet);
+	if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
+		zlog_debug("u%" PRIu64 ":s%" PRIu64
+			   " send UPDATE len %zd (max message len: %hu) numpfx %d",
+			   subgrp->update_group->id, subgrp->id,
+			   (stream_get_endp(packet) - stream_get_getp(packet)),
+			   peer->max_packet_size, num_pfx);
+	stream_reset(s);
+	stream_reset(snlri);
+
+	enc->packet = packet;
+	enc->num_pfx = num_pfx;
+
+	usec = monotime_since(&start, NULL);
+	subgrp->build_count++;
+	subgrp->build_usec_total += usec;
+	if (usec > subgrp->build_usec_max)
+		subgrp->build_usec_max = usec;
+}
+
+/*
+ * Synchronize the advertisements that went into the packet built by
+ * subgroup_update_packet_encode() and queue the packet.
+ */
+static struct bpacket *
+subgroup_update_packet_commit(struct subgroup_encode *enc)
+{
+	struct update_subgroup *subgrp = enc->subgrp;
+	struct bgp_advertise *adv;
+	struct bgp_adj_out *adj;
+	int i;
+
+	adv = bgp_adv_fifo_first(&subgrp->sync->update);
+
+	if (enc->attr_too_long) {
+		/* Flush the FIFO update queue */
+		while (adv)
+			adv = bgp_advertise_clean_subgroup(subgrp, adv->adj);
+		return NULL;
+	}
+
+	for (i = 0; i < enc->num_pfx; i++) {
+		adj = adv->adj;
+
 		/* Synchnorize attribute.  */
 		if (adj->attr)
 			bgp_attr_unintern(&adj->attr);
@@ -864,35 +1038,26 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 		adv = bgp_advertise_clean_subgroup(subgrp, adj);
 	}
 
-	if (!stream_empty(s)) {
-		if (!stream_empty(snlri)) {
-			bgp_packet_mpattr_end(snlri, mpattrlen_pos);
-			total_attr_len += stream_get_endp(snlri);
-		}
+	if (!enc->packet)
+		return NULL;
 
-		/* set the total attribute length correctly */
-		stream_putw_at(s, attrlen_pos, total_attr_len);
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), enc->packet,
+				 &enc->vecarr);
+}
 
-		if (!stream_empty(snlri)) {
-			packet = stream_dupcat(s, snlri, mpattr_pos);
-			bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
-		} else
-			packet = stream_dup(s);
-		bgp_packet_set_size(packet);
-		if (bgp_debug_update(NULL, NULL, subgrp->update_group, 0))
-			zlog_debug(
-				"u%" PRIu64 ":s%" PRIu64
-				" send UPDATE len %zd (max message len: %hu) numpfx %d",
-				subgrp->update_group->id, subgrp->id,
-				(stream_get_endp(packet)
-				 - stream_get_getp(packet)),
-				peer->max_packet_size, num_pfx);
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
-		stream_reset(s);
-		stream_reset(snlri);
-		return pkt;
-	}
-	return NULL;
+/* Make BGP update packet.  */
+struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+{
+	struct subgroup_encode enc = {.subgrp = subgrp};
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	subgroup_update_packet_encode(&enc);
+	return subgroup_update_packet_commit(&enc);
 }
 
 /* Make BGP withdraw packet.  */
@@ -1313,3 +1478,223 @@ void bpacket_attr_vec_arr_set_vec(struct bpacket_attr_vec_arr *vecarr,
 	if (attr)
 		bpacket_vec_arr_inherit_attr_flags(vecarr, type, attr);
 }
+
+/*
+ * UPDATE encoding pool.
+ *
+ * When enabled, UPDATEs for all subgroups with pending advertisements are
+ * built up front in rounds instead of lazily when a peer runs out of
+ * packets: in each round one UPDATE per subgroup is encoded concurrently by
+ * the main pthread and the pool pthreads, while the main pthread does
+ * nothing else.  The advertisements are then synchronized and the packets
+ * queued on the main pthread in subgroup order, so every subgroup ends up
+ * with the same packets in the same order as when built serially.
+ */
+static void subgroup_encode_batch_run(struct subgroup_encode_batch *batch)
+{
+	unsigned int i;
+
+	while ((i = atomic_fetch_add_explicit(&batch->next, 1,
+					      memory_order_relaxed))
+	       < batch->count)
+		subgroup_update_packet_encode(&batch->items[i]);
+}
+
+static void subgroup_encode_worker(struct thread *thread)
+{
+	struct subgroup_encode_batch *batch = THREAD_ARG(thread);
+
+	subgroup_encode_batch_run(batch);
+
+	frr_with_mutex (&batch->mtx) {
+		if (--batch->pending == 0)
+			pthread_cond_signal(&batch->cond);
+	}
+}
+
+static void subgroup_encode_batch(struct subgroup_encode_batch *batch)
+{
+	unsigned int i, nworkers;
+
+	nworkers = MIN(subgroup_encode_nthreads, batch->count - 1);
+
+	atomic_store_explicit(&batch->next, 0, memory_order_relaxed);
+	batch->pending = nworkers;
+
+	for (i = 0; i < nworkers; i++)
+		thread_add_event(subgroup_encode_pth[i]->master,
+				 subgroup_encode_worker, batch, 0, NULL);
+
+	subgroup_encode_batch_run(batch);
+
+	frr_with_mutex (&batch->mtx) {
+		while (batch->pending)
+			pthread_cond_wait(&batch->cond, &batch->mtx);
+	}
+}
+
+/*
+ * Whether a subgroup's UPDATEs may be built now: the same gating as in
+ * bgp_generate_updgrp_packets(), for at least one of its peers.  Others are
+ * left to the regular path, which builds their UPDATEs once the coalesce or
+ * MRAI timers expire.
+ */
+static bool subgroup_encode_ready(struct update_subgroup *subgrp)
+{
+	struct bgp *bgp = SUBGRP_INST(subgrp);
+	struct peer_af *paf;
+
+	if (subgrp->t_coalesce)
+		return false;
+
+	if (bgp->main_peers_update_hold || bgp_update_delay_active(bgp))
+		return false;
+
+	SUBGRP_FOREACH_PEER (subgrp, paf)
+		if (peer_established(paf->peer) && !paf->peer->t_routeadv)
+			return true;
+
+	return false;
+}
+
+/*
+ * bgp_dump_attr() fills in the strings of the communities the first time
+ * they are printed.  The attributes are interned and shared between
+ * subgroups, so do that here, before the pool pthreads dump them.
+ */
+static void subgroup_encode_batch_dump(struct subgroup_encode_batch *batch)
+{
+	char buf[BUFSIZ];
+	struct bgp_advertise *adv;
+	unsigned int i;
+
+	if (!BGP_DEBUG(update, UPDATE_OUT) && !BGP_DEBUG(update, UPDATE_PREFIX))
+		return;
+
+	for (i = 0; i < batch->count; i++) {
+		adv = bgp_adv_fifo_first(&batch->items[i].subgrp->sync->update);
+		bgp_dump_attr(adv->baa->attr, buf, sizeof(buf));
+	}
+}
+
+static void subgroup_encode_pending(struct thread *thread)
+{
+	struct subgroup_encode_batch batch = {};
+	struct update_subgroup *subgrp;
+	struct listnode *node;
+	struct list *subgrps;
+	unsigned int i;
+
+	subgrps = list_new();
+	while ((subgrp = subgroup_encode_queue_pop(&subgroup_encode_queue)))
+		if (subgroup_encode_ready(subgrp))
+			listnode_add(subgrps, subgrp);
+
+	if (!listcount(subgrps)) {
+		list_delete(&subgrps);
+		return;
+	}
+
+	batch.items = XCALLOC(MTYPE_TMP,
+			      listcount(subgrps) * sizeof(*batch.items));
+	pthread_mutex_init(&batch.mtx, NULL);
+	pthread_cond_init(&batch.cond, NULL);
+
+	do {
+		batch.count = 0;
+
+		for (ALL_LIST_ELEMENTS_RO(subgrps, node, subgrp)) {
+			/* withdraws go out first, as in
+			 * bgp_generate_updgrp_packets()
+			 */
+			while (subgroup_withdraw_packet(subgrp))
+				;
+
+			if (bpacket_queue_is_full(SUBGRP_INST(subgrp),
+						  SUBGRP_PKTQ(subgrp))
+			    || !bgp_adv_fifo_count(&subgrp->sync->update))
+				continue;
+
+			batch.items[batch.count++].subgrp = subgrp;
+		}
+
+		if (batch.count) {
+			subgroup_encode_batch_dump(&batch);
+			subgroup_encode_batch(&batch);
+		}
+
+		/* leave subgroups that did not produce a packet to the
+		 * regular path
+		 */
+		for (i = 0; i < batch.count; i++)
+			if (!subgroup_update_packet_commit(&batch.items[i]))
+				listnode_delete(subgrps,
+						batch.items[i].subgrp);
+	} while (batch.count);
+
+	/* the packets queued above requeued their own subgroups, which
+	 * have nothing left to encode
+	 */
+	while (subgroup_encode_queue_pop(&subgroup_encode_queue))
+		;
+	THREAD_OFF(t_subgroup_encode);
+
+	pthread_cond_destroy(&batch.cond);
+	pthread_mutex_destroy(&batch.mtx);
+	XFREE(MTYPE_TMP, batch.items);
+	list_delete(&subgrps);
+}
+
+void subgroup_encode_schedule(struct update_subgroup *subgrp)
+{
+	if (!subgroup_encode_nthreads)
+		return;
+
+	if (!subgroup_encode_queue_anywhere(subgrp))
+		subgroup_encode_queue_add_tail(&subgroup_encode_queue, subgrp);
+
+	thread_add_event(bm->master, subgroup_encode_pending, NULL, 0,
+			 &t_subgroup_encode);
+}
+
+void subgroup_encode_cancel(struct update_subgroup *subgrp)
+{
+	if (subgroup_encode_queue_anywhere(subgrp))
+		subgroup_encode_queue_del(&subgroup_encode_queue, subgrp);
+}
+
+void subgroup_encode_init(unsigned int nthreads)
+{
+	struct frr_pthread_attr attr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop,
+	};
+	char name[32], os_name[OS_THREAD_NAMELEN];
+	unsigned int i;
+
+	subgroup_encode_nthreads = MIN(nthreads, BGP_ENCODE_THREADS_MAX);
+	subgroup_encode_queue_init(&subgroup_encode_queue);
+
+	for (i = 0; i < subgroup_encode_nthreads; i++) {
+		snprintf(name, sizeof(name), "BGP UPDATE encode thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_enc%u", i);
+		subgroup_encode_pth[i] = frr_pthread_new(&attr, name, os_name);
+	}
+}
+
+void subgroup_encode_run(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < subgroup_encode_nthreads; i++)
+		frr_pthread_run(subgroup_encode_pth[i], NULL);
+
+	/* Wait until threads are ready. */
+	for (i = 0; i < subgroup_encode_nthreads; i++)
+		frr_pthread_wait_running(subgroup_encode_pth[i]);
+}
+
+unsigned int subgroup_encode_threads(void)
+{
+	return subgroup_encode_nthreads;
+}
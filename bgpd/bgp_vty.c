@@ -1776,6 +1776,36 @@ DEFPY (bgp_suppress_fib_pending,
 	return CMD_SUCCESS;
 }
 
+DEFPY (bgp_install_nhg,
+       bgp_install_nhg_cmd,
+       "[no] bgp install nexthop-group",
+       NO_STR
+       BGP_STR
+       "Route installation\n"
+       "Install routes through nexthop-groups managed by BGP\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	afi_t afi;
+	safi_t safi;
+
+	if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_INSTALL_NHG) == !no)
+		return CMD_SUCCESS;
+
+	if (no)
+		UNSET_FLAG(bgp->flags, BGP_FLAG_INSTALL_NHG);
+	else
+		SET_FLAG(bgp->flags, BGP_FLAG_INSTALL_NHG);
+
+	/* This config is used in route install, so redo that. */
+	FOREACH_AFI_SAFI (afi, safi) {
+		if (!bgp_fibupd_safi(safi))
+			continue;
+		bgp_zebra_announce_table(bgp, afi, safi);
+	}
+
+	return CMD_SUCCESS;
+}
+
 
 /* BGP Cluster ID.  */
 DEFUN (bgp_cluster_id,
@@ -2304,6 +2334,16 @@ static int bgp_rpkt_quanta_config_vty(struct vty *vty, uint32_t quanta,
 	return CMD_SUCCESS;
 }
 
+static int bgp_wbatch_config_vty(struct vty *vty, uint32_t bytes, bool set)
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+
+	bytes = set ? bytes : 0;
+	atomic_store_explicit(&bgp->wbatch_bytes, bytes, memory_order_relaxed);
+
+	return CMD_SUCCESS;
+}
+
 void bgp_config_write_wpkt_quanta(struct vty *vty, struct bgp *bgp)
 {
 	uint32_t quanta =
@@ -2320,6 +2360,14 @@ void bgp_config_write_rpkt_quanta(struct vty *vty, struct bgp *bgp)
 		vty_out(vty, " read-quanta %d\n", quanta);
 }
 
+void bgp_config_write_wbatch(struct vty *vty, struct bgp *bgp)
+{
+	uint32_t bytes =
+		atomic_load_explicit(&bgp->wbatch_bytes, memory_order_relaxed);
+	if (bytes)
+		vty_out(vty, " write-batch %u\n", bytes);
+}
+
 /* Packet quanta configuration
  *
  * XXX: The value set here controls the size of a stack buffer in the IO
@@ -2348,6 +2396,20 @@ DEFPY (bgp_rpkt_quanta,
 	return bgp_rpkt_quanta_config_vty(vty, quanta, !no);
 }
 
+/*
+ * Like write-quanta this bounds a stack buffer in the IO thread, which holds
+ * at most BGP_WRITE_BATCH_PACKET_MAX packets when write-batch is set.
+ */
+DEFPY (bgp_wbatch,
+       bgp_wbatch_cmd,
+       "[no] write-batch (4096-1048576)$bytes",
+       NO_STR
+       "Coalesce packets written to peer socket up to a number of bytes\n"
+       "Number of bytes\n")
+{
+	return bgp_wbatch_config_vty(vty, bytes, !no);
+}
+
 void bgp_config_write_coalesce_time(struct vty *vty, struct bgp *bgp)
 {
 	if (!bgp->heuristic_coalesce)
@@ -10192,6 +10254,8 @@ DEFUN (show_bgp_memory,
 {
 	char memstrbuf[MTYPE_MEMSTR_LEN];
 	unsigned long count;
+	unsigned long adj_in_count;
+	size_t adj_in_bytes;
 
 	/* RIB related usage stats */
 	count = mtype_stats_alloc(MTYPE_BGP_NODE);
@@ -10221,10 +10285,14 @@ DEFUN (show_bgp_memory,
 				     count * sizeof(struct bpacket)));
 
 	/* Adj-In/Out */
-	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_IN)))
-		vty_out(vty, "%ld Adj-In entries, using %s of memory\n", count,
+	bgp_adj_in_stats(&adj_in_count, &adj_in_bytes);
+	if (adj_in_count)
+		vty_out(vty,
+			"%lu Adj-In entries, using %s of memory (%zu bytes per entry)\n",
+			adj_in_count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
-				     count * sizeof(struct bgp_adj_in)));
+				     adj_in_bytes),
+			adj_in_bytes / adj_in_count);
 	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT)))
 		vty_out(vty, "%ld Adj-Out entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
@@ -10251,6 +10319,12 @@ DEFUN (show_bgp_memory,
 	if ((count = attr_unknown_count()))
 		vty_out(vty, "%ld unknown attributes\n", count);
 
+	if ((count = attr_evpn_count()))
+		vty_out(vty, "%ld BGP EVPN attributes, using %s of memory\n",
+			count,
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * sizeof(struct bgp_attr_evpn)));
+
 	/* AS_PATH attributes */
 	count = aspath_count();
 	vty_out(vty, "%ld BGP AS-PATH entries, using %s of memory\n", count,
@@ -12051,6 +12125,15 @@ static void bgp_show_peer_afi(struct vty *vty, struct peer *p, afi_t afi,
 		if (CHECK_FLAG(p->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG))
 			json_object_boolean_true_add(json_addr,
 						     "inboundSoftConfigPermit");
+		if (p->soft_reconfig_evaluated[afi][safi]
+		    || p->soft_reconfig_skipped[afi][safi]) {
+			json_object_int_add(
+				json_addr, "inboundSoftConfigReevaluated",
+				p->soft_reconfig_evaluated[afi][safi]);
+			json_object_int_add(json_addr,
+					    "inboundSoftConfigSkipped",
+					    p->soft_reconfig_skipped[afi][safi]);
+		}
 
 		if (CHECK_FLAG(p->af_flags[afi][safi],
 			       PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE))
@@ -12366,6 +12449,12 @@ static void bgp_show_peer_afi(struct vty *vty, struct peer *p, afi_t afi,
 		if (CHECK_FLAG(p->af_flags[afi][safi], PEER_FLAG_SOFT_RECONFIG))
 			vty_out(vty,
 				"  Inbound soft reconfiguration allowed\n");
+		if (p->soft_reconfig_evaluated[afi][safi]
+		    || p->soft_reconfig_skipped[afi][safi])
+			vty_out(vty,
+				"  Last inbound soft reconfiguration: %u prefixes re-evaluated, %u skipped\n",
+				p->soft_reconfig_evaluated[afi][safi],
+				p->soft_reconfig_skipped[afi][safi]);
 
 		if (CHECK_FLAG(p->af_flags[afi][safi],
 			       PEER_FLAG_REMOVE_PRIVATE_AS_ALL_REPLACE))
@@ -13937,6 +14026,8 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 
 	if (use_json) {
 		json_object *json_stat = NULL;
+		uint64_t write_calls, write_bytes;
+
 		json_stat = json_object_new_object();
 		/* Packet counts. */
 
@@ -13988,12 +14079,23 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 							 memory_order_relaxed));
 		json_object_int_add(json_stat, "totalSent", PEER_TOTAL_TX(p));
 		json_object_int_add(json_stat, "totalRecv", PEER_TOTAL_RX(p));
+		write_calls = atomic_load_explicit(&p->write_calls,
+						   memory_order_relaxed);
+		write_bytes = atomic_load_explicit(&p->write_bytes,
+						   memory_order_relaxed);
+		json_object_int_add(json_stat, "writeCalls", write_calls);
+		json_object_int_add(json_stat, "writeBytes", write_bytes);
+		json_object_double_add(json_stat, "writeCallsPerMb",
+				       BGP_WRITE_CALLS_PER_MB(write_calls,
+							      write_bytes));
 		json_object_object_add(json_neigh, "messageStats", json_stat);
 	} else {
 		atomic_size_t outq_count, inq_count, open_out, open_in,
 			notify_out, notify_in, update_out, update_in,
 			keepalive_out, keepalive_in, refresh_out, refresh_in,
 			dynamic_cap_out, dynamic_cap_in;
+		uint64_t write_calls, write_bytes;
+
 		outq_count = atomic_load_explicit(&p->obuf->count,
 						  memory_order_relaxed);
 		inq_count = atomic_load_explicit(&p->ibuf->count,
@@ -14022,6 +14124,10 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 						       memory_order_relaxed);
 		dynamic_cap_in = atomic_load_explicit(&p->dynamic_cap_in,
 						      memory_order_relaxed);
+		write_calls = atomic_load_explicit(&p->write_calls,
+						   memory_order_relaxed);
+		write_bytes = atomic_load_explicit(&p->write_bytes,
+						   memory_order_relaxed);
 
 		/* Packet counts. */
 		vty_out(vty, "  Message statistics:\n");
@@ -14042,6 +14148,11 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 			dynamic_cap_out, dynamic_cap_in);
 		vty_out(vty, "    Total:         %10u %10u\n",
 			(uint32_t)PEER_TOTAL_TX(p), (uint32_t)PEER_TOTAL_RX(p));
+		vty_out(vty,
+			"    Socket writes: %" PRIu64 " calls, %" PRIu64
+			" bytes, %.1f calls/MB\n",
+			write_calls, write_bytes,
+			BGP_WRITE_CALLS_PER_MB(write_calls, write_bytes));
 	}
 
 	if (use_json) {
@@ -17520,6 +17631,9 @@ int bgp_config_write(struct vty *vty)
 		if (CHECK_FLAG(bgp->flags, BGP_FLAG_SUPPRESS_FIB_PENDING))
 			vty_out(vty, " bgp suppress-fib-pending\n");
 
+		if (CHECK_FLAG(bgp->flags, BGP_FLAG_INSTALL_NHG))
+			vty_out(vty, " bgp install nexthop-group\n");
+
 		/* BGP log-neighbor-changes. */
 		if (!!CHECK_FLAG(bgp->flags, BGP_FLAG_LOG_NEIGHBOR_CHANGES)
 		    != SAVE_BGP_LOG_NEIGHBOR_CHANGES)
@@ -17670,6 +17784,7 @@ int bgp_config_write(struct vty *vty)
 		bgp_config_write_wpkt_quanta(vty, bgp);
 		/* read quanta */
 		bgp_config_write_rpkt_quanta(vty, bgp);
+		bgp_config_write_wbatch(vty, bgp);
 
 		/* coalesce time */
 		bgp_config_write_coalesce_time(vty, bgp);
@@ -18287,6 +18402,7 @@ void bgp_vty_init(void)
 
 	/* "bgp suppress-fib-pending" command */
 	install_element(BGP_NODE, &bgp_suppress_fib_pending_cmd);
+	install_element(BGP_NODE, &bgp_install_nhg_cmd);
 
 	/* "bgp cluster-id" commands. */
 	install_element(BGP_NODE, &bgp_cluster_id_cmd);
@@ -18328,6 +18444,7 @@ void bgp_vty_init(void)
 
 	install_element(BGP_NODE, &bgp_wpkt_quanta_cmd);
 	install_element(BGP_NODE, &bgp_rpkt_quanta_cmd);
+	install_element(BGP_NODE, &bgp_wbatch_cmd);
 
 	install_element(BGP_NODE, &bgp_coalesce_time_cmd);
 	install_element(BGP_NODE, &no_bgp_coalesce_time_cmd);
@@ -50,6 +50,7 @@
 #include "bgpd/bgp_errors.h"
 #include "bgpd/bgp_mpath.h"
 #include "bgpd/bgp_nexthop.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_bfd.h"
 #include "bgpd/bgp_label.h"
@@ -1124,7 +1125,8 @@ static bool update_ipv4nh_for_route_install(int nh_othervrf, struct bgp *nh_bgp,
 		 * treat the nexthop as NEXTHOP_TYPE_IPV4
 		 * Else, mark the nexthop as onlink.
 		 */
-		if (attr->evpn_overlay.type == OVERLAY_INDEX_GATEWAY_IP)
+		if (bgp_attr_get_evpn_overlay(attr)->type
+		    == OVERLAY_INDEX_GATEWAY_IP)
 			api_nh->type = NEXTHOP_TYPE_IPV4;
 		else {
 			api_nh->type = NEXTHOP_TYPE_IPV4_IFINDEX;
@@ -1163,7 +1165,8 @@ static bool update_ipv6nh_for_route_install(int nh_othervrf, struct bgp *nh_bgp,
 		 * treat the nexthop as NEXTHOP_TYPE_IPV4
 		 * Else, mark the nexthop as onlink.
 		 */
-		if (attr->evpn_overlay.type == OVERLAY_INDEX_GATEWAY_IP)
+		if (bgp_attr_get_evpn_overlay(attr)->type
+		    == OVERLAY_INDEX_GATEWAY_IP)
 			api_nh->type = NEXTHOP_TYPE_IPV6;
 		else {
 			api_nh->type = NEXTHOP_TYPE_IPV6_IFINDEX;
@@ -1270,6 +1273,9 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 	bool do_wt_ecmp;
 	uint64_t cum_bw = 0;
 	uint32_t nhg_id = 0;
+	struct bgp_nhg_nexthop nhg_nexthops[MULTIPATH_NUM];
+	struct bgp_nhg *nhg = NULL, *old_nhg;
+	bool use_nhg;
 	bool is_add;
 	uint32_t ttl = 0;
 	uint32_t bos = 0;
@@ -1296,6 +1302,9 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 	if (info->extra && info->extra->bgp_orig)
 		nh_othervrf = 1;
 
+	use_nhg = CHECK_FLAG(bgp->flags, BGP_FLAG_INSTALL_NHG) && !nh_othervrf
+		  && info->sub_type != BGP_ROUTE_AGGREGATE;
+
 	/* Make Zebra API structure. */
 	api.vrf_id = bgp->vrf_id;
 	api.type = ZEBRA_ROUTE_BGP;
@@ -1475,9 +1484,10 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 		}
 
 		if (is_evpn
-		    && mpinfo->attr->evpn_overlay.type
+		    && bgp_attr_get_evpn(mpinfo->attr)->overlay.type
 			       != OVERLAY_INDEX_GATEWAY_IP)
-			memcpy(&api_nh->rmac, &(mpinfo->attr->rmac),
+			memcpy(&api_nh->rmac,
+			       &(bgp_attr_get_evpn(mpinfo->attr)->rmac),
 			       sizeof(struct ethaddr));
 
 		api_nh->weight = nh_weight;
@@ -1504,9 +1514,31 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 			SET_FLAG(api_nh->flags, ZAPI_NEXTHOP_FLAG_SEG6);
 		}
 
+		if (use_nhg && bgp_nhg_nexthop_usable(mpinfo->nexthop, api_nh)) {
+			nhg_nexthops[valid_nh_count].bnc = mpinfo->nexthop;
+			nhg_nexthops[valid_nh_count].weight = nh_weight;
+		} else
+			use_nhg = false;
+
 		valid_nh_count++;
 	}
 
+	/*
+	 * Refer to a nexthop-group of the BGP nexthops instead of sending the
+	 * nexthops, the group follows their resolution by itself.
+	 */
+	if (use_nhg)
+		nhg = bgp_nhg_get(nhg_nexthops, valid_nh_count);
+	if (nhg) {
+		nhg_id = bgp_nhg_id(nhg);
+		api.nhgid = nhg_id;
+		SET_FLAG(api.message, ZAPI_MESSAGE_NHG);
+		UNSET_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP);
+		valid_nh_count = 0;
+	}
+	old_nhg = dest->nhg;
+	dest->nhg = nhg;
+
 	is_add = (valid_nh_count || nhg_id) ? true : false;
 
 	if (is_add && CHECK_FLAG(bm->flags, BM_FLAG_SEND_EXTRA_DATA_TO_ZEBRA)) {
@@ -1576,7 +1608,7 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 		zlog_debug(
 			"Tx route %s VRF %u %pFX metric %u tag %" ROUTE_TAG_PRI
 			" count %d nhg %d",
-			valid_nh_count ? "add" : "delete", bgp->vrf_id,
+			is_add ? "add" : "delete", bgp->vrf_id,
 			&api.prefix, api.metric, api.tag, api.nexthop_num,
 			nhg_id);
 		for (i = 0; i < api.nexthop_num; i++) {
@@ -1642,8 +1674,11 @@ void bgp_zebra_announce(struct bgp_dest *dest, const struct prefix *p,
 		zlog_debug("%s: %pFX: announcing to zebra (recursion %sset)",
 			   __func__, p, (recursion_flag ? "" : "NOT "));
 	}
-	zclient_route_send(is_add ? ZEBRA_ROUTE_ADD : ZEBRA_ROUTE_DELETE,
-			   zclient, &api);
+	zclient_route_bulk_send(is_add ? ZEBRA_ROUTE_ADD : ZEBRA_ROUTE_DELETE,
+				zclient, &api);
+
+	/* after the route moved off it */
+	bgp_nhg_put(old_nhg);
 }
 
 /* Announce all routes of a table to zebra */
@@ -1733,7 +1768,12 @@ void bgp_zebra_withdraw(const struct prefix *p, struct bgp_path_info *info,
 		zlog_debug("Tx route delete VRF %u %pFX", bgp->vrf_id,
 			   &api.prefix);
 
-	zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+
+	if (info->net) {
+		bgp_nhg_put(info->net->nhg);
+		info->net->nhg = NULL;
+	}
 }
 
 /* Withdraw all entries in a BGP instances RIB table from Zebra */
@@ -2623,6 +2663,19 @@ static int bgp_zebra_route_notify_owner(int command, struct zclient *zclient,
 	return 0;
 }
 
+/* Process nexthop-group notification messages from RIB */
+static int bgp_zebra_nhg_notify_owner(ZAPI_CALLBACK_ARGS)
+{
+	enum zapi_nhg_notify_owner note;
+	uint32_t id;
+
+	if (!zapi_nhg_notify_decode(zclient->ibuf, &id, &note))
+		return -1;
+
+	bgp_nhg_notify(id, note);
+	return 0;
+}
+
 /* this function is used to forge ip rule,
  * - either for iptable/ipset using fwmark id
  * - or for sample ip rule cmd
@@ -2766,6 +2819,9 @@ static void bgp_zebra_connected(struct zclient *zclient)
 
 	zclient_num_connects++; /* increment even if not responding */
 
+	/* zebra does not know about our nexthop-groups anymore */
+	bgp_nhg_zebra_reset();
+
 	/* Send the client registration */
 	bfd_client_sendmsg(zclient, ZEBRA_BFD_CLIENT_REGISTER, VRF_DEFAULT);
 
@@ -3331,6 +3387,7 @@ static zclient_handler *const bgp_handlers[] = {
 	[ZEBRA_IPSET_ENTRY_NOTIFY_OWNER] = ipset_entry_notify_owner,
 	[ZEBRA_IPTABLE_NOTIFY_OWNER] = iptable_notify_owner,
 	[ZEBRA_ROUTE_NOTIFY_OWNER] = bgp_zebra_route_notify_owner,
+	[ZEBRA_NHG_NOTIFY_OWNER] = bgp_zebra_nhg_notify_owner,
 	[ZEBRA_SRV6_LOCATOR_ADD] = bgp_zebra_process_srv6_locator_add,
 	[ZEBRA_SRV6_LOCATOR_DELETE] = bgp_zebra_process_srv6_locator_delete,
 	[ZEBRA_SRV6_MANAGER_GET_LOCATOR_CHUNK] =
@@ -46,6 +46,7 @@
 #include "lib/sockopt.h"
 #include "frr_pthread.h"
 #include "bitfield.h"
+#include "mempool.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -77,6 +78,7 @@
 #include "bgpd/bgp_network.h"
 #include "bgpd/bgp_vty.h"
 #include "bgpd/bgp_mpath.h"
+#include "bgpd/bgp_nhg.h"
 #include "bgpd/bgp_nht.h"
 #include "bgpd/bgp_updgrp.h"
 #include "bgpd/bgp_bfd.h"
@@ -84,6 +86,7 @@
 #include "bgpd/bgp_evpn_vty.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_preparse.h"
 #include "bgpd/bgp_ecommunity.h"
 #include "bgpd/bgp_flowspec.h"
 #include "bgpd/bgp_labelpool.h"
@@ -1162,6 +1165,9 @@ static void peer_free(struct peer *peer)
 
 	bgp_unlock(peer->bgp);
 
+	mempool_release(&peer->path_pool);
+	mempool_release(&peer->path_extra_pool);
+
 	memset(peer, 0, sizeof(struct peer));
 
 	XFREE(MTYPE_BGP_PEER, peer);
@@ -1380,9 +1386,16 @@ struct peer *peer_new(struct bgp *bgp)
 
 	/* Create buffers.  */
 	peer->ibuf = stream_fifo_new();
-	peer->obuf = stream_fifo_new();
+	peer->obuf = bgp_obuf_new();
+	peer->ibuf_preparse = stream_fifo_new();
+	bgp_preparse_list_init(&peer->preparsed);
 	pthread_mutex_init(&peer->io_mtx, NULL);
 
+	peer->path_pool =
+		mempool_new(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+	peer->path_extra_pool = mempool_new(MTYPE_BGP_ROUTE_EXTRA,
+					    sizeof(struct bgp_path_info_extra));
+
 	/* We use a larger buffer for peer->obuf_work in the event that:
 	 * - We RX a BGP_UPDATE where the attributes alone are just
 	 *   under BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE.
@@ -2500,8 +2513,15 @@ int peer_delete(struct peer *peer)
 		peer->ibuf = NULL;
 	}
 
+	if (peer->ibuf_preparse) {
+		bgp_preparse_flush(peer);
+		bgp_preparse_list_fini(&peer->preparsed);
+		stream_fifo_free(peer->ibuf_preparse);
+		peer->ibuf_preparse = NULL;
+	}
+
 	if (peer->obuf) {
-		stream_fifo_free(peer->obuf);
+		bgp_obuf_free(peer->obuf);
 		peer->obuf = NULL;
 	}
 
@@ -3258,6 +3278,7 @@ static struct bgp *bgp_create(as_t *as, const char *name,
 			      memory_order_relaxed);
 	atomic_store_explicit(&bgp->rpkt_quanta, BGP_READ_PACKET_MAX,
 			      memory_order_relaxed);
+	atomic_store_explicit(&bgp->wbatch_bytes, 0, memory_order_relaxed);
 	bgp->coalesce_time = BGP_DEFAULT_SUBGROUP_COALESCE_TIME;
 	bgp->default_af[AFI_IP][SAFI_UNICAST] = true;
 
@@ -7818,6 +7839,10 @@ static void peer_reset_message_stats(struct peer *peer)
 				      memory_order_relaxed);
 		atomic_store_explicit(&peer->dynamic_cap_out, 0,
 				      memory_order_relaxed);
+		atomic_store_explicit(&peer->write_calls, 0,
+				      memory_order_relaxed);
+		atomic_store_explicit(&peer->write_bytes, 0,
+				      memory_order_relaxed);
 	}
 }
 
@@ -8022,6 +8047,7 @@ void bgp_master_init(struct thread_master *master, const int buffer_size,
 	bgp_lp_init(bm->master, &bm->labelpool);
 
 	bgp_l3nhg_init();
+	bgp_nhg_init();
 	bgp_evpn_mh_init();
 	QOBJ_REG(bm, bgp_master);
 }
@@ -8112,6 +8138,9 @@ static void bgp_pthreads_init(void)
 	};
 	bgp_pth_io = frr_pthread_new(&io, "BGP I/O thread", "bgpd_io");
 	bgp_pth_ka = frr_pthread_new(&ka, "BGP Keepalives thread", "bgpd_ka");
+
+	bgp_preparse_init(bm->parse_threads);
+	subgroup_encode_init(bm->encode_threads);
 }
 
 void bgp_pthreads_run(void)
@@ -8122,6 +8151,9 @@ void bgp_pthreads_run(void)
 	/* Wait until threads are ready. */
 	frr_pthread_wait_running(bgp_pth_io);
 	frr_pthread_wait_running(bgp_pth_ka);
+
+	bgp_preparse_run();
+	subgroup_encode_run();
 }
 
 void bgp_pthreads_finish(void)
@@ -8172,6 +8204,7 @@ void bgp_init(unsigned short instance)
 
 	/* BGP VTY commands installation.  */
 	bgp_vty_init();
+	bgp_preparse_vty_init();
 
 	/* BGP inits. */
 	bgp_attr_init();
@@ -8181,6 +8214,7 @@ void bgp_init(unsigned short instance)
 	bgp_route_init();
 	bgp_route_map_init();
 	bgp_scan_vty_init();
+	bgp_nhg_vty_init();
 	bgp_mplsvpn_init();
 #ifdef ENABLE_BGP_VNC
 	rfapi_init();
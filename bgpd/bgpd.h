@@ -56,6 +56,9 @@
 
 struct update_subgroup;
 struct bpacket;
+struct bpacket_body;
+struct bgp_obuf;
+struct bgp_opkt;
 struct bgp_pbr_config;
 
 /*
@@ -156,6 +159,12 @@ struct bgp_master {
 	/* How big should we set the socket buffer size */
 	uint32_t socket_buffer;
 
+	/* Number of UPDATE pre-parse pthreads, 0 to disable */
+	uint32_t parse_threads;
+
+	/* Number of UPDATE encode pthreads, 0 to disable */
+	uint32_t encode_threads;
+
 	/* Should we do wait for fib install globally? */
 	bool wait_for_fib;
 
@@ -491,6 +500,7 @@ struct bgp {
 #define BGP_FLAG_SHUTDOWN (1 << 25)
 #define BGP_FLAG_SUPPRESS_FIB_PENDING (1 << 26)
 #define BGP_FLAG_SUPPRESS_DUPLICATES (1 << 27)
+#define BGP_FLAG_INSTALL_NHG (1 << 28)
 #define BGP_FLAG_PEERTYPE_MULTIPATH_RELAX (1 << 29)
 /* Indicate Graceful Restart support for BGP NOTIFICATION messages */
 #define BGP_FLAG_GRACEFUL_NOTIFICATION (1 << 30)
@@ -631,6 +641,7 @@ struct bgp {
 
 	_Atomic uint32_t wpkt_quanta; // max # packets to write per i/o cycle
 	_Atomic uint32_t rpkt_quanta; // max # packets to read per i/o cycle
+	_Atomic uint32_t wbatch_bytes; // coalesce writes up to # bytes, 0 = off
 
 	/* Automatic coalesce adjust on/off */
 	bool heuristic_coalesce;
@@ -1075,6 +1086,8 @@ struct llgr_info {
 	uint8_t flags;
 };
 
+PREDECL_LIST(bgp_preparse_list);
+
 /* BGP neighbor structure. */
 struct peer {
 	/* BGP structure.  */
@@ -1087,6 +1100,12 @@ struct peer {
 	 */
 	int lock;
 
+	/* allocators for the paths learned from this peer, so that they are
+	 * packed together and handed back to the system when it goes away
+	 */
+	struct mempool *path_pool;
+	struct mempool *path_extra_pool;
+
 	/* BGP peer group.  */
 	struct peer_group *group;
 	uint64_t version[AFI_MAX][SAFI_MAX];
@@ -1115,7 +1134,7 @@ struct peer {
 	/* Packet receive and send buffer. */
 	pthread_mutex_t io_mtx;   // guards ibuf, obuf
 	struct stream_fifo *ibuf; // packets waiting to be processed
-	struct stream_fifo *obuf; // packets waiting to be written
+	struct bgp_obuf *obuf;    // packets waiting to be written
 
 	/* used as a block to deposit raw wire data to */
 	uint8_t ibuf_scratch[BGP_EXTENDED_MESSAGE_MAX_PACKET_SIZE
@@ -1125,6 +1144,13 @@ struct peer {
 
 	struct stream *curr; // the current packet being parsed
 
+	/* UPDATE pre-parse, see bgp_preparse.h */
+	struct frr_pthread *preparse_fpt;	  // pthread assigned to the peer
+	struct stream_fifo *ibuf_preparse;	  // packets waiting for it
+	struct timeval preparse_enqueued;	  // when ibuf_preparse filled
+	struct bgp_preparse_list_head preparsed; // results for ibuf UPDATEs
+	struct bgp_preparse *curr_preparse;	  // result for curr, if any
+
 	/* We use a separate stream to encode MP_REACH_NLRI for efficient
 	 * NLRI packing. peer->obuf_work stores all the other attributes. The
 	 * actual packet is then constructed by concatenating the two.
@@ -1491,6 +1517,7 @@ struct peer {
 	struct thread *t_generate_updgrp_packets;
 	struct thread *t_process_packet;
 	struct thread *t_process_packet_error;
+	struct thread *t_preparse;
 	struct thread *t_refresh_stalepath;
 
 	/* Thread flags. */
@@ -1527,6 +1554,9 @@ struct peer {
 		+ atomic_load_explicit(&peer->dynamic_cap_out,                 \
 				       memory_order_relaxed)
 
+#define BGP_WRITE_CALLS_PER_MB(calls, bytes)                                   \
+	((bytes) ? (double)(calls) * (1024 * 1024) / (bytes) : 0.0)
+
 	/* Statistics field */
 	_Atomic uint32_t open_in;	 /* Open message input count */
 	_Atomic uint32_t open_out;	/* Open message output count */
@@ -1541,6 +1571,8 @@ struct peer {
 	_Atomic uint32_t refresh_out;     /* Route Refresh output count */
 	_Atomic uint32_t dynamic_cap_in;  /* Dynamic Capability input count.  */
 	_Atomic uint32_t dynamic_cap_out; /* Dynamic Capability output count. */
+	_Atomic uint64_t write_calls;     /* writev() calls on the socket */
+	_Atomic uint64_t write_bytes;     /* bytes written to the socket */
 
 	uint32_t stat_pfx_filter;
 	uint32_t stat_pfx_aspath_loop;
@@ -1561,6 +1593,18 @@ struct peer {
 	/* Syncronization list and time.  */
 	struct bgp_synchronize *sync[AFI_MAX][SAFI_MAX];
 	time_t synctime;
+
+	/* Allocation of the Adj-RIB-In entries from this peer */
+	struct bgp_adj_in_pool *adj_in_pool;
+
+	/* Changes of the inbound route-map the Adj-RIB-In is being
+	 * reprocessed for, NULL if all of it is
+	 */
+	struct route_map_changes *soft_reconfig_changes[AFI_MAX][SAFI_MAX];
+	/* Paths evaluated again and skipped by the last reprocessing */
+	uint32_t soft_reconfig_evaluated[AFI_MAX][SAFI_MAX];
+	uint32_t soft_reconfig_skipped[AFI_MAX][SAFI_MAX];
+
 	/* timestamp when the last UPDATE msg was written */
 	_Atomic time_t last_write;
 	/* timestamp when the last msg was written */
@@ -45,6 +45,7 @@
 #include "bgpd/bgp_advertise.h"
 #include "bgpd/bgp_vnc_types.h"
 #include "bgpd/bgp_zebra.h"
+#include "bgpd/bgp_io.h"
 
 #include "bgpd/rfapi/rfapi_import.h"
 #include "bgpd/rfapi/rfapi_private.h"
@@ -1263,7 +1264,7 @@ static int rfapi_open_inner(struct rfapi_descriptor *rfd, struct bgp *bgp,
 		if (rfd->peer->ibuf)
 			stream_fifo_free(rfd->peer->ibuf);
 		if (rfd->peer->obuf)
-			stream_fifo_free(rfd->peer->obuf);
+			bgp_obuf_free(rfd->peer->obuf);
 
 		if (rfd->peer->ibuf_work)
 			ringbuf_del(rfd->peer->ibuf_work);
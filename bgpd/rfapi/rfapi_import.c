@@ -28,6 +28,7 @@
 #include "lib/agg_table.h"
 #include "lib/vty.h"
 #include "lib/memory.h"
+#include "lib/mempool.h"
 #include "lib/log.h"
 #include "lib/skiplist.h"
 #include "lib/thread.h"
@@ -519,7 +520,7 @@ static void rfapiBgpInfoFree(struct bgp_path_info *goner)
 
 	if (goner->extra)
 		bgp_path_info_extra_free(&goner->extra);
-	XFREE(MTYPE_BGP_ROUTE, goner);
+	MEMPOOL_FREE(goner);
 }
 
 struct rfapi_import_table *rfapiMacImportTableGetNoAlloc(struct bgp *bgp,
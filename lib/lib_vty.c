@@ -34,6 +34,7 @@
 
 #include "log.h"
 #include "memory.h"
+#include "mempool.h"
 #include "module.h"
 #include "defaults.h"
 #include "lib_vty.h"
@@ -125,6 +126,32 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 	return 0;
 }
 
+struct mempool_walk_args {
+	struct vty *vty;
+	bool header;
+};
+
+static int mempool_walker(void *arg, struct memtype *mt,
+			  const struct mempool_stats *stats)
+{
+	struct mempool_walk_args *args = arg;
+	struct vty *vty = args->vty;
+
+	if (!args->header) {
+		vty_out(vty, "--- memory pools ---\n");
+		vty_out(vty, "%-30s: %6s %6s %11s %9s %9s %5s\n", "Type",
+			"Pools", "Slabs", "SlabBytes", "Used#", "Capacity",
+			"Occ%");
+		args->header = true;
+	}
+
+	vty_out(vty, "%-30s: %6zu %6zu %11zu %9zu %9zu %4zu%%\n", mt->name,
+		stats->pools, stats->slabs, stats->slab_bytes, stats->used,
+		stats->capacity,
+		stats->capacity ? stats->used * 100 / stats->capacity : 0);
+	return 0;
+}
+
 
 DEFUN_NOSH (show_memory,
 	    show_memory_cmd,
@@ -132,11 +159,14 @@ DEFUN_NOSH (show_memory,
 	    "Show running system information\n"
 	    "Memory statistics\n")
 {
+	struct mempool_walk_args args = {.vty = vty};
+
 #ifdef HAVE_MALLINFO
 	show_memory_mallinfo(vty);
 #endif /* HAVE_MALLINFO */
 
 	qmem_walk(qmem_walker, vty);
+	mempool_walk(mempool_walker, &args);
 	return CMD_SUCCESS;
 }
 
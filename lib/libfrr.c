@@ -109,6 +109,7 @@ static void opt_extend(const struct optspec *os)
 #define OPTION_LOGGING   1007
 #define OPTION_LIMIT_FDS 1008
 #define OPTION_SCRIPTDIR 1009
+#define OPTION_IO_BACKEND 1010
 
 static const struct option lo_always[] = {
 	{"help", no_argument, NULL, 'h'},
@@ -125,6 +126,7 @@ static const struct option lo_always[] = {
 	{"log-level", required_argument, NULL, OPTION_LOGLEVEL},
 	{"command-log-always", no_argument, NULL, OPTION_LOGGING},
 	{"limit-fds", required_argument, NULL, OPTION_LIMIT_FDS},
+	{"io-backend", required_argument, NULL, OPTION_IO_BACKEND},
 	{NULL}};
 static const struct optspec os_always = {
 	"hvdM:F:N:o:",
@@ -140,7 +142,8 @@ static const struct optspec os_always = {
 	"      --scriptdir    Override scripts directory\n"
 	"      --log          Set Logging to stdout, syslog, or file:<name>\n"
 	"      --log-level    Set Logging Level to use, debug, info, warn, etc\n"
-	"      --limit-fds    Limit number of fds supported\n",
+	"      --limit-fds    Limit number of fds supported\n"
+	"      --io-backend   Set I/O event mechanism, poll or epoll\n",
 	lo_always};
 
 
@@ -631,6 +634,19 @@ static int frr_opt(int opt)
 	case OPTION_LIMIT_FDS:
 		di->limit_fds = strtoul(optarg, &err, 0);
 		break;
+	case OPTION_IO_BACKEND:
+		if (!strcmp(optarg, "poll"))
+			di->io_backend = THREAD_IO_POLL;
+#ifdef HAVE_EPOLL
+		else if (!strcmp(optarg, "epoll"))
+			di->io_backend = THREAD_IO_EPOLL;
+#endif
+		else {
+			fprintf(stderr, "unsupported --io-backend \"%s\"\n",
+				optarg);
+			errors++;
+		}
+		break;
 	default:
 		return 1;
 	}
@@ -835,6 +851,11 @@ uint32_t frr_get_fd_limit(void)
 	return di ? di->limit_fds : 0;
 }
 
+enum thread_io_backend frr_get_io_backend(void)
+{
+	return di ? di->io_backend : THREAD_IO_POLL;
+}
+
 static int rcvd_signal = 0;
 
 static void rcv_signal(int signum)
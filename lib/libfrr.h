@@ -117,6 +117,9 @@ struct frr_daemon_info {
 
 	/* Optional upper limit on the number of fds used in select/poll */
 	uint32_t limit_fds;
+
+	/* I/O event mechanism for all thread_masters */
+	enum thread_io_backend io_backend;
 };
 
 /* execname is the daemon's executable (and pidfile and configfile) name,
@@ -150,6 +153,7 @@ extern struct thread_master *frr_init(void);
 extern const char *frr_get_progname(void);
 extern enum frr_cli_mode frr_get_cli_mode(void);
 extern uint32_t frr_get_fd_limit(void);
+extern enum thread_io_backend frr_get_io_backend(void);
 extern bool frr_is_startup_fd(int fd);
 
 /* call order of these hooks is as ordered here */
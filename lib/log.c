@@ -461,7 +461,11 @@ static const struct zebra_desc_table command_types[] = {
 	DESC_ENTRY(ZEBRA_CONFIGURE_ARP),
 	DESC_ENTRY(ZEBRA_GRE_GET),
 	DESC_ENTRY(ZEBRA_GRE_UPDATE),
-	DESC_ENTRY(ZEBRA_GRE_SOURCE_SET)};
+	DESC_ENTRY(ZEBRA_GRE_SOURCE_SET),
+	DESC_ENTRY(ZEBRA_SHM_RING_SETUP),
+	DESC_ENTRY(ZEBRA_SHM_RING_WAKEUP),
+	DESC_ENTRY(ZEBRA_ROUTE_BULK_ADD),
+	DESC_ENTRY(ZEBRA_ROUTE_BULK_DELETE)};
 #undef DESC_ENTRY
 
 static const struct zebra_desc_table unknown = {0, "unknown", '?'};
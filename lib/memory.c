@@ -38,6 +38,22 @@ DEFINE_MGROUP(LIB, "libfrr");
 DEFINE_MTYPE(LIB, TMP, "Temporary memory");
 DEFINE_MTYPE(LIB, BITFIELD, "Bitfield memory");
 
+static inline void mt_count_total(struct memtype *mt, size_t bytes)
+{
+	size_t current;
+	size_t oldsize;
+
+	current = bytes + atomic_fetch_add_explicit(&mt->total, bytes,
+						    memory_order_relaxed);
+	oldsize = atomic_load_explicit(&mt->max_size, memory_order_relaxed);
+	if (current > oldsize)
+		/* note that this may fail, but approximation is sufficient */
+		atomic_compare_exchange_weak_explicit(&mt->max_size, &oldsize,
+						      current,
+						      memory_order_relaxed,
+						      memory_order_relaxed);
+}
+
 static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 {
 	size_t current;
@@ -63,21 +79,14 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 				      memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
-
-	current = mallocsz + atomic_fetch_add_explicit(&mt->total, mallocsz,
-						       memory_order_relaxed);
-	oldsize = atomic_load_explicit(&mt->max_size, memory_order_relaxed);
-	if (current > oldsize)
-		/* note that this may fail, but approximation is sufficient */
-		atomic_compare_exchange_weak_explicit(&mt->max_size, &oldsize,
-						      current,
-						      memory_order_relaxed,
-						      memory_order_relaxed);
+	if (ptr)
+		mt_count_total(mt, malloc_usable_size(ptr));
+	else
+		mt_count_total(mt, size);
 #endif
 }
 
-static inline void mt_count_free(struct memtype *mt, void *ptr)
+static inline void mt_count_free(struct memtype *mt, size_t size, void *ptr)
 {
 	frrtrace(2, frr_libfrr, memfree, mt, ptr);
 
@@ -85,7 +94,7 @@ static inline void mt_count_free(struct memtype *mt, void *ptr)
 	atomic_fetch_sub_explicit(&mt->n_alloc, 1, memory_order_relaxed);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
-	size_t mallocsz = malloc_usable_size(ptr);
+	size_t mallocsz = ptr ? malloc_usable_size(ptr) : size;
 
 	atomic_fetch_sub_explicit(&mt->total, mallocsz, memory_order_relaxed);
 #endif
@@ -119,7 +128,7 @@ void *qcalloc(struct memtype *mt, size_t size)
 void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 {
 	if (ptr)
-		mt_count_free(mt, ptr);
+		mt_count_free(mt, 0, ptr);
 	return mt_checkalloc(mt, ptr ? realloc(ptr, size) : malloc(size), size);
 }
 
@@ -131,13 +140,23 @@ void *qstrdup(struct memtype *mt, const char *str)
 void qcountfree(struct memtype *mt, void *ptr)
 {
 	if (ptr)
-		mt_count_free(mt, ptr);
+		mt_count_free(mt, 0, ptr);
+}
+
+void qcountalloc_size(struct memtype *mt, size_t size)
+{
+	mt_count_alloc(mt, size, NULL);
+}
+
+void qcountfree_size(struct memtype *mt, size_t size)
+{
+	mt_count_free(mt, size, NULL);
 }
 
 void qfree(struct memtype *mt, void *ptr)
 {
 	if (ptr)
-		mt_count_free(mt, ptr);
+		mt_count_free(mt, 0, ptr);
 	free(ptr);
 }
 
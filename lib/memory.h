@@ -166,6 +166,12 @@ extern void qcountfree(struct memtype *mt, void *ptr)
 	__attribute__((nonnull(1)));
 extern void qfree(struct memtype *mt, void *ptr) __attribute__((nonnull(1)));
 
+/* accounting for memory not obtained through malloc, e.g. from a mempool */
+extern void qcountalloc_size(struct memtype *mt, size_t size)
+	__attribute__((nonnull(1)));
+extern void qcountfree_size(struct memtype *mt, size_t size)
+	__attribute__((nonnull(1)));
+
 #define XMALLOC(mtype, size)		qmalloc(mtype, size)
 #define XCALLOC(mtype, size)		qcalloc(mtype, size)
 #define XREALLOC(mtype, ptr, size)	qrealloc(mtype, ptr, size)
@@ -0,0 +1,314 @@
+/*
+ * Fixed-size object pools.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <sys/mman.h>
+
+#include "mempool.h"
+#include "typesafe.h"
+
+DEFINE_MTYPE_STATIC(LIB, MEMPOOL, "Memory pool");
+
+/*
+ * Slabs start small so that the many pools that only ever hold a handful of
+ * objects stay cheap, and double in size up to MEMPOOL_SLAB_MAX.  Large slabs
+ * are mapped directly so that freeing them returns the memory to the system
+ * regardless of the state of the heap.
+ */
+#define MEMPOOL_SLAB_MIN 4096
+#define MEMPOOL_SLAB_MAX (1024 * 1024)
+#define MEMPOOL_SLAB_MMAP (128 * 1024)
+#define MEMPOOL_SLAB_MINOBJ 8
+
+PREDECL_DLIST(mempool_slabs);
+PREDECL_DLIST(mempools);
+PREDECL_DLIST(mempool_types);
+
+struct mempool_slab {
+	struct mempool_slabs_item item;
+
+	struct mempool *pool;
+	size_t size;
+
+	unsigned int nobj;
+	unsigned int used;
+	/* slots handed out at least once, the rest are untouched */
+	unsigned int carved;
+	/* freed objects, linked through their first word */
+	void *free;
+
+	/* slots follow, each a back pointer to the slab and an object */
+	void *slots[];
+};
+
+DECLARE_DLIST(mempool_slabs, struct mempool_slab, item);
+
+struct mempool {
+	struct mempools_item item;
+
+	struct mempool_type *type;
+	struct memtype *mt;
+	size_t size;
+	size_t slotsize;
+	size_t next_slab;
+
+	/* slabs with free slots, and slabs without */
+	struct mempool_slabs_head partial;
+	struct mempool_slabs_head full;
+
+	size_t slab_bytes;
+	size_t used;
+	size_t capacity;
+
+	bool released;
+};
+
+DECLARE_DLIST(mempools, struct mempool, item);
+
+/* The pools of an MTYPE, so they can be reported together */
+struct mempool_type {
+	struct mempool_types_item item;
+
+	struct memtype *mt;
+	struct mempools_head pools;
+};
+
+DECLARE_DLIST(mempool_types, struct mempool_type, item);
+
+static struct mempool_types_head mempool_types = INIT_DLIST(mempool_types);
+
+static size_t mempool_roundup(size_t size, size_t to)
+{
+	return (size + to - 1) / to * to;
+}
+
+/* There are only a few MTYPEs with pools, a walk is fine to find one */
+static struct mempool_type *mempool_type_get(struct memtype *mt)
+{
+	struct mempool_type *type;
+
+	frr_each (mempool_types, &mempool_types, type)
+		if (type->mt == mt)
+			return type;
+
+	type = XCALLOC(MTYPE_MEMPOOL, sizeof(struct mempool_type));
+	type->mt = mt;
+	mempools_init(&type->pools);
+	mempool_types_add_tail(&mempool_types, type);
+
+	return type;
+}
+
+struct mempool *mempool_new(struct memtype *mt, size_t size)
+{
+	struct mempool *pool;
+
+	pool = XCALLOC(MTYPE_MEMPOOL, sizeof(struct mempool));
+	pool->type = mempool_type_get(mt);
+	pool->mt = mt;
+	pool->size = mempool_roundup(MAX(size, sizeof(void *)),
+				     sizeof(void *));
+	pool->slotsize = sizeof(void *) + pool->size;
+	pool->next_slab = MEMPOOL_SLAB_MIN;
+	mempool_slabs_init(&pool->partial);
+	mempool_slabs_init(&pool->full);
+	mempools_add_tail(&pool->type->pools, pool);
+
+	return pool;
+}
+
+static struct mempool_slab *mempool_slab_new(struct mempool *pool)
+{
+	struct mempool_slab *slab;
+	size_t size;
+
+	size = MAX(pool->next_slab,
+		   sizeof(struct mempool_slab)
+			   + MEMPOOL_SLAB_MINOBJ * pool->slotsize);
+	size = mempool_roundup(size, MEMPOOL_SLAB_MIN);
+
+	if (size >= MEMPOOL_SLAB_MMAP) {
+		slab = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (slab == MAP_FAILED)
+			memory_oom(size, pool->mt->name);
+	} else {
+		slab = malloc(size);
+		if (!slab)
+			memory_oom(size, pool->mt->name);
+	}
+
+	memset(slab, 0, sizeof(*slab));
+	slab->pool = pool;
+	slab->size = size;
+	slab->nobj = (size - sizeof(struct mempool_slab)) / pool->slotsize;
+
+	pool->slab_bytes += size;
+	pool->capacity += slab->nobj;
+	if (pool->next_slab < MEMPOOL_SLAB_MAX)
+		pool->next_slab *= 2;
+
+	mempool_slabs_add_head(&pool->partial, slab);
+	return slab;
+}
+
+static void mempool_slab_free(struct mempool *pool, struct mempool_slab *slab)
+{
+	size_t size = slab->size;
+
+	pool->slab_bytes -= size;
+	pool->capacity -= slab->nobj;
+
+	if (size >= MEMPOOL_SLAB_MMAP)
+		munmap(slab, size);
+	else
+		free(slab);
+}
+
+static void mempool_destroy(struct mempool *pool)
+{
+	struct mempool_slab *slab;
+
+	assert(!pool->used);
+
+	while ((slab = mempool_slabs_pop(&pool->partial)))
+		mempool_slab_free(pool, slab);
+	mempool_slabs_fini(&pool->partial);
+	mempool_slabs_fini(&pool->full);
+
+	mempools_del(&pool->type->pools, pool);
+	if (!mempools_count(&pool->type->pools)) {
+		mempools_fini(&pool->type->pools);
+		mempool_types_del(&mempool_types, pool->type);
+		XFREE(MTYPE_MEMPOOL, pool->type);
+	}
+	XFREE(MTYPE_MEMPOOL, pool);
+}
+
+void mempool_release(struct mempool **pool)
+{
+	if (!*pool)
+		return;
+
+	(*pool)->released = true;
+	if (!(*pool)->used)
+		mempool_destroy(*pool);
+
+	*pool = NULL;
+}
+
+void *mempool_alloc(struct mempool *pool)
+{
+	struct mempool_slab *slab;
+	uint8_t *slot;
+	void *obj;
+
+	assert(!pool->released);
+
+	slab = mempool_slabs_first(&pool->partial);
+	if (!slab)
+		slab = mempool_slab_new(pool);
+
+	if (slab->free) {
+		obj = slab->free;
+		slab->free = *(void **)obj;
+	} else {
+		slot = (uint8_t *)slab->slots + slab->carved++ * pool->slotsize;
+		*(struct mempool_slab **)slot = slab;
+		obj = slot + sizeof(void *);
+	}
+
+	if (++slab->used == slab->nobj) {
+		mempool_slabs_del(&pool->partial, slab);
+		mempool_slabs_add_head(&pool->full, slab);
+	}
+	pool->used++;
+
+	memset(obj, 0, pool->size);
+	qcountalloc_size(pool->mt, pool->size);
+
+	return obj;
+}
+
+void mempool_free(void *ptr)
+{
+	struct mempool_slab *slab;
+	struct mempool *pool;
+
+	if (!ptr)
+		return;
+
+	slab = *((struct mempool_slab **)ptr - 1);
+	pool = slab->pool;
+
+	qcountfree_size(pool->mt, pool->size);
+
+	if (slab->used-- == slab->nobj) {
+		mempool_slabs_del(&pool->full, slab);
+		mempool_slabs_add_head(&pool->partial, slab);
+	}
+	pool->used--;
+
+	*(void **)ptr = slab->free;
+	slab->free = ptr;
+
+	/*
+	 * Give empty slabs back, except for the last one of a live pool so
+	 * that a pool hovering around a slab boundary does not thrash.
+	 */
+	if (!slab->used
+	    && (pool->released
+		|| mempool_slabs_count(&pool->partial)
+			   + mempool_slabs_count(&pool->full)
+			   > 1)) {
+		mempool_slabs_del(&pool->partial, slab);
+		mempool_slab_free(pool, slab);
+	}
+
+	if (pool->released && !pool->used)
+		mempool_destroy(pool);
+}
+
+int mempool_walk(mempool_walk_fn *func, void *arg)
+{
+	struct mempool_type *type;
+	struct mempool_stats stats;
+	struct mempool *pool;
+	int ret = 0;
+
+	frr_each (mempool_types, &mempool_types, type) {
+		memset(&stats, 0, sizeof(stats));
+		frr_each (mempools, &type->pools, pool) {
+			stats.pools++;
+			stats.slabs += mempool_slabs_count(&pool->partial)
+				       + mempool_slabs_count(&pool->full);
+			stats.slab_bytes += pool->slab_bytes;
+			stats.used += pool->used;
+			stats.capacity += pool->capacity;
+		}
+
+		ret = func(arg, type->mt, &stats);
+		if (ret)
+			break;
+	}
+
+	return ret;
+}
@@ -0,0 +1,95 @@
+/*
+ * Fixed-size object pools.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_MEMPOOL_H
+#define _FRR_MEMPOOL_H
+
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A mempool hands out zeroed objects of a single size, carved out of slabs
+ * that hold many of them.  This avoids per-object malloc overhead and heap
+ * fragmentation for objects that exist by the million (e.g. bgpd routes),
+ * and since slabs that become empty are given back to the system, memory is
+ * actually returned when a pool's objects are freed en masse.
+ *
+ * Objects are accounted to the pool's MTYPE like any other allocation, so
+ * "show memory" and the leak report at exit are unaffected; "show memory"
+ * additionally lists pool occupancy per MTYPE.
+ *
+ * Objects are aligned to sizeof(void *).  Pools are not thread-safe.
+ */
+struct mempool;
+
+/**
+ * Creates an empty pool for objects of the given size.
+ *
+ * @param mt - MTYPE objects are accounted to
+ * @param size - object size
+ */
+extern struct mempool *mempool_new(struct memtype *mt, size_t size);
+
+/**
+ * Drops the owner's handle on a pool and sets *pool to NULL.
+ *
+ * The pool is destroyed right away if it has no objects, otherwise as soon
+ * as its last object is freed.  No further objects may be allocated from it.
+ */
+extern void mempool_release(struct mempool **pool);
+
+/* Returns a zeroed object, never NULL. */
+extern void *mempool_alloc(struct mempool *pool)
+	__attribute__((malloc, nonnull(1) _RET_NONNULL));
+
+/* Frees an object allocated from any pool, NULL is ignored. */
+extern void mempool_free(void *ptr);
+
+#define MEMPOOL_FREE(ptr)                                                      \
+	do {                                                                   \
+		mempool_free(ptr);                                             \
+		ptr = NULL;                                                    \
+	} while (0)
+
+struct mempool_stats {
+	size_t pools;
+	size_t slabs;
+	size_t slab_bytes;
+	size_t used;
+	size_t capacity;
+};
+
+/*
+ * Calls func once for each MTYPE that has pools, with the pools' statistics
+ * added up.  Returns the last return value of func; a non-zero value aborts
+ * the walk.
+ */
+typedef int mempool_walk_fn(void *arg, struct memtype *mt,
+			    const struct mempool_stats *stats);
+extern int mempool_walk(mempool_walk_fn *func, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_MEMPOOL_H */
@@ -44,6 +44,8 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str");
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency");
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_MATCH_CACHE, "Route map match cache");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_CHANGES, "Route map changes");
 
 DEFINE_QOBJ_TYPE(route_map_index);
 DEFINE_QOBJ_TYPE(route_map);
@@ -77,12 +79,84 @@ static struct rmap_cmd_name_head rmap_set_cmds[1] = {
 #define IS_RULE_IPv6_PREFIX_LIST(S)                                            \
 	(strncmp(S, IPv6_PREFIX_LIST, strlen(IPv6_PREFIX_LIST)) == 0)
 
+/* Direct mapped, per route-map index */
+#define ROUTE_MAP_MATCH_CACHE_SIZE 64
+
+struct route_map_match_cache {
+	struct route_map_match_cache_entry {
+		const void *key;
+		uint32_t serial;
+		uint32_t version;
+		enum route_map_cmd_result_t result;
+	} entries[ROUTE_MAP_MATCH_CACHE_SIZE];
+};
+
+/* Attributes of the object a route-map is applied to */
+struct route_map_attr_key {
+	bool looked_up;
+	bool valid;
+	const void *key;
+	uint32_t serial;
+};
+
 struct route_map_pentry_dep {
 	struct prefix_list_entry *pentry;
 	const char *plist_name;
 	route_map_event_t event;
 };
 
+/* Entry of a prefix-list used by an address prefix-list match clause */
+struct route_map_prefix_range {
+	struct prefix prefix;
+	int ge;
+	int le;
+	bool any;
+};
+
+/* Past these, the match clauses or prefix-list entries changed in a
+ * sequence are no longer told apart
+ */
+#define RMAP_CHANGE_MAX_MATCH 8
+#define RMAP_CHANGE_MAX_RANGES 64
+
+/* How a sequence changed since its map was last processed */
+struct route_map_index_change {
+	int pref;
+
+	uint8_t flags;
+/* Its action or set clauses changed */
+#define RMAP_CHANGE_RESULT (1 << 0)
+/* Its prefix-list clauses changed for more prefixes than ranges has */
+#define RMAP_CHANGE_PLIST (1 << 1)
+/* Too many of its match clauses changed to keep track of them */
+#define RMAP_CHANGE_ALL (1 << 2)
+/* Added, it applies differently to the objects it now matches only */
+#define RMAP_CHANGE_CREATED (1 << 3)
+
+	/* Commands of the match clauses added, deleted or whose lists
+	 * changed
+	 */
+	uint8_t match_num;
+	const struct route_map_rule_cmd *match[RMAP_CHANGE_MAX_MATCH];
+
+	/* Entries changed in the lists of the address prefix-list clauses */
+	uint8_t range_num;
+	struct route_map_prefix_range *ranges;
+};
+
+struct route_map_changes {
+	/* The changes cannot be analysed, e.g. a sequence was deleted */
+	bool unknown;
+
+	unsigned int num;
+	struct route_map_index_change *indexes;
+};
+
+struct route_map_dep_notify {
+	const char *name;
+	route_map_event_t event;
+};
+
 static void route_map_pfx_tbl_update(route_map_event_t event,
 				     struct route_map_index *index, afi_t afi,
 				     const char *plist_name);
@@ -101,6 +175,7 @@ static void route_map_del_plist_entries(afi_t afi,
 
 static struct hash *route_map_get_dep_hash(route_map_event_t event);
 static void route_map_free_map(struct route_map *map);
+static void route_map_changed_unknown(struct route_map *map);
 
 struct route_map_match_set_hooks rmap_match_set_hook;
 
@@ -623,6 +698,7 @@ static struct route_map *route_map_new(const char *name)
 
 	new = XCALLOC(MTYPE_ROUTE_MAP, sizeof(struct route_map));
 	new->name = XSTRDUP(MTYPE_ROUTE_MAP_NAME, name);
+	new->version = 1;
 	QOBJ_REG(new, route_map);
 	return new;
 }
@@ -649,6 +725,10 @@ static struct route_map *route_map_add(const char *name)
 		map->to_be_processed = exist->to_be_processed;
 		route_map_free_map(exist);
 	}
+
+	/* Objects it did not exist for may all be affected */
+	route_map_changed_unknown(map);
+
 	hash_get(route_map_master_hash, map, hash_alloc_intern);
 
 	/* Add new entry to the head of the list to match how it is added in the
@@ -719,6 +799,7 @@ static void route_map_free_map(struct route_map *map)
 		list->head = map->next;
 
 	hash_release(route_map_master_hash, map);
+	route_map_changes_free(&map->changes);
 	XFREE(MTYPE_ROUTE_MAP_NAME, map->name);
 	XFREE(MTYPE_ROUTE_MAP, map);
 }
@@ -818,6 +899,7 @@ static int route_map_clear_updated(struct route_map *map)
 
 	if (map) {
 		map->to_be_processed = false;
+		route_map_changes_free(&map->changes);
 		if (map->deleted)
 			route_map_free_map(map);
 	}
@@ -946,6 +1028,14 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map,
 			json_object_int_add(json_rule, "invoked",
 					    index->applied
 						    - index->applied_clear);
+			if (index->match_cacheable) {
+				json_object_int_add(json_rule,
+						    "matchCacheHits",
+						    index->match_cache_hits);
+				json_object_int_add(json_rule,
+						    "matchCacheMisses",
+						    index->match_cache_misses);
+			}
 
 			/* Description */
 			if (index->description)
@@ -1000,6 +1090,12 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map,
 			vty_out(vty, " %s, sequence %d Invoked %" PRIu64 "\n",
 				route_map_type_str(index->type), index->pref,
 				index->applied - index->applied_clear);
+			if (index->match_cacheable)
+				vty_out(vty,
+					"  Match cache: %" PRIu64
+					" hits, %" PRIu64 " misses\n",
+					index->match_cache_hits,
+					index->match_cache_misses);
 
 			/* Description */
 			if (index->description)
@@ -1180,6 +1276,7 @@ void route_map_index_delete(struct route_map_index *index, int notify)
 	XFREE(MTYPE_ROUTE_MAP_NAME, index->nextrm);
 
 	route_map_pfx_tbl_update(RMAP_EVENT_INDEX_DELETED, index, 0, NULL);
+	route_map_changed_unknown(index->map);
 
 	/* Execute event hook. */
 	if (route_map_master.event_hook && notify) {
@@ -1187,6 +1284,7 @@ void route_map_index_delete(struct route_map_index *index, int notify)
 		route_map_notify_dependencies(index->map->name,
 					      RMAP_EVENT_CALL_ADDED);
 	}
+	XFREE(MTYPE_ROUTE_MAP_MATCH_CACHE, index->match_cache);
 	XFREE(MTYPE_ROUTE_MAP_INDEX, index);
 }
 
@@ -1204,6 +1302,306 @@ static struct route_map_index *route_map_index_lookup(struct route_map *map,
 	return NULL;
 }
 
+static struct route_map_changes *route_map_changes_new(void)
+{
+	return XCALLOC(MTYPE_ROUTE_MAP_CHANGES,
+		       sizeof(struct route_map_changes));
+}
+
+void route_map_changes_free(struct route_map_changes **changes)
+{
+	unsigned int i;
+
+	if (!*changes)
+		return;
+
+	for (i = 0; i < (*changes)->num; i++)
+		XFREE(MTYPE_ROUTE_MAP_CHANGES, (*changes)->indexes[i].ranges);
+	XFREE(MTYPE_ROUTE_MAP_CHANGES, (*changes)->indexes);
+	XFREE(MTYPE_ROUTE_MAP_CHANGES, *changes);
+}
+
+static struct route_map_index_change *
+route_map_changes_index(struct route_map_changes *changes, int pref)
+{
+	struct route_map_index_change *ic;
+	unsigned int i;
+
+	for (i = 0; i < changes->num; i++)
+		if (changes->indexes[i].pref == pref)
+			return &changes->indexes[i];
+
+	changes->indexes = XREALLOC(MTYPE_ROUTE_MAP_CHANGES, changes->indexes,
+				    (changes->num + 1) * sizeof(*ic));
+	ic = &changes->indexes[changes->num++];
+	memset(ic, 0, sizeof(*ic));
+	ic->pref = pref;
+	return ic;
+}
+
+static void route_map_change_add_match(struct route_map_index_change *ic,
+				       const struct route_map_rule_cmd *cmd)
+{
+	unsigned int i;
+
+	for (i = 0; i < ic->match_num; i++)
+		if (ic->match[i] == cmd)
+			return;
+
+	if (ic->match_num == RMAP_CHANGE_MAX_MATCH)
+		SET_FLAG(ic->flags, RMAP_CHANGE_ALL);
+	else
+		ic->match[ic->match_num++] = cmd;
+}
+
+static void
+route_map_change_add_range(struct route_map_index_change *ic,
+			   const struct route_map_prefix_range *range)
+{
+	if (CHECK_FLAG(ic->flags, RMAP_CHANGE_PLIST))
+		return;
+
+	if (ic->range_num == RMAP_CHANGE_MAX_RANGES) {
+		SET_FLAG(ic->flags, RMAP_CHANGE_PLIST);
+		XFREE(MTYPE_ROUTE_MAP_CHANGES, ic->ranges);
+		ic->range_num = 0;
+		return;
+	}
+
+	ic->ranges = XREALLOC(MTYPE_ROUTE_MAP_CHANGES, ic->ranges,
+			      (ic->range_num + 1) * sizeof(*range));
+	ic->ranges[ic->range_num++] = *range;
+}
+
+static struct route_map_changes *route_map_changes_of(struct route_map *map)
+{
+	if (!map->changes)
+		map->changes = route_map_changes_new();
+	return map->changes;
+}
+
+static void route_map_changed_unknown(struct route_map *map)
+{
+	struct route_map_changes *changes = route_map_changes_of(map);
+	unsigned int i;
+
+	if (changes->unknown)
+		return;
+
+	/* What is recorded so far is no use anymore */
+	for (i = 0; i < changes->num; i++)
+		XFREE(MTYPE_ROUTE_MAP_CHANGES, changes->indexes[i].ranges);
+	XFREE(MTYPE_ROUTE_MAP_CHANGES, changes->indexes);
+	changes->num = 0;
+	changes->unknown = true;
+}
+
+/* Record a change of index, cmd is the command of a changed match clause */
+static void route_map_index_changed(struct route_map_index *index,
+				    uint8_t flags,
+				    const struct route_map_rule_cmd *cmd)
+{
+	struct route_map_changes *changes = route_map_changes_of(index->map);
+	struct route_map_index_change *ic;
+
+	if (changes->unknown)
+		return;
+
+	ic = route_map_changes_index(changes, index->pref);
+	SET_FLAG(ic->flags, flags);
+	if (cmd)
+		route_map_change_add_match(ic, cmd);
+}
+
+/* An entry of a list used by an address prefix-list clause of index
+ * changed
+ */
+static void route_map_index_changed_pentry(struct route_map_index *index,
+					   struct prefix_list_entry *pentry)
+{
+	struct route_map_changes *changes = route_map_changes_of(index->map);
+	struct route_map_prefix_range range = {};
+
+	if (changes->unknown)
+		return;
+
+	prefix_copy(&range.prefix, &pentry->prefix);
+	range.ge = pentry->ge;
+	range.le = pentry->le;
+	range.any = pentry->any;
+	route_map_change_add_range(
+		route_map_changes_index(changes, index->pref), &range);
+}
+
+void route_map_index_action_changed(struct route_map_index *index)
+{
+	route_map_index_changed(index, RMAP_CHANGE_RESULT, NULL);
+}
+
+void route_map_index_exit_changed(struct route_map_index *index)
+{
+	/* Which sequences are run for an object changed */
+	route_map_changed_unknown(index->map);
+}
+
+struct route_map_changes *route_map_changes_get(struct route_map *map)
+{
+	struct route_map_index *index;
+	struct route_map_changes *changes = NULL;
+
+	if (!map->changes || map->changes->unknown)
+		return NULL;
+
+	/*
+	 * The set clauses of a sequence could change what the following ones
+	 * match, their clauses cannot be run on the unmodified object.
+	 */
+	for (index = map->head; index; index = index->next)
+		if (index->exitpolicy != RMAP_EXIT || index->nextrm)
+			return NULL;
+
+	route_map_changes_merge(&changes, map->changes);
+	return changes;
+}
+
+void route_map_changes_merge(struct route_map_changes **dst,
+			     const struct route_map_changes *src)
+{
+	const struct route_map_index_change *sic;
+	struct route_map_index_change *ic;
+	unsigned int i, j;
+
+	if (!*dst)
+		*dst = route_map_changes_new();
+
+	if (src->unknown) {
+		route_map_changes_free(dst);
+		*dst = route_map_changes_new();
+		(*dst)->unknown = true;
+		return;
+	}
+
+	for (i = 0; i < src->num; i++) {
+		sic = &src->indexes[i];
+		ic = route_map_changes_index(*dst, sic->pref);
+
+		SET_FLAG(ic->flags, sic->flags);
+		for (j = 0; j < sic->match_num; j++)
+			route_map_change_add_match(ic, sic->match[j]);
+		for (j = 0; j < sic->range_num; j++)
+			route_map_change_add_range(ic, &sic->ranges[j]);
+	}
+}
+
+static bool
+route_map_prefix_range_match(const struct route_map_prefix_range *range,
+			     const struct prefix *p)
+{
+	/* Only matched by prefix-lists after a conversion, e.g. EVPN */
+	if (p->family != AF_INET && p->family != AF_INET6)
+		return true;
+
+	if (range->prefix.family != p->family)
+		return false;
+
+	if (range->any)
+		return true;
+
+	if (!prefix_match(&range->prefix, p))
+		return false;
+
+	if (!range->le && !range->ge)
+		return range->prefix.prefixlen == p->prefixlen;
+
+	if (range->le && p->prefixlen > range->le)
+		return false;
+	if (range->ge && p->prefixlen < range->ge)
+		return false;
+	return true;
+}
+
+/*
+ * Do the match clauses of index which did not change in ic match the
+ * object?  If they don't, the changed clauses cannot make the sequence
+ * match it, now or before.
+ */
+static bool route_map_change_match_rest(const struct route_map_index_change *ic,
+					struct route_map_index *index,
+					const struct prefix *prefix,
+					void *object)
+{
+	struct route_map_rule *rule;
+	bool plist_changed;
+	unsigned int i;
+
+	plist_changed = ic->range_num
+			|| CHECK_FLAG(ic->flags, RMAP_CHANGE_PLIST);
+
+	for (rule = index->match_list.head; rule; rule = rule->next) {
+		for (i = 0; i < ic->match_num; i++)
+			if (ic->match[i] == rule->cmd)
+				break;
+		if (i < ic->match_num)
+			continue;
+
+		if (plist_changed
+		    && (IS_RULE_IPv4_PREFIX_LIST(rule->cmd->str)
+			|| IS_RULE_IPv6_PREFIX_LIST(rule->cmd->str)))
+			continue;
+
+		if ((*rule->cmd->func_apply)(rule->value, prefix, object)
+		    == RMAP_NOMATCH)
+			return false;
+	}
+
+	return true;
+}
+
+bool route_map_changes_match(const struct route_map_changes *changes,
+			     struct route_map *map, const struct prefix *prefix,
+			     void *object)
+{
+	static const struct route_map_index_change unchanged;
+	const struct route_map_index_change *ic;
+	struct route_map_index *index;
+	unsigned int i, j;
+
+	if (changes->unknown)
+		return true;
+
+	for (i = 0; i < changes->num; i++) {
+		ic = &changes->indexes[i];
+
+		/* Deleted since, its deletion will be processed next */
+		index = route_map_index_lookup(map, RMAP_ANY, ic->pref);
+		if (!index)
+			return true;
+
+		if (CHECK_FLAG(ic->flags, RMAP_CHANGE_CREATED)) {
+			if (route_map_change_match_rest(&unchanged, index,
+							prefix, object))
+				return true;
+			continue;
+		}
+
+		if (CHECK_FLAG(ic->flags, RMAP_CHANGE_ALL))
+			return true;
+
+		if (!route_map_change_match_rest(ic, index, prefix, object))
+			continue;
+
+		if (ic->flags || ic->match_num)
+			return true;
+
+		for (j = 0; j < ic->range_num; j++)
+			if (route_map_prefix_range_match(&ic->ranges[j],
+							 prefix))
+				return true;
+	}
+
+	return false;
+}
+
 /* Add new index to route map. */
 static struct route_map_index *
 route_map_index_add(struct route_map *map, enum route_map_type type, int pref)
@@ -1241,6 +1639,7 @@ route_map_index_add(struct route_map *map, enum route_map_type type, int pref)
 	}
 
 	route_map_pfx_tbl_update(RMAP_EVENT_INDEX_ADDED, index, 0, NULL);
+	route_map_index_changed(index, RMAP_CHANGE_CREATED, NULL);
 
 	/* Execute event hook. */
 	if (route_map_master.event_hook) {
@@ -1442,6 +1841,22 @@ static route_map_event_t get_route_map_delete_event(route_map_event_t type)
 	return RMAP_EVENT_CALL_ADDED;
 }
 
+/* The match clauses of index changed */
+static void route_map_match_cache_update(struct route_map_index *index)
+{
+	struct route_map_rule *rule;
+
+	index->map->version++;
+
+	index->match_cacheable = index->match_list.head != NULL;
+	for (rule = index->match_list.head; rule; rule = rule->next)
+		if (!CHECK_FLAG(rule->cmd->flags, RMAP_RULE_ATTR_ONLY))
+			index->match_cacheable = false;
+
+	if (!index->match_cacheable)
+		XFREE(MTYPE_ROUTE_MAP_MATCH_CACHE, index->match_cache);
+}
+
 /* Add match statement to route map. */
 enum rmap_compile_rets route_map_add_match(struct route_map_index *index,
 					   const char *match_name,
@@ -1529,6 +1944,8 @@ enum rmap_compile_rets route_map_add_match(struct route_map_index *index,
 
 	/* Add new route match rule to linked list. */
 	route_map_rule_add(&index->match_list, rule);
+	route_map_match_cache_update(index);
+	route_map_index_changed(index, 0, cmd);
 
 	/* If IPv4 or IPv6 prefix-list match criteria
 	 * has been added to the route-map index, update
@@ -1589,6 +2006,8 @@ enum rmap_compile_rets route_map_delete_match(struct route_map_index *index,
 						index->map->name);
 
 			route_map_rule_delete(&index->match_list, rule);
+			route_map_match_cache_update(index);
+			route_map_index_changed(index, 0, cmd);
 
 			/* If IPv4 or IPv6 prefix-list match criteria
 			 * has been delete from the route-map index, update
@@ -1652,6 +2071,7 @@ enum rmap_compile_rets route_map_add_set(struct route_map_index *index,
 
 	/* Add new route match rule to linked list. */
 	route_map_rule_add(&index->set_list, rule);
+	route_map_index_changed(index, RMAP_CHANGE_RESULT, NULL);
 
 	/* Execute event hook. */
 	if (route_map_master.event_hook) {
@@ -1678,6 +2098,8 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 		if ((rule->cmd == cmd) && (rulecmp(rule->rule_str, set_arg) == 0
 					   || set_arg == NULL)) {
 			route_map_rule_delete(&index->set_list, rule);
+			route_map_index_changed(index, RMAP_CHANGE_RESULT,
+						NULL);
 			/* Execute event hook. */
 			if (route_map_master.event_hook) {
 				(*route_map_master.event_hook)(index->map->name);
@@ -1768,6 +2190,54 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 	return ret;
 }
 
+/*
+ * route_map_apply_match() on the match clauses of index, using the result
+ * previously found for the same attributes if none of the clauses changed
+ * since.
+ */
+static enum route_map_cmd_result_t
+route_map_apply_index_match(struct route_map_index *index,
+			    const struct prefix *prefix, void *object,
+			    struct route_map_attr_key *ak)
+{
+	struct route_map_match_cache_entry *entry;
+	uint32_t version = index->map->version;
+
+	if (!index->match_cacheable || !route_map_master.attr_key_hook)
+		return route_map_apply_match(&index->match_list, prefix,
+					     object);
+
+	if (!ak->looked_up) {
+		ak->valid = (*route_map_master.attr_key_hook)(object, &ak->key,
+							      &ak->serial);
+		ak->looked_up = true;
+	}
+	if (!ak->valid)
+		return route_map_apply_match(&index->match_list, prefix,
+					     object);
+
+	if (!index->match_cache)
+		index->match_cache = XCALLOC(MTYPE_ROUTE_MAP_MATCH_CACHE,
+					     sizeof(*index->match_cache));
+
+	entry = &index->match_cache->entries[jhash_2words(
+		(uint32_t)(uintptr_t)ak->key, ak->serial, 0)
+		% ROUTE_MAP_MATCH_CACHE_SIZE];
+	if (entry->key == ak->key && entry->serial == ak->serial
+	    && entry->version == version) {
+		index->match_cache_hits++;
+		return entry->result;
+	}
+
+	index->match_cache_misses++;
+	entry->result = route_map_apply_match(&index->match_list, prefix,
+					      object);
+	entry->key = ak->key;
+	entry->serial = ak->serial;
+	entry->version = version;
+	return entry->result;
+}
+
 static struct list *route_map_get_index_list(struct route_node **rn,
 					     const struct prefix *prefix,
 					     struct route_table *table)
@@ -1811,7 +2281,8 @@ static struct list *route_map_get_index_list(struct route_node **rn,
  */
 static struct route_map_index *
 route_map_get_index(struct route_map *map, const struct prefix *prefix,
-		    void *object, enum route_map_cmd_result_t *match_ret)
+		    void *object, struct route_map_attr_key *ak,
+		    enum route_map_cmd_result_t *match_ret)
 {
 	enum route_map_cmd_result_t ret = RMAP_NOMATCH;
 	struct list *candidate_rmap_list = NULL;
@@ -1856,8 +2327,8 @@ route_map_get_index(struct route_map *map, const struct prefix *prefix,
 			if (best_index && (best_index->pref < index->pref))
 				break;
 
-			ret = route_map_apply_match(&index->match_list, prefix,
-						    object);
+			ret = route_map_apply_index_match(index, prefix,
+							  object, ak);
 
 			if (ret == RMAP_MATCH) {
 				*match_ret = ret;
@@ -2447,6 +2918,8 @@ static void route_map_pentry_process_dependency(struct hash_bucket *bucket,
 						pentry_dep->event,
 						pentry_dep->plist_name, index,
 						pentry_dep->pentry);
+					route_map_index_changed_pentry(
+						index, pentry_dep->pentry);
 				} else if (IS_RULE_IPv6_PREFIX_LIST(
 						   match->cmd->str)
 					   && family == AF_INET6) {
@@ -2454,6 +2927,8 @@ static void route_map_pentry_process_dependency(struct hash_bucket *bucket,
 						pentry_dep->event,
 						pentry_dep->plist_name, index,
 						pentry_dep->pentry);
+					route_map_index_changed_pentry(
+						index, pentry_dep->pentry);
 				}
 			}
 		}
@@ -2549,6 +3024,7 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 	struct route_map_index *index = NULL;
 	struct route_map_rule *set = NULL;
 	bool skip_match_clause = false;
+	struct route_map_attr_key ak = {};
 
 	if (recursion > RMAP_RECURSION_LIMIT) {
 		flog_warn(
@@ -2568,7 +3044,7 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 
 	if ((!map->optimization_disabled)
 	    && (map->ipv4_prefix_table || map->ipv6_prefix_table)) {
-		index = route_map_get_index(map, prefix, match_object,
+		index = route_map_get_index(map, prefix, match_object, &ak,
 					    &match_ret);
 		if (index) {
 			index->applied++;
@@ -2602,8 +3078,8 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 		if (!skip_match_clause) {
 			index->applied++;
 			/* Apply this index. */
-			match_ret = route_map_apply_match(&index->match_list,
-							  prefix, match_object);
+			match_ret = route_map_apply_index_match(
+				index, prefix, match_object, &ak);
 			if (rmap_debug) {
 				zlog_debug(
 					"Route-map: %s, sequence: %d, prefix: %pFX, result: %s",
@@ -2686,6 +3162,10 @@ route_map_result_t route_map_apply_ext(struct route_map *map,
 						goto route_map_apply_end;
 				}
 
+				/* The attributes may have been changed */
+				if (index->set_list.head || index->nextrm)
+					ak.looked_up = false;
+
 				switch (index->exitpolicy) {
 				case RMAP_EXIT:
 					goto route_map_apply_end;
@@ -2747,6 +3227,12 @@ void route_map_event_hook(void (*func)(const char *name))
 	route_map_master.event_hook = func;
 }
 
+void route_map_attr_key_hook(bool (*func)(void *object, const void **key,
+					  uint32_t *serial))
+{
+	route_map_master.attr_key_hook = func;
+}
+
 /* Routines for route map dependency lists and dependency processing */
 static bool route_map_rmap_hash_cmp(const void *p1, const void *p2)
 {
@@ -3015,14 +3501,74 @@ static struct hash *route_map_get_dep_hash(route_map_event_t event)
 	return (upd8_hash);
 }
 
+/* Record which match clauses of map use the list or route-map changed */
+static void route_map_dependency_changed(struct route_map *map,
+					 const char *name,
+					 route_map_event_t event)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+	const char *rule_key;
+	bool found = false;
+
+	switch (event) {
+	case RMAP_EVENT_CALL_ADDED:
+	case RMAP_EVENT_CALL_DELETED:
+	case RMAP_EVENT_MATCH_ADDED:
+	case RMAP_EVENT_MATCH_DELETED:
+		/* A route-map it calls */
+		route_map_changed_unknown(map);
+		return;
+	default:
+		break;
+	}
+
+	for (index = map->head; index; index = index->next)
+		for (rule = index->match_list.head; rule; rule = rule->next) {
+			if (rule->cmd->func_get_rmap_rule_key)
+				rule_key = (*rule->cmd->func_get_rmap_rule_key)(
+					rule->value);
+			else
+				rule_key = rule->rule_str;
+			if (!rule_key || strcmp(rule_key, name))
+				continue;
+
+			found = true;
+
+			/* Recorded entry by entry in
+			 * route_map_pentry_process_dependency()
+			 */
+			if ((event == RMAP_EVENT_PLIST_ADDED
+			     || event == RMAP_EVENT_PLIST_DELETED)
+			    && (IS_RULE_IPv4_PREFIX_LIST(rule->cmd->str)
+				|| IS_RULE_IPv6_PREFIX_LIST(rule->cmd->str)))
+				continue;
+
+			route_map_index_changed(index, 0, rule->cmd);
+		}
+
+	if (!found)
+		route_map_changed_unknown(map);
+}
+
 static void route_map_process_dependency(struct hash_bucket *bucket, void *data)
 {
 	struct route_map_dep_data *dep_data = NULL;
+	struct route_map_dep_notify *notify = data;
 	char *rmap_name = NULL;
 
+	struct route_map *map;
+
 	dep_data = bucket->data;
 	rmap_name = dep_data->rname;
 
+	/* The list used by a match clause changed */
+	map = route_map_lookup_by_name(rmap_name);
+	if (map) {
+		map->version++;
+		route_map_dependency_changed(map, notify->name, notify->event);
+	}
+
 	if (rmap_debug)
 		zlog_debug("Notifying %s of dependency", rmap_name);
 	if (route_map_master.event_hook)
@@ -3033,10 +3579,18 @@ void route_map_upd8_dependency(route_map_event_t type, const char *arg,
 			       const char *rmap_name)
 {
 	struct hash *upd8_hash = NULL;
+	struct route_map *map;
 
 	if ((upd8_hash = route_map_get_dep_hash(type))) {
 		route_map_dep_update(upd8_hash, arg, rmap_name, type);
 
+		if (type == RMAP_EVENT_CALL_ADDED
+		    || type == RMAP_EVENT_CALL_DELETED) {
+			map = route_map_lookup_by_name(rmap_name);
+			if (map)
+				route_map_changed_unknown(map);
+		}
+
 		if (type == RMAP_EVENT_CALL_ADDED) {
 			/* Execute hook. */
 			if (route_map_master.add_hook)
@@ -3053,6 +3607,7 @@ void route_map_notify_dependencies(const char *affected_name,
 				   route_map_event_t event)
 {
 	struct route_map_dep *dep;
+	struct route_map_dep_notify notify;
 	struct hash *upd8_hash;
 	char *name;
 
@@ -3073,8 +3628,10 @@ void route_map_notify_dependencies(const char *affected_name,
 
 		if (rmap_debug)
 			zlog_debug("Filter %s updated", dep->dep_name);
+		notify.name = name;
+		notify.event = event;
 		hash_iterate(dep->dep_rmap_hash, route_map_process_dependency,
-			     (void *)event);
+			     &notify);
 	}
 
 	XFREE(MTYPE_ROUTE_MAP_NAME, name);
@@ -3086,8 +3643,11 @@ static void clear_route_map_helper(struct route_map *map)
 	struct route_map_index *index;
 
 	map->applied_clear = map->applied;
-	for (index = map->head; index; index = index->next)
+	for (index = map->head; index; index = index->next) {
 		index->applied_clear = index->applied;
+		index->match_cache_hits = 0;
+		index->match_cache_misses = 0;
+	}
 }
 
 DEFUN (rmap_clear_counters,
@@ -117,8 +117,18 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/* RMAP_RULE_* flags */
+	uint32_t flags;
 };
 
+/*
+ * The match only depends on the configuration and on the attributes of the
+ * object as identified by route_map_attr_key_hook(), so its result can be
+ * cached.
+ */
+#define RMAP_RULE_ATTR_ONLY (1 << 0)
+
 /* Route map apply error. */
 enum rmap_compile_rets {
 	RMAP_COMPILE_SUCCESS,
@@ -188,6 +198,14 @@ struct route_map_index {
 	uint64_t applied;
 	uint64_t applied_clear;
 
+	/* Results of the match clauses by object attributes, used when all
+	 * of them are RMAP_RULE_ATTR_ONLY.
+	 */
+	bool match_cacheable;
+	struct route_map_match_cache *match_cache;
+	uint64_t match_cache_hits;
+	uint64_t match_cache_misses;
+
 	/* List of match/sets contexts. */
 	TAILQ_HEAD(, routemap_hook_context) rhclist;
 
@@ -225,6 +243,14 @@ struct route_map {
 	/* Counter to track active usage of this route-map */
 	uint16_t use_count;
 
+	/* Bumped when the result of a match clause may have changed */
+	uint32_t version;
+
+	/* Sequences changed since the map was last processed, see
+	 * route_map_changes_get()
+	 */
+	struct route_map_changes *changes;
+
 	/* Tables to maintain IPv4 and IPv6 prefixes from
 	 * the prefix-list match clause.
 	 */
@@ -488,6 +514,16 @@ extern route_map_result_t route_map_apply_ext(struct route_map *map,
 #define route_map_apply(map, prefix, object)                                   \
 	route_map_apply_ext(map, prefix, object, object, NULL)
 
+/*
+ * Identify the attributes of a match object: key and serial must be the
+ * same for two objects only if all RMAP_RULE_ATTR_ONLY matches give the
+ * same result for them.  Return false if the object cannot be identified,
+ * its matches are then not cached.
+ */
+extern void route_map_attr_key_hook(bool (*func)(void *object,
+						 const void **key,
+						 uint32_t *serial));
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
@@ -501,6 +537,38 @@ extern void route_map_delete_hook(void (*func)(const char *));
 extern void route_map_event_hook(void (*func)(const char *name));
 extern int route_map_mark_updated(const char *name);
 extern void route_map_walk_update_list(void (*update_fn)(char *name));
+
+/*
+ * What changed in map since it was last processed by
+ * route_map_walk_update_list(): the sequences which were added or whose
+ * action, match or set clauses changed, including the lists used by the
+ * match clauses.  The copy returned stays valid when the map is changed
+ * again.
+ *
+ * @return the changes, or NULL if the objects the map may now apply
+ * differently to cannot be told apart, e.g. because a sequence was deleted
+ * or the map uses on-match or call
+ */
+extern struct route_map_changes *route_map_changes_get(struct route_map *map);
+
+/* Record that the action, or the exit policy or call of index changed */
+extern void route_map_index_action_changed(struct route_map_index *index);
+extern void route_map_index_exit_changed(struct route_map_index *index);
+
+/* Add the changes in src to *dst, which may be NULL */
+extern void route_map_changes_merge(struct route_map_changes **dst,
+				    const struct route_map_changes *src);
+extern void route_map_changes_free(struct route_map_changes **changes);
+
+/*
+ * Could the result of applying map to object have changed with changes?
+ * The match clauses the changes do not affect are run on object, so a
+ * false answer is only reliable if object is in the state route_map_apply()
+ * would get it in.
+ */
+extern bool route_map_changes_match(const struct route_map_changes *changes,
+				    struct route_map *map,
+				    const struct prefix *prefix, void *object);
 extern void route_map_upd8_dependency(route_map_event_t type, const char *arg,
 				      const char *rmap_name);
 extern void route_map_notify_dependencies(const char *affected_name,
@@ -950,6 +1018,8 @@ struct route_map_list {
 	void (*add_hook)(const char *);
 	void (*delete_hook)(const char *);
 	void (*event_hook)(const char *);
+	bool (*attr_key_hook)(void *object, const void **key,
+			      uint32_t *serial);
 };
 
 extern struct route_map_list route_map_master;
@@ -283,6 +283,7 @@ static int lib_route_map_entry_action_modify(struct nb_cb_modify_args *args)
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->type = yang_dnode_get_enum(args->dnode, NULL);
 		map = rmi->map;
+		route_map_index_action_changed(rmi);
 
 		/* Execute event hook. */
 		if (route_map_master.event_hook) {
@@ -409,6 +410,7 @@ lib_route_map_entry_exit_policy_modify(struct nb_cb_modify_args *args)
 			rmi->exitpolicy = RMAP_GOTO;
 			break;
 		}
+		route_map_index_exit_changed(rmi);
 		break;
 	}
 
@@ -440,6 +442,7 @@ static int lib_route_map_entry_goto_value_modify(struct nb_cb_modify_args *args)
 	case NB_EV_APPLY:
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->nextpref = yang_dnode_get_uint16(args->dnode, NULL);
+		route_map_index_exit_changed(rmi);
 		break;
 	}
 
@@ -460,6 +463,7 @@ lib_route_map_entry_goto_value_destroy(struct nb_cb_destroy_args *args)
 	case NB_EV_APPLY:
 		rmi = nb_running_get_entry(args->dnode, NULL, true);
 		rmi->nextpref = 0;
+		route_map_index_exit_changed(rmi);
 		break;
 	}
 
@@ -0,0 +1,255 @@
+/*
+ * Single producer, single consumer ring buffer in shared memory.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <zebra.h>
+
+#include <sys/mman.h>
+
+#include "shmring.h"
+#include "memory.h"
+#include "frratomic.h"
+
+DEFINE_MTYPE_STATIC(LIB, SHMRING, "Shared memory ring buffer");
+
+#define SHMRING_MAGIC 0x464e5247 /* "FRRG" */
+#define SHMRING_SIZE_MIN 4096
+#define SHMRING_SIZE_MAX (1U << 30)
+
+/*
+ * Layout of the shared memory.  The positions run freely and wrap around at
+ * 2^32, the size being a power of 2 the offset into the data is simply the
+ * position masked.  The producer and consumer owned fields are kept on
+ * different cache lines.
+ */
+struct shmring_shared {
+	uint32_t magic;
+	uint32_t size;
+
+	/* Written by the producer only */
+	_Atomic uint32_t head __attribute__((aligned(64)));
+
+	/* Written by the consumer only, except for the wakeup handshake */
+	_Atomic uint32_t tail __attribute__((aligned(64)));
+	_Atomic uint32_t idle;
+
+	uint8_t data[] __attribute__((aligned(64)));
+};
+
+struct shmring {
+	struct shmring_shared *shm;
+	size_t maplen;
+	uint32_t mask;
+
+	/* Producer only, until the consumer removed the file */
+	char *path;
+};
+
+static struct shmring *shmring_map(int fd, size_t maplen)
+{
+	struct shmring *ring;
+	void *addr;
+
+	addr = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	ring = XCALLOC(MTYPE_SHMRING, sizeof(struct shmring));
+	ring->shm = addr;
+	ring->maplen = maplen;
+	return ring;
+}
+
+struct shmring *shmring_create(const char *path, size_t size)
+{
+	struct shmring *ring;
+	size_t ringsize = SHMRING_SIZE_MIN;
+	size_t maplen;
+	int fd;
+
+	while (ringsize < size && ringsize < SHMRING_SIZE_MAX)
+		ringsize <<= 1;
+	maplen = sizeof(struct shmring_shared) + ringsize;
+
+	fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, maplen) < 0) {
+		close(fd);
+		unlink(path);
+		return NULL;
+	}
+
+	ring = shmring_map(fd, maplen);
+	close(fd);
+	if (!ring) {
+		unlink(path);
+		return NULL;
+	}
+
+	ring->shm->magic = SHMRING_MAGIC;
+	ring->shm->size = ringsize;
+	atomic_store_explicit(&ring->shm->head, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->shm->tail, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->shm->idle, 1, memory_order_relaxed);
+	ring->mask = ringsize - 1;
+	ring->path = XSTRDUP(MTYPE_SHMRING, path);
+
+	return ring;
+}
+
+struct shmring *shmring_attach(const char *path)
+{
+	struct shmring *ring;
+	struct stat st;
+	uint32_t size;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0
+	    || (size_t)st.st_size < sizeof(struct shmring_shared)) {
+		close(fd);
+		return NULL;
+	}
+
+	ring = shmring_map(fd, st.st_size);
+	close(fd);
+	if (!ring)
+		return NULL;
+
+	unlink(path);
+
+	size = ring->shm->size;
+	if (ring->shm->magic != SHMRING_MAGIC || size < SHMRING_SIZE_MIN
+	    || (size & (size - 1))
+	    || sizeof(struct shmring_shared) + size > ring->maplen) {
+		shmring_del(ring);
+		return NULL;
+	}
+	ring->mask = size - 1;
+
+	return ring;
+}
+
+void shmring_del(struct shmring *ring)
+{
+	munmap(ring->shm, ring->maplen);
+	if (ring->path) {
+		/* gone already if the consumer attached */
+		unlink(ring->path);
+		XFREE(MTYPE_SHMRING, ring->path);
+	}
+	XFREE(MTYPE_SHMRING, ring);
+}
+
+size_t shmring_remain(struct shmring *ring)
+{
+	uint32_t head, tail;
+
+	head = atomic_load_explicit(&ring->shm->head, memory_order_acquire);
+	tail = atomic_load_explicit(&ring->shm->tail, memory_order_acquire);
+
+	return head - tail;
+}
+
+size_t shmring_space(struct shmring *ring)
+{
+	return ring->mask + 1 - shmring_remain(ring);
+}
+
+bool shmring_put(struct shmring *ring, const void *data, size_t size)
+{
+	struct shmring_shared *shm = ring->shm;
+	const uint8_t *dp = data;
+	uint32_t head, offset;
+	size_t ts;
+
+	if (size > shmring_space(ring))
+		return false;
+
+	head = atomic_load_explicit(&shm->head, memory_order_relaxed);
+	offset = head & ring->mask;
+	ts = MIN(size, ring->mask + 1 - offset);
+	memcpy(shm->data + offset, dp, ts);
+	memcpy(shm->data, dp + ts, size - ts);
+
+	/* pairs with the consumer's check in shmring_idle() */
+	atomic_store_explicit(&shm->head, head + size, memory_order_seq_cst);
+	return true;
+}
+
+bool shmring_wakeup(struct shmring *ring)
+{
+	return atomic_exchange_explicit(&ring->shm->idle, 0,
+					memory_order_seq_cst) != 0;
+}
+
+size_t shmring_peek(struct shmring *ring, void *data, size_t size)
+{
+	struct shmring_shared *shm = ring->shm;
+	uint8_t *dp = data;
+	uint32_t tail, offset;
+	size_t remain, copysize, ts;
+
+	remain = shmring_remain(ring);
+	copysize = MIN(size, remain);
+
+	tail = atomic_load_explicit(&shm->tail, memory_order_relaxed);
+	offset = tail & ring->mask;
+	ts = MIN(copysize, ring->mask + 1 - offset);
+	memcpy(dp, shm->data + offset, ts);
+	memcpy(dp + ts, shm->data, copysize - ts);
+
+	return copysize;
+}
+
+size_t shmring_get(struct shmring *ring, void *data, size_t size)
+{
+	struct shmring_shared *shm = ring->shm;
+	size_t copysize;
+	uint32_t tail;
+
+	copysize = shmring_peek(ring, data, size);
+
+	tail = atomic_load_explicit(&shm->tail, memory_order_relaxed);
+	atomic_store_explicit(&shm->tail, tail + copysize,
+			      memory_order_release);
+
+	return copysize;
+}
+
+bool shmring_idle(struct shmring *ring)
+{
+	struct shmring_shared *shm = ring->shm;
+
+	/*
+	 * Either the producer sees the flag after putting more data, or we
+	 * see its data here; the producer is told to wake us up at most once.
+	 */
+	atomic_store_explicit(&shm->idle, 1, memory_order_seq_cst);
+	if (atomic_load_explicit(&shm->head, memory_order_seq_cst)
+	    == atomic_load_explicit(&shm->tail, memory_order_relaxed))
+		return true;
+
+	atomic_store_explicit(&shm->idle, 0, memory_order_seq_cst);
+	return false;
+}
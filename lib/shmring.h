@@ -0,0 +1,138 @@
+/*
+ * Single producer, single consumer ring buffer in shared memory.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_SHMRING_H_
+#define _FRR_SHMRING_H_
+
+#include <zebra.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A byte ring like struct ringbuf, but shared between two processes (or
+ * pthreads) through a mapped file.  The file is meant to live on a tmpfs,
+ * such as FRR's runtime directory, and is removed as soon as the consumer
+ * attached to it.
+ *
+ * One side only ever puts data and the other only ever gets it, so no lock
+ * is needed.  Data is put all or nothing: the consumer never sees a part of
+ * what was put with one call.
+ *
+ * The consumer does not poll.  Before waiting for more data, it announces
+ * that it is idle with shmring_idle(); after putting data the producer asks
+ * shmring_wakeup() whether the consumer is idle and has to be woken up by
+ * some other means, e.g. a message on a socket.  So wakeups are only needed
+ * when the ring goes from empty to non-empty.
+ */
+struct shmring;
+
+/*
+ * Creates the file backing a new ring buffer and maps it.  This is done by
+ * the producer.
+ *
+ * @param path	file to create, must not exist
+ * @param size	buffer size, in bytes; rounded up to a power of 2
+ * @return the newly created buffer, or NULL on error
+ */
+struct shmring *shmring_create(const char *path, size_t size);
+
+/*
+ * Maps a ring buffer created by another process and removes its file.  This
+ * is done by the consumer.
+ *
+ * @param path	file backing the ring buffer
+ * @return the ring buffer, or NULL on error
+ */
+struct shmring *shmring_attach(const char *path);
+
+/*
+ * Unmaps a ring buffer and frees all associated resources.  The producer
+ * also removes the file if the consumer did not attach to it.
+ *
+ * @param ring	the ring buffer to destroy
+ */
+void shmring_del(struct shmring *ring);
+
+/*
+ * Get amount of data left to read from the buffer.
+ *
+ * @return number of readable bytes
+ */
+size_t shmring_remain(struct shmring *ring);
+
+/*
+ * Get amount of space left to write to the buffer.
+ *
+ * @return number of writeable bytes
+ */
+size_t shmring_space(struct shmring *ring);
+
+/*
+ * Put data into the ring buffer.  Producer only.
+ *
+ * @param data	the data to put in the buffer
+ * @param size	how much of data to put in
+ * @return true if the data was put, false if there was not enough space
+ */
+bool shmring_put(struct shmring *ring, const void *data, size_t size);
+
+/*
+ * Check whether the consumer needs to be woken up after putting data.
+ * Producer only.  Returns true at most once per shmring_idle() call of the
+ * consumer.
+ */
+bool shmring_wakeup(struct shmring *ring);
+
+/*
+ * Peek data from the ring buffer.  Consumer only.
+ *
+ * @param data	where to put the data
+ * @param size	how much data to get
+ * @return number of bytes read into data; will be less than size if there
+ * was not enough data to read
+ */
+size_t shmring_peek(struct shmring *ring, void *data, size_t size);
+
+/*
+ * Get data from the ring buffer.  Consumer only.
+ *
+ * @param data	where to put the data
+ * @param size	how much data to get
+ * @return number of bytes read into data; will be less than size if there
+ * was not enough data to read
+ */
+size_t shmring_get(struct shmring *ring, void *data, size_t size);
+
+/*
+ * Announce that the consumer is going to wait for a wakeup.  Consumer only.
+ *
+ * @return true if the consumer may wait, false if more data was put in the
+ * meantime and has to be read first
+ */
+bool shmring_idle(struct shmring *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_SHMRING_H_ */
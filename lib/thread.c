@@ -37,6 +37,7 @@
 #include "lib_errors.h"
 #include "libfrr_trace.h"
 #include "libfrr.h"
+#include "json.h"
 
 DEFINE_MTYPE_STATIC(LIB, THREAD, "Thread");
 DEFINE_MTYPE_STATIC(LIB, THREAD_MASTER, "Thread master");
@@ -70,6 +71,161 @@ static int thread_timer_cmp(const struct thread *a, const struct thread *b)
 
 DECLARE_HEAP(thread_timer_list, struct thread, timeritem, thread_timer_cmp);
 
+/*
+ * Timers of a second or more (hold, keepalive, connect-retry, ...) are kept in
+ * a hierarchical timing wheel instead of the heap, making add & cancel O(1).
+ * Each level has THREAD_WHEEL_SLOTS slots, a level 0 slot spans one tick and
+ * each further level is THREAD_WHEEL_SLOTS times coarser.  A level 0 slot is
+ * moved into the heap when its tick starts, so the heap only ever holds timers
+ * due within the next tick or so and still orders timers to the microsecond.
+ */
+DECLARE_DLIST(thread_wheel_list, struct thread, wheelitem);
+
+#define THREAD_WHEEL_TICK_SHIFT 16 /* 65.536ms */
+#define THREAD_WHEEL_SLOT_BITS 6
+#define THREAD_WHEEL_SLOT_MASK (THREAD_WHEEL_SLOTS - 1)
+
+static inline uint64_t thread_wheel_tick(const struct timeval *tv)
+{
+	return ((uint64_t)tv->tv_sec * TIMER_SECOND_MICRO + tv->tv_usec)
+	       >> THREAD_WHEEL_TICK_SHIFT;
+}
+
+/* Returns false if the timer can't be held by the wheel (already due, or
+ * further out than the top level reaches); it then belongs in the heap.
+ */
+static bool thread_wheel_add(struct thread_timer_wheel *w,
+			     struct thread *thread)
+{
+	uint64_t expires = thread_wheel_tick(&thread->u.sands);
+	uint64_t delta;
+	unsigned int level, slot;
+
+	if (expires < w->tick)
+		return false;
+
+	delta = expires - w->tick;
+	for (level = 0; level < THREAD_WHEEL_LEVELS; level++)
+		if (delta < (1ULL << (THREAD_WHEEL_SLOT_BITS * (level + 1))))
+			break;
+	if (level == THREAD_WHEEL_LEVELS)
+		return false;
+
+	slot = (expires >> (THREAD_WHEEL_SLOT_BITS * level))
+	       & THREAD_WHEEL_SLOT_MASK;
+	thread_wheel_list_add_tail(&w->slots[level][slot], thread);
+	w->occupied[level] |= 1ULL << slot;
+	w->count++;
+	thread->wheelslot = level * THREAD_WHEEL_SLOTS + slot + 1;
+	return true;
+}
+
+static void thread_wheel_del(struct thread_timer_wheel *w,
+			     struct thread *thread)
+{
+	unsigned int level = (thread->wheelslot - 1) / THREAD_WHEEL_SLOTS;
+	unsigned int slot = (thread->wheelslot - 1) % THREAD_WHEEL_SLOTS;
+	struct thread_wheel_list_head *head = &w->slots[level][slot];
+
+	thread_wheel_list_del(head, thread);
+	if (!thread_wheel_list_count(head))
+		w->occupied[level] &= ~(1ULL << slot);
+	w->count--;
+	thread->wheelslot = 0;
+}
+
+/* Next tick at which the wheel has timers to cascade or hand to the heap,
+ * UINT64_MAX if the wheel is empty.
+ */
+static uint64_t thread_wheel_next(const struct thread_timer_wheel *w)
+{
+	uint64_t next = UINT64_MAX;
+
+	for (unsigned int level = 0; level < THREAD_WHEEL_LEVELS; level++) {
+		unsigned int shift = THREAD_WHEEL_SLOT_BITS * level;
+		uint64_t occupied = w->occupied[level];
+		uint64_t base;
+		unsigned int rot;
+
+		if (!occupied)
+			continue;
+
+		/* slots of this level are processed on level-sized
+		 * boundaries; find the first one at or after w->tick
+		 */
+		base = (w->tick + (1ULL << shift) - 1) >> shift;
+		rot = base & THREAD_WHEEL_SLOT_MASK;
+		if (rot)
+			occupied = (occupied >> rot) | (occupied << (64 - rot));
+
+		next = MIN(next, (base + __builtin_ctzll(occupied)) << shift);
+	}
+	return next;
+}
+
+static inline void thread_timer_del(struct thread_master *m,
+				    struct thread *thread)
+{
+	if (thread->wheelslot)
+		thread_wheel_del(&m->timer_wheel, thread);
+	else
+		thread_timer_list_del(&m->timer, thread);
+}
+
+/* Process all wheel ticks up to and including 'now', moving timers that
+ * become due into the heap.  Empty stretches of the wheel are skipped.
+ */
+static void thread_wheel_advance(struct thread_master *m, uint64_t now)
+{
+	struct thread_timer_wheel *w = &m->timer_wheel;
+	struct thread_wheel_list_head *head;
+	struct thread *thread;
+	unsigned int level, slot;
+
+	while (w->tick <= now) {
+		uint64_t next = thread_wheel_next(w);
+
+		if (next > now) {
+			w->tick = now + 1;
+			break;
+		}
+		w->tick = next;
+
+		/* find the highest level with a slot boundary on this tick */
+		for (level = 1; level < THREAD_WHEEL_LEVELS; level++)
+			if (w->tick
+			    & ((1ULL << (THREAD_WHEEL_SLOT_BITS * level)) - 1))
+				break;
+
+		/* cascade top-down, timers land in lower levels */
+		while (--level > 0) {
+			slot = (w->tick >> (THREAD_WHEEL_SLOT_BITS * level))
+			       & THREAD_WHEEL_SLOT_MASK;
+			head = &w->slots[level][slot];
+
+			while ((thread = thread_wheel_list_pop(head))) {
+				w->count--;
+				thread->wheelslot = 0;
+				if (!thread_wheel_add(w, thread))
+					thread_timer_list_add(&m->timer,
+							      thread);
+			}
+			w->occupied[level] &= ~(1ULL << slot);
+		}
+
+		slot = w->tick & THREAD_WHEEL_SLOT_MASK;
+		head = &w->slots[0][slot];
+		while ((thread = thread_wheel_list_pop(head))) {
+			w->count--;
+			thread->wheelslot = 0;
+			thread_timer_list_add(&m->timer, thread);
+		}
+		w->occupied[0] &= ~(1ULL << slot);
+
+		w->tick++;
+	}
+}
+
 #if defined(__APPLE__)
 #include <mach/mach.h>
 #include <mach/mach_time.h>
@@ -101,6 +257,23 @@ bool cputime_enabled = !EXCLUDE_CPU_TIME;
 unsigned long cputime_threshold = CONSUMED_TIME_CHECK;
 unsigned long walltime_threshold = CONSUMED_TIME_CHECK;
 
+/* Count a time in a histogram; relaxed atomics keep this cheap enough to
+ * be done for every task run.
+ */
+static void thread_hist_add(struct time_hist *hist, unsigned long usecs)
+{
+	unsigned int bucket = 0;
+
+	if (usecs) {
+		bucket = sizeof(usecs) * 8 - __builtin_clzl(usecs);
+		if (bucket >= THREAD_HIST_BUCKETS)
+			bucket = THREAD_HIST_BUCKETS - 1;
+	}
+
+	atomic_fetch_add_explicit(&hist->buckets[bucket], 1,
+				  memory_order_relaxed);
+}
+
 /* CLI start ---------------------------------------------------------------- */
 #ifndef VTYSH_EXTRACT_PL
 #include "lib/thread_clippy.c"
@@ -264,6 +437,175 @@ static void cpu_record_print(struct vty *vty, uint8_t filter)
 		vty_out_cpu_thread_history(vty, &tmp);
 }
 
+/* Percentiles shown, in 1/1000 */
+static const unsigned int thread_hist_permille[] = {500, 900, 990};
+static const char *const thread_hist_pct_names[] = {"p50", "p90", "p99"};
+
+/* Take a snapshot of a histogram, returns the number of times counted */
+static size_t thread_hist_load(const struct time_hist *hist, size_t *buckets)
+{
+	size_t total = 0;
+	unsigned int i;
+
+	for (i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		buckets[i] = atomic_load_explicit(&hist->buckets[i],
+						  memory_order_relaxed);
+		total += buckets[i];
+	}
+
+	return total;
+}
+
+/* Estimate a percentile (in 1/1000) of the times counted in a histogram,
+ * interpolating within the bucket it falls in.
+ */
+static size_t thread_hist_percentile(const size_t *buckets, size_t total,
+				     unsigned int permille)
+{
+	size_t target, count = 0, low, high;
+	unsigned int i;
+
+	if (total == 0)
+		return 0;
+
+	target = (total * permille + 999) / 1000;
+
+	for (i = 0; i < THREAD_HIST_BUCKETS; i++) {
+		if (count + buckets[i] < target) {
+			count += buckets[i];
+			continue;
+		}
+
+		if (i == 0)
+			return 0;
+
+		low = 1UL << (i - 1);
+		if (i == THREAD_HIST_BUCKETS - 1)
+			return low;
+
+		high = 1UL << i;
+		return low + (high - low) * (target - count) / buckets[i];
+	}
+
+	return 0;
+}
+
+struct cpu_record_hist_args {
+	struct vty *vty;
+	uint8_t filter;
+	json_object *json;
+};
+
+static void cpu_record_hist_print(struct hash_bucket *bucket, void *arg)
+{
+	static const char *const hist_names[] = {"wall", "cpu", "delay"};
+	struct cpu_record_hist_args *args = arg;
+	struct cpu_thread_history *a = bucket->data;
+	const struct time_hist *hists[] = {&a->real_hist, &a->cpu_hist,
+					   &a->delay_hist};
+	size_t buckets[THREAD_HIST_BUCKETS], total, pct;
+	json_object *json_task = NULL, *json_hist, *json_buckets;
+	unsigned int h, i;
+
+	if (!(atomic_load_explicit(&a->types, memory_order_relaxed) &
+	      args->filter))
+		return;
+
+	if (args->json) {
+		/* Function names aren't unique, static ones in particular */
+		json_task = json_object_new_object();
+		json_object_string_add(json_task, "function", a->funcname);
+		json_object_int_add(json_task, "invoked",
+				    atomic_load_explicit(&a->total_calls,
+							 memory_order_relaxed));
+		json_object_array_add(args->json, json_task);
+	} else
+		vty_out(args->vty, "%9zu",
+			atomic_load_explicit(&a->total_calls,
+					     memory_order_relaxed));
+
+	for (h = 0; h < array_size(hists); h++) {
+		total = thread_hist_load(hists[h], buckets);
+
+		if (args->json) {
+			json_hist = json_object_new_object();
+			json_object_int_add(json_hist, "count", total);
+			json_buckets = json_object_new_array();
+			for (i = 0; i < THREAD_HIST_BUCKETS; i++)
+				json_object_array_add(
+					json_buckets,
+					json_object_new_int64(buckets[i]));
+			json_object_object_add(json_hist, "buckets",
+					       json_buckets);
+			json_object_object_add(json_task, hist_names[h],
+					       json_hist);
+		}
+
+		for (i = 0; i < array_size(thread_hist_permille); i++) {
+			pct = thread_hist_percentile(buckets, total,
+						     thread_hist_permille[i]);
+			if (args->json)
+				json_object_int_add(json_hist,
+						    thread_hist_pct_names[i],
+						    pct);
+			else
+				vty_out(args->vty, " %8zu", pct);
+		}
+	}
+
+	if (!args->json)
+		vty_out(args->vty, "  %s\n", a->funcname);
+}
+
+static void cpu_record_hist_show(struct vty *vty, uint8_t filter, bool uj)
+{
+	struct cpu_record_hist_args args = {.vty = vty, .filter = filter};
+	json_object *json = NULL, *json_pthread;
+	struct thread_master *m;
+	struct listnode *ln;
+	unsigned int h;
+
+	if (uj)
+		json = json_object_new_object();
+
+	frr_with_mutex (&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, ln, m)) {
+			const char *name = m->name ? m->name : "main";
+
+			if (uj) {
+				json_pthread = json_object_new_array();
+				json_object_object_add(json, name,
+						       json_pthread);
+				args.json = json_pthread;
+			} else {
+				vty_out(vty, "\nShowing percentiles for pthread %s\n",
+					name);
+				vty_out(vty, "%9s %-26s %-26s %-26s\n", "",
+					" Real (wall-clock) uSec:",
+					" CPU (user+system) uSec:",
+					" Scheduling delay uSec:");
+				vty_out(vty, "%9s", "Invoked");
+				for (h = 0; h < 3; h++)
+					vty_out(vty, " %8s %8s %8s", "p50",
+						"p90", "p99");
+				vty_out(vty, "  Thread\n");
+			}
+
+			frr_with_mutex (&m->mtx) {
+				hash_iterate(m->cpu_record,
+					     cpu_record_hist_print, &args);
+			}
+		}
+	}
+
+	if (uj)
+		vty_json(vty, json);
+	else if (!cputime_enabled)
+		vty_out(vty,
+			"\nCollecting CPU time statistics is currently disabled, CPU time percentiles\n"
+			"may be zero or show data from when collection was enabled.\n");
+}
+
 static void cpu_record_hash_clear(struct hash_bucket *bucket, void *args[])
 {
 	uint8_t *filter = args[0];
@@ -357,6 +699,32 @@ DEFUN_NOSH (show_thread_cpu,
 	return CMD_SUCCESS;
 }
 
+DEFPY_NOSH (show_thread_cpu_percentiles,
+	    show_thread_cpu_percentiles_cmd,
+	    "show thread cpu percentiles [FILTER$filterstr] [json$uj]",
+	    SHOW_STR
+	    "Thread information\n"
+	    "Thread CPU usage\n"
+	    "Time percentiles\n"
+	    "Display filter (rwtex)\n"
+	    JSON_STR)
+{
+	uint8_t filter = (uint8_t)-1U;
+
+	if (filterstr) {
+		filter = parse_filter(filterstr);
+		if (!filter) {
+			vty_out(vty,
+				"Invalid filter \"%s\" specified; must contain at least one of 'RWTEX'\n",
+				filterstr);
+			return CMD_WARNING;
+		}
+	}
+
+	cpu_record_hist_show(vty, filter, !!uj);
+	return CMD_SUCCESS;
+}
+
 DEFPY (service_cputime_stats,
        service_cputime_stats_cmd,
        "[no] service cputime-stats",
@@ -424,6 +792,7 @@ static void show_thread_poll_helper(struct vty *vty, struct thread_master *m)
 
 	vty_out(vty, "\nShowing poll FD's for %s\n", name);
 	vty_out(vty, "----------------------%s\n", underline);
+	vty_out(vty, "Backend: %s\n", thread_io_backend_name(m->io_backend));
 	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
 		m->fd_limit);
 	for (i = 0; i < m->handler.pfdcount; i++) {
@@ -513,6 +882,13 @@ static void show_thread_timers_helper(struct vty *vty, struct thread_master *m)
 	frr_each (thread_timer_list, &m->timer, thread) {
 		vty_out(vty, "  %-50s%pTH\n", thread->hist->funcname, thread);
 	}
+
+	for (int level = 0; level < THREAD_WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < THREAD_WHEEL_SLOTS; slot++)
+			frr_each (thread_wheel_list,
+				  &m->timer_wheel.slots[level][slot], thread)
+				vty_out(vty, "  %-50s%pTH\n",
+					thread->hist->funcname, thread);
 }
 
 DEFPY_NOSH (show_thread_timers,
@@ -536,6 +912,7 @@ DEFPY_NOSH (show_thread_timers,
 void thread_cmd_init(void)
 {
 	install_element(VIEW_NODE, &show_thread_cpu_cmd);
+	install_element(VIEW_NODE, &show_thread_cpu_percentiles_cmd);
 	install_element(VIEW_NODE, &show_thread_poll_cmd);
 	install_element(ENABLE_NODE, &clear_thread_cpu_cmd);
 
@@ -565,6 +942,7 @@ struct thread_master *thread_master_create(const char *name)
 {
 	struct thread_master *rv;
 	struct rlimit limit;
+	struct timeval tv;
 
 	pthread_once(&init_once, &initializer);
 
@@ -605,6 +983,13 @@ struct thread_master *thread_master_create(const char *name)
 	thread_list_init(&rv->ready);
 	thread_list_init(&rv->unuse);
 	thread_timer_list_init(&rv->timer);
+	for (int level = 0; level < THREAD_WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < THREAD_WHEEL_SLOTS; slot++)
+			thread_wheel_list_init(
+				&rv->timer_wheel.slots[level][slot]);
+	monotime(&tv);
+	rv->timer_wheel.tick = thread_wheel_tick(&tv);
+	rv->use_timer_wheel = true;
 
 	/* Initialize thread_fetch() settings */
 	rv->spin = true;
@@ -628,6 +1013,16 @@ struct thread_master *thread_master_create(const char *name)
 				   sizeof(struct pollfd) * rv->handler.pfdsize);
 	rv->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
 				   sizeof(struct pollfd) * rv->handler.pfdsize);
+#ifdef HAVE_EPOLL
+	rv->handler.epfd = -1;
+#endif
+
+	rv->io_backend = THREAD_IO_POLL;
+	if (frr_get_io_backend() != THREAD_IO_POLL
+	    && thread_master_set_io_backend(rv, frr_get_io_backend()) < 0)
+		flog_err(EC_LIB_SYSTEM_CALL,
+			 "%s: could not enable %s I/O backend, using poll",
+			 name, thread_io_backend_name(frr_get_io_backend()));
 
 	/* add to list of threadmasters */
 	frr_with_mutex (&masters_mtx) {
@@ -640,6 +1035,171 @@ struct thread_master *thread_master_create(const char *name)
 	return rv;
 }
 
+const char *thread_io_backend_name(enum thread_io_backend backend)
+{
+	switch (backend) {
+	case THREAD_IO_POLL:
+		return "poll";
+	case THREAD_IO_EPOLL:
+		return "epoll";
+	}
+	return "unknown";
+}
+
+#ifdef HAVE_EPOLL
+/* Number of events fetched from the kernel per epoll_wait() call. */
+#define THREAD_EPOLL_EVENTS 256
+
+static void thread_epoll_fini(struct thread_master *m)
+{
+	if (m->handler.epfd >= 0)
+		close(m->handler.epfd);
+	m->handler.epfd = -1;
+
+	XFREE(MTYPE_THREAD_POLL, m->handler.epstate);
+	XFREE(MTYPE_THREAD_POLL, m->handler.epslot);
+	XFREE(MTYPE_THREAD_POLL, m->handler.epevents);
+}
+
+static int thread_epoll_init(struct thread_master *m)
+{
+	struct epoll_event ev = {};
+
+	m->handler.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (m->handler.epfd < 0)
+		return -1;
+
+	/* the pipe poker stays registered for the master's lifetime */
+	ev.events = EPOLLIN;
+	ev.data.fd = m->io_pipe[0];
+	if (epoll_ctl(m->handler.epfd, EPOLL_CTL_ADD, m->io_pipe[0], &ev) < 0) {
+		thread_epoll_fini(m);
+		return -1;
+	}
+
+	m->handler.epstate = XCALLOC(MTYPE_THREAD_POLL,
+				     sizeof(uint8_t) * m->fd_limit);
+	m->handler.epslot = XCALLOC(MTYPE_THREAD_POLL,
+				    sizeof(nfds_t) * m->fd_limit);
+	m->handler.epeventsize = MIN(m->fd_limit, THREAD_EPOLL_EVENTS);
+	m->handler.epevents =
+		XCALLOC(MTYPE_THREAD_POLL,
+			sizeof(struct epoll_event) * m->handler.epeventsize);
+	return 0;
+}
+
+/*
+ * Make the kernel's interest set for 'fd' match 'events' (POLLIN/POLLOUT).
+ *
+ * Registrations are only narrowed lazily: when a task fires, its interest is
+ * left armed in the kernel since the task is usually rescheduled right away.
+ * If it isn't, the next event on the fd finds no task and disarms it.
+ *
+ * As the fd may have been closed (dropping its kernel registration) and
+ * reused since we last touched it, callers adding interest must pass
+ * 'force' so that the registration is always re-established.
+ */
+static void thread_epoll_update(struct thread_master *m, int fd, short events,
+				bool force)
+{
+	struct epoll_event ev = {};
+	uint8_t registered = m->handler.epstate[fd];
+	int op;
+
+	events &= (POLLIN | POLLOUT);
+	if (registered == events && !force)
+		return;
+
+	if (events & POLLIN)
+		ev.events |= EPOLLIN;
+	if (events & POLLOUT)
+		ev.events |= EPOLLOUT;
+	ev.data.fd = fd;
+
+	if (!events)
+		op = EPOLL_CTL_DEL;
+	else if (!registered)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	if (epoll_ctl(m->handler.epfd, op, fd, &ev) < 0) {
+		if (op == EPOLL_CTL_MOD && errno == ENOENT)
+			op = EPOLL_CTL_ADD;
+		else if (op == EPOLL_CTL_ADD && errno == EEXIST)
+			op = EPOLL_CTL_MOD;
+		else
+			op = -1;
+
+		/* removing interest from a closed fd is not an error */
+		if ((op < 0 || epoll_ctl(m->handler.epfd, op, fd, &ev) < 0)
+		    && events)
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "%s: epoll_ctl() failed for fd %d: %s",
+				 m->name ? m->name : "", fd,
+				 safe_strerror(errno));
+	}
+
+	m->handler.epstate[fd] = events;
+}
+
+/* Remove entry i from the (unordered) set of fds with scheduled I/O. */
+static void thread_epoll_pfd_del(struct thread_master *m, nfds_t i)
+{
+	struct fd_handler *h = &m->handler;
+	nfds_t last = h->pfdcount - 1;
+
+	h->epslot[h->pfds[i].fd] = 0;
+	if (i != last) {
+		h->pfds[i] = h->pfds[last];
+		h->epslot[h->pfds[i].fd] = i + 1;
+	}
+	h->pfds[last].fd = 0;
+	h->pfds[last].events = 0;
+	h->pfdcount--;
+}
+#endif /* HAVE_EPOLL */
+
+int thread_master_set_io_backend(struct thread_master *m,
+				 enum thread_io_backend backend)
+{
+	frr_with_mutex (&m->mtx) {
+		if (m->io_backend == backend)
+			return 0;
+
+		/* registrations are not carried over between backends */
+		if (m->handler.pfdcount)
+			return -1;
+
+		switch (backend) {
+		case THREAD_IO_POLL:
+#ifdef HAVE_EPOLL
+			thread_epoll_fini(m);
+#endif
+			break;
+		case THREAD_IO_EPOLL:
+#ifdef HAVE_EPOLL
+			if (thread_epoll_init(m) < 0)
+				return -1;
+			break;
+#else
+			errno = ENOSYS;
+			return -1;
+#endif
+		}
+
+		m->io_backend = backend;
+	}
+	return 0;
+}
+
+void thread_master_set_timer_wheel(struct thread_master *m, bool enable)
+{
+	frr_with_mutex (&m->mtx) {
+		m->use_timer_wheel = enable;
+	}
+}
+
 void thread_master_set_name(struct thread_master *master, const char *name)
 {
 	frr_with_mutex (&master->mtx) {
@@ -731,11 +1291,19 @@ void thread_master_free(struct thread_master *m)
 	thread_array_free(m, m->write);
 	while ((t = thread_timer_list_pop(&m->timer)))
 		thread_free(m, t);
+	for (int level = 0; level < THREAD_WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < THREAD_WHEEL_SLOTS; slot++)
+			while ((t = thread_wheel_list_pop(
+					&m->timer_wheel.slots[level][slot])))
+				thread_free(m, t);
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
 	pthread_mutex_destroy(&m->mtx);
 	pthread_cond_destroy(&m->cancel_cond);
+#ifdef HAVE_EPOLL
+	thread_epoll_fini(m);
+#endif
 	close(m->io_pipe[0]);
 	close(m->io_pipe[1]);
 	list_delete(&m->cancel_req);
@@ -833,6 +1401,7 @@ static struct thread *thread_get(struct thread_master *m, uint8_t type,
 	thread->yield = THREAD_YIELD_TIME_SLOT; /* default */
 	thread->ref = NULL;
 	thread->ignore_timer_late = false;
+	timerclear(&thread->ready);
 
 	/*
 	 * So if the passed in funcname is not what we have
@@ -906,11 +1475,13 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 	rcu_read_unlock();
 	rcu_assert_read_unlocked();
 
-	/* add poll pipe poker */
-	assert(count + 1 < m->handler.pfdsize);
-	m->handler.copy[count].fd = m->io_pipe[0];
-	m->handler.copy[count].events = POLLIN;
-	m->handler.copy[count].revents = 0x00;
+	/* add poll pipe poker (always registered with epoll) */
+	if (m->io_backend == THREAD_IO_POLL) {
+		assert(count + 1 < m->handler.pfdsize);
+		m->handler.copy[count].fd = m->io_pipe[0];
+		m->handler.copy[count].events = POLLIN;
+		m->handler.copy[count].revents = 0x00;
+	}
 
 	/* We need to deal with a signal-handling race here: we
 	 * don't want to miss a crucial signal, such as SIGTERM or SIGINT,
@@ -935,6 +1506,16 @@ static int fd_poll(struct thread_master *m, const struct timeval *timer_wait,
 		pthread_sigmask(SIG_SETMASK, NULL, &origsigs);
 	}
 
+#ifdef HAVE_EPOLL
+	if (m->io_backend == THREAD_IO_EPOLL) {
+		/* the pipe poker is drained in thread_process_io_epoll() */
+		num = epoll_pwait(m->handler.epfd, m->handler.epevents,
+				  m->handler.epeventsize, timeout, &origsigs);
+		pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
+		goto done;
+	}
+#endif
+
 #if defined(HAVE_PPOLL)
 	struct timespec ts, *tsp;
 
@@ -958,7 +1539,8 @@ done:
 	if (num < 0 && errno == EINTR)
 		*eintr_p = true;
 
-	if (num > 0 && m->handler.copy[count].revents != 0 && num--)
+	if (num > 0 && m->io_backend == THREAD_IO_POLL
+	    && m->handler.copy[count].revents != 0 && num--)
 		while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
 			;
 
@@ -1005,20 +1587,26 @@ void _thread_add_read_write(const struct xref_threadsched *xref,
 
 		/* if we already have a pollfd for our file descriptor, find and
 		 * use it */
-		for (nfds_t i = 0; i < m->handler.pfdcount; i++)
-			if (m->handler.pfds[i].fd == fd) {
-				queuepos = i;
+#ifdef HAVE_EPOLL
+		if (m->io_backend == THREAD_IO_EPOLL) {
+			if (m->handler.epslot[fd])
+				queuepos = m->handler.epslot[fd] - 1;
+		} else
+#endif
+			for (nfds_t i = 0; i < m->handler.pfdcount; i++)
+				if (m->handler.pfds[i].fd == fd) {
+					queuepos = i;
+					break;
+				}
 
 #ifdef DEV_BUILD
-				/*
-				 * What happens if we have a thread already
-				 * created for this event?
-				 */
-				if (thread_array[fd])
-					assert(!"Thread already scheduled for file descriptor");
+		/*
+		 * What happens if we have a thread already
+		 * created for this event?
+		 */
+		if (queuepos < m->handler.pfdcount && thread_array[fd])
+			assert(!"Thread already scheduled for file descriptor");
 #endif
-				break;
-			}
 
 		/* make sure we have room for this fd + pipe poker fd */
 		assert(queuepos + 1 < m->handler.pfdsize);
@@ -1032,6 +1620,14 @@ void _thread_add_read_write(const struct xref_threadsched *xref,
 		if (queuepos == m->handler.pfdcount)
 			m->handler.pfdcount++;
 
+#ifdef HAVE_EPOLL
+		if (m->io_backend == THREAD_IO_EPOLL) {
+			m->handler.epslot[fd] = queuepos + 1;
+			thread_epoll_update(m, fd, m->handler.pfds[queuepos].events,
+					    true);
+		}
+#endif
+
 		if (thread) {
 			frr_with_mutex (&thread->mtx) {
 				thread->u.fd = fd;
@@ -1078,7 +1674,9 @@ static void _thread_add_timer_timeval(const struct xref_threadsched *xref,
 
 		frr_with_mutex (&thread->mtx) {
 			thread->u.sands = t;
-			thread_timer_list_add(&m->timer, thread);
+			if (!m->use_timer_wheel || time_relative->tv_sec < 1
+			    || !thread_wheel_add(&m->timer_wheel, thread))
+				thread_timer_list_add(&m->timer, thread);
 			if (t_ptr) {
 				*t_ptr = thread;
 				thread->ref = t_ptr;
@@ -1087,9 +1685,13 @@ static void _thread_add_timer_timeval(const struct xref_threadsched *xref,
 
 		/* The timer list is sorted - if this new timer
 		 * might change the time we'll wait for, give the pthread
-		 * a chance to re-compute.
+		 * a chance to re-compute.  The wheel isn't sorted; only
+		 * poke the pthread if it may be sleeping.
 		 */
-		if (thread_timer_list_first(&m->timer) == thread)
+		if (thread->wheelslot) {
+			if (m->owner != pthread_self())
+				AWAKEN(m);
+		} else if (thread_timer_list_first(&m->timer) == thread)
 			AWAKEN(m);
 	}
 #define ONEYEAR2SEC (60 * 60 * 24 * 365)
@@ -1162,6 +1764,7 @@ void _thread_add_event(const struct xref_threadsched *xref,
 		thread = thread_get(m, THREAD_EVENT, func, arg, xref);
 		frr_with_mutex (&thread->mtx) {
 			thread->u.val = val;
+			monotime(&thread->ready);
 			thread_list_add_tail(&m->event, thread);
 		}
 
@@ -1201,6 +1804,14 @@ static void thread_cancel_rw(struct thread_master *master, int fd, short state,
 	/* Cancel POLLHUP too just in case some bozo set it */
 	state |= POLLHUP;
 
+#ifdef HAVE_EPOLL
+	/* The epoll backend tracks each fd's position in pfds */
+	if (master->io_backend == THREAD_IO_EPOLL) {
+		i = master->handler.epslot[fd];
+		found = (i != 0);
+		i--;
+	} else
+#endif
 	/* Some callers know the index of the pfd already */
 	if (idx_hint >= 0) {
 		i = idx_hint;
@@ -1225,6 +1836,17 @@ static void thread_cancel_rw(struct thread_master *master, int fd, short state,
 	/* NOT out event. */
 	master->handler.pfds[i].events &= ~(state);
 
+#ifdef HAVE_EPOLL
+	/* epoll keeps no ordering (nor a copy) to preserve */
+	if (master->io_backend == THREAD_IO_EPOLL) {
+		thread_epoll_update(master, fd, master->handler.pfds[i].events,
+				    false);
+		if (master->handler.pfds[i].events == 0)
+			thread_epoll_pfd_del(master, i);
+		return;
+	}
+#endif
+
 	/* If all events are canceled, delete / resize the pollfd array. */
 	if (master->handler.pfds[i].events == 0) {
 		memmove(master->handler.pfds + i, master->handler.pfds + i + 1,
@@ -1339,6 +1961,25 @@ static void cancel_arg_helper(struct thread_master *master,
 
 		t = t_next;
 	}
+
+	for (int level = 0; level < THREAD_WHEEL_LEVELS; level++) {
+		for (int slot = 0; slot < THREAD_WHEEL_SLOTS; slot++) {
+			if (!(master->timer_wheel.occupied[level]
+			      & (1ULL << slot)))
+				continue;
+
+			frr_each_safe (thread_wheel_list,
+				       &master->timer_wheel.slots[level][slot],
+				       t) {
+				if (t->arg != cr->eventobj)
+					continue;
+				thread_wheel_del(&master->timer_wheel, t);
+				if (t->ref)
+					*t->ref = NULL;
+				thread_add_unuse(master, t);
+			}
+		}
+	}
 }
 
 /**
@@ -1393,7 +2034,7 @@ static void do_thread_cancel(struct thread_master *master)
 			thread_array = master->write;
 			break;
 		case THREAD_TIMER:
-			thread_timer_list_del(&master->timer, thread);
+			thread_timer_del(master, thread);
 			break;
 		case THREAD_EVENT:
 			list = &master->event;
@@ -1579,14 +2220,31 @@ void thread_cancel_async(struct thread_master *master, struct thread **thread,
 }
 /* ------------------------------------------------------------------------- */
 
-static struct timeval *thread_timer_wait(struct thread_timer_list_head *timers,
+static struct timeval *thread_timer_wait(struct thread_master *m,
 					 struct timeval *timer_val)
 {
-	if (!thread_timer_list_count(timers))
+	uint64_t wheel_next = thread_wheel_next(&m->timer_wheel);
+	struct timeval wheel_tv, wheel_wait;
+
+	if (!thread_timer_list_count(&m->timer) && wheel_next == UINT64_MAX)
 		return NULL;
 
-	struct thread *next_timer = thread_timer_list_first(timers);
-	monotime_until(&next_timer->u.sands, timer_val);
+	if (thread_timer_list_count(&m->timer)) {
+		struct thread *next_timer = thread_timer_list_first(&m->timer);
+		monotime_until(&next_timer->u.sands, timer_val);
+		if (wheel_next == UINT64_MAX)
+			return timer_val;
+	}
+
+	/* wake up when the next wheel slot is due to be processed */
+	wheel_next <<= THREAD_WHEEL_TICK_SHIFT;
+	wheel_tv.tv_sec = wheel_next / TIMER_SECOND_MICRO;
+	wheel_tv.tv_usec = wheel_next % TIMER_SECOND_MICRO;
+	monotime_until(&wheel_tv, &wheel_wait);
+
+	if (!thread_timer_list_count(&m->timer)
+	    || timercmp(&wheel_wait, timer_val, <))
+		*timer_val = wheel_wait;
 	return timer_val;
 }
 
@@ -1600,7 +2258,8 @@ static struct thread *thread_run(struct thread_master *m, struct thread *thread,
 
 static int thread_process_io_helper(struct thread_master *m,
 				    struct thread *thread, short state,
-				    short actual_state, int pos)
+				    short actual_state, int pos,
+				    const struct timeval *now)
 {
 	struct thread **thread_array;
 
@@ -1633,10 +2292,82 @@ static int thread_process_io_helper(struct thread_master *m,
 	thread_array[thread->u.fd] = NULL;
 	thread_list_add_tail(&m->ready, thread);
 	thread->type = THREAD_READY;
+	thread->ready = *now;
 
 	return 1;
 }
 
+#ifdef HAVE_EPOLL
+/* Move an I/O task whose fd became ready to the ready list. */
+static void thread_io_ready(struct thread_master *m, struct thread *thread,
+			    struct thread **thread_array,
+			    const struct timeval *now)
+{
+	thread_array[thread->u.fd] = NULL;
+	thread_list_add_tail(&m->ready, thread);
+	thread->type = THREAD_READY;
+	thread->ready = *now;
+}
+
+/**
+ * Process I/O events returned by epoll_wait().
+ *
+ * Only the fds that are actually ready are visited, independent of how many
+ * fds have tasks scheduled.
+ *
+ * @param m the thread master
+ * @param num the number of events in m->handler.epevents
+ * @param now the time epoll_wait() returned
+ */
+static void thread_process_io_epoll(struct thread_master *m, unsigned int num,
+				    const struct timeval *now)
+{
+	struct fd_handler *h = &m->handler;
+	unsigned char trash[64];
+
+	for (unsigned int i = 0; i < num; i++) {
+		int fd = h->epevents[i].data.fd;
+		uint32_t revents = h->epevents[i].events;
+		struct pollfd *pfd = NULL;
+		short wanted = 0, fired = 0;
+
+		if (fd == m->io_pipe[0]) {
+			while (read(fd, &trash, sizeof(trash)) > 0)
+				;
+			continue;
+		}
+
+		if (h->epslot[fd]) {
+			pfd = &h->pfds[h->epslot[fd] - 1];
+			wanted = pfd->events;
+		}
+
+		/* lazily disarm interest nobody is waiting for anymore */
+		if (h->epstate[fd] & ~wanted)
+			thread_epoll_update(m, fd, wanted, false);
+
+		/* as with poll(), errors & hangups are handed to the reader */
+		if ((wanted & POLLIN) && (revents & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+			fired |= POLLIN;
+		if ((wanted & POLLOUT) && (revents & EPOLLOUT))
+			fired |= POLLOUT;
+
+		if (!fired)
+			continue;
+
+		if ((fired & POLLIN) && m->read[fd])
+			thread_io_ready(m, m->read[fd], m->read, now);
+		if ((fired & POLLOUT) && m->write[fd])
+			thread_io_ready(m, m->write[fd], m->write, now);
+
+		/* kernel registration stays armed, see thread_epoll_update() */
+		pfd->events &= ~fired;
+		if (pfd->events == 0)
+			thread_epoll_pfd_del(m, h->epslot[fd] - 1);
+	}
+}
+#endif /* HAVE_EPOLL */
+
 /**
  * Process I/O events.
  *
@@ -1645,12 +2376,21 @@ static int thread_process_io_helper(struct thread_master *m,
  *
  * @param m the thread master
  * @param num the number of active file descriptors (return value of poll())
+ * @param now the time poll() returned
  */
-static void thread_process_io(struct thread_master *m, unsigned int num)
+static void thread_process_io(struct thread_master *m, unsigned int num,
+			      const struct timeval *now)
 {
 	unsigned int ready = 0;
 	struct pollfd *pfds = m->handler.copy;
 
+#ifdef HAVE_EPOLL
+	if (m->io_backend == THREAD_IO_EPOLL) {
+		thread_process_io_epoll(m, num, now);
+		return;
+	}
+#endif
+
 	for (nfds_t i = 0; i < m->handler.copycount && ready < num; ++i) {
 		/* no event for current fd? immediately continue */
 		if (pfds[i].revents == 0)
@@ -1674,11 +2414,12 @@ static void thread_process_io(struct thread_master *m, unsigned int num)
 		 */
 		if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
 			thread_process_io_helper(m, m->read[pfds[i].fd], POLLIN,
-						 pfds[i].revents, i);
+						 pfds[i].revents, i, now);
 		}
 		if (pfds[i].revents & POLLOUT)
 			thread_process_io_helper(m, m->write[pfds[i].fd],
-						 POLLOUT, pfds[i].revents, i);
+						 POLLOUT, pfds[i].revents, i,
+						 now);
 
 		/* if one of our file descriptors is garbage, remove the same
 		 * from
@@ -1712,6 +2453,8 @@ static unsigned int thread_process_timers(struct thread_master *m,
 	struct thread *thread;
 	unsigned int ready = 0;
 
+	thread_wheel_advance(m, thread_wheel_tick(timenow));
+
 	while ((thread = thread_timer_list_first(&m->timer))) {
 		if (timercmp(timenow, &thread->u.sands, <))
 			break;
@@ -1738,6 +2481,7 @@ static unsigned int thread_process_timers(struct thread_master *m,
 
 		thread_timer_list_pop(&m->timer);
 		thread->type = THREAD_READY;
+		thread->ready = thread->u.sands;
 		thread_list_add_tail(&m->ready, thread);
 		ready++;
 	}
@@ -1822,7 +2566,7 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 		 * once per loop to avoid starvation by events
 		 */
 		if (!thread_list_count(&m->ready))
-			tw = thread_timer_wait(&m->timer, &tv);
+			tw = thread_timer_wait(m, &tv);
 
 		if (thread_list_count(&m->ready) ||
 				(tw && !timercmp(tw, &zerotime, >)))
@@ -1836,11 +2580,14 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 
 		/*
 		 * Copy pollfd array + # active pollfds in it. Not necessary to
-		 * copy the array size as this is fixed.
+		 * copy the array size as this is fixed.  epoll keeps its
+		 * registrations in the kernel and needs no copy.
 		 */
-		m->handler.copycount = m->handler.pfdcount;
-		memcpy(m->handler.copy, m->handler.pfds,
-		       m->handler.copycount * sizeof(struct pollfd));
+		if (m->io_backend == THREAD_IO_POLL) {
+			m->handler.copycount = m->handler.pfdcount;
+			memcpy(m->handler.copy, m->handler.pfds,
+			       m->handler.copycount * sizeof(struct pollfd));
+		}
 
 		pthread_mutex_unlock(&m->mtx);
 		{
@@ -1871,7 +2618,7 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 
 		/* Post I/O to ready queue. */
 		if (num > 0)
-			thread_process_io(m, num);
+			thread_process_io(m, num, &now);
 
 		pthread_mutex_unlock(&m->mtx);
 
@@ -2016,6 +2763,14 @@ void thread_call(struct thread *thread)
 
 	walltime = thread_consumed_time(&after, &before, &cputime);
 
+	thread_hist_add(&thread->hist->real_hist, walltime);
+	if (timerisset(&thread->ready))
+		thread_hist_add(&thread->hist->delay_hist,
+				timercmp(&before.real, &thread->ready, >)
+					? timeval_elapsed(before.real,
+							  thread->ready)
+					: 0);
+
 	/* update walltime */
 	atomic_fetch_add_explicit(&thread->hist->real.total, walltime,
 				  memory_order_seq_cst);
@@ -2028,6 +2783,8 @@ void thread_call(struct thread *thread)
 		;
 
 	if (cputime_enabled_here && cputime_enabled) {
+		thread_hist_add(&thread->hist->cpu_hist, cputime);
+
 		/* update cputime */
 		atomic_fetch_add_explicit(&thread->hist->cpu.total, cputime,
 					  memory_order_seq_cst);
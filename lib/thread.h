@@ -24,6 +24,9 @@
 #include <zebra.h>
 #include <pthread.h>
 #include <poll.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 #include "monotime.h"
 #include "frratomic.h"
 #include "typesafe.h"
@@ -54,6 +57,15 @@ struct rusage_t {
 
 PREDECL_LIST(thread_list);
 PREDECL_HEAP(thread_timer_list);
+PREDECL_DLIST(thread_wheel_list);
+
+/* Mechanism used by a thread_master to wait for I/O readiness. */
+enum thread_io_backend {
+	/* rebuild & scan a pollfd array on every wakeup (portable) */
+	THREAD_IO_POLL = 0,
+	/* persistent kernel registrations, O(ready fds) per wakeup */
+	THREAD_IO_EPOLL,
+};
 
 struct fd_handler {
 	/* number of pfd that fit in the allocated space of pfds. This is a
@@ -70,6 +82,38 @@ struct fd_handler {
 	struct pollfd *copy;
 	/* number of pollfds stored in copy */
 	nfds_t copycount;
+
+#ifdef HAVE_EPOLL
+	/* With the epoll backend, pfds is kept as an unordered set of the
+	 * fds that have an I/O task scheduled (.events is what those tasks
+	 * wait for) and copy is unused.
+	 */
+	int epfd;
+	/* events registered with the kernel for each fd, may be a superset
+	 * of what is wanted since disarming is done lazily
+	 */
+	uint8_t *epstate;
+	/* 1-based position of each fd in pfds, 0 if not present */
+	nfds_t *epslot;
+	/* receive buffer for epoll_wait() */
+	struct epoll_event *epevents;
+	int epeventsize;
+#endif
+};
+
+/* Hierarchical timing wheel holding coarse (>= 1s) timers, see thread.c */
+#define THREAD_WHEEL_LEVELS 5
+#define THREAD_WHEEL_SLOTS 64
+
+struct thread_timer_wheel {
+	/* next tick to be processed */
+	uint64_t tick;
+	/* number of timers in the wheel */
+	size_t count;
+	/* bitmap of non-empty slots, per level */
+	uint64_t occupied[THREAD_WHEEL_LEVELS];
+	struct thread_wheel_list_head slots[THREAD_WHEEL_LEVELS]
+					   [THREAD_WHEEL_SLOTS];
 };
 
 struct xref_threadsched {
@@ -87,6 +131,8 @@ struct thread_master {
 	struct thread **read;
 	struct thread **write;
 	struct thread_timer_list_head timer;
+	struct thread_timer_wheel timer_wheel;
+	bool use_timer_wheel;
 	struct thread_list_head event, ready, unuse;
 	struct list *cancel_req;
 	bool canceled;
@@ -95,6 +141,7 @@ struct thread_master {
 	int io_pipe[2];
 	int fd_limit;
 	struct fd_handler handler;
+	enum thread_io_backend io_backend;
 	unsigned long alloc;
 	long selectpoll_timeout;
 	bool spin;
@@ -112,6 +159,8 @@ struct thread {
 	uint8_t add_type;	  /* thread type */
 	struct thread_list_item threaditem;
 	struct thread_timer_list_item timeritem;
+	struct thread_wheel_list_item wheelitem;
+	uint16_t wheelslot;	  /* 1 + wheel level/slot, 0 if not in wheel */
 	struct thread **ref;	  /* external reference (if given) */
 	struct thread_master *master; /* pointer to the struct thread_master */
 	void (*func)(struct thread *); /* event function */
@@ -122,6 +171,7 @@ struct thread {
 		struct timeval sands; /* rest of time sands value. */
 	} u;
 	struct timeval real;
+	struct timeval ready;	      /* when the task became runnable */
 	struct cpu_thread_history *hist; /* cache pointer to cpu_history */
 	unsigned long yield;		 /* yield time in microseconds */
 	const struct xref_threadsched *xref;   /* origin location */
@@ -133,6 +183,12 @@ struct thread {
 #pragma FRR printfrr_ext "%pTH" (struct thread *)
 #endif
 
+/* Buckets of the task time histograms: bucket n counts times shorter than
+ * 2^n microseconds (and not counted in a lower bucket), the last one all
+ * longer times.
+ */
+#define THREAD_HIST_BUCKETS 26
+
 struct cpu_thread_history {
 	void (*func)(struct thread *);
 	atomic_size_t total_cpu_warn;
@@ -146,6 +202,13 @@ struct cpu_thread_history {
 	struct time_stats cpu;
 	atomic_uint_fast32_t types;
 	const char *funcname;
+
+	/* time histograms: wall-clock and CPU time of a run, and delay
+	 * between the task becoming runnable and the run starting.
+	 */
+	struct time_hist {
+		atomic_size_t buckets[THREAD_HIST_BUCKETS];
+	} real_hist, cpu_hist, delay_hist;
 };
 
 /* Struct timeval's tv_usec one second value.  */
@@ -224,6 +287,17 @@ extern struct thread_master *thread_master_create(const char *);
 void thread_master_set_name(struct thread_master *master, const char *name);
 extern void thread_master_free(struct thread_master *);
 extern void thread_master_free_unused(struct thread_master *);
+/* Switch the I/O backend; only possible while no I/O tasks are scheduled.
+ * Returns 0 on success, -1 on failure (master keeps its current backend).
+ */
+extern int thread_master_set_io_backend(struct thread_master *m,
+					enum thread_io_backend backend);
+extern const char *thread_io_backend_name(enum thread_io_backend backend);
+/* Coarse timers use the timing wheel by default; disabling it makes new
+ * timers go to the timer heap regardless of their duration.
+ */
+extern void thread_master_set_timer_wheel(struct thread_master *m,
+					  bool enable);
 
 extern void _thread_add_read_write(const struct xref_threadsched *xref,
 				   struct thread_master *master,
@@ -41,6 +41,16 @@ static struct list *work_queues = &_work_queues;
 
 #define WORK_QUEUE_MIN_GRANULARITY 1
 
+/* Adaptive mode: number of yield checks aimed for during a run, so that the
+ * cost of an item can vary somewhat without overshooting the target.
+ */
+#define WQ_ADAPTIVE_CHECKS 4
+
+/* Adaptive mode: weight of the previous average in the item cost, in 1/8 */
+#define WQ_ADAPTIVE_COST_WEIGHT 7
+
+#define WQ_ADAPTIVE_MAX_BATCH 100000
+
 static struct work_queue_item *work_queue_item_new(struct work_queue *wq)
 {
 	struct work_queue_item *item;
@@ -182,6 +192,7 @@ DEFUN (show_work_queues,
 {
 	struct listnode *node;
 	struct work_queue *wq;
+	unsigned int i;
 
 	vty_out(vty, "%c %8s %5s %8s %8s %21s\n", ' ', "List", "(ms) ",
 		"Q. Runs", "Yields", "Cycle Counts   ");
@@ -200,6 +211,35 @@ DEFUN (show_work_queues,
 			wq->name);
 	}
 
+	vty_out(vty, "\nRun durations (us):\n");
+
+	for (ALL_LIST_ELEMENTS_RO(work_queues, node, wq)) {
+		if (wq->runs == 0)
+			continue;
+
+		vty_out(vty, "  %s", wq->name);
+		if (wq->spec.max_latency)
+			vty_out(vty,
+				" (adaptive, target %lu, batch %u, item %" PRIu64
+				"ns)",
+				wq->spec.max_latency, wq->adaptive.batch,
+				wq->adaptive.item_cost);
+		vty_out(vty, ":");
+
+		for (i = 0; i < WORK_QUEUE_HIST_BUCKETS; i++) {
+			if (wq->run_hist[i] == 0)
+				continue;
+
+			if (i == WORK_QUEUE_HIST_BUCKETS - 1)
+				vty_out(vty, " >=%lu:%lu", 1UL << (i - 1),
+					wq->run_hist[i]);
+			else
+				vty_out(vty, " <%lu:%lu", 1UL << i,
+					wq->run_hist[i]);
+		}
+		vty_out(vty, "\n");
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -229,6 +269,44 @@ void work_queue_unplug(struct work_queue *wq)
 	work_queue_schedule(wq, wq->spec.hold);
 }
 
+static unsigned int work_queue_hist_bucket(unsigned long usecs)
+{
+	unsigned int bucket = 0;
+
+	while (usecs && bucket < WORK_QUEUE_HIST_BUCKETS - 1) {
+		usecs >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/* Adaptive mode: update the average cost of an item after a run, and
+ * derive from it how many items can be processed between yield checks.
+ */
+static void work_queue_adapt(struct work_queue *wq, unsigned int cycles,
+			     unsigned long realtime)
+{
+	uint64_t cost, batch;
+
+	if (cycles == 0)
+		return;
+
+	cost = (uint64_t)realtime * 1000 / cycles;
+	if (wq->adaptive.item_cost)
+		cost = (wq->adaptive.item_cost * WQ_ADAPTIVE_COST_WEIGHT
+			+ cost) / (WQ_ADAPTIVE_COST_WEIGHT + 1);
+	wq->adaptive.item_cost = cost ? cost : 1;
+
+	batch = (uint64_t)wq->spec.max_latency * 1000
+		/ (wq->adaptive.item_cost * WQ_ADAPTIVE_CHECKS);
+	if (batch < WORK_QUEUE_MIN_GRANULARITY)
+		batch = WORK_QUEUE_MIN_GRANULARITY;
+	else if (batch > WQ_ADAPTIVE_MAX_BATCH)
+		batch = WQ_ADAPTIVE_MAX_BATCH;
+	wq->adaptive.batch = batch;
+}
+
 /* timer thread to process a work queue
  * will reschedule itself if required,
  * otherwise work_queue_item_add
@@ -240,11 +318,15 @@ void work_queue_run(struct thread *thread)
 	wq_item_status ret = WQ_SUCCESS;
 	unsigned int cycles = 0;
 	char yielded = 0;
+	RUSAGE_T start, now;
+	unsigned long realtime, cputime;
 
 	wq = THREAD_ARG(thread);
 
 	assert(wq);
 
+	GETRUSAGE(&start);
+
 	/* calculate cycle granularity:
 	 * list iteration == 1 run
 	 * listnode processing == 1 cycle
@@ -267,6 +349,14 @@ void work_queue_run(struct thread *thread)
 	if (wq->cycles.granularity == 0)
 		wq->cycles.granularity = WORK_QUEUE_MIN_GRANULARITY;
 
+	/* In adaptive mode, 'batch' replaces the granularity: it is the
+	 * number of items expected to take a fraction of the latency target.
+	 * Each time a batch is done, yield unless the next one still fits in
+	 * the target at the rate measured so far.
+	 */
+	if (wq->adaptive.batch == 0)
+		wq->adaptive.batch = WORK_QUEUE_MIN_GRANULARITY;
+
 	STAILQ_FOREACH_SAFE (item, &wq->items, wq, titem) {
 		assert(item->data);
 
@@ -333,14 +423,31 @@ void work_queue_run(struct thread *thread)
 		cycles++;
 
 		/* test if we should yield */
-		if (!(cycles % wq->cycles.granularity)
-		    && thread_should_yield(thread)) {
+		if (wq->spec.max_latency) {
+			if (cycles % wq->adaptive.batch)
+				continue;
+
+			GETRUSAGE(&now);
+			realtime = thread_consumed_time(&now, &start, &cputime);
+			if (realtime + realtime * wq->adaptive.batch / cycles
+			    > wq->spec.max_latency) {
+				yielded = 1;
+				goto stats;
+			}
+		} else if (!(cycles % wq->cycles.granularity)
+			   && thread_should_yield(thread)) {
 			yielded = 1;
 			goto stats;
 		}
 	}
 
 stats:
+	GETRUSAGE(&now);
+	realtime = thread_consumed_time(&now, &start, &cputime);
+	wq->run_hist[work_queue_hist_bucket(realtime)]++;
+
+	if (wq->spec.max_latency)
+		work_queue_adapt(wq, cycles, realtime);
 
 #define WQ_HYSTERESIS_FACTOR 4
 
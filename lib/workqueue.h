@@ -38,6 +38,12 @@ DECLARE_MTYPE(WORK_QUEUE);
 /* Retry for queue that is 'blocked' or 'retry later' */
 #define WORK_QUEUE_DEFAULT_RETRY 0
 
+/* Buckets of the run duration histogram, bucket n counts runs shorter than
+ * 2^n microseconds (and not counted in a lower bucket), the last one all
+ * longer runs.
+ */
+#define WORK_QUEUE_HIST_BUCKETS 22
+
 /* action value, for use by item processor and item error handlers */
 typedef enum {
 	WQ_SUCCESS = 0,
@@ -100,6 +106,13 @@ struct work_queue {
 			yield; /* yield time in us for associated thread */
 
 		uint32_t retry; /* Optional retry timeout if queue is blocked */
+
+		/* Adaptive mode, if non-zero: max time in us a run should
+		 * take. The number of items processed between yield checks
+		 * is then derived from the measured cost of an item, rather
+		 * than from yield and the cycle granularity.
+		 */
+		unsigned long max_latency;
 	} spec;
 
 	/* remaining fields should be opaque to users */
@@ -115,6 +128,14 @@ struct work_queue {
 		unsigned long total;
 	} cycles; /* cycle counts */
 
+	struct {
+		uint64_t item_cost; /* average wall time per item, in ns */
+		unsigned int batch; /* items between yield checks */
+	} adaptive;
+
+	/* duration of runs */
+	unsigned long run_hist[WORK_QUEUE_HIST_BUCKETS];
+
 	/* private state */
 	uint16_t flags; /* user set flag */
 };
@@ -42,6 +42,11 @@
 #include "srte.h"
 #include "printfrr.h"
 #include "srv6.h"
+#include "shmring.h"
+#include "libfrr.h"
+
+/* How long to wait for zebra to make room in the shared memory ring. */
+#define ZCLIENT_RING_RETRY_MSEC 10
 
 DEFINE_MTYPE_STATIC(LIB, ZCLIENT, "Zclient");
 DEFINE_MTYPE_STATIC(LIB, REDIST_INST, "Redistribution instance IDs");
@@ -56,7 +61,8 @@ static void zebra_interface_if_set_value(struct stream *s,
 					 struct interface *ifp);
 
 struct zclient_options zclient_options_default = {.receive_notify = false,
-						  .synchronous = false};
+						  .synchronous = false,
+						  .shm_ring = false};
 
 struct sockaddr_storage zclient_addr;
 socklen_t zclient_addr_len;
@@ -85,6 +91,9 @@ struct zclient *zclient_new(struct thread_master *master,
 
 	zclient->receive_notify = opt->receive_notify;
 	zclient->synchronous = opt->synchronous;
+	zclient->shm_ring = opt->shm_ring;
+	if (zclient->shm_ring)
+		zclient->ring_pending = stream_fifo_new();
 
 	return zclient;
 }
@@ -102,6 +111,10 @@ void zclient_free(struct zclient *zclient)
 		stream_free(zclient->obuf);
 	if (zclient->wb)
 		buffer_free(zclient->wb);
+	if (zclient->ring_pending)
+		stream_fifo_free(zclient->ring_pending);
+	if (zclient->bulk)
+		stream_free(zclient->bulk);
 
 	XFREE(MTYPE_ZCLIENT, zclient);
 }
@@ -177,14 +190,27 @@ void zclient_stop(struct zclient *zclient)
 	THREAD_OFF(zclient->t_read);
 	THREAD_OFF(zclient->t_connect);
 	THREAD_OFF(zclient->t_write);
+	THREAD_OFF(zclient->t_ring);
+	THREAD_OFF(zclient->t_bulk);
 
 	/* Reset streams. */
 	stream_reset(zclient->ibuf);
 	stream_reset(zclient->obuf);
+	zclient->bulk_count = 0;
 
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
 
+	/* Drop the shared memory ring, zebra does the same on its side. */
+	if (zclient->ring) {
+		shmring_del(zclient->ring);
+		zclient->ring = NULL;
+		zclient->ring_active = false;
+		stream_free(zclient->ring_wakeup);
+		zclient->ring_wakeup = NULL;
+		stream_fifo_clean(zclient->ring_pending);
+	}
+
 	/* Close socket. */
 	if (zclient->sock >= 0) {
 		close(zclient->sock);
@@ -291,18 +317,86 @@ static void zclient_flush_data(struct thread *thread)
 }
 
 /*
- * Returns:
- * ZCLIENT_SEND_FAILED   - is a failure
- * ZCLIENT_SEND_SUCCESS  - means we sent data to zebra
- * ZCLIENT_SEND_BUFFERED - means we are buffering
+ * Wake zebra up if it went to sleep after emptying the shared memory ring.
  */
-enum zclient_send_status zclient_send_message(struct zclient *zclient)
+static enum zclient_send_status zclient_ring_wakeup(struct zclient *zclient)
+{
+	if (!shmring_wakeup(zclient->ring))
+		return ZCLIENT_SEND_SUCCESS;
+
+	switch (buffer_write(zclient->wb, zclient->sock,
+			     STREAM_DATA(zclient->ring_wakeup),
+			     stream_get_endp(zclient->ring_wakeup))) {
+	case BUFFER_ERROR:
+		flog_err(EC_LIB_ZAPI_SOCKET,
+			 "%s: buffer_write failed to zclient fd %d, closing",
+			 __func__, zclient->sock);
+		return zclient_failed(zclient);
+	case BUFFER_EMPTY:
+		break;
+	case BUFFER_PENDING:
+		thread_add_write(zclient->master, zclient_flush_data, zclient,
+				 zclient->sock, &zclient->t_write);
+		break;
+	}
+
+	return ZCLIENT_SEND_SUCCESS;
+}
+
+/* Retry putting messages that did not fit into the ring. */
+static void zclient_ring_flush(struct thread *thread)
+{
+	struct zclient *zclient = THREAD_ARG(thread);
+	struct stream *s;
+
+	while ((s = stream_fifo_head(zclient->ring_pending))) {
+		if (!shmring_put(zclient->ring, STREAM_DATA(s),
+				 stream_get_endp(s)))
+			break;
+
+		stream_free(stream_fifo_pop(zclient->ring_pending));
+	}
+
+	if (zclient_ring_wakeup(zclient) == ZCLIENT_SEND_FAILURE)
+		return;
+
+	if (stream_fifo_head(zclient->ring_pending)) {
+		thread_add_timer_msec(zclient->master, zclient_ring_flush,
+				      zclient, ZCLIENT_RING_RETRY_MSEC,
+				      &zclient->t_ring);
+		return;
+	}
+
+	if (zclient->zebra_buffer_write_ready)
+		(*zclient->zebra_buffer_write_ready)();
+}
+
+static enum zclient_send_status zclient_ring_send(struct zclient *zclient,
+						  struct stream *s)
+{
+	if (!stream_fifo_head(zclient->ring_pending)
+	    && shmring_put(zclient->ring, STREAM_DATA(s), stream_get_endp(s)))
+		return zclient_ring_wakeup(zclient);
+
+	/*
+	 * zebra is lagging behind, it does not need a wakeup since there is
+	 * data in the ring.  Retry later.
+	 */
+	stream_fifo_push(zclient->ring_pending, stream_dup(s));
+	thread_add_timer_msec(zclient->master, zclient_ring_flush, zclient,
+			      ZCLIENT_RING_RETRY_MSEC, &zclient->t_ring);
+	return ZCLIENT_SEND_BUFFERED;
+}
+
+static enum zclient_send_status zclient_send_stream(struct zclient *zclient,
+						    struct stream *s)
 {
 	if (zclient->sock < 0)
 		return ZCLIENT_SEND_FAILURE;
-	switch (buffer_write(zclient->wb, zclient->sock,
-			     STREAM_DATA(zclient->obuf),
-			     stream_get_endp(zclient->obuf))) {
+	if (zclient->ring_active)
+		return zclient_ring_send(zclient, s);
+	switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+			     stream_get_endp(s))) {
 	case BUFFER_ERROR:
 		flog_err(EC_LIB_ZAPI_SOCKET,
 			 "%s: buffer_write failed to zclient fd %d, closing",
@@ -321,6 +415,25 @@ enum zclient_send_status zclient_send_message(struct zclient *zclient)
 	return ZCLIENT_SEND_SUCCESS;
 }
 
+/*
+ * Returns:
+ * ZCLIENT_SEND_FAILED   - is a failure
+ * ZCLIENT_SEND_SUCCESS  - means we sent data to zebra
+ * ZCLIENT_SEND_BUFFERED - means we are buffering
+ */
+enum zclient_send_status zclient_send_message(struct zclient *zclient)
+{
+	/*
+	 * Routes held back for a bulk message go first.  If they got
+	 * buffered, so does this message.
+	 */
+	if (zclient->bulk_count
+	    && zclient_route_bulk_flush(zclient) == ZCLIENT_SEND_FAILURE)
+		return ZCLIENT_SEND_FAILURE;
+
+	return zclient_send_stream(zclient, zclient->obuf);
+}
+
 /*
  * If we add more data to this structure please ensure that
  * struct zmsghdr in lib/zclient.h is updated as appropriate.
@@ -393,6 +506,73 @@ static enum zclient_send_status zebra_message_send(struct zclient *zclient,
 	return zclient_send_message(zclient);
 }
 
+/*
+ * Offer zebra a shared memory ring for our messages.  The socket is used
+ * until zebra confirmed that it attached to the ring.
+ */
+static enum zclient_send_status zclient_ring_setup(struct zclient *zclient)
+{
+	static unsigned int ring_id;
+	char name[ZEBRA_SHM_RING_NAMSIZ];
+	char path[MAXPATHLEN];
+	struct stream *s;
+
+	snprintf(name, sizeof(name), ZEBRA_SHM_RING_PREFIX "%ld.%u",
+		 (long)getpid(), ++ring_id);
+	snprintf(path, sizeof(path), "%s/%s", frr_vtydir, name);
+
+	zclient->ring = shmring_create(path, ZEBRA_SHM_RING_SIZE);
+	if (!zclient->ring) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "%s: cannot create shared memory ring %s: %s",
+			     __func__, path, safe_strerror(errno));
+		return ZCLIENT_SEND_SUCCESS;
+	}
+
+	zclient->ring_wakeup = stream_new(ZEBRA_HEADER_SIZE);
+	zclient_create_header(zclient->ring_wakeup, ZEBRA_SHM_RING_WAKEUP,
+			      VRF_DEFAULT);
+
+	s = zclient->obuf;
+	stream_reset(s);
+
+	zclient_create_header(s, ZEBRA_SHM_RING_SETUP, VRF_DEFAULT);
+	stream_putw(s, strlen(name));
+	stream_put(s, name, strlen(name));
+
+	stream_putw_at(s, 0, stream_get_endp(s));
+	return zclient_send_message(zclient);
+}
+
+/* zebra's answer to the ring setup, from now on the ring is used */
+static int zclient_ring_setup_reply(ZAPI_CALLBACK_ARGS)
+{
+	struct stream *s = zclient->ibuf;
+	uint8_t accepted;
+
+	STREAM_GETC(s, accepted);
+
+	if (!zclient->ring)
+		return 0;
+
+	if (!accepted) {
+		zlog_info("%s: zebra did not attach to the shared memory ring",
+			  __func__);
+		shmring_del(zclient->ring);
+		zclient->ring = NULL;
+		stream_free(zclient->ring_wakeup);
+		zclient->ring_wakeup = NULL;
+		return 0;
+	}
+
+	if (zclient_debug)
+		zlog_debug("zclient %p uses a shared memory ring", zclient);
+	zclient->ring_active = true;
+
+stream_failure:
+	return 0;
+}
+
 enum zclient_send_status zclient_send_hello(struct zclient *zclient)
 {
 	struct stream *s;
@@ -416,7 +596,13 @@ enum zclient_send_status zclient_send_hello(struct zclient *zclient)
 			stream_putc(s, 0);
 
 		stream_putw_at(s, 0, stream_get_endp(s));
-		return zclient_send_message(zclient);
+		if (zclient_send_message(zclient) == ZCLIENT_SEND_FAILURE)
+			return ZCLIENT_SEND_FAILURE;
+
+		if (zclient->shm_ring && !zclient->synchronous)
+			return zclient_ring_setup(zclient);
+
+		return ZCLIENT_SEND_SUCCESS;
 	}
 
 	return ZCLIENT_SEND_SUCCESS;
@@ -831,6 +1017,104 @@ zclient_route_send(uint8_t cmd, struct zclient *zclient, struct zapi_route *api)
 	return zclient_send_message(zclient);
 }
 
+/* Largest prefix of a bulk message: family, length and an IPv6 address */
+#define ZAPI_ROUTE_BULK_PREFIX_MAX (2 + IPV6_MAX_BYTELEN)
+
+static int zapi_route_encode_body(struct stream *s, struct zapi_route *api,
+				  bool bulk);
+
+static void zclient_route_bulk_event(struct thread *thread)
+{
+	struct zclient *zclient = THREAD_ARG(thread);
+
+	zclient_route_bulk_flush(zclient);
+}
+
+enum zclient_send_status zclient_route_bulk_flush(struct zclient *zclient)
+{
+	struct stream *s = zclient->bulk;
+
+	THREAD_OFF(zclient->t_bulk);
+	if (!zclient->bulk_count)
+		return ZCLIENT_SEND_SUCCESS;
+
+	stream_putw_at(s, zclient->bulk_countp, zclient->bulk_count);
+	stream_putw_at(s, 0, stream_get_endp(s));
+	zclient->bulk_count = 0;
+
+	return zclient_send_stream(zclient, s);
+}
+
+enum zclient_send_status zclient_route_bulk_send(uint8_t cmd,
+						 struct zclient *zclient,
+						 struct zapi_route *api)
+{
+	enum zclient_send_status ret = ZCLIENT_SEND_SUCCESS;
+	struct stream *s = zclient->obuf;
+	struct stream *bulk;
+	size_t len;
+
+	if ((cmd != ZEBRA_ROUTE_ADD && cmd != ZEBRA_ROUTE_DELETE)
+	    || CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX) || !zclient->master)
+		return zclient_route_send(cmd, zclient, api);
+
+	/*
+	 * Encode what the route shares with others into obuf, so it can be
+	 * compared with what the pending bulk message carries.
+	 */
+	stream_reset(s);
+	zclient_create_header(s,
+			      cmd == ZEBRA_ROUTE_ADD ? ZEBRA_ROUTE_BULK_ADD
+						     : ZEBRA_ROUTE_BULK_DELETE,
+			      api->vrf_id);
+	if (zapi_route_encode_body(s, api, true) < 0)
+		return ZCLIENT_SEND_FAILURE;
+	len = stream_get_endp(s);
+
+	if (len + 2 + ZAPI_ROUTE_BULK_PREFIX_MAX > STREAM_SIZE(s))
+		return zclient_route_send(cmd, zclient, api);
+
+	/* The length in the header is not filled in yet, skip it */
+	if (zclient->bulk_count
+	    && (zclient->bulk_countp != len
+		|| memcmp(STREAM_DATA(zclient->bulk) + 2, STREAM_DATA(s) + 2,
+			  len - 2))) {
+		ret = zclient_route_bulk_flush(zclient);
+		if (ret == ZCLIENT_SEND_FAILURE)
+			return ret;
+	}
+
+	if (!zclient->bulk)
+		zclient->bulk = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	bulk = zclient->bulk;
+
+	if (!zclient->bulk_count) {
+		stream_reset(bulk);
+		stream_put(bulk, STREAM_DATA(s), len);
+		zclient->bulk_countp = len;
+		stream_putw(bulk, 0);
+		thread_add_event(zclient->master, zclient_route_bulk_event,
+				 zclient, 0, &zclient->t_bulk);
+	}
+
+	stream_putc(bulk, api->prefix.family);
+	stream_putc(bulk, api->prefix.prefixlen);
+	stream_write(bulk, &api->prefix.u.prefix,
+		     PSIZE(api->prefix.prefixlen));
+	zclient->bulk_count++;
+
+	if (STREAM_WRITEABLE(bulk) < ZAPI_ROUTE_BULK_PREFIX_MAX
+	    || zclient->bulk_count == UINT16_MAX) {
+		enum zclient_send_status fret;
+
+		fret = zclient_route_bulk_flush(zclient);
+		if (fret != ZCLIENT_SEND_SUCCESS)
+			ret = fret;
+	}
+
+	return ret;
+}
+
 static int zapi_nexthop_labels_cmp(const struct zapi_nexthop *next1,
 				   const struct zapi_nexthop *next2)
 {
@@ -1200,15 +1484,17 @@ enum zclient_send_status zclient_nhg_send(struct zclient *zclient, int cmd,
 	return zclient_send_message(zclient);
 }
 
-int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+/*
+ * Encode a route after the header.  Bulk messages leave the prefix out, it
+ * follows everything the routes share.
+ */
+static int zapi_route_encode_body(struct stream *s, struct zapi_route *api,
+				  bool bulk)
 {
 	struct zapi_nexthop *api_nh;
 	int i;
 	int psize;
 
-	stream_reset(s);
-	zclient_create_header(s, cmd, api->vrf_id);
-
 	if (api->type >= ZEBRA_ROUTE_MAX) {
 		flog_err(EC_LIB_ZAPI_ENCODE,
 			 "%s: Specified route type (%u) is not a legal value",
@@ -1230,10 +1516,12 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 	stream_putc(s, api->safi);
 
 	/* Put prefix information. */
-	stream_putc(s, api->prefix.family);
-	psize = PSIZE(api->prefix.prefixlen);
-	stream_putc(s, api->prefix.prefixlen);
-	stream_write(s, &api->prefix.u.prefix, psize);
+	if (!bulk) {
+		stream_putc(s, api->prefix.family);
+		psize = PSIZE(api->prefix.prefixlen);
+		stream_putc(s, api->prefix.prefixlen);
+		stream_write(s, &api->prefix.u.prefix, psize);
+	}
 
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		psize = PSIZE(api->src_prefix.prefixlen);
@@ -1347,6 +1635,18 @@ int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
 		stream_putw(s, api->opaque.length);
 		stream_write(s, api->opaque.data, api->opaque.length);
 	}
+
+	return 0;
+}
+
+int zapi_route_encode(uint8_t cmd, struct stream *s, struct zapi_route *api)
+{
+	stream_reset(s);
+	zclient_create_header(s, cmd, api->vrf_id);
+
+	if (zapi_route_encode_body(s, api, false) < 0)
+		return -1;
+
 	/* Put length at the first point of the stream. */
 	stream_putw_at(s, 0, stream_get_endp(s));
 
@@ -1443,7 +1743,44 @@ stream_failure:
 	return ret;
 }
 
-int zapi_route_decode(struct stream *s, struct zapi_route *api)
+static int zapi_route_decode_prefix(struct stream *s, struct prefix *p)
+{
+	STREAM_GETC(s, p->family);
+	STREAM_GETC(s, p->prefixlen);
+	switch (p->family) {
+	case AF_INET:
+		if (p->prefixlen > IPV4_MAX_BITLEN) {
+			flog_err(
+				EC_LIB_ZAPI_ENCODE,
+				"%s: V4 prefixlen is %d which should not be more than 32",
+				__func__, p->prefixlen);
+			return -1;
+		}
+		break;
+	case AF_INET6:
+		if (p->prefixlen > IPV6_MAX_BITLEN) {
+			flog_err(
+				EC_LIB_ZAPI_ENCODE,
+				"%s: v6 prefixlen is %d which should not be more than 128",
+				__func__, p->prefixlen);
+			return -1;
+		}
+		break;
+	default:
+		flog_err(EC_LIB_ZAPI_ENCODE,
+			 "%s: Specified family %d is not v4 or v6", __func__,
+			 p->family);
+		return -1;
+	}
+	STREAM_GET(&p->u.prefix, s, PSIZE(p->prefixlen));
+
+	return 0;
+stream_failure:
+	return -1;
+}
+
+static int zapi_route_decode_body(struct stream *s, struct zapi_route *api,
+				  bool bulk)
 {
 	struct zapi_nexthop *api_nh;
 	int i;
@@ -1470,37 +1807,17 @@ int zapi_route_decode(struct stream *s, struct zapi_route *api)
 		return -1;
 	}
 
-	/* Prefix. */
-	STREAM_GETC(s, api->prefix.family);
-	STREAM_GETC(s, api->prefix.prefixlen);
-	switch (api->prefix.family) {
-	case AF_INET:
-		if (api->prefix.prefixlen > IPV4_MAX_BITLEN) {
-			flog_err(
-				EC_LIB_ZAPI_ENCODE,
-				"%s: V4 prefixlen is %d which should not be more than 32",
-				__func__, api->prefix.prefixlen);
-			return -1;
-		}
-		break;
-	case AF_INET6:
-		if (api->prefix.prefixlen > IPV6_MAX_BITLEN) {
-			flog_err(
-				EC_LIB_ZAPI_ENCODE,
-				"%s: v6 prefixlen is %d which should not be more than 128",
-				__func__, api->prefix.prefixlen);
-			return -1;
-		}
-		break;
-	default:
-		flog_err(EC_LIB_ZAPI_ENCODE,
-			 "%s: Specified family %d is not v4 or v6", __func__,
-			 api->prefix.family);
+	/* Prefix, bulk messages carry it later. */
+	if (!bulk && zapi_route_decode_prefix(s, &api->prefix) < 0)
 		return -1;
-	}
-	STREAM_GET(&api->prefix.u.prefix, s, PSIZE(api->prefix.prefixlen));
 
 	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
+		if (bulk) {
+			flog_err(EC_LIB_ZAPI_ENCODE,
+				 "%s: SRC prefix in a bulk message", __func__);
+			return -1;
+		}
+
 		api->src_prefix.family = AF_INET6;
 		STREAM_GETC(s, api->src_prefix.prefixlen);
 		if (api->src_prefix.prefixlen > IPV6_MAX_BITLEN) {
@@ -1596,6 +1913,36 @@ stream_failure:
 	return -1;
 }
 
+int zapi_route_decode(struct stream *s, struct zapi_route *api)
+{
+	return zapi_route_decode_body(s, api, false);
+}
+
+/*
+ * Decode what the routes of a ZEBRA_ROUTE_BULK_ADD or
+ * ZEBRA_ROUTE_BULK_DELETE message share, and how many there are.  Each
+ * prefix is then read with zapi_route_bulk_decode_prefix().
+ */
+int zapi_route_bulk_decode(struct stream *s, struct zapi_route *api,
+			   uint16_t *count)
+{
+	if (zapi_route_decode_body(s, api, true) < 0)
+		return -1;
+
+	STREAM_GETW(s, *count);
+
+	return 0;
+stream_failure:
+	return -1;
+}
+
+int zapi_route_bulk_decode_prefix(struct stream *s, struct zapi_route *api)
+{
+	memset(&api->prefix, 0, sizeof(api->prefix));
+
+	return zapi_route_decode_prefix(s, &api->prefix);
+}
+
 static void zapi_encode_prefix(struct stream *s, struct prefix *p,
 			       uint8_t family)
 {
@@ -3873,6 +4220,7 @@ static zclient_handler *const lib_handlers[] = {
 	/* fundamentals */
 	[ZEBRA_CAPABILITIES] = zclient_capability_decode,
 	[ZEBRA_ERROR] = zclient_handle_error,
+	[ZEBRA_SHM_RING_SETUP] = zclient_ring_setup_reply,
 
 	/* VRF & interface code is shared in lib */
 	[ZEBRA_VRF_ADD] = zclient_vrf_add,
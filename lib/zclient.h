@@ -63,6 +63,14 @@ typedef uint16_t zebra_size_t;
 /* Zebra header size. */
 #define ZEBRA_HEADER_SIZE             10
 
+/*
+ * Shared memory ring from a client to zebra: the file, in the runtime
+ * directory, is named after the prefix, the client's pid and a counter.
+ */
+#define ZEBRA_SHM_RING_PREFIX         "zapi-ring."
+#define ZEBRA_SHM_RING_NAMSIZ         64
+#define ZEBRA_SHM_RING_SIZE           (4U * 1024 * 1024)
+
 /* special socket path name to use TCP
  * @ is used as first character because that's abstract socket names on Linux
  */
@@ -239,6 +247,10 @@ typedef enum {
 	ZEBRA_GRE_GET,
 	ZEBRA_GRE_UPDATE,
 	ZEBRA_GRE_SOURCE_SET,
+	ZEBRA_SHM_RING_SETUP,
+	ZEBRA_SHM_RING_WAKEUP,
+	ZEBRA_ROUTE_BULK_ADD,
+	ZEBRA_ROUTE_BULK_DELETE,
 } zebra_message_types_t;
 
 enum zebra_error_types {
@@ -311,6 +323,9 @@ struct zclient {
 	/* BFD enabled with bfd_protocol_integration_init() */
 	bool bfd_integration;
 
+	/* Send messages to zebra through a shared memory ring, if possible */
+	bool shm_ring;
+
 	/* Session id (optional) to support clients with multiple sessions */
 	uint32_t session_id;
 
@@ -336,6 +351,26 @@ struct zclient {
 	/* Thread to write buffered data to zebra. */
 	struct thread *t_write;
 
+	/*
+	 * Shared memory ring, which replaces the socket for messages to zebra
+	 * once zebra attached to it.  Messages that do not fit into the ring
+	 * wait in ring_pending, so that their order is kept.
+	 */
+	struct shmring *ring;
+	bool ring_active;
+	struct stream *ring_wakeup;
+	struct stream_fifo *ring_pending;
+	struct thread *t_ring;
+
+	/*
+	 * Routes differing in their prefix only, waiting to be sent in one
+	 * ZEBRA_ROUTE_BULK_ADD or ZEBRA_ROUTE_BULK_DELETE message.
+	 */
+	struct stream *bulk;
+	uint16_t bulk_count;
+	size_t bulk_countp;
+	struct thread *t_bulk;
+
 	/* Redistribute information. */
 	uint8_t redist_default; /* clients protocol */
 	unsigned short instance;
@@ -811,6 +846,7 @@ enum zebra_neigh_state { ZEBRA_NEIGH_INACTIVE = 0, ZEBRA_NEIGH_ACTIVE = 1 };
 struct zclient_options {
 	bool receive_notify;
 	bool synchronous;
+	bool shm_ring;
 };
 
 extern struct zclient_options zclient_options_default;
@@ -1070,6 +1106,19 @@ extern int zebra_read_pw_status_update(ZAPI_CALLBACK_ARGS,
 
 extern enum zclient_send_status zclient_route_send(uint8_t, struct zclient *,
 						   struct zapi_route *);
+
+/*
+ * Like zclient_route_send(), but the route may be held back and sent along
+ * with the following routes that differ in their prefix only, in a single
+ * ZEBRA_ROUTE_BULK_ADD or ZEBRA_ROUTE_BULK_DELETE message.  Routes held back
+ * are sent before any other message, when the message is full or once the
+ * current task is done, whatever comes first.
+ */
+extern enum zclient_send_status
+zclient_route_bulk_send(uint8_t cmd, struct zclient *zclient,
+			struct zapi_route *api);
+extern enum zclient_send_status
+zclient_route_bulk_flush(struct zclient *zclient);
 extern enum zclient_send_status
 zclient_send_rnh(struct zclient *zclient, int command, const struct prefix *p,
 		 safi_t safi, bool connected, bool resolve_via_default,
@@ -1078,6 +1127,10 @@ int zapi_nexthop_encode(struct stream *s, const struct zapi_nexthop *api_nh,
 			uint32_t api_flags, uint32_t api_message);
 extern int zapi_route_encode(uint8_t, struct stream *, struct zapi_route *);
 extern int zapi_route_decode(struct stream *s, struct zapi_route *api);
+extern int zapi_route_bulk_decode(struct stream *s, struct zapi_route *api,
+				  uint16_t *count);
+extern int zapi_route_bulk_decode_prefix(struct stream *s,
+					 struct zapi_route *api);
 extern int zapi_nexthop_decode(struct stream *s, struct zapi_nexthop *api_nh,
 			       uint32_t api_flags, uint32_t api_message);
 bool zapi_nhg_notify_decode(struct stream *s, uint32_t *id,
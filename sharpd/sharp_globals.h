@@ -74,6 +74,9 @@ struct sharp_global {
 
 	/* list of sharp_srv6_locator */
 	struct list *srv6_locators;
+
+	/* Talk to zebra through a shared memory ring */
+	bool shm_ring;
 };
 
 extern struct sharp_global sg;
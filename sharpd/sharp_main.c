@@ -67,7 +67,12 @@ struct zebra_privs_t sharp_privs = {
 	.cap_num_p = array_size(_caps_p),
 	.cap_num_i = 0};
 
-struct option longopts[] = {{0}};
+#define OPTION_SHM_RING 2000
+
+struct option longopts[] = {
+	{"shm-ring", no_argument, NULL, OPTION_SHM_RING},
+	{0}
+};
 
 /* Master of threads. */
 struct thread_master *master;
@@ -155,8 +160,11 @@ static void sharp_end_configuration(void)
 
 int main(int argc, char **argv, char **envp)
 {
+	bool shm_ring = false;
+
 	frr_preinit(&sharpd_di, argc, argv);
-	frr_opt_add("", longopts, "");
+	frr_opt_add("", longopts,
+		    "      --shm-ring      Send messages to zebra through a shared memory ring\n");
 
 	while (1) {
 		int opt;
@@ -169,6 +177,9 @@ int main(int argc, char **argv, char **envp)
 		switch (opt) {
 		case 0:
 			break;
+		case OPTION_SHM_RING:
+			shm_ring = true;
+			break;
 		default:
 			frr_help_exit(1);
 		}
@@ -179,6 +190,7 @@ int main(int argc, char **argv, char **envp)
 	cmd_init_config_callbacks(sharp_start_configuration,
 				  sharp_end_configuration);
 	sharp_global_init();
+	sg.shm_ring = shm_ring;
 
 	sharp_nhgroup_init();
 	vrf_init(NULL, NULL, NULL, NULL);
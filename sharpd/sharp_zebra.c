@@ -302,7 +302,7 @@ static bool route_add(const struct prefix *p, vrf_id_t vrf_id, uint8_t instance,
 		memcpy(api.opaque.data, opaque, api.opaque.length);
 	}
 
-	if (zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api)
+	if (zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api)
 	    == ZCLIENT_SEND_BUFFERED)
 		return true;
 	else
@@ -326,7 +326,7 @@ static bool route_delete(struct prefix *p, vrf_id_t vrf_id, uint8_t instance)
 	api.instance = instance;
 	memcpy(&api.prefix, p, sizeof(*p));
 
-	if (zclient_route_send(ZEBRA_ROUTE_DELETE, zclient, &api)
+	if (zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api)
 	    == ZCLIENT_SEND_BUFFERED)
 		return true;
 	else
@@ -997,7 +997,8 @@ static zclient_handler *const sharp_handlers[] = {
 
 void sharp_zebra_init(void)
 {
-	struct zclient_options opt = {.receive_notify = true};
+	struct zclient_options opt = {.receive_notify = true,
+				      .shm_ring = sg.shm_ring};
 
 	if_zapi_callbacks(sharp_ifp_create, sharp_ifp_up,
 			  sharp_ifp_down, sharp_ifp_destroy);
@@ -888,6 +888,25 @@ static struct aspath *make_aspath(const uint8_t *data, size_t len, int use32bit)
 	return as;
 }
 
+/* same as make_aspath(), going through the pre-parse path */
+static struct aspath *make_aspath_prepared(const uint8_t *data, size_t len,
+					   int use32bit)
+{
+	struct stream *s = NULL;
+	struct aspath *as;
+
+	if (len) {
+		s = stream_new(len);
+		stream_put(s, data, len);
+	}
+	as = aspath_parse_prepare(s, len, use32bit);
+
+	if (s)
+		stream_free(s);
+
+	return as ? aspath_intern_prepared(as) : NULL;
+}
+
 static void printbytes(const uint8_t *bytes, int len)
 {
 	int i = 0;
@@ -1047,15 +1066,21 @@ static void empty_get_test(void)
 /* basic parsing test */
 static void parse_test(struct test_segment *t)
 {
-	struct aspath *asp;
+	struct aspath *asp, *asprep;
 
 	printf("%s: %s\n", t->name, t->desc);
 
 	asp = make_aspath(t->asdata, t->len, 0);
+	asprep = make_aspath_prepared(t->asdata, t->len, 0);
 
 	printf("aspath: %s\nvalidating...:\n", aspath_print(asp));
 
-	if (!validate(asp, &t->sp))
+	/* pre-parsing must end up with the very same interned aspath */
+	if (asprep != asp) {
+		failed++;
+		printf("pre-parsed aspath differs: %s\n", aspath_print(asprep));
+		printf(FAILED "\n");
+	} else if (!validate(asp, &t->sp))
 		printf(OK "\n");
 	else
 		printf(FAILED "\n");
@@ -1063,6 +1088,8 @@ static void parse_test(struct test_segment *t)
 	printf("\n");
 
 	aspath_unintern(&asp);
+	if (asprep)
+		aspath_unintern(&asprep);
 }
 
 /* prepend testing */
@@ -1228,7 +1255,7 @@ static int handle_attr_test(struct aspath_tests *t)
 	asp = make_aspath(t->segment->asdata, t->segment->len, 0);
 
 	peer.curr = stream_new(BGP_MAX_PACKET_SIZE);
-	peer.obuf = stream_fifo_new();
+	peer.obuf = bgp_obuf_new();
 	peer.bgp = &bgp;
 	peer.host = (char *)"none";
 	peer.fd = -1;
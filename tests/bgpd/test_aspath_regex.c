@@ -0,0 +1,262 @@
+/*
+ * Test program which checks that AS path regexes give the same results as
+ * regexec() on the AS path string, and compares how fast both are.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+
+#include "privs.h"
+#include "qobj.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_regex.h"
+
+#define NUM_ASPATHS 20000
+/* times each AS path is matched, e.g. once per peer of a route server */
+#define ROUNDS 5
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+/* Expressions seen in as-path access-lists, with whether they are expected
+ * to be handled by regexec()
+ */
+static const struct {
+	const char *regex;
+	bool posix;
+} regexes[] = {
+	{"^$"},
+	{".*"},
+	{"_3356_"},
+	{"^174_"},
+	{"_2914$"},
+	{"^65001$"},
+	{"_13335"},
+	{"^(174|3356|1299)_"},
+	{"_(6939|2914)_.*_(3356|174)_"},
+	{"_6451[2-9]_"},
+	{"_6[4-5][0-9][0-9][0-9]_"},
+	{"_42[0-9]{8}_"},
+	{"_[0-9]{6,}_"},
+	{"^[0-9]+$"},
+	{"^[0-9]+_[0-9]+$"},
+	{"^([0-9]+_){0,2}[0-9]+$"},
+	{"^65001(_65001)*_"},
+	{"^64512 64512 64512"},
+	{"_1299_1299_"},
+	{"[^0-9 ]"},
+	{"\\{"},
+	{"_65010,"},
+	{"^\\(65"},
+	{"[]{}]"},
+	{"^[-0-9 ]+$"},
+	{"1.*2.*3"},
+	{"^174_?3356?_"},
+	{"(^|_)174($|_)"},
+	{"x|"},
+	{"^$|_8075_"},
+	{"(_[0-9]+)+$"},
+	{"3356$|^$"},
+	{"_.*_.*_.*_.*_.*_.*_"},
+	{"_23456_"},
+	/* back references */
+	{"^([0-9]+)(_\\1)+$", true},
+	{"[[:digit:]]{6}", true},
+};
+
+/* Frequently seen transit and content networks */
+static const as_t asns[] = {
+	174,	209,	701,	1239,	1273,	1299,	2497,	2828,
+	2914,	3257,	3320,	3356,	3491,	3549,	4134,	4637,
+	4755,	5511,	6453,	6461,	6539,	6762,	6830,	6939,
+	7018,	7473,	7922,	8075,	9002,	12956,	13335,	15169,
+	16509,	20473,	20940,	32934,	36351,	45102,	46489,	57463,
+	64512,	65001,	65010,	65535,	131072,	23456,	4200000000,
+	4294967294,
+};
+
+static struct aspath *aspaths[NUM_ASPATHS];
+static struct aspath *copies[NUM_ASPATHS];
+
+static unsigned int rnd(void)
+{
+	static unsigned int seed = 1;
+
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+static void aspath_make(char *buf, size_t size)
+{
+	unsigned int i, len, prepend;
+	as_t asn;
+	size_t n = 0;
+
+	buf[0] = '\0';
+
+	/* the odd iBGP route */
+	if (rnd() % 50 == 0)
+		return;
+
+	if (rnd() % 10 == 0)
+		n += snprintf(buf + n, size - n, "(65010 %u) ",
+			      65000 + rnd() % 20);
+
+	len = 1 + rnd() % 7;
+	for (i = 0; i < len; i++) {
+		asn = asns[rnd() % array_size(asns)];
+		prepend = rnd() % 8 == 0 ? 1 + rnd() % 4 : 0;
+		do {
+			n += snprintf(buf + n, size - n, "%u ", asn);
+		} while (prepend--);
+	}
+
+	if (rnd() % 20 == 0)
+		n += snprintf(buf + n, size - n, "{%u,%u} ",
+			      asns[rnd() % array_size(asns)],
+			      asns[rnd() % array_size(asns)]);
+
+	buf[n - 1] = '\0';
+}
+
+static unsigned long elapsed_usec(struct timeval *start, struct timeval *stop)
+{
+	return 1000000UL * (stop->tv_sec - start->tv_sec)
+	       + (stop->tv_usec - start->tv_usec);
+}
+
+static void print_rate(const char *what, unsigned long usec)
+{
+	unsigned long n = (unsigned long)ROUNDS * NUM_ASPATHS
+			  * array_size(regexes);
+
+	printf("%-28s %lu.%03lu seconds (%lu ns per match)\n", what,
+	       usec / 1000000, usec / 1000 % 1000, usec * 1000 / n);
+}
+
+int main(void)
+{
+	struct bgp_aspath_regex *re[array_size(regexes)];
+	regex_t *posix[array_size(regexes)];
+	struct timeval tv_start, tv_stop;
+	unsigned long matches, expect = 0, found;
+	unsigned int i, j, r;
+	char buf[256];
+	bool match;
+
+	qobj_init();
+	bgp_master_init(thread_master_create(NULL), BGP_SOCKET_SNDBUF_SIZE,
+			list_new());
+	master = bm->master;
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	for (i = 0; i < NUM_ASPATHS; i++) {
+		aspath_make(buf, sizeof(buf));
+		aspaths[i] = aspath_intern(aspath_str2aspath(buf));
+		/* not interned, so never cached */
+		copies[i] = aspath_dup(aspaths[i]);
+	}
+
+	printf("Validating against regexec()...\n");
+	for (j = 0; j < array_size(regexes); j++) {
+		re[j] = bgp_aspath_regcomp(regexes[j].regex);
+		posix[j] = bgp_regcomp(regexes[j].regex);
+		assert(re[j] && posix[j]);
+		assert(bgp_aspath_regex_is_posix(re[j]) == regexes[j].posix);
+
+		matches = 0;
+		for (i = 0; i < NUM_ASPATHS; i++) {
+			match = regexec(posix[j], aspaths[i]->str, 0, NULL, 0)
+				!= REG_NOMATCH;
+			if (bgp_aspath_regexec(re[j], copies[i]) != match
+			    || bgp_aspath_regexec(re[j], aspaths[i]) != match
+			    || bgp_aspath_regexec(re[j], aspaths[i]) != match) {
+				printf("%s on \"%s\": expected %s\n",
+				       regexes[j].regex, aspaths[i]->str,
+				       match ? "match" : "no match");
+				assert(0);
+			}
+			matches += match;
+		}
+		printf("%-32s %5lu of %u\n", regexes[j].regex, matches,
+		       NUM_ASPATHS);
+		expect += matches;
+	}
+
+	assert(!bgp_aspath_regcomp("(174"));
+	assert(!bgp_aspath_regcomp("174{2,1}"));
+
+	printf("Comparing speed...\n");
+
+	found = 0;
+	monotime(&tv_start);
+	for (i = 0; i < NUM_ASPATHS; i++)
+		for (r = 0; r < ROUNDS; r++)
+			for (j = 0; j < array_size(regexes); j++)
+				found += regexec(posix[j], aspaths[i]->str, 0,
+						 NULL, 0)
+					 != REG_NOMATCH;
+	monotime(&tv_stop);
+	assert(found == expect * ROUNDS);
+	print_rate("regexec():", elapsed_usec(&tv_start, &tv_stop));
+
+	found = 0;
+	monotime(&tv_start);
+	for (i = 0; i < NUM_ASPATHS; i++)
+		for (r = 0; r < ROUNDS; r++)
+			for (j = 0; j < array_size(regexes); j++)
+				found += bgp_aspath_regexec(re[j],
+							    copies[i]);
+	monotime(&tv_stop);
+	assert(found == expect * ROUNDS);
+	print_rate("automaton:", elapsed_usec(&tv_start, &tv_stop));
+
+	found = 0;
+	monotime(&tv_start);
+	for (i = 0; i < NUM_ASPATHS; i++)
+		for (r = 0; r < ROUNDS; r++)
+			for (j = 0; j < array_size(regexes); j++)
+				found += bgp_aspath_regexec(re[j],
+							    aspaths[i]);
+	monotime(&tv_stop);
+	assert(found == expect * ROUNDS);
+	print_rate("automaton, interned paths:",
+		   elapsed_usec(&tv_start, &tv_stop));
+
+	for (j = 0; j < array_size(regexes); j++) {
+		bgp_aspath_regex_free(re[j]);
+		bgp_regex_free(posix[j]);
+	}
+	for (i = 0; i < NUM_ASPATHS; i++) {
+		aspath_unintern(&aspaths[i]);
+		aspath_free(copies[i]);
+	}
+
+	bgp_attr_finish();
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestAspathRegex(frrtest.TestMultiOut):
+    program = "./test_aspath_regex"
+
+
+TestAspathRegex.exit_cleanly()
@@ -0,0 +1,200 @@
+/*
+ * Test program which measures the memory taken up by interned BGP
+ * attributes for a full table worth of distinct attributes, and how long
+ * it takes to intern them.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+
+#include "privs.h"
+#include "qobj.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_ecommunity.h"
+#include "bgpd/bgp_lcommunity.h"
+#include "bgpd/bgp_network.h"
+
+#define NUM_ATTRS 1000000
+#define NUM_ASPATHS 256
+#define NUM_COMMUNITIES 64
+#define NUM_VTEPS 256
+/* one in EVPN_RATIO attributes carries EVPN attributes */
+#define EVPN_RATIO 4
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+static struct aspath *aspaths[NUM_ASPATHS];
+static struct community *communities[NUM_COMMUNITIES];
+static struct ecommunity *ecommunities[NUM_COMMUNITIES];
+static struct lcommunity *lcommunities[NUM_COMMUNITIES];
+static struct attr *attrs[NUM_ATTRS];
+
+static void attr_fill(struct attr *attr, unsigned int i)
+{
+	memset(attr, 0, sizeof(*attr));
+
+	attr->origin = BGP_ORIGIN_IGP;
+	attr->aspath = aspaths[i % NUM_ASPATHS];
+	attr->nexthop.s_addr = htonl(0x0a000000 | (i % NUM_VTEPS));
+	attr->med = i;
+	attr->local_pref = BGP_DEFAULT_LOCAL_PREF;
+	attr->weight = BGP_ATTR_DEFAULT_WEIGHT;
+	attr->label_index = BGP_INVALID_LABEL_INDEX;
+	attr->label = MPLS_INVALID_LABEL;
+	attr->mp_nexthop_len = BGP_ATTR_NHLEN_IPV4;
+	attr->flag = ATTR_FLAG_BIT(BGP_ATTR_ORIGIN)
+		     | ATTR_FLAG_BIT(BGP_ATTR_AS_PATH)
+		     | ATTR_FLAG_BIT(BGP_ATTR_NEXT_HOP)
+		     | ATTR_FLAG_BIT(BGP_ATTR_MULTI_EXIT_DISC)
+		     | ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
+
+	bgp_attr_set_community(attr, communities[i % NUM_COMMUNITIES]);
+	bgp_attr_set_ecommunity(attr, ecommunities[i % NUM_COMMUNITIES]);
+	bgp_attr_set_lcommunity(attr, lcommunities[i % NUM_COMMUNITIES]);
+
+	if (i % EVPN_RATIO == 0) {
+		struct bgp_attr_evpn evpn;
+
+		/* router MAC and gateway IP per VTEP, like type-5 routes */
+		memset(&evpn, 0, sizeof(evpn));
+		evpn.rmac.octet[0] = 0x02;
+		evpn.rmac.octet[5] = i % NUM_VTEPS;
+		evpn.overlay.type = OVERLAY_INDEX_GATEWAY_IP;
+		SET_IPADDR_V4(&evpn.overlay.gw_ip);
+		evpn.overlay.gw_ip.ipaddr_v4 = attr->nexthop;
+		bgp_attr_set_evpn(attr, &evpn);
+	}
+}
+
+static unsigned long elapsed_usec(struct timeval *start, struct timeval *stop)
+{
+	return 1000000UL * (stop->tv_sec - start->tv_sec)
+	       + (stop->tv_usec - start->tv_usec);
+}
+
+int main(void)
+{
+	struct attr attr;
+	struct attr *found;
+	char buf[128];
+	unsigned long n_attr, n_evpn;
+	size_t inline_evpn, bytes, bytes_inline;
+	struct timeval tv_start, tv_lap, tv_stop;
+	unsigned long t_new, t_existing;
+	unsigned int i;
+
+	qobj_init();
+	bgp_master_init(thread_master_create(NULL), BGP_SOCKET_SNDBUF_SIZE,
+			list_new());
+	master = bm->master;
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_community_alias_init();
+
+	for (i = 0; i < NUM_ASPATHS; i++) {
+		snprintf(buf, sizeof(buf), "64512 %u 3356 1299 174 2914 %u",
+			 65000 + i % 16, 100 + i);
+		aspaths[i] = aspath_intern(aspath_str2aspath(buf));
+	}
+	for (i = 0; i < NUM_COMMUNITIES; i++) {
+		snprintf(buf, sizeof(buf),
+			 "64512:%u 64512:1000 64512:2000 3356:%u 65535:666", i,
+			 100 + i);
+		communities[i] = community_intern(community_str2com(buf));
+		snprintf(buf, sizeof(buf), "64512:%u 64512:100", i);
+		ecommunities[i] = ecommunity_intern(
+			ecommunity_str2com(buf, ECOMMUNITY_ROUTE_TARGET, 0));
+		snprintf(buf, sizeof(buf), "64512:1:%u 64512:2:%u", i, i);
+		lcommunities[i] = lcommunity_intern(lcommunity_str2com(buf));
+	}
+
+	monotime(&tv_start);
+
+	for (i = 0; i < NUM_ATTRS; i++) {
+		attr_fill(&attr, i);
+		attrs[i] = bgp_attr_intern(&attr);
+	}
+
+	monotime(&tv_lap);
+
+	/* what every received prefix with an already known attribute costs */
+	for (i = 0; i < NUM_ATTRS; i++) {
+		attr_fill(&attr, i);
+		found = bgp_attr_intern(&attr);
+		assert(found == attrs[i]);
+		bgp_attr_unintern(&found);
+	}
+
+	monotime(&tv_stop);
+
+	t_new = elapsed_usec(&tv_start, &tv_lap);
+	t_existing = elapsed_usec(&tv_lap, &tv_stop);
+
+	n_attr = attr_count();
+	n_evpn = attr_evpn_count();
+	assert(n_attr == NUM_ATTRS);
+	assert(n_evpn == NUM_VTEPS / EVPN_RATIO);
+
+	/* the EVPN fields as they used to be laid out in struct attr */
+	inline_evpn = sizeof(struct bgp_attr_evpn)
+		      - offsetof(struct bgp_attr_evpn, overlay);
+	bytes = n_attr * sizeof(struct attr)
+		+ n_evpn * sizeof(struct bgp_attr_evpn);
+	bytes_inline = n_attr * (sizeof(struct attr)
+				 - sizeof(struct bgp_attr_evpn *)
+				 + inline_evpn);
+
+	printf("struct attr: %zu bytes, struct bgp_attr_evpn: %zu bytes\n",
+	       sizeof(struct attr), sizeof(struct bgp_attr_evpn));
+	printf("%lu attributes, %lu EVPN attributes\n", n_attr, n_evpn);
+	printf("attribute memory: %zu kB, with inline EVPN fields at least %zu kB (%.1f%% saved)\n",
+	       bytes / 1024, bytes_inline / 1024,
+	       100.0 * (bytes_inline - bytes) / bytes_inline);
+	printf("interning %d new attributes took %lu.%03lu seconds (%lu ns each)\n",
+	       NUM_ATTRS, t_new / 1000000, t_new / 1000 % 1000,
+	       t_new * 1000 / NUM_ATTRS);
+	printf("interning %d known attributes took %lu.%03lu seconds (%lu ns each)\n",
+	       NUM_ATTRS, t_existing / 1000000, t_existing / 1000 % 1000,
+	       t_existing * 1000 / NUM_ATTRS);
+
+	for (i = 0; i < NUM_ATTRS; i++)
+		bgp_attr_unintern(&attrs[i]);
+	for (i = 0; i < NUM_ASPATHS; i++)
+		aspath_unintern(&aspaths[i]);
+	for (i = 0; i < NUM_COMMUNITIES; i++) {
+		community_unintern(&communities[i]);
+		ecommunity_unintern(&ecommunities[i]);
+		lcommunity_unintern(&lcommunities[i]);
+	}
+
+	assert(attr_count() == 0);
+
+	bgp_community_alias_finish();
+	bgp_attr_finish();
+	return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Test program for the allocation of the Adj-RIB-In entries: the chunks
+ * they are allocated from per peer, the re-use of freed entries and the
+ * release of chunks once they have none left.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "privs.h"
+#include "qobj.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_advertise.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_table.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+#define N_DESTS 1024
+
+static struct bgp bgp;
+static struct bgp_table *table;
+static struct bgp_dest *dests[N_DESTS];
+static struct peer peers[2] = { { .lock = 1 }, { .lock = 1 } };
+static struct attr attr;
+
+static unsigned long adj_in_count(void)
+{
+	unsigned long count;
+	size_t bytes;
+
+	bgp_adj_in_stats(&count, &bytes);
+	return count;
+}
+
+static size_t adj_in_bytes(void)
+{
+	unsigned long count;
+	size_t bytes;
+
+	bgp_adj_in_stats(&count, &bytes);
+	return bytes;
+}
+
+static void set(int i, struct peer *peer)
+{
+	bgp_adj_in_set(dests[i], peer, &attr, 0);
+}
+
+static void unset(int i, struct peer *peer)
+{
+	assert(bgp_adj_in_unset(dests[i], peer, 0));
+}
+
+/* How many entries a chunk holds, and how large it is */
+static int chunk_size(size_t *bytes)
+{
+	int i, n;
+
+	set(0, &peers[0]);
+	*bytes = adj_in_bytes();
+	assert(*bytes);
+
+	/* Until the entry that takes the next chunk */
+	for (n = 1; adj_in_bytes() == *bytes; n++)
+		set(n, &peers[0]);
+	n--;
+	assert(adj_in_bytes() == 2 * *bytes);
+
+	for (i = 0; i <= n; i++)
+		unset(i, &peers[0]);
+	assert(!adj_in_count() && !adj_in_bytes());
+
+	return n;
+}
+
+static void test_chunks(int n, size_t bytes)
+{
+	int i;
+
+	printf("Entries allocated from chunks\n");
+
+	/* Three full chunks and one more entry */
+	for (i = 0; i < 3 * n + 1; i++)
+		set(i, &peers[0]);
+	assert(adj_in_count() == (unsigned long)3 * n + 1);
+	assert(adj_in_bytes() == 4 * bytes);
+
+	/* Setting it again does not take another entry */
+	set(0, &peers[0]);
+	assert(adj_in_count() == (unsigned long)3 * n + 1);
+
+	/* Freed entries are reused, those of the last chunk freed from first */
+	unset(n, &peers[0]);
+	unset(2 * n, &peers[0]);
+	set(2 * n, &peers[0]);
+	set(n, &peers[0]);
+	assert(adj_in_bytes() == 4 * bytes);
+
+	/* Chunks are released once none of their entries are left */
+	for (i = n; i < 2 * n; i++)
+		unset(i, &peers[0]);
+	assert(adj_in_bytes() == 3 * bytes);
+	for (i = 0; i < n; i++)
+		unset(i, &peers[0]);
+	assert(adj_in_bytes() == 2 * bytes);
+
+	/* But a partly used one is kept */
+	for (i = 2 * n; i < 3 * n; i += 2)
+		unset(i, &peers[0]);
+	assert(adj_in_bytes() == 2 * bytes);
+	for (i = 2 * n + 1; i < 3 * n; i += 2)
+		unset(i, &peers[0]);
+	assert(adj_in_bytes() == bytes);
+
+	/* And the last one until the peer has no entries left */
+	unset(3 * n, &peers[0]);
+	assert(!adj_in_count() && !adj_in_bytes());
+}
+
+static void test_peers(int n, size_t bytes)
+{
+	int i;
+
+	printf("Chunks of different peers\n");
+
+	/* The peers' entries are not mixed in chunks */
+	for (i = 0; i < n; i++) {
+		set(i, &peers[0]);
+		set(i, &peers[1]);
+	}
+	assert(adj_in_count() == (unsigned long)2 * n);
+	assert(adj_in_bytes() == 2 * bytes);
+
+	for (i = 0; i < n; i++)
+		unset(i, &peers[0]);
+	assert(adj_in_bytes() == bytes);
+	for (i = 0; i < n; i++)
+		assert(dests[i]->adj_in && dests[i]->adj_in->peer == &peers[1]
+		       && !dests[i]->adj_in->next);
+
+	for (i = 0; i < n; i++)
+		unset(i, &peers[1]);
+	assert(!adj_in_count() && !adj_in_bytes());
+}
+
+int main(void)
+{
+	struct prefix p;
+	size_t bytes;
+	char buf[32];
+	int i, n;
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	bgp.default_local_pref = BGP_DEFAULT_LOCAL_PREF;
+	bgp_attr_default_set(&attr, &bgp, BGP_ORIGIN_IGP);
+
+	table = bgp_table_init(NULL, AFI_IP, SAFI_UNICAST);
+	for (i = 0; i < N_DESTS; i++) {
+		snprintf(buf, sizeof(buf), "10.%d.%d.0/24", i / 256, i % 256);
+		assert(str2prefix(buf, &p));
+		dests[i] = bgp_node_get(table, &p);
+	}
+
+	n = chunk_size(&bytes);
+	assert(3 * n + 1 <= N_DESTS);
+	printf("%d entries per chunk of %zu bytes\n", n, bytes);
+
+	test_chunks(n, bytes);
+	test_peers(n, bytes);
+
+	for (i = 0; i < N_DESTS; i++)
+		bgp_dest_unlock_node(dests[i]);
+	bgp_table_unlock(table);
+	assert(!mtype_stats_alloc(MTYPE_BGP_ADJ_IN));
+
+	printf("Done.\n");
+	return 0;
+}
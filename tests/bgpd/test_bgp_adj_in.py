@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestBgpAdjIn(frrtest.TestMultiOut):
+    program = "./test_bgp_adj_in"
+
+
+TestBgpAdjIn.exit_cleanly()
@@ -0,0 +1,325 @@
+/*
+ * Test program for the nexthop-groups BGP installs routes through: sharing
+ * of groups between routes, reference counting, what is sent to zebra and
+ * how groups go stale or fail.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "privs.h"
+#include "qobj.h"
+#include "stream.h"
+#include "thread.h"
+
+#include "bgpd/bgp_nhg.c"
+#include "bgpd/bgp_network.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+/* zebra's end of the zclient socket */
+static int zebra_sock;
+
+static struct bgp bgp;
+static struct bgp_nexthop_cache_head bnc_tree;
+
+static struct bgp_nexthop_cache *bnc_make(const char *addr, ifindex_t ifindex)
+{
+	struct bgp_nexthop_cache *bnc;
+	struct prefix p;
+	struct in_addr gate;
+
+	assert(str2prefix(addr, &p));
+	gate = p.u.prefix4;
+
+	bnc = bnc_new(&bnc_tree, &p, 0, 0);
+	bnc->bgp = &bgp;
+	bnc->nexthop = nexthop_from_ipv4_ifindex(&gate, NULL, ifindex,
+						 VRF_DEFAULT);
+	bnc->nexthop_num = 1;
+	SET_FLAG(bnc->flags, BGP_NEXTHOP_VALID);
+
+	return bnc;
+}
+
+static struct bgp_nhg *get2(struct bgp_nexthop_cache *bnc1, uint32_t weight1,
+			    struct bgp_nexthop_cache *bnc2, uint32_t weight2)
+{
+	struct bgp_nhg_nexthop nexthops[2] = {
+		{ .bnc = bnc1, .weight = weight1 },
+		{ .bnc = bnc2, .weight = weight2 },
+	};
+
+	return bgp_nhg_get(nexthops, bnc2 ? 2 : 1);
+}
+
+/* Check the next message zebra got */
+static void expect_sent(uint16_t cmd, uint32_t id, uint16_t nexthop_num)
+{
+	struct stream *s = stream_new(ZEBRA_MAX_PACKET_SIZ);
+	uint16_t size, rx_cmd, rx_num;
+	uint8_t marker, version;
+	vrf_id_t vrf_id;
+	uint32_t rx_id;
+
+	/* reads the whole message */
+	assert(zclient_read_header(s, zebra_sock, &size, &marker, &version,
+				   &vrf_id, &rx_cmd) == 0);
+	(void)stream_getw(s);
+	rx_id = stream_getl(s);
+
+	if (rx_cmd != cmd || rx_id != id) {
+		printf("expected %s id %u, got %s id %u\n",
+		       zserv_command_string(cmd), id,
+		       zserv_command_string(rx_cmd), rx_id);
+		assert(0);
+	}
+
+	if (cmd == ZEBRA_NHG_ADD) {
+		rx_num = stream_getw(s);
+		assert(rx_num == nexthop_num);
+	}
+
+	stream_free(s);
+}
+
+static void expect_none(void)
+{
+	uint8_t c;
+
+	assert(recv(zebra_sock, &c, 1, MSG_DONTWAIT) < 0);
+	assert(errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/* Drop the last reference, the group is deleted from zebra if it was sent */
+static void put_last(struct bgp_nhg *nhg, bool sent)
+{
+	uint32_t id = nhg->id;
+
+	assert(nhg->refcnt == 1);
+	bgp_nhg_put(nhg);
+	if (sent)
+		expect_sent(ZEBRA_NHG_DEL, id, 0);
+	else
+		expect_none();
+}
+
+static void test_sharing(struct bgp_nexthop_cache *a,
+			 struct bgp_nexthop_cache *b)
+{
+	struct bgp_nhg *g1, *g2, *g;
+
+	printf("Sharing and reference counting\n");
+
+	g1 = get2(a, 0, NULL, 0);
+	assert(g1 && g1->refcnt == 1);
+	assert(CHECK_FLAG(g1->flags, BGP_NHG_FLAG_SENT));
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 1);
+
+	assert(get2(a, 0, NULL, 0) == g1 && g1->refcnt == 2);
+	expect_none();
+
+	/* the order of the nexthops doesn't matter, their weights do */
+	g2 = get2(a, 1, b, 2);
+	assert(g2 && g2 != g1);
+	expect_sent(ZEBRA_NHG_ADD, g2->id, 2);
+	assert(get2(b, 2, a, 1) == g2 && g2->refcnt == 2);
+	g = get2(a, 1, b, 3);
+	assert(g && g != g2);
+	expect_sent(ZEBRA_NHG_ADD, g->id, 2);
+	assert(bgp_nhg_ids_count(&bgp_nhg_ids) == 3);
+
+	put_last(g, true);
+
+	bgp_nhg_put(g1);
+	expect_none();
+	put_last(g1, true);
+
+	bgp_nhg_put(g2);
+	put_last(g2, true);
+
+	assert(bgp_nhg_ids_count(&bgp_nhg_ids) == 0);
+	assert(bgp_nhg_cache_count(&bgp_nhg_cache) == 0);
+
+	/* nothing to install, no group */
+	UNSET_FLAG(a->flags, BGP_NEXTHOP_VALID);
+	assert(!get2(a, 0, NULL, 0));
+	expect_none();
+	assert(bgp_nhg_ids_count(&bgp_nhg_ids) == 0);
+	SET_FLAG(a->flags, BGP_NEXTHOP_VALID);
+}
+
+static void test_changes(struct bgp_nexthop_cache *a,
+			 struct bgp_nexthop_cache *b)
+{
+	struct bgp_nhg *g1, *g2;
+	struct in_addr gate;
+
+	printf("Nexthop resolution changes\n");
+
+	g1 = get2(a, 0, b, 0);
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 2);
+
+	/* updated in place */
+	inet_pton(AF_INET, "10.0.0.9", &gate);
+	a->nexthop->next = nexthop_from_ipv4_ifindex(&gate, NULL, 3,
+						     VRF_DEFAULT);
+	a->nexthop_num++;
+	assert(bgp_nhg_nexthop_changed(a));
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 3);
+
+	/* one nexthop left, still updated in place */
+	UNSET_FLAG(b->flags, BGP_NEXTHOP_VALID);
+	assert(bgp_nhg_nexthop_changed(b));
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 2);
+
+	/* none left, its routes have to move to another group */
+	UNSET_FLAG(a->flags, BGP_NEXTHOP_VALID);
+	assert(!bgp_nhg_nexthop_changed(a));
+	expect_none();
+	assert(CHECK_FLAG(g1->flags, BGP_NHG_FLAG_STALE));
+
+	SET_FLAG(a->flags, BGP_NEXTHOP_VALID);
+	SET_FLAG(b->flags, BGP_NEXTHOP_VALID);
+	g2 = get2(a, 0, b, 0);
+	assert(g2 && g2 != g1);
+	expect_sent(ZEBRA_NHG_ADD, g2->id, 3);
+
+	/* stale groups are no longer updated */
+	assert(bgp_nhg_nexthop_changed(a));
+	expect_sent(ZEBRA_NHG_ADD, g2->id, 3);
+	expect_none();
+
+	put_last(g1, true);
+	put_last(g2, true);
+}
+
+static void test_failed(struct bgp_nexthop_cache *a)
+{
+	struct bgp_nhg *g1, *g2;
+
+	printf("Groups zebra fails to install\n");
+
+	g1 = get2(a, 0, NULL, 0);
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 2);
+	bgp_nhg_notify(g1->id, ZAPI_NHG_INSTALLED);
+	assert(CHECK_FLAG(g1->flags, BGP_NHG_FLAG_INSTALLED));
+
+	/* not one of ours */
+	bgp_nhg_notify(g1->id + 1, ZAPI_NHG_FAIL_INSTALL);
+
+	/* routes with these nexthops get them instead of the group */
+	bgp_nhg_notify(g1->id, ZAPI_NHG_FAIL_INSTALL);
+	assert(CHECK_FLAG(g1->flags, BGP_NHG_FLAG_FAILED));
+	assert(!CHECK_FLAG(g1->flags, BGP_NHG_FLAG_INSTALLED));
+	assert(g1->refcnt == 1);
+	assert(!get2(a, 0, NULL, 0));
+	assert(g1->refcnt == 1);
+	expect_none();
+
+	/* failed groups are not updated */
+	assert(bgp_nhg_nexthop_changed(a));
+	expect_none();
+
+	/* until zebra managed after all */
+	bgp_nhg_notify(g1->id, ZAPI_NHG_INSTALLED);
+	assert(get2(a, 0, NULL, 0) == g1 && g1->refcnt == 2);
+	bgp_nhg_put(g1);
+
+	/* another try once the last route moved off it */
+	bgp_nhg_notify(g1->id, ZAPI_NHG_FAIL_INSTALL);
+	put_last(g1, true);
+
+	g2 = get2(a, 0, NULL, 0);
+	assert(g2 && !CHECK_FLAG(g2->flags, BGP_NHG_FLAG_FAILED));
+	expect_sent(ZEBRA_NHG_ADD, g2->id, 2);
+	put_last(g2, true);
+}
+
+static void test_reset_free(struct bgp_nexthop_cache *a,
+			    struct bgp_nexthop_cache *b)
+{
+	struct bgp_nhg *g1, *g2;
+
+	printf("zebra reconnects, BGP nexthops go away\n");
+
+	g1 = get2(a, 0, NULL, 0);
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 2);
+	g2 = get2(a, 0, b, 0);
+	expect_sent(ZEBRA_NHG_ADD, g2->id, 3);
+
+	/* sent again when the routes are */
+	bgp_nhg_zebra_reset();
+	assert(!CHECK_FLAG(g1->flags, BGP_NHG_FLAG_SENT));
+	assert(get2(a, 0, NULL, 0) == g1);
+	expect_sent(ZEBRA_NHG_ADD, g1->id, 2);
+	expect_none();
+	bgp_nhg_put(g1);
+
+	/* the groups stay until their routes are sent again */
+	bnc_free(b);
+	assert(CHECK_FLAG(g2->flags, BGP_NHG_FLAG_STALE));
+	assert(!CHECK_FLAG(g1->flags, BGP_NHG_FLAG_STALE));
+	assert(!bgp_nhg_has_nexthop(g2, b));
+	assert(bgp_nhg_has_nexthop(g2, a));
+
+	/* zebra has not seen g2 since the reset */
+	put_last(g2, false);
+	put_last(g1, true);
+	assert(bgp_nhg_ids_count(&bgp_nhg_ids) == 0);
+	assert(bgp_nhg_cache_count(&bgp_nhg_cache) == 0);
+}
+
+int main(void)
+{
+	struct bgp_nexthop_cache *a, *b;
+	int sv[2];
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_l3nhg_init();
+	bgp_nhg_init();
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+	zebra_sock = sv[1];
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	zclient->sock = sv[0];
+
+	bgp.vrf_id = VRF_DEFAULT;
+	bgp_nexthop_cache_init(&bnc_tree);
+
+	a = bnc_make("10.0.0.1/32", 2);
+	b = bnc_make("10.0.0.2/32", 2);
+
+	test_sharing(a, b);
+	test_changes(a, b);
+	test_failed(a);
+	test_reset_free(a, b);
+
+	bnc_free(a);
+	bgp_nhg_finish();
+	bgp_l3nhg_finish();
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestBgpNhg(frrtest.TestMultiOut):
+    program = "./test_bgp_nhg"
+
+
+TestBgpNhg.exit_cleanly()
@@ -0,0 +1,195 @@
+/*
+ * Test program for the cache of the results of route-map match clauses
+ * bgpd keys by attributes: which routes share results, and that changes to
+ * the route-map or to the lists it uses are seen.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "plist.h"
+#include "plist_int.h"
+#include "privs.h"
+#include "qobj.h"
+#include "routemap.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_clist.h"
+#include "bgpd/bgp_community.h"
+#include "bgpd/bgp_community_alias.h"
+#include "bgpd/bgp_network.h"
+#include "bgpd/bgp_route.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+static struct bgp bgp;
+static struct prefix p;
+
+static struct attr *attr_new(const char *community)
+{
+	struct attr attr;
+
+	bgp_attr_default_set(&attr, &bgp, BGP_ORIGIN_IGP);
+	bgp_attr_set_community(&attr, community_str2com(community));
+	return bgp_attr_intern(&attr);
+}
+
+static bool apply(struct route_map *map, struct attr *attr)
+{
+	struct bgp_path_info path = { .attr = attr };
+
+	return route_map_apply(map, &p, &path) == RMAP_PERMITMATCH;
+}
+
+/* Apply map to attr, and check how the match of index was found */
+static void check(struct route_map *map, struct route_map_index *index,
+		  struct attr *attr, bool permit, bool hit)
+{
+	uint64_t hits = index->match_cache_hits;
+	uint64_t misses = index->match_cache_misses;
+
+	assert(apply(map, attr) == permit);
+	assert(index->match_cache_hits == hits + hit);
+	assert(index->match_cache_misses == misses + !hit);
+}
+
+static void plist_add(const char *name, int64_t seq, const char *prefix,
+		      int le)
+{
+	struct prefix_list_entry *ple;
+
+	ple = prefix_list_entry_new();
+	ple->pl = prefix_list_get(AFI_IP, 0, name);
+	ple->seq = seq;
+	ple->type = PREFIX_PERMIT;
+	assert(str2prefix(prefix, &ple->prefix));
+	ple->le = le;
+	prefix_list_entry_update_finish(ple);
+}
+
+static void test_attrs(struct route_map *map, struct route_map_index *index,
+		       struct attr *a1, struct attr *a2)
+{
+	struct attr copy;
+
+	printf("Interned attributes and copies\n");
+
+	check(map, index, a1, true, false);
+	check(map, index, a1, true, true);
+	check(map, index, a2, false, false);
+	check(map, index, a2, false, true);
+
+	/* The same attributes */
+	copy = *a1;
+	check(map, index, &copy, true, true);
+
+	/* Once changed, copies are no longer what they were copied from */
+	bgp_attr_set_community(&copy, bgp_attr_get_community(a2));
+	assert(copy.serial == a1->serial && copy.refcnt);
+	check(map, index, &copy, false, true);
+
+	/* Nor anything interned, not cached */
+	bgp_attr_set_community(&copy, community_str2com("65000:9"));
+	assert(!apply(map, &copy));
+	community_free(&copy.community);
+}
+
+static void test_changes(struct route_map *map, struct route_map_index *index,
+			 struct attr *a1, struct attr *a2, struct attr *a3)
+{
+	printf("Changes of the route-map and its lists\n");
+
+	/* community-list */
+	assert(community_list_set(bgp_clist, "CL", "65000:2", NULL,
+				  COMMUNITY_PERMIT, COMMUNITY_LIST_STANDARD)
+	       == 0);
+	check(map, index, a2, true, false);
+	check(map, index, a1, true, false);
+	check(map, index, a1, true, true);
+
+	/* route-map */
+	route_map_add_match(index, "metric", "5", RMAP_EVENT_MATCH_ADDED);
+	check(map, index, a1, false, false);
+	check(map, index, a1, false, true);
+	route_map_delete_match(index, "metric", "5", RMAP_EVENT_MATCH_DELETED);
+	check(map, index, a1, true, false);
+
+	/* prefix-list of the next sequence */
+	check(map, index, a3, false, false);
+	check(map, index, a3, false, true);
+	plist_add("PL", 10, "10.0.0.0/8", 32);
+	check(map, index, a3, true, false);
+	check(map, index, a1, true, false);
+}
+
+int main(void)
+{
+	struct route_map_index *index;
+	struct route_map *map;
+	struct attr *a1, *a2, *a3;
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	bgp_master_init(master, BGP_SOCKET_SNDBUF_SIZE, list_new());
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	bgp_community_alias_init();
+	bgp_clist = community_list_init();
+	bgp_route_map_init();
+	prefix_list_init();
+
+	bgp.default_local_pref = BGP_DEFAULT_LOCAL_PREF;
+	assert(str2prefix("10.1.0.0/24", &p));
+
+	/*
+	 * 10: permit community-list CL
+	 * 20: permit prefix-list PL
+	 */
+	assert(community_list_set(bgp_clist, "CL", "65000:1", NULL,
+				  COMMUNITY_PERMIT, COMMUNITY_LIST_STANDARD)
+	       == 0);
+	plist_add("PL", 5, "192.168.0.0/16", 32);
+
+	map = route_map_get("RM");
+	index = route_map_index_get(map, RMAP_PERMIT, 20);
+	route_map_add_match(index, "ip address prefix-list", "PL",
+			    RMAP_EVENT_PLIST_ADDED);
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	route_map_add_match(index, "community", "CL", RMAP_EVENT_CLIST_ADDED);
+	assert(index->match_cacheable);
+
+	a1 = attr_new("65000:1");
+	a2 = attr_new("65000:2");
+	a3 = attr_new("65000:3");
+
+	test_attrs(map, index, a1, a2);
+	test_changes(map, index, a1, a2, a3);
+
+	bgp_attr_unintern(&a1);
+	bgp_attr_unintern(&a2);
+	bgp_attr_unintern(&a3);
+
+	printf("Done.\n");
+	return 0;
+}
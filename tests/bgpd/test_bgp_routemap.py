@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestBgpRoutemap(frrtest.TestMultiOut):
+    program = "./test_bgp_routemap"
+
+
+TestBgpRoutemap.exit_cleanly()
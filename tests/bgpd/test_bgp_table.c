@@ -174,7 +174,36 @@ static void test_range_lookup(void)
 		"1.16.32.0/20", "1.16.32.0/21", "16.0.0.0/16", NULL);
 }
 
+static void test_dest_pool(void)
+{
+	struct bgp_table *table = bgp_table_init(NULL, AFI_IP, SAFI_UNICAST);
+	struct bgp_dest *dests[256];
+	struct prefix p;
+	char buf[32];
+	int i;
+
+	printf("Testing the pools of the dests\n");
+
+	/* Small tables share a pool, larger ones get their own */
+	for (i = 0; i < 256; i++) {
+		snprintf(buf, sizeof(buf), "10.0.%d.0/24", i);
+		assert(str2prefix(buf, &p));
+		dests[i] = bgp_node_get(table, &p);
+		if (i < 8)
+			assert(!table->dest_pool);
+	}
+	assert(table->dest_pool);
+
+	for (i = 0; i < 256; i++)
+		bgp_dest_unlock_node(dests[i]);
+	assert(!bgp_table_count(table));
+	bgp_table_unlock(table);
+
+	printf("Checks successfull\n");
+}
+
 int main(void)
 {
 	test_range_lookup();
+	test_dest_pool();
 }
@@ -0,0 +1,321 @@
+/*
+ * Test program for the lookup of the first matching community-list entry:
+ * on random lists and attributes, it has to find what walking the entries
+ * one by one in order finds.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "network.h"
+#include "privs.h"
+#include "qobj.h"
+#include "routemap.h"
+#include "thread.h"
+
+#include "bgpd/bgp_clist.c"
+#include "bgpd/bgp_community_alias.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {};
+struct thread_master *master = NULL;
+
+#define LIST_NAME "CL"
+#define N_VALUES 12
+#define N_TRIALS 200
+#define N_ATTRS 100
+
+/* The walk community_list_first_match() replaced */
+static bool linear_match(const void *attr, struct community_list *list,
+			 bool (*entry_match)(const void *attr,
+					     struct community_entry *entry))
+{
+	struct community_entry *entry;
+
+	for (entry = list->head; entry; entry = entry->next)
+		if (entry_match(attr, entry))
+			return entry->direct == COMMUNITY_PERMIT;
+	return false;
+}
+
+/* The communities of a flavour of list, and how to match them */
+struct flavour {
+	const char *name;
+	int master;
+	int standard;
+	int expanded;
+	const char *value_fmt;
+	/* the regular expressions expanded entries are made of */
+	const char *const *regexps;
+
+	int (*set)(struct community_list_handler *ch, const char *name,
+		   const char *str, const char *seq, int direct, int style);
+	void *(*attr_new)(const char *str);
+	void (*attr_free)(void *attr);
+	bool (*list_match)(void *attr, struct community_list *list);
+	bool (*entry_match)(const void *attr, struct community_entry *entry);
+};
+
+static const char *const community_regexps[] = {
+	"65000:1$", "^65000:[2-4] ", "65000:1[01]", "_65000:(5|7)_", NULL,
+};
+
+static void *community_attr_new(const char *str)
+{
+	return community_str2com(str);
+}
+
+static void community_attr_free(void *attr)
+{
+	struct community *com = attr;
+
+	community_free(&com);
+}
+
+static bool community_list_match_attr(void *attr, struct community_list *list)
+{
+	return community_list_match(attr, list);
+}
+
+static const char *const lcommunity_regexps[] = {
+	"65000:0:1$", "^65000:0:[2-4] ", "65000:0:1[01]", NULL,
+};
+
+static void *lcommunity_attr_new(const char *str)
+{
+	return lcommunity_str2com(str);
+}
+
+static void lcommunity_attr_free(void *attr)
+{
+	struct lcommunity *lcom = attr;
+
+	lcommunity_free(&lcom);
+}
+
+static bool lcommunity_list_match_attr(void *attr,
+				       struct community_list *list)
+{
+	return lcommunity_list_match(attr, list);
+}
+
+static const char *const ecommunity_regexps[] = {
+	"65000:1$", "^RT:65000:[2-4] ", "65000:1[01]", NULL,
+};
+
+static void *ecommunity_attr_new(const char *str)
+{
+	return ecommunity_str2com(str, 0, 1);
+}
+
+static void ecommunity_attr_free(void *attr)
+{
+	struct ecommunity *ecom = attr;
+
+	ecommunity_free(&ecom);
+}
+
+static bool ecommunity_list_match_attr(void *attr,
+				       struct community_list *list)
+{
+	return ecommunity_list_match(attr, list);
+}
+
+static const struct flavour flavours[] = {
+	{
+		.name = "community-list",
+		.master = COMMUNITY_LIST_MASTER,
+		.standard = COMMUNITY_LIST_STANDARD,
+		.expanded = COMMUNITY_LIST_EXPANDED,
+		.value_fmt = "65000:%u",
+		.regexps = community_regexps,
+		.set = community_list_set,
+		.attr_new = community_attr_new,
+		.attr_free = community_attr_free,
+		.list_match = community_list_match_attr,
+		.entry_match = community_entry_match,
+	},
+	{
+		.name = "large-community-list",
+		.master = LARGE_COMMUNITY_LIST_MASTER,
+		.standard = LARGE_COMMUNITY_LIST_STANDARD,
+		.expanded = LARGE_COMMUNITY_LIST_EXPANDED,
+		.value_fmt = "65000:0:%u",
+		.regexps = lcommunity_regexps,
+		.set = lcommunity_list_set,
+		.attr_new = lcommunity_attr_new,
+		.attr_free = lcommunity_attr_free,
+		.list_match = lcommunity_list_match_attr,
+		.entry_match = lcommunity_entry_match,
+	},
+	{
+		.name = "extcommunity-list",
+		.master = EXTCOMMUNITY_LIST_MASTER,
+		.standard = EXTCOMMUNITY_LIST_STANDARD,
+		.expanded = EXTCOMMUNITY_LIST_EXPANDED,
+		.value_fmt = "rt 65000:%u",
+		.regexps = ecommunity_regexps,
+		.set = extcommunity_list_set,
+		.attr_new = ecommunity_attr_new,
+		.attr_free = ecommunity_attr_free,
+		.list_match = ecommunity_list_match_attr,
+		.entry_match = ecommunity_entry_match,
+	},
+};
+
+static struct community_list_handler *ch;
+
+/* Up to max random values, "internet" among them now and then */
+static void random_values(const struct flavour *f, char *buf, size_t size,
+			  unsigned int max, bool internet)
+{
+	unsigned int i, n = frr_weak_random() % (max + 1);
+	size_t len = 0;
+
+	buf[0] = '\0';
+	for (i = 0; i < n; i++) {
+		if (len)
+			len += snprintf(buf + len, size - len, " ");
+		if (internet && frr_weak_random() % 16 == 0)
+			len += snprintf(buf + len, size - len, "internet");
+		else
+			len += snprintf(buf + len, size - len, f->value_fmt,
+					1 + frr_weak_random() % N_VALUES);
+	}
+}
+
+/* A random entry, "any" now and then where the flavour has it */
+static void entry_add(const struct flavour *f, int style, int64_t seq)
+{
+	int direct = frr_weak_random() % 2 ? COMMUNITY_PERMIT : COMMUNITY_DENY;
+	const char *str;
+	char buf[128], seqbuf[32];
+	unsigned int n;
+
+	if (style == f->expanded) {
+		for (n = 0; f->regexps[n]; n++)
+			;
+		str = f->regexps[frr_weak_random() % n];
+	} else {
+		random_values(f, buf, sizeof(buf), 3,
+			      f->master == COMMUNITY_LIST_MASTER);
+		str = buf;
+	}
+
+	if (f->master != EXTCOMMUNITY_LIST_MASTER
+	    && frr_weak_random() % 32 == 0)
+		str = NULL;
+	else if (!str[0])
+		return;
+
+	snprintf(seqbuf, sizeof(seqbuf), "%" PRId64, seq);
+	assert(f->set(ch, LIST_NAME, str, seqbuf, direct, style) == 0);
+}
+
+/* Random attributes, the same answer as the walk */
+static void check_attrs(const struct flavour *f, struct community_list *list,
+			int style)
+{
+	char buf[128];
+	void *attr;
+	int i;
+
+	for (i = 0; i < N_ATTRS; i++) {
+		random_values(f, buf, sizeof(buf), 5, false);
+		attr = buf[0] ? f->attr_new(buf) : NULL;
+
+		/* The expressions are run on its string */
+		if (!attr && style == f->expanded)
+			continue;
+
+		if (f->list_match(attr, list)
+		    != linear_match(attr, list, f->entry_match)) {
+			printf("%s %s: \"%s\" matched differently\n", f->name,
+			       LIST_NAME, buf);
+			assert(0);
+		}
+
+		if (attr)
+			f->attr_free(attr);
+	}
+}
+
+static void test_flavour(const struct flavour *f, int style)
+{
+	struct community_list_master *cm;
+	struct community_list *list;
+	unsigned int i, j, n;
+	int64_t seq;
+
+	printf("%s, %s entries\n", f->name,
+	       style == f->standard ? "standard" : "expanded");
+
+	cm = community_list_master_lookup(ch, f->master);
+
+	for (i = 0; i < N_TRIALS; i++) {
+		n = 1 + frr_weak_random() % 48;
+		for (j = 0; j < n; j++)
+			entry_add(f, style, 5 * (j + 1));
+
+		list = community_list_lookup(ch, LIST_NAME, 0, f->master);
+		if (!list)
+			continue;
+		check_attrs(f, list, style);
+		assert(list->compiled);
+
+		/* Entries inserted in between and deleted */
+		for (j = 0; j < 4; j++) {
+			seq = 5 * (frr_weak_random() % (n + 1)) + 1 + j;
+			entry_add(f, style, seq);
+			if (list->head != list->tail) {
+				community_list_entry_delete(cm, list,
+							    list->head->next);
+				assert(!list->compiled);
+			}
+			check_attrs(f, list, style);
+		}
+
+		community_list_delete(cm, list);
+	}
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	route_map_init();
+	community_init();
+	lcommunity_init();
+	ecommunity_init();
+	bgp_community_alias_init();
+	ch = community_list_init();
+
+	for (i = 0; i < array_size(flavours); i++) {
+		test_flavour(&flavours[i], flavours[i].standard);
+		test_flavour(&flavours[i], flavours[i].expanded);
+	}
+
+	community_list_terminate(ch);
+
+	printf("Done.\n");
+	return 0;
+}
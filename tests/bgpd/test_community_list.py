@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestCommunityList(frrtest.TestMultiOut):
+    program = "./test_community_list"
+
+
+TestCommunityList.exit_cleanly()
@@ -0,0 +1,138 @@
+/*
+ * Test program which measures the cost of an I/O wakeup in the event loop
+ * depending on the number of file descriptors being watched, for each
+ * available I/O backend.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "thread.h"
+#include "prng.h"
+
+#define WAKEUPS 10000
+
+struct thread_master *master;
+
+struct io_pair {
+	int fds[2];
+	struct thread *t_read;
+};
+
+static unsigned long wakeups;
+
+static void read_func(struct thread *thread)
+{
+	struct io_pair *pair = THREAD_ARG(thread);
+	char buf[16];
+
+	if (read(pair->fds[0], buf, sizeof(buf)) <= 0)
+		abort();
+
+	wakeups++;
+	thread_add_read(master, read_func, pair, pair->fds[0], &pair->t_read);
+}
+
+static void run_bench(enum thread_io_backend backend, int npairs)
+{
+	struct prng *prng;
+	struct io_pair *pairs;
+	struct thread thread;
+	struct timeval tv_start, tv_stop;
+	unsigned long t_usec;
+	int i;
+
+	master = thread_master_create(NULL);
+	if (thread_master_set_io_backend(master, backend) < 0) {
+		printf("%-6s backend not available\n",
+		       thread_io_backend_name(backend));
+		thread_master_free(master);
+		return;
+	}
+
+	prng = prng_new(0);
+	pairs = calloc(npairs, sizeof(*pairs));
+
+	for (i = 0; i < npairs; i++) {
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i].fds) < 0) {
+			perror("socketpair");
+			exit(1);
+		}
+		thread_add_read(master, read_func, &pairs[i], pairs[i].fds[0],
+				&pairs[i].t_read);
+	}
+
+	wakeups = 0;
+	monotime(&tv_start);
+
+	for (i = 0; i < WAKEUPS; i++) {
+		struct io_pair *pair = &pairs[prng_rand(prng) % npairs];
+
+		if (write(pair->fds[1], "x", 1) != 1)
+			abort();
+
+		while (wakeups <= (unsigned long)i
+		       && thread_fetch(master, &thread))
+			thread_call(&thread);
+	}
+
+	monotime(&tv_stop);
+
+	t_usec = (tv_stop.tv_sec - tv_start.tv_sec) * 1000000
+		 + (tv_stop.tv_usec - tv_start.tv_usec);
+
+	printf("%-6s %6d fds: %d wakeups took %lu.%03lu seconds, %.2f usec/wakeup\n",
+	       thread_io_backend_name(backend), npairs, WAKEUPS,
+	       t_usec / 1000000, (t_usec / 1000) % 1000,
+	       (double)t_usec / WAKEUPS);
+	fflush(stdout);
+
+	for (i = 0; i < npairs; i++) {
+		thread_cancel(&pairs[i].t_read);
+		close(pairs[i].fds[0]);
+		close(pairs[i].fds[1]);
+	}
+	free(pairs);
+	thread_master_free(master);
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	static const int counts[] = {16, 256, 1024, 4096};
+	struct rlimit limit;
+	unsigned int i;
+
+	/* every pair uses 2 fds, make sure we may open enough of them */
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	for (i = 0; i < array_size(counts); i++) {
+		if ((rlim_t)counts[i] * 2 + 64 > limit.rlim_cur)
+			break;
+
+		run_bench(THREAD_IO_POLL, counts[i]);
+		run_bench(THREAD_IO_EPOLL, counts[i]);
+	}
+	return 0;
+}
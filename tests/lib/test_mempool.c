@@ -0,0 +1,151 @@
+/*
+ * mempool tests
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "mempool.h"
+
+DEFINE_MGROUP(TEST_MEMPOOL, "mempool test");
+DEFINE_MTYPE_STATIC(TEST_MEMPOOL, TEST_OBJ, "test object");
+DEFINE_MTYPE_STATIC(TEST_MEMPOOL, TEST_OBJ2, "test object 2");
+
+#define NOBJ 100000
+
+struct obj {
+	unsigned int id;
+	char data[36];
+};
+
+static void *objs[NOBJ];
+static unsigned int walked;
+
+static int stats_walker(void *arg, struct memtype *mt,
+			const struct mempool_stats *stats)
+{
+	struct mempool_stats *out = arg;
+
+	if (mt == MTYPE_TEST_OBJ) {
+		*out = *stats;
+		walked++;
+	}
+	return 0;
+}
+
+static struct mempool_stats get_stats(void)
+{
+	struct mempool_stats stats = {};
+
+	walked = 0;
+	mempool_walk(stats_walker, &stats);
+	assert(walked <= 1);
+	return stats;
+}
+
+int main(int argc, char **argv)
+{
+	struct mempool *pool, *pool2, *pool3;
+	struct mempool_stats stats, peak;
+	struct obj *o;
+	unsigned int i;
+
+	/* 1. objects are zeroed, distinct and accounted to the MTYPE */
+	pool = mempool_new(MTYPE_TEST_OBJ, sizeof(struct obj));
+	for (i = 0; i < NOBJ; i++) {
+		o = mempool_alloc(pool);
+		assert(o->id == 0 && o->data[sizeof(o->data) - 1] == 0);
+		assert(((uintptr_t)o % sizeof(void *)) == 0);
+		o->id = i;
+		memset(o->data, 0xff, sizeof(o->data));
+		objs[i] = o;
+	}
+	for (i = 0; i < NOBJ; i++)
+		assert(((struct obj *)objs[i])->id == i);
+	assert(mtype_stats_alloc(MTYPE_TEST_OBJ) == NOBJ);
+
+	peak = get_stats();
+	assert(peak.pools == 1);
+	assert(peak.used == NOBJ);
+	assert(peak.capacity >= NOBJ);
+
+	/* 2. freed slots are reused, and reallocated objects are zeroed */
+	for (i = 0; i < NOBJ; i += 2)
+		MEMPOOL_FREE(objs[i]);
+	assert(mtype_stats_alloc(MTYPE_TEST_OBJ) == NOBJ / 2);
+	for (i = 0; i < NOBJ; i += 2) {
+		o = mempool_alloc(pool);
+		assert(o->id == 0 && o->data[0] == 0);
+		objs[i] = o;
+	}
+	stats = get_stats();
+	assert(stats.slabs == peak.slabs);
+
+	/* 3. emptying the pool gives back all slabs but one */
+	for (i = 0; i < NOBJ; i++)
+		MEMPOOL_FREE(objs[i]);
+	assert(mtype_stats_alloc(MTYPE_TEST_OBJ) == 0);
+	stats = get_stats();
+	assert(stats.used == 0);
+	assert(stats.slabs == 1);
+	assert(stats.slab_bytes < peak.slab_bytes);
+
+	/* 4. pools of the same MTYPE are reported together, once */
+	pool3 = mempool_new(MTYPE_TEST_OBJ2, sizeof(struct obj));
+	pool2 = mempool_new(MTYPE_TEST_OBJ, sizeof(struct obj));
+	objs[0] = mempool_alloc(pool);
+	objs[1] = mempool_alloc(pool2);
+	objs[2] = mempool_alloc(pool3);
+	stats = get_stats();
+	assert(walked == 1);
+	assert(stats.pools == 2);
+	assert(stats.used == 2);
+	MEMPOOL_FREE(objs[2]);
+	mempool_release(&pool3);
+
+	/* 5. releasing a pool with live objects defers its destruction */
+	mempool_release(&pool);
+	assert(pool == NULL);
+	stats = get_stats();
+	assert(stats.pools == 2);
+	MEMPOOL_FREE(objs[0]);
+	stats = get_stats();
+	assert(stats.pools == 1);
+
+	MEMPOOL_FREE(objs[1]);
+	mempool_release(&pool2);
+	stats = get_stats();
+	assert(walked == 0 && stats.pools == 0);
+
+	/* 6. tiny objects still get their own slot */
+	pool = mempool_new(MTYPE_TEST_OBJ2, 1);
+	for (i = 0; i < 1000; i++)
+		objs[i] = mempool_alloc(pool);
+	for (i = 1; i < 1000; i++)
+		assert(objs[i] != objs[i - 1]);
+	for (i = 0; i < 1000; i++)
+		MEMPOOL_FREE(objs[i]);
+	mempool_release(&pool);
+	assert(mtype_stats_alloc(MTYPE_TEST_OBJ2) == 0);
+
+	puts("Mempool test successful.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestMempool(frrtest.TestMultiOut):
+    program = "./test_mempool"
+
+
+TestMempool.onesimple("Mempool test successful.")
@@ -0,0 +1,464 @@
+/*
+ * Route-map changes tests: what route_map_changes_get() records of an edit
+ * and which objects route_map_changes_match() says it may apply differently
+ * to.  Every object the result of the map changed for has to be matched.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "network.h"
+#include "plist.h"
+#include "plist_int.h"
+#include "routemap.h"
+
+struct thread_master *master;
+
+struct test_route {
+	uint32_t tag;
+	uint32_t metric;
+};
+
+/* "ip address prefix-list" */
+static enum route_map_cmd_result_t
+match_plist(void *rule, const struct prefix *prefix, void *object)
+{
+	struct prefix_list *plist = prefix_list_lookup(AFI_IP, rule);
+
+	if (!plist || prefix_list_apply(plist, prefix) == PREFIX_DENY)
+		return RMAP_NOMATCH;
+	return RMAP_MATCH;
+}
+
+static void *compile_str(const char *arg)
+{
+	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+}
+
+static void free_str(void *rule)
+{
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+}
+
+static const struct route_map_rule_cmd match_plist_cmd = {
+	"ip address prefix-list",
+	match_plist,
+	compile_str,
+	free_str,
+};
+
+/* "tag" */
+static enum route_map_cmd_result_t
+match_tag(void *rule, const struct prefix *prefix, void *object)
+{
+	struct test_route *route = object;
+
+	return route->tag == *(uint32_t *)rule ? RMAP_MATCH : RMAP_NOMATCH;
+}
+
+static void *compile_u32(const char *arg)
+{
+	uint32_t *val = XMALLOC(MTYPE_ROUTE_MAP_COMPILED, sizeof(*val));
+
+	*val = strtoul(arg, NULL, 10);
+	return val;
+}
+
+static void free_u32(void *rule)
+{
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+}
+
+static const struct route_map_rule_cmd match_tag_cmd = {
+	"tag",
+	match_tag,
+	compile_u32,
+	free_u32,
+};
+
+/* set "metric" */
+static enum route_map_cmd_result_t
+set_metric(void *rule, const struct prefix *prefix, void *object)
+{
+	struct test_route *route = object;
+
+	route->metric = *(uint32_t *)rule;
+	return RMAP_OKAY;
+}
+
+static const struct route_map_rule_cmd set_metric_cmd = {
+	"metric",
+	set_metric,
+	compile_u32,
+	free_u32,
+};
+
+/* What the daemons do when a route-map changes */
+static void test_rmap_event(const char *name)
+{
+	route_map_mark_updated(name);
+	route_map_notify_dependencies(name, RMAP_EVENT_MATCH_ADDED);
+}
+
+/* The objects: prefixes of 10.0.0.0/14 with a tag each */
+#define N_ROUTES 4096
+
+static struct prefix prefixes[N_ROUTES];
+static struct test_route routes[N_ROUTES];
+static int results[N_ROUTES];
+
+static int outcome(struct route_map *map, int i, uint32_t *metric)
+{
+	struct test_route route = routes[i];
+	int ret;
+
+	ret = route_map_apply(map, &prefixes[i], &route);
+	*metric = route.metric;
+	return ret == RMAP_PERMITMATCH ? (int)route.metric : -1;
+}
+
+static void snapshot(struct route_map *map)
+{
+	uint32_t metric;
+	int i;
+
+	for (i = 0; i < N_ROUTES; i++)
+		results[i] = outcome(map, i, &metric);
+}
+
+/* What route_map_walk_update_list() gives the daemons for the map */
+static struct route_map_changes *walked;
+static bool walked_unknown;
+static const char *walk_name;
+
+static void walk_fn(char *name)
+{
+	struct route_map *map;
+
+	if (strcmp(name, walk_name))
+		return;
+
+	map = route_map_lookup_by_name(name);
+	walked = map ? route_map_changes_get(map) : NULL;
+	walked_unknown = !walked;
+}
+
+static struct route_map_changes *walk(const char *name, bool *processed)
+{
+	struct route_map_changes *changes;
+
+	walked = NULL;
+	walked_unknown = false;
+	walk_name = name;
+	route_map_walk_update_list(walk_fn);
+
+	*processed = walked || walked_unknown;
+	changes = walked;
+	walked = NULL;
+	return changes;
+}
+
+/*
+ * Check changes against what really changed since the last snapshot, and
+ * return how many objects they let skip.
+ */
+static int check(struct route_map *map, const struct route_map_changes *changes)
+{
+	struct test_route route;
+	int i, changed = 0, skipped = 0;
+	uint32_t metric;
+	int result;
+
+	for (i = 0; i < N_ROUTES; i++) {
+		result = outcome(map, i, &metric);
+		if (result != results[i])
+			changed++;
+
+		route = routes[i];
+		if (changes
+		    && !route_map_changes_match(changes, map, &prefixes[i],
+						&route)) {
+			skipped++;
+			if (result != results[i]) {
+				printfrr("%pFX tag %u: %d => %d, not matched\n",
+					 &prefixes[i], routes[i].tag, results[i],
+					 result);
+				assert(0);
+			}
+		}
+	}
+
+	assert(changed);
+	snapshot(map);
+	return skipped;
+}
+
+/* Apply the changes made to map since the last call */
+static int changed(struct route_map *map, bool known)
+{
+	struct route_map_changes *changes;
+	bool processed;
+	int skipped;
+
+	changes = walk(map->name, &processed);
+	assert(processed);
+	assert(!changes == !known);
+
+	skipped = check(map, changes);
+	route_map_changes_free(&changes);
+
+	return skipped;
+}
+
+static bool would_match(const struct route_map_changes *changes,
+			struct route_map *map, const char *prefix, uint32_t tag)
+{
+	struct test_route route = { .tag = tag };
+	struct prefix p;
+
+	assert(str2prefix(prefix, &p));
+	return route_map_changes_match(changes, map, &p, &route);
+}
+
+static struct prefix_list_entry *plist_add(const char *name, int64_t seq,
+					   enum prefix_list_type type,
+					   const char *prefix, int ge, int le)
+{
+	struct prefix_list_entry *ple;
+
+	ple = prefix_list_entry_new();
+	ple->pl = prefix_list_get(AFI_IP, 0, name);
+	ple->seq = seq;
+	ple->type = type;
+	assert(str2prefix(prefix, &ple->prefix));
+	ple->ge = ge;
+	ple->le = le;
+	prefix_list_entry_update_finish(ple);
+
+	return ple;
+}
+
+static void test_plist(struct route_map *map)
+{
+	struct route_map_changes *changes;
+	struct prefix_list_entry *ple;
+	bool processed;
+
+	printf("Prefix-list entries\n");
+
+	ple = plist_add("PL", 20, PREFIX_PERMIT, "10.1.0.0/16", 20, 24);
+	changes = walk(map->name, &processed);
+	assert(changes);
+
+	/* Within the range of the entry, and matching the other clauses */
+	assert(would_match(changes, map, "10.1.16.0/20", 1));
+	assert(would_match(changes, map, "10.1.2.0/24", 1));
+	assert(!would_match(changes, map, "10.1.0.0/16", 1));
+	assert(!would_match(changes, map, "10.1.2.0/25", 1));
+	assert(!would_match(changes, map, "10.2.2.0/24", 1));
+	assert(!would_match(changes, map, "10.1.2.0/24", 2));
+
+	assert(check(map, changes));
+	route_map_changes_free(&changes);
+
+	/* A deleted entry, any prefix length */
+	prefix_list_entry_delete(ple->pl, ple, 1);
+	plist_add("PL", 30, PREFIX_DENY, "10.2.0.0/16", 0, 32);
+	changes = walk(map->name, &processed);
+	assert(changes);
+	assert(would_match(changes, map, "10.1.2.0/24", 1));
+	assert(would_match(changes, map, "10.2.2.128/25", 1));
+	assert(!would_match(changes, map, "10.3.2.0/24", 1));
+	assert(check(map, changes));
+	route_map_changes_free(&changes);
+}
+
+static void test_sequences(struct route_map *map)
+{
+	struct route_map_changes *changes;
+	struct route_map_index *index;
+	bool processed;
+
+	printf("Sequences added, changed and deleted\n");
+
+	/* Only what it matches now */
+	index = route_map_index_get(map, RMAP_PERMIT, 15);
+	route_map_add_match(index, "tag", "3", RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "metric", "15");
+	assert(changed(map, true));
+
+	/* What the other clauses match */
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	route_map_add_set(index, "metric", "11");
+	changes = walk(map->name, &processed);
+	assert(changes);
+	assert(would_match(changes, map, "10.0.1.0/24", 1));
+	assert(!would_match(changes, map, "10.0.1.0/24", 2));
+	assert(check(map, changes));
+	route_map_changes_free(&changes);
+
+	/* Match clauses changed, the objects they could start or stop
+	 * matching
+	 */
+	route_map_add_match(index, "tag", "2", RMAP_EVENT_MATCH_ADDED);
+	assert(changed(map, true));
+	route_map_delete_match(index, "tag", "2", RMAP_EVENT_MATCH_DELETED);
+	assert(changed(map, true));
+	route_map_add_match(index, "tag", "1", RMAP_EVENT_MATCH_ADDED);
+	assert(changed(map, true));
+
+	/* Everything it matched could now match later sequences */
+	route_map_index_delete(route_map_index_get(map, RMAP_PERMIT, 15), 1);
+	assert(!changed(map, false));
+}
+
+static void test_merge(struct route_map *map)
+{
+	struct route_map_changes *merged = NULL, *changes;
+	struct route_map_index *index;
+	bool processed;
+
+	printf("Changes merged\n");
+
+	plist_add("PL", 40, PREFIX_PERMIT, "10.3.0.0/16", 0, 32);
+	changes = walk(map->name, &processed);
+	route_map_changes_merge(&merged, changes);
+	route_map_changes_free(&changes);
+
+	index = route_map_index_get(map, RMAP_DENY, 30);
+	route_map_add_match(index, "tag", "2", RMAP_EVENT_MATCH_ADDED);
+	changes = walk(map->name, &processed);
+	route_map_changes_merge(&merged, changes);
+	route_map_changes_free(&changes);
+
+	assert(would_match(merged, map, "10.3.2.0/24", 1));
+	assert(would_match(merged, map, "10.0.2.0/24", 2));
+	assert(!would_match(merged, map, "10.0.2.0/24", 3));
+	assert(check(map, merged));
+
+	/* Unknown changes make the merge unknown */
+	route_map_index_delete(index, 1);
+	changes = walk(map->name, &processed);
+	assert(processed && !changes);
+	route_map_changes_free(&merged);
+	snapshot(map);
+}
+
+static void test_nested(struct route_map *map)
+{
+	struct route_map *called;
+	struct route_map_index *index;
+
+	printf("Called route-maps and on-match\n");
+
+	/* Its set clauses could change what the following sequences match */
+	called = route_map_get("CALLED");
+	index = route_map_index_get(called, RMAP_PERMIT, 10);
+	route_map_add_match(index, "tag", "1", RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "metric", "21");
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	index->nextrm = XSTRDUP(MTYPE_ROUTE_MAP_NAME, "CALLED");
+	route_map_upd8_dependency(RMAP_EVENT_CALL_ADDED, index->nextrm,
+				  map->name);
+	changed(map, false);
+
+	/* The map calling it is processed when it changes */
+	route_map_add_set(route_map_index_get(called, RMAP_PERMIT, 10),
+			  "metric", "22");
+	changed(map, false);
+
+	route_map_upd8_dependency(RMAP_EVENT_CALL_DELETED, index->nextrm,
+				  map->name);
+	XFREE(MTYPE_ROUTE_MAP_NAME, index->nextrm);
+	changed(map, false);
+
+	/* And once it's no longer called, only its own changes count */
+	route_map_add_set(route_map_index_get(called, RMAP_PERMIT, 10),
+			  "metric", "23");
+	route_map_add_set(index, "metric", "12");
+	assert(changed(map, true));
+
+	/* Which sequences are run changes */
+	index->exitpolicy = RMAP_NEXT;
+	route_map_index_exit_changed(index);
+	route_map_add_set(index, "metric", "13");
+	changed(map, false);
+
+	/* Seen by a later sequence once its set clauses ran */
+	index = route_map_index_get(map, RMAP_PERMIT, 25);
+	route_map_add_match(index, "tag", "1", RMAP_EVENT_MATCH_ADDED);
+	changed(map, false);
+}
+
+int main(void)
+{
+	struct route_map_index *index;
+	struct route_map *map;
+	bool processed;
+	uint32_t addr;
+	int i;
+
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	route_map_init();
+	prefix_list_init();
+
+	route_map_install_match(&match_plist_cmd);
+	route_map_install_match(&match_tag_cmd);
+	route_map_install_set(&set_metric_cmd);
+	route_map_add_hook(test_rmap_event);
+	route_map_delete_hook(test_rmap_event);
+	route_map_event_hook(test_rmap_event);
+
+	for (i = 0; i < N_ROUTES; i++) {
+		addr = 0x0a000000 | (frr_weak_random() & 0x3ffff) << 8;
+		prefixes[i].family = AF_INET;
+		prefixes[i].prefixlen = 16 + frr_weak_random() % 13;
+		prefixes[i].u.prefix4.s_addr = htonl(addr);
+		apply_mask(&prefixes[i]);
+		routes[i].tag = 1 + frr_weak_random() % 3;
+	}
+
+	/*
+	 * 10: permit the prefixes of PL with tag 1
+	 * 20: permit the ones with tag 2
+	 */
+	plist_add("PL", 10, PREFIX_PERMIT, "10.0.0.0/16", 16, 26);
+	map = route_map_get("RM");
+	index = route_map_index_get(map, RMAP_PERMIT, 10);
+	route_map_add_match(index, "ip address prefix-list", "PL",
+			    RMAP_EVENT_PLIST_ADDED);
+	route_map_add_match(index, "tag", "1", RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "metric", "10");
+	index = route_map_index_get(map, RMAP_PERMIT, 20);
+	route_map_add_match(index, "tag", "2", RMAP_EVENT_MATCH_ADDED);
+	route_map_add_set(index, "metric", "20");
+
+	/* Created, nothing to tell */
+	assert(!walk(map->name, &processed) && processed);
+	snapshot(map);
+
+	test_plist(map);
+	test_sequences(map);
+	test_merge(map);
+	test_nested(map);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestRoutemapChanges(frrtest.TestMultiOut):
+    program = "./test_routemap_changes"
+
+
+TestRoutemapChanges.exit_cleanly()
@@ -0,0 +1,113 @@
+/*
+ * Shared memory ring buffer tests.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <zebra.h>
+#include <pthread.h>
+
+#include "shmring.h"
+
+#define RING_SIZE 4096
+#define NUM_MSGS 100000
+
+static struct shmring *producer, *consumer;
+
+static void *thr_produce(void *arg)
+{
+	uint32_t i;
+
+	for (i = 0; i < NUM_MSGS; i++) {
+		while (!shmring_put(producer, &i, sizeof(i)))
+			;
+		shmring_wakeup(producer);
+	}
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/test_shmring.XXXXXX";
+	char path[256];
+	uint8_t in[RING_SIZE], out[RING_SIZE];
+	pthread_t thr;
+	uint32_t i, val;
+	size_t n;
+
+	assert(mkdtemp(dir));
+	snprintf(path, sizeof(path), "%s/ring", dir);
+
+	printf("Validating create and attach...\n");
+	producer = shmring_create(path, RING_SIZE - 100);
+	assert(producer);
+	assert(!shmring_create(path, RING_SIZE));
+	consumer = shmring_attach(path);
+	assert(consumer);
+	assert(access(path, F_OK) < 0);
+
+	assert(shmring_remain(consumer) == 0);
+	assert(shmring_space(producer) == RING_SIZE);
+
+	printf("Validating all or nothing writes...\n");
+	for (n = 0; n < sizeof(in); n++)
+		in[n] = n * 7;
+	assert(shmring_put(producer, in, 1000));
+	assert(!shmring_put(producer, in, RING_SIZE - 999));
+	assert(shmring_remain(consumer) == 1000);
+
+	printf("Validating wrapping reads and writes...\n");
+	assert(shmring_get(consumer, out, 600) == 600);
+	assert(!memcmp(in, out, 600));
+	assert(shmring_put(producer, in, RING_SIZE - 400));
+	assert(shmring_space(producer) == 0);
+	assert(shmring_peek(consumer, out, 100) == 100);
+	assert(!memcmp(in + 600, out, 100));
+	assert(shmring_get(consumer, out, 400) == 400);
+	assert(!memcmp(in + 600, out, 400));
+	assert(shmring_get(consumer, out, sizeof(out)) == RING_SIZE - 400);
+	assert(!memcmp(in, out, RING_SIZE - 400));
+	assert(shmring_remain(consumer) == 0);
+
+	printf("Validating wakeup handshake...\n");
+	assert(shmring_wakeup(producer));
+	assert(!shmring_wakeup(producer));
+	assert(shmring_idle(consumer));
+	assert(shmring_put(producer, in, 1));
+	assert(!shmring_idle(consumer));
+	assert(!shmring_wakeup(producer));
+	assert(shmring_get(consumer, out, 1) == 1);
+	assert(shmring_idle(consumer));
+	assert(shmring_wakeup(producer));
+
+	printf("Validating concurrent use...\n");
+	pthread_create(&thr, NULL, thr_produce, NULL);
+	for (i = 0; i < NUM_MSGS; i++) {
+		while (shmring_get(consumer, &val, sizeof(val)) == 0)
+			;
+		assert(val == i);
+	}
+	pthread_join(thr, NULL);
+	assert(shmring_remain(consumer) == 0);
+
+	shmring_del(consumer);
+	shmring_del(producer);
+	rmdir(dir);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestShmring(frrtest.TestMultiOut):
+    program = "./test_shmring"
+
+
+TestShmring.exit_cleanly()
@@ -39,7 +39,7 @@ static void dummy_func(struct thread *thread)
 {
 }
 
-int main(int argc, char **argv)
+static void run_bench(bool use_wheel)
 {
 	struct prng *prng;
 	int i;
@@ -48,6 +48,7 @@ int main(int argc, char **argv)
 	unsigned long t_schedule, t_remove;
 
 	master = thread_master_create(NULL);
+	thread_master_set_timer_wheel(master, use_wheel);
 	prng = prng_new(0);
 	timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
 
@@ -86,14 +87,24 @@ int main(int argc, char **argv)
 	t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
 	t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
 
-	printf("Scheduling %d random timers took %lu.%03lu seconds.\n",
-	       SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
-	printf("Removing %d random timers took %lu.%03lu seconds.\n",
-	       REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
+	printf("[%s] Scheduling %d random timers took %lu.%03lu seconds.\n",
+	       use_wheel ? "wheel" : "heap", SCHEDULE_TIMERS,
+	       t_schedule / 1000, t_schedule % 1000);
+	printf("[%s] Removing %d random timers took %lu.%03lu seconds.\n",
+	       use_wheel ? "wheel" : "heap", REMOVE_TIMERS, t_remove / 1000,
+	       t_remove % 1000);
 	fflush(stdout);
 
 	free(timers);
 	thread_master_free(master);
 	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	/* heap only, i.e. all timers ordered by deadline */
+	run_bench(false);
+	/* coarse timers (>= 1s) in the hierarchical timing wheel */
+	run_bench(true);
 	return 0;
 }
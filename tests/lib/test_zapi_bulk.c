@@ -0,0 +1,163 @@
+/*
+ * ZAPI bulk route message tests.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2, or (at your option) any later
+ * version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+#include <zebra.h>
+
+#include "stream.h"
+#include "thread.h"
+#include "zclient.h"
+
+#define NUM_ROUTES 3000
+#define NHG_ID 5
+
+static struct zclient *zclient;
+static struct stream *ibuf;
+static int peer;
+
+static void route_fill(struct zapi_route *api, unsigned int i,
+		       uint32_t nhgid)
+{
+	memset(api, 0, sizeof(*api));
+	api->vrf_id = VRF_DEFAULT;
+	api->type = ZEBRA_ROUTE_SHARP;
+	api->safi = SAFI_UNICAST;
+	api->prefix.family = AF_INET;
+	api->prefix.prefixlen = IPV4_MAX_BITLEN;
+	api->prefix.u.prefix4.s_addr = htonl(0x0a000000 + i);
+	SET_FLAG(api->message, ZAPI_MESSAGE_NHG);
+	api->nhgid = nhgid;
+}
+
+/* Read the next message zclient sent, returns its command */
+static uint16_t msg_read(void)
+{
+	uint16_t size, cmd;
+	uint8_t marker, version;
+	vrf_id_t vrf_id;
+
+	stream_reset(ibuf);
+	assert(zclient_read_header(ibuf, peer, &size, &marker, &version,
+				   &vrf_id, &cmd) == 0);
+	assert(STREAM_READABLE(ibuf) == size);
+	assert(vrf_id == VRF_DEFAULT);
+
+	return cmd;
+}
+
+/* Check a bulk message carrying routes first to first + count - 1 */
+static void bulk_check(uint16_t cmd, unsigned int first, unsigned int count,
+		       uint32_t nhgid)
+{
+	struct zapi_route api, expect;
+	uint16_t n;
+
+	assert(msg_read() == cmd);
+	assert(zapi_route_bulk_decode(ibuf, &api, &n) == 0);
+	assert(n == count);
+	assert(api.type == ZEBRA_ROUTE_SHARP);
+	assert(api.nhgid == nhgid);
+
+	while (n--) {
+		assert(zapi_route_bulk_decode_prefix(ibuf, &api) == 0);
+		route_fill(&expect, first++, nhgid);
+		assert(prefix_same(&api.prefix, &expect.prefix));
+	}
+	assert(STREAM_READABLE(ibuf) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	struct thread_master *master;
+	struct zapi_route api;
+	unsigned int i, first;
+	uint16_t n;
+	int sv[2];
+
+	master = thread_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	ibuf = stream_new(ZEBRA_MAX_PACKET_SIZ);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+	zclient->sock = sv[0];
+	peer = sv[1];
+
+	printf("Validating bulk add...\n");
+	for (i = 0; i < NUM_ROUTES; i++) {
+		route_fill(&api, i, NHG_ID);
+		assert(zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api)
+		       == ZCLIENT_SEND_SUCCESS);
+	}
+
+	/* a different nexthop group starts another message */
+	route_fill(&api, NUM_ROUTES, NHG_ID + 1);
+	zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api);
+	assert(zclient_route_bulk_flush(zclient) == ZCLIENT_SEND_SUCCESS);
+
+	first = 0;
+	while (first < NUM_ROUTES) {
+		/* as many as fit into a message */
+		assert(msg_read() == ZEBRA_ROUTE_BULK_ADD);
+		assert(zapi_route_bulk_decode(ibuf, &api, &n) == 0);
+		assert(api.nhgid == NHG_ID);
+		assert(n > 1 && first + n <= NUM_ROUTES);
+
+		while (n--) {
+			struct zapi_route expect;
+
+			assert(zapi_route_bulk_decode_prefix(ibuf, &api) == 0);
+			route_fill(&expect, first++, NHG_ID);
+			assert(prefix_same(&api.prefix, &expect.prefix));
+		}
+	}
+	bulk_check(ZEBRA_ROUTE_BULK_ADD, NUM_ROUTES, 1, NHG_ID + 1);
+
+	printf("Validating ordering with other messages...\n");
+	route_fill(&api, 0, NHG_ID);
+	zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	route_fill(&api, 1, NHG_ID);
+	zclient_route_bulk_send(ZEBRA_ROUTE_DELETE, zclient, &api);
+	route_fill(&api, 2, NHG_ID);
+	zclient_route_send(ZEBRA_ROUTE_ADD, zclient, &api);
+	bulk_check(ZEBRA_ROUTE_BULK_DELETE, 0, 2, NHG_ID);
+	assert(msg_read() == ZEBRA_ROUTE_ADD);
+	assert(zapi_route_decode(ibuf, &api) == 0);
+	assert(api.prefix.u.prefix4.s_addr == htonl(0x0a000002));
+
+	printf("Validating flush once the task is done...\n");
+	route_fill(&api, 7, NHG_ID);
+	zclient_route_bulk_send(ZEBRA_ROUTE_ADD, zclient, &api);
+	assert(zclient->bulk_count == 1);
+	while (zclient->bulk_count) {
+		struct thread thread;
+
+		assert(thread_fetch(master, &thread));
+		thread_call(&thread);
+	}
+	bulk_check(ZEBRA_ROUTE_BULK_ADD, 7, 1, NHG_ID);
+
+	close(sv[0]);
+	close(sv[1]);
+	zclient->sock = -1;
+	zclient_free(zclient);
+	stream_free(ibuf);
+	thread_master_free(master);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestZapiBulk(frrtest.TestMultiOut):
+    program = "./test_zapi_bulk"
+
+
+TestZapiBulk.exit_cleanly()
@@ -65,7 +65,7 @@ def scale_build_common(tgen):
         switch.add_link(tgen.gears["r1"])
 
 
-def scale_setup_module(module):
+def scale_setup_module(module, sharp_param=None):
     "Setup topology"
     tgen = Topogen(scale_build_common, module.__name__)
     tgen.start_topology()
@@ -76,7 +76,9 @@ def scale_setup_module(module):
             TopoRouter.RD_ZEBRA, os.path.join(CWD, "{}/zebra.conf".format(rname))
         )
         router.load_config(
-            TopoRouter.RD_SHARP, os.path.join(CWD, "{}/sharpd.conf".format(rname))
+            TopoRouter.RD_SHARP,
+            os.path.join(CWD, "{}/sharpd.conf".format(rname)),
+            sharp_param,
         )
 
     tgen.start_router()
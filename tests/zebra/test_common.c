@@ -0,0 +1,174 @@
+/*
+ * Common code for the zebra tests: a zebra without the kernel, its vrfs
+ * and the routes and interfaces the tests add to them.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "privs.h"
+#include "thread.h"
+#include "vrf.h"
+
+#include "zebra/interface.h"
+#include "zebra/rib.h"
+#include "zebra/zebra_nhg.h"
+#include "zebra/zebra_ns.h"
+#include "zebra/zebra_router.h"
+#include "zebra/zebra_vrf.h"
+#include "zebra/zserv.h"
+
+#include "test_common.h"
+
+/* need these to link in zebra */
+pid_t pid;
+struct thread_master *master;
+int retain_mode;
+int graceful_restart;
+bool v6_rr_semantics;
+uint32_t rcvbufsize;
+struct zebra_privs_t zserv_privs = {};
+
+void zebra_finalize(struct thread *event)
+{
+	exit(0);
+}
+
+static struct zebra_ns zns;
+
+/* The vrfs and their tables, without the kernel */
+static int test_vrf_new(struct vrf *vrf)
+{
+	struct zebra_vrf *zvrf = zebra_vrf_alloc(vrf);
+
+	zvrf->zns = &zns;
+	if (vrf->vrf_id != VRF_DEFAULT)
+		zvrf->table_id = VRF_RED_TABLE;
+
+	return 0;
+}
+
+static int test_vrf_enable(struct vrf *vrf)
+{
+	struct zebra_vrf *zvrf = vrf->info;
+
+	zvrf->table[AFI_IP][SAFI_UNICAST] = zebra_router_get_table(
+		zvrf, zvrf->table_id, AFI_IP, SAFI_UNICAST);
+	zvrf->rnh_table[AFI_IP] = route_table_init();
+
+	return 0;
+}
+
+/* The router, the rib and the default and red vrfs */
+void test_zebra_init(void)
+{
+	struct vrf *vrf;
+
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	zebra_if_init();
+	zrouter.master = master;
+
+	zebra_router_init(false, true);
+	rib_init();
+	vrf_init(test_vrf_new, test_vrf_enable, NULL, NULL);
+
+	vrf = vrf_get(VRF_RED, "red");
+	assert(vrf_enable(vrf));
+}
+
+/* The ipv4 unicast table of a vrf */
+struct route_table *test_vrf_table(vrf_id_t vrf_id)
+{
+	struct zebra_vrf *zvrf = zebra_vrf_lookup_by_id(vrf_id);
+
+	return zvrf->table[AFI_IP][SAFI_UNICAST];
+}
+
+/* Add an installed, selected route */
+struct route_entry *test_route_add(vrf_id_t vrf_id, const char *prefix,
+				   int type, const char *gate,
+				   ifindex_t ifindex, struct route_node **rnp)
+{
+	struct zebra_vrf *zvrf = zebra_vrf_lookup_by_id(vrf_id);
+	struct nhg_hash_entry nhe;
+	struct route_entry *re;
+	struct route_node *rn;
+	struct nexthop *nh;
+	struct in_addr addr;
+	struct prefix p;
+	rib_dest_t *dest;
+
+	assert(str2prefix(prefix, &p));
+
+	rn = srcdest_rnode_get(zvrf->table[AFI_IP][SAFI_UNICAST], &p, NULL);
+	dest = rib_dest_from_rnode(rn);
+	if (!dest)
+		dest = zebra_rib_create_dest(rn);
+
+	re = zebra_rib_route_entry_new(vrf_id, type, 0,
+				       ZEBRA_FLAG_ALLOW_RECURSION, 0,
+				       zvrf->table_id, 0, 0, 0, 0);
+	re_list_add_head(&dest->routes, re);
+
+	if (!gate)
+		nh = nexthop_from_ifindex(ifindex, vrf_id);
+	else {
+		assert(inet_pton(AF_INET, gate, &addr) == 1);
+		if (ifindex)
+			nh = nexthop_from_ipv4_ifindex(&addr, NULL, ifindex,
+						       vrf_id);
+		else
+			nh = nexthop_from_ipv4(&addr, NULL, vrf_id);
+	}
+
+	zebra_nhe_init(&nhe, AFI_IP, nh);
+	nhe.nhg.nexthop = nh;
+	nhe.vrf_id = vrf_id;
+	route_entry_update_nhe(re, zebra_nhg_rib_find_nhe(&nhe, AFI_IP));
+	nexthops_free(nh);
+
+	/* What rib_process() would do once installed */
+	nexthop_active_update(rn, re);
+	zebra_nhg_install_kernel(re->nhe);
+	for (ALL_NEXTHOPS(re->nhe->nhg, nh))
+		SET_FLAG(nh->flags, NEXTHOP_FLAG_FIB);
+	SET_FLAG(re->status, ROUTE_ENTRY_INSTALLED);
+	SET_FLAG(re->flags, ZEBRA_FLAG_SELECTED);
+	dest->selected_fib = re;
+	zebra_nhg_pic_dest_update(rn);
+
+	if (rnp)
+		*rnp = rn;
+	return re;
+}
+
+/* An interface with a connected route */
+void test_if_add(const char *name, ifindex_t ifindex, vrf_id_t vrf_id,
+		 const char *prefix)
+{
+	struct interface *ifp;
+
+	ifp = if_get_by_name(name, vrf_id, NULL);
+	if_set_index(ifp, ifindex);
+	SET_FLAG(ifp->flags, IFF_UP | IFF_RUNNING);
+
+	test_route_add(vrf_id, prefix, ZEBRA_ROUTE_CONNECT, NULL, ifindex,
+		       NULL);
+}
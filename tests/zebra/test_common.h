@@ -0,0 +1,41 @@
+/*
+ * Common definitions for the zebra tests: a zebra without the kernel, its
+ * vrfs and the routes and interfaces the tests add to them.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _ZEBRA_TEST_COMMON_H
+#define _ZEBRA_TEST_COMMON_H
+
+#include "zebra/rib.h"
+
+/* The vrf the tests have next to the default one */
+#define VRF_RED 100
+#define VRF_RED_TABLE 1100
+
+/* Prototypes. */
+extern void test_zebra_init(void);
+extern struct route_table *test_vrf_table(vrf_id_t vrf_id);
+extern struct route_entry *test_route_add(vrf_id_t vrf_id, const char *prefix,
+					  int type, const char *gate,
+					  ifindex_t ifindex,
+					  struct route_node **rnp);
+extern void test_if_add(const char *name, ifindex_t ifindex, vrf_id_t vrf_id,
+			const char *prefix);
+
+#endif /* _ZEBRA_TEST_COMMON_H */
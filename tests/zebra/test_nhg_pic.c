@@ -0,0 +1,323 @@
+/*
+ * Test program for the in place update of the recursive nexthop-groups
+ * installed for PIC: what they resolve to, their dependencies, the
+ * references the routes using them hold on those, the update the dataplane
+ * gets and what resolves through the routes using them.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "zebra/zebra_nhg.c"
+
+#include "frr_pthread.h"
+
+#include "test_common.h"
+
+/*
+ * The nexthop updates the dataplane got.  They go through its test provider
+ * and this one, which stands in for the kernel.
+ */
+static struct nh_update {
+	uint32_t id;
+	uint32_t depend;
+	struct in_addr gate;
+} nh_updates[16];
+static unsigned int nh_updates_count;
+static pthread_mutex_t nh_updates_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static void test_provider_update(struct zebra_dplane_ctx *ctx)
+{
+	const struct nexthop_group *ng = dplane_ctx_get_nhe_ng(ctx);
+	struct nh_update *update;
+	struct nexthop *nh;
+
+	assert(dplane_ctx_get_status(ctx) == ZEBRA_DPLANE_REQUEST_SUCCESS);
+	assert(dplane_ctx_get_nhe_nh_grp_count(ctx) == 1);
+
+	frr_with_mutex (&nh_updates_mtx) {
+		assert(nh_updates_count < array_size(nh_updates));
+		update = &nh_updates[nh_updates_count++];
+
+		update->id = dplane_ctx_get_nhe_id(ctx);
+		update->depend = dplane_ctx_get_nhe_nh_grp(ctx)[0].id;
+		for (ALL_NEXTHOPS_PTR(ng, nh))
+			if (!CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE))
+				update->gate = nh->gate.ipv4;
+	}
+}
+
+static int test_provider_process(struct zebra_dplane_provider *prov)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	while ((ctx = dplane_provider_dequeue_in_ctx(prov))) {
+		if (dplane_ctx_get_op(ctx) == DPLANE_OP_NH_UPDATE)
+			test_provider_update(ctx);
+
+		dplane_ctx_set_skip_kernel(ctx);
+		dplane_provider_enqueue_out_ctx(prov, ctx);
+	}
+
+	return 0;
+}
+
+/* Run zebra until the dataplane handed back what was queued for nhe */
+static void dplane_wait(struct nhg_hash_entry *nhe)
+{
+	struct thread thread;
+
+	while (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED))
+		if (thread_fetch(zrouter.master, &thread))
+			thread_call(&thread);
+
+	assert(CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED));
+}
+
+static struct nhg_hash_entry *only_depend(struct nhg_hash_entry *nhe)
+{
+	struct nhg_connected *rb_node_dep;
+
+	assert(nhg_connected_tree_count(&nhe->nhg_depends) == 1);
+	rb_node_dep = nhg_connected_tree_first(&nhe->nhg_depends);
+	return rb_node_dep->nhe;
+}
+
+static bool is_dependent(struct nhg_hash_entry *depend,
+			 struct nhg_hash_entry *nhe)
+{
+	struct nhg_connected lookup = { .nhe = nhe };
+
+	return !!nhg_connected_tree_find(&depend->nhg_dependents, &lookup);
+}
+
+static void check_resolved(struct nhg_hash_entry *nhe, const char *gate)
+{
+	struct nexthop *resolved = nhe->nhg.nexthop->resolved;
+	struct nhg_hash_entry *depend = only_depend(nhe);
+	struct in_addr addr;
+
+	assert(inet_pton(AF_INET, gate, &addr) == 1);
+
+	assert(CHECK_FLAG(nhe->nhg.nexthop->flags, NEXTHOP_FLAG_RECURSIVE));
+	assert(resolved && !resolved->next);
+	assert(IPV4_ADDR_SAME(&resolved->gate.ipv4, &addr));
+	assert(CHECK_FLAG(resolved->flags, NEXTHOP_FLAG_FIB));
+
+	assert(depend->nhg.nexthop && !depend->nhg.nexthop->next);
+	assert(IPV4_ADDR_SAME(&depend->nhg.nexthop->gate.ipv4, &addr));
+	assert(is_dependent(depend, nhe));
+
+	/* Still found by its id, and by its new nexthops */
+	assert(zebra_nhg_lookup_id(nhe->id) == nhe);
+	assert(hash_lookup(zrouter.nhgs, nhe) == nhe);
+}
+
+/* The count-th update of a group the dataplane got, the last one */
+static void check_update(struct nhg_hash_entry *nhe, unsigned int count,
+			 const char *gate)
+{
+	struct nh_update *update = NULL;
+	struct in_addr addr;
+	unsigned int i, n = 0;
+
+	assert(inet_pton(AF_INET, gate, &addr) == 1);
+
+	dplane_wait(nhe);
+
+	frr_with_mutex (&nh_updates_mtx) {
+		for (i = 0; i < nh_updates_count; i++)
+			if (nh_updates[i].id == nhe->id) {
+				update = &nh_updates[i];
+				n++;
+			}
+	}
+
+	assert(update && n == count);
+	assert(update->depend == only_depend(nhe)->id);
+	assert(IPV4_ADDR_SAME(&update->gate, &addr));
+}
+
+/* A nexthop tracked through one of the routes using a group */
+static void check_tracked(struct rnh *rnh, const char *route, const char *gate)
+{
+	struct nexthop *nh = rnh->state->nhe->nhg.nexthop;
+	struct in_addr addr;
+	struct prefix p;
+
+	assert(str2prefix(route, &p));
+	assert(inet_pton(AF_INET, gate, &addr) == 1);
+
+	assert(prefix_same(&rnh->resolved_route, &p));
+	assert(CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE));
+	assert(nh->resolved && !nh->resolved->next);
+	assert(IPV4_ADDR_SAME(&nh->resolved->gate.ipv4, &addr));
+}
+
+static void test_update(struct nhg_hash_entry *g, struct nhg_hash_entry *r,
+			struct rnh *rnh)
+{
+	struct nhg_hash_entry *d1, *d2;
+	uint32_t d1_refcnt, d2_refcnt, id;
+	struct route_entry *re;
+	struct route_node *rn;
+	uint64_t updates;
+
+	printf("Group updated in place\n");
+
+	check_resolved(g, "192.168.1.1");
+	id = g->id;
+	d1 = only_depend(g);
+
+	/* Keep the old dependency around to check its references */
+	zebra_nhg_increment_ref(d1);
+	d1_refcnt = d1->refcnt;
+	assert(d1_refcnt >= g->refcnt + r->refcnt + 3);
+
+	/* Nothing changed, nothing to do */
+	updates = zrouter.nhg_pic_updates;
+	assert(!zebra_nhg_pic_update_nhe(g, AFI_IP));
+	assert(zrouter.nhg_pic_updates == updates);
+	assert(only_depend(g) == d1 && d1->refcnt == d1_refcnt);
+
+	/* A more specific route to the gateway, its nexthop is the new one */
+	re = test_route_add(VRF_DEFAULT, "10.0.0.0/28", ZEBRA_ROUTE_OSPF,
+			    "192.168.2.1", 3, &rn);
+	d2 = re->nhe;
+	zebra_nhg_increment_ref(d2);
+	d2_refcnt = d2->refcnt;
+
+	/* Only the group whose gateway it covers is updated and queued */
+	zebra_nhg_pic_update(rn);
+	assert(zrouter.nhg_pic_updates == updates + 1);
+	assert(CHECK_FLAG(g->flags, NEXTHOP_GROUP_QUEUED));
+	assert(CHECK_FLAG(g->flags, NEXTHOP_GROUP_PIC));
+	assert(!CHECK_FLAG(r->flags, NEXTHOP_GROUP_QUEUED));
+
+	assert(g->id == id);
+	check_resolved(g, "192.168.2.1");
+
+	/* Its own reference and those of its routes moved over with it */
+	assert(only_depend(g) == d2);
+	assert(d2->refcnt == d2_refcnt + g->refcnt + 1);
+	assert(d1->refcnt == d1_refcnt - g->refcnt - 1);
+	assert(!is_dependent(d1, g));
+
+	/* The dataplane replaces it under the same id */
+	check_update(g, 1, "192.168.2.1");
+
+	/* Then what resolves through the routes using it follows */
+	check_tracked(rnh, "1.1.1.0/24", "192.168.2.1");
+	assert(zrouter.nhg_pic_updates == updates + 2);
+	check_resolved(r, "192.168.2.1");
+	check_update(r, 1, "192.168.2.1");
+	assert(d1->refcnt == d1_refcnt - g->refcnt - r->refcnt - 2);
+
+	zebra_nhg_decrement_ref(d1);
+	zebra_nhg_decrement_ref(d2);
+}
+
+static void test_vrf(struct nhg_hash_entry *g, struct nhg_hash_entry *r,
+		     struct rnh *rnh)
+{
+	struct route_node *rn_red, *rn;
+	uint64_t updates;
+
+	printf("Routes of other vrfs\n");
+
+	/* Not looked at until something in its vrf changes */
+	test_route_add(VRF_DEFAULT, "10.0.0.4/30", ZEBRA_ROUTE_OSPF,
+		       "192.168.3.1", 4, &rn);
+	test_route_add(VRF_RED, "10.0.0.0/24", ZEBRA_ROUTE_OSPF, "192.168.9.1",
+		       9, &rn_red);
+
+	updates = zrouter.nhg_pic_updates;
+	zebra_nhg_pic_update(rn_red);
+	assert(zrouter.nhg_pic_updates == updates);
+	check_resolved(g, "192.168.2.1");
+
+	zebra_nhg_pic_update(rn);
+	assert(zrouter.nhg_pic_updates == updates + 1);
+	check_resolved(g, "192.168.3.1");
+	check_update(g, 2, "192.168.3.1");
+
+	check_tracked(rnh, "1.1.1.0/24", "192.168.3.1");
+	check_resolved(r, "192.168.3.1");
+	check_update(r, 2, "192.168.3.1");
+}
+
+int main(void)
+{
+	struct route_entry *b1, *b2, *b3;
+	struct nhg_hash_entry *g, *r;
+	struct prefix p;
+	struct rnh *rnh;
+	bool exists;
+
+	test_zebra_init();
+	zrouter.supports_nhgs = true;
+	zebra_nhg_enable_pic(true);
+
+	/* The dataplane pthread, with our provider after its test one */
+	assert(dplane_provider_register("PIC test", DPLANE_PRIO_PRE_KERNEL,
+					DPLANE_PROV_FLAGS_DEFAULT, NULL,
+					test_provider_process, NULL, NULL,
+					NULL) == 0);
+	frr_pthread_init();
+	zebra_dplane_start();
+
+	test_if_add("eth2", 2, VRF_DEFAULT, "192.168.1.0/24");
+	test_if_add("eth3", 3, VRF_DEFAULT, "192.168.2.0/24");
+	test_if_add("eth4", 4, VRF_DEFAULT, "192.168.3.0/24");
+	test_if_add("red9", 9, VRF_RED, "192.168.9.0/24");
+
+	/* Two routes through a recursive group */
+	test_route_add(VRF_DEFAULT, "10.0.0.0/24", ZEBRA_ROUTE_OSPF,
+		       "192.168.1.1", 2, NULL);
+	b1 = test_route_add(VRF_DEFAULT, "1.1.1.0/24", ZEBRA_ROUTE_BGP,
+			    "10.0.0.5", 0, NULL);
+	b2 = test_route_add(VRF_DEFAULT, "2.2.2.0/24", ZEBRA_ROUTE_BGP,
+			    "10.0.0.5", 0, NULL);
+
+	g = b1->nhe;
+	assert(b2->nhe == g && g->refcnt == 2);
+	assert(CHECK_FLAG(g->flags, NEXTHOP_GROUP_PIC));
+	dplane_wait(g);
+
+	/* A route and a nexthop resolving through one of them */
+	b3 = test_route_add(VRF_DEFAULT, "3.3.3.0/24", ZEBRA_ROUTE_BGP,
+			    "1.1.1.9", 0, NULL);
+	r = b3->nhe;
+	assert(r != g && CHECK_FLAG(r->flags, NEXTHOP_GROUP_PIC));
+	check_resolved(r, "192.168.1.1");
+	dplane_wait(r);
+
+	assert(str2prefix("1.1.1.7/32", &p));
+	rnh = zebra_add_rnh(&p, VRF_DEFAULT, SAFI_UNICAST, &exists);
+	zebra_evaluate_rnh(zebra_vrf_lookup_by_id(VRF_DEFAULT), AFI_IP, 1, &p,
+			   SAFI_UNICAST);
+	check_tracked(rnh, "1.1.1.0/24", "192.168.1.1");
+
+	test_update(g, r, rnh);
+	test_vrf(g, r, rnh);
+
+	zebra_dplane_shutdown();
+
+	printf("Done.\n");
+	return 0;
+}
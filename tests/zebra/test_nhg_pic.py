@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestNhgPic(frrtest.TestMultiOut):
+    program = "./test_nhg_pic"
+
+
+TestNhgPic.exit_cleanly()
@@ -0,0 +1,226 @@
+/*
+ * Test program for the processing of route changes in the rib: which
+ * tracked nexthops are evaluated when a route changes, and the order the
+ * route nodes queued for the tables of the vrfs are processed in.
+ *
+ * This file is part of FRRouting.
+ *
+ * FRRouting is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * FRRouting is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "zebra/zebra_rib.c"
+
+#include "test_common.h"
+
+/* A tracked nexthop, resolved */
+static struct rnh *rnh_add(const char *addr)
+{
+	struct zebra_vrf *zvrf = zebra_vrf_lookup_by_id(VRF_DEFAULT);
+	struct prefix p;
+	struct rnh *rnh;
+	bool exists;
+
+	assert(str2prefix(addr, &p));
+	rnh = zebra_add_rnh(&p, VRF_DEFAULT, SAFI_UNICAST, &exists);
+	assert(rnh && !exists);
+	zebra_evaluate_rnh(zvrf, AFI_IP, 1, &p, SAFI_UNICAST);
+
+	return rnh;
+}
+
+static void check_resolved(struct rnh *rnh, const char *prefix)
+{
+	struct prefix p;
+
+	assert(str2prefix(prefix, &p));
+	assert(prefix_same(&rnh->resolved_route, &p));
+}
+
+/* The tracked nexthops evaluated and skipped for a change of rn */
+static void changed(struct route_node *rn, uint64_t evals, uint64_t avoided)
+{
+	uint64_t evals_before = zrouter.nht_evals;
+	uint64_t avoided_before = zrouter.nht_evals_avoided;
+
+	zebra_rib_evaluate_rn_nexthops(rn, zebra_router_get_next_sequence(),
+				       false);
+	assert(zrouter.nht_evals == evals_before + evals);
+	assert(zrouter.nht_evals_avoided == avoided_before + avoided);
+}
+
+static void test_nht(void)
+{
+	struct route_node *rn8, *rn16, *rn;
+	struct rnh *r1, *r2;
+
+	printf("Nexthops evaluated on route changes\n");
+
+	test_route_add(VRF_DEFAULT, "10.0.0.0/8", ZEBRA_ROUTE_OSPF,
+		       "192.168.1.1", 2, &rn8);
+	r1 = rnh_add("10.1.1.1/32");
+	r2 = rnh_add("10.2.2.2/32");
+	check_resolved(r1, "10.0.0.0/8");
+	check_resolved(r2, "10.0.0.0/8");
+
+	/* Both could resolve through another route */
+	changed(rn8, 2, 0);
+
+	/* Only the one in the more specific route moves to it */
+	test_route_add(VRF_DEFAULT, "10.1.0.0/16", ZEBRA_ROUTE_OSPF,
+		       "192.168.1.2", 2, &rn16);
+	changed(rn16, 1, 1);
+	check_resolved(r1, "10.1.0.0/16");
+	check_resolved(r2, "10.0.0.0/8");
+
+	/* Nothing tracked is in this one */
+	test_route_add(VRF_DEFAULT, "10.3.0.0/16", ZEBRA_ROUTE_OSPF,
+		       "192.168.1.3", 2, &rn);
+	changed(rn, 0, 1);
+	check_resolved(r2, "10.0.0.0/8");
+
+	/* Those resolving through the changed route itself are */
+	changed(rn16, 1, 1);
+}
+
+/* A route queued for processing */
+static struct route_node *queued_add(struct meta_queue *mq, vrf_id_t vrf_id,
+				     int i)
+{
+	struct route_node *rn;
+	unsigned int lock;
+	char prefix[32];
+
+	snprintf(prefix, sizeof(prefix), "172.16.%d.0/24", i);
+	if (vrf_id == VRF_DEFAULT)
+		test_route_add(vrf_id, prefix, ZEBRA_ROUTE_OSPF, "192.168.1.1",
+			       2, &rn);
+	else
+		test_route_add(vrf_id, prefix, ZEBRA_ROUTE_OSPF, "192.168.9.1",
+			       9, &rn);
+
+	lock = rn->lock;
+	assert(rib_meta_queue_add(mq, rn) == 0);
+	assert(rn->lock == lock + 1);
+
+	/* Only once */
+	assert(rib_meta_queue_add(mq, rn) == -1);
+
+	return rn;
+}
+
+static void check_processed(struct route_node *rn)
+{
+	uint8_t qindex = route_info[ZEBRA_ROUTE_OSPF].meta_q_map;
+
+	assert(!CHECK_FLAG(rib_dest_from_rnode(rn)->flags,
+			   RIB_ROUTE_QUEUED(qindex)));
+}
+
+/* Process the next route node, and return the table it was in */
+static struct route_table *process_next(struct meta_queue *mq)
+{
+	struct meta_queue_table *mqt = mq_table_list_first(&mq->turns);
+	uint32_t size = mq->size;
+	struct route_table *table;
+	wq_item_status ret;
+
+	assert(mqt);
+	table = mqt->table;
+
+	ret = meta_queue_process(NULL, mq);
+	assert(mq->size == size - 1);
+	assert(ret == (mq->size ? WQ_REQUEUE : WQ_SUCCESS));
+
+	return table;
+}
+
+#define N_DEFAULT (MQ_TABLE_QUANTUM + 8)
+#define N_RED 3
+
+static void test_meta_queue(void)
+{
+	struct route_node *rn_default[N_DEFAULT], *rn_red[N_RED];
+	struct route_table *table_default = test_vrf_table(VRF_DEFAULT);
+	struct route_table *table_red = test_vrf_table(VRF_RED);
+	struct meta_queue *mq = meta_queue_new();
+	unsigned int lock[N_RED];
+	int i;
+
+	printf("Route nodes queued per table\n");
+
+	for (i = 0; i < N_DEFAULT; i++)
+		rn_default[i] = queued_add(mq, VRF_DEFAULT, i);
+	for (i = 0; i < N_RED; i++)
+		rn_red[i] = queued_add(mq, VRF_RED, i);
+	assert(mq->size == N_DEFAULT + N_RED);
+	assert(mq_table_hash_count(&mq->tables) == 2);
+
+	/* The first table has its quantum, then the next one its turn */
+	for (i = 0; i < MQ_TABLE_QUANTUM; i++)
+		assert(process_next(mq) == table_default);
+	for (i = 0; i < N_RED; i++)
+		assert(process_next(mq) == table_red);
+
+	/* Done with, its queues are gone until it has work again */
+	assert(mq_table_hash_count(&mq->tables) == 1);
+	for (i = 0; i < N_RED; i++)
+		check_processed(rn_red[i]);
+
+	for (i = MQ_TABLE_QUANTUM; i < N_DEFAULT; i++)
+		assert(process_next(mq) == table_default);
+	for (i = 0; i < N_DEFAULT; i++)
+		check_processed(rn_default[i]);
+	assert(!mq->size && !mq_table_hash_count(&mq->tables));
+	assert(!mq_table_list_count(&mq->turns));
+	assert(mq->max_tables == 2);
+
+	printf("Route nodes of a vrf dropped\n");
+
+	for (i = 0; i < N_RED; i++) {
+		lock[i] = rn_red[i]->lock;
+		assert(rib_meta_queue_add(mq, rn_red[i]) == 0);
+		assert(rib_meta_queue_add(mq, rn_default[i]) == 0);
+	}
+	assert(mq_table_hash_count(&mq->tables) == 2);
+
+	/* Only those of its tables, and the references they held */
+	rib_meta_queue_free(mq, zebra_vrf_lookup_by_id(VRF_RED));
+	assert(mq->size == N_RED);
+	assert(mq_table_hash_count(&mq->tables) == 1);
+	for (i = 0; i < N_RED; i++)
+		assert(rn_red[i]->lock == lock[i]);
+
+	for (i = 0; i < N_RED; i++)
+		assert(process_next(mq) == table_default);
+	assert(!mq_table_hash_count(&mq->tables));
+
+	meta_queue_free(mq, NULL);
+}
+
+int main(void)
+{
+	test_zebra_init();
+
+	test_if_add("eth2", 2, VRF_DEFAULT, "192.168.1.0/24");
+	test_if_add("red9", 9, VRF_RED, "192.168.9.0/24");
+
+	test_nht();
+	test_meta_queue();
+
+	printf("Done.\n");
+	return 0;
+}
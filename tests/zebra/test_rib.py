@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestRib(frrtest.TestMultiOut):
+    program = "./test_rib"
+
+
+TestRib.exit_cleanly()
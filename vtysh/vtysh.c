@@ -37,6 +37,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "buffer.h"
 #include "linklist.h"
 #include "command.h"
 #include "memory.h"
@@ -2778,6 +2779,55 @@ static int show_per_daemon(struct vty *vty, struct cmd_token **argv, int argc,
 	return ret;
 }
 
+static void show_per_daemon_json_line(void *arg, const char *line)
+{
+	struct buffer *b = arg;
+
+	buffer_putstr(b, line);
+	buffer_putstr(b, "\n");
+}
+
+/* The JSON output of all daemons, as one object keyed by daemon name */
+static int show_per_daemon_json(struct vty *vty, struct cmd_token **argv,
+				int argc)
+{
+	unsigned int i;
+	int ret = CMD_SUCCESS;
+	char *line = do_prepend(vty, argv, argc);
+	json_object *json = json_object_new_object();
+	json_object *json_daemon;
+	struct buffer *b;
+	char *output;
+
+	/* suppress the output of the daemons, it is collected instead */
+	vty->of_saved = vty->of;
+	vty->of = NULL;
+
+	for (i = 0; i < array_size(vtysh_client); i++)
+		if (vtysh_client[i].fd >= 0 || vtysh_client[i].next) {
+			b = buffer_new(0);
+			ret = vtysh_client_run_all(&vtysh_client[i], line, 0,
+						   show_per_daemon_json_line,
+						   b);
+			output = buffer_getstr(b);
+			buffer_free(b);
+
+			json_daemon = json_tokener_parse(output);
+			if (json_daemon)
+				json_object_object_add(
+					json, vtysh_client[i].name,
+					json_daemon);
+			XFREE(MTYPE_TMP, output);
+		}
+
+	vty->of = vty->of_saved;
+	vty_json(vty, json);
+
+	XFREE(MTYPE_TMP, line);
+
+	return ret;
+}
+
 static int show_one_daemon(struct vty *vty, struct cmd_token **argv, int argc,
 			   const char *name)
 {
@@ -2822,6 +2872,22 @@ DEFUN (vtysh_show_thread,
 	return show_per_daemon(vty, argv, argc, "Thread statistics for %s:\n");
 }
 
+DEFUN (vtysh_show_thread_percentiles,
+       vtysh_show_thread_percentiles_cmd,
+       "show thread cpu percentiles [FILTER] [json]",
+       SHOW_STR
+       "Thread information\n"
+       "Thread CPU usage\n"
+       "Time percentiles\n"
+       "Display filter (rwtex)\n"
+       JSON_STR)
+{
+	if (strmatch(argv[argc - 1]->text, "json"))
+		return show_per_daemon_json(vty, argv, argc);
+
+	return show_per_daemon(vty, argv, argc, "Thread statistics for %s:\n");
+}
+
 DEFUN (vtysh_show_work_queues,
        vtysh_show_work_queues_cmd,
        "show work-queues",
@@ -4923,6 +4989,7 @@ void vtysh_init_vty(void)
 	install_element(VIEW_NODE, &vtysh_show_work_queues_cmd);
 	install_element(VIEW_NODE, &vtysh_show_work_queues_daemon_cmd);
 	install_element(VIEW_NODE, &vtysh_show_thread_cmd);
+	install_element(VIEW_NODE, &vtysh_show_thread_percentiles_cmd);
 	install_element(VIEW_NODE, &vtysh_show_poll_cmd);
 	install_element(VIEW_NODE, &vtysh_show_thread_timer_cmd);
 
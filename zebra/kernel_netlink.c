@@ -91,6 +91,19 @@
  */
 #define NL_DEFAULT_BATCH_SEND_THRESHOLD (15 * NL_PKT_BUF_SIZE)
 
+/*
+ * Number of batches that may be sent before the responses to the first one
+ * are read.
+ */
+#define NL_DEFAULT_BATCH_WINDOW 4
+
+/*
+ * Generous estimate of the receive buffer space the kernel charges for one
+ * ack.  The acks of all batches in flight have to fit into the dplane
+ * socket's receive buffer, an overrun loses them and is fatal.
+ */
+#define NL_ACK_TRUESIZE 1024
+
 static const struct message nlmsg_str[] = {{RTM_NEWROUTE, "RTM_NEWROUTE"},
 					   {RTM_DELROUTE, "RTM_DELROUTE"},
 					   {RTM_GETROUTE, "RTM_GETROUTE"},
@@ -190,6 +203,26 @@ char *nl_batch_tx_buf;
 
 _Atomic uint32_t nl_batch_bufsize = NL_DEFAULT_BATCH_BUFSIZE;
 _Atomic uint32_t nl_batch_send_threshold = NL_DEFAULT_BATCH_SEND_THRESHOLD;
+_Atomic uint32_t nl_batch_window = NL_DEFAULT_BATCH_WINDOW;
+
+/* Batching statistics, updated by the dplane pthread */
+static _Atomic uint64_t nl_batch_stat_sent;
+static _Atomic uint64_t nl_batch_stat_msgs;
+static _Atomic uint64_t nl_batch_stat_resps;
+static _Atomic uint64_t nl_batch_stat_errors;
+static _Atomic uint64_t nl_batch_stat_drains;
+static _Atomic uint32_t nl_batch_stat_inflight_max;
+
+/* A batch that was sent and whose responses have not all been read yet */
+struct nl_batch_inflight {
+	struct dplane_ctx_q ctx_list;
+
+	/* Range of sequence numbers used by the batch's contexts */
+	uint32_t seq_first;
+	uint32_t seq_last;
+
+	size_t msgcnt;
+};
 
 struct nl_batch {
 	void *buf;
@@ -204,6 +237,20 @@ struct nl_batch {
 
 	struct dplane_ctx_q ctx_list;
 
+	/*
+	 * Batches in flight, a ring of 'inflight_cnt' entries starting at
+	 * 'inflight_head', oldest first.  They were all sent to the namespace
+	 * 'inflight_zns'.
+	 */
+	struct nl_batch_inflight inflight[NL_BATCH_WINDOW_MAX];
+	unsigned int inflight_head;
+	unsigned int inflight_cnt;
+	size_t inflight_msgs;
+	const struct zebra_dplane_info *inflight_zns;
+
+	unsigned int window;
+	size_t ack_budget;
+
 	/*
 	 * Pointer to the queue of completed contexts outbound back
 	 * towards the dataplane module.
@@ -217,12 +264,17 @@ int netlink_config_write_helper(struct vty *vty)
 		atomic_load_explicit(&nl_batch_bufsize, memory_order_relaxed);
 	uint32_t threshold = atomic_load_explicit(&nl_batch_send_threshold,
 						  memory_order_relaxed);
+	uint32_t window =
+		atomic_load_explicit(&nl_batch_window, memory_order_relaxed);
 
 	if (size != NL_DEFAULT_BATCH_BUFSIZE
 	    || threshold != NL_DEFAULT_BATCH_SEND_THRESHOLD)
 		vty_out(vty, "zebra kernel netlink batch-tx-buf %u %u\n", size,
 			threshold);
 
+	if (window != NL_DEFAULT_BATCH_WINDOW)
+		vty_out(vty, "zebra kernel netlink batch-window %u\n", window);
+
 	if (if_netlink_frr_protodown_r_bit_is_set())
 		vty_out(vty, "zebra protodown reason-bit %u\n",
 			if_netlink_get_frr_protodown_r_bit());
@@ -242,6 +294,35 @@ void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold, bool set)
 			      memory_order_relaxed);
 }
 
+void netlink_set_batch_window(uint32_t window, bool set)
+{
+	if (!set)
+		window = NL_DEFAULT_BATCH_WINDOW;
+
+	atomic_store_explicit(&nl_batch_window, window, memory_order_relaxed);
+}
+
+void netlink_batch_show_helper(struct vty *vty)
+{
+	vty_out(vty,
+		"Kernel netlink batches: %" PRIu64 ", messages: %" PRIu64
+		", responses: %" PRIu64 ", errors: %" PRIu64 "\n",
+		atomic_load_explicit(&nl_batch_stat_sent, memory_order_relaxed),
+		atomic_load_explicit(&nl_batch_stat_msgs, memory_order_relaxed),
+		atomic_load_explicit(&nl_batch_stat_resps,
+				     memory_order_relaxed),
+		atomic_load_explicit(&nl_batch_stat_errors,
+				     memory_order_relaxed));
+	vty_out(vty,
+		"Kernel netlink window: %u, in flight max: %u, drains: %" PRIu64
+		"\n",
+		atomic_load_explicit(&nl_batch_window, memory_order_relaxed),
+		atomic_load_explicit(&nl_batch_stat_inflight_max,
+				     memory_order_relaxed),
+		atomic_load_explicit(&nl_batch_stat_drains,
+				     memory_order_relaxed));
+}
+
 int netlink_talk_filter(struct nlmsghdr *h, ns_id_t ns_id, int startup)
 {
 	/*
@@ -1281,6 +1362,51 @@ int netlink_request(struct nlsock *nl, void *req)
 	return 0;
 }
 
+/*
+ * Move the contexts of the oldest batch in flight to the outbound queue.
+ * Contexts that did not receive an error are considered successful.
+ */
+static void nl_batch_inflight_done(struct nl_batch *bth, bool failed)
+{
+	struct nl_batch_inflight *ifl = &bth->inflight[bth->inflight_head];
+	struct zebra_dplane_ctx *ctx;
+
+	while ((ctx = dplane_ctx_dequeue(&(ifl->ctx_list))) != NULL) {
+		if (failed)
+			dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+		dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
+	}
+
+	bth->inflight_msgs -= ifl->msgcnt;
+	bth->inflight_head = (bth->inflight_head + 1) % NL_BATCH_WINDOW_MAX;
+	bth->inflight_cnt--;
+}
+
+/*
+ * Find the batch in flight a response belongs to.  Responses are received in
+ * the order the requests were sent, so all batches sent before that one have
+ * received all of their responses.
+ */
+static struct nl_batch_inflight *nl_batch_inflight_lookup(struct nl_batch *bth,
+							  uint32_t seq)
+{
+	struct nl_batch_inflight *ifl;
+
+	while (bth->inflight_cnt > 0) {
+		ifl = &bth->inflight[bth->inflight_head];
+
+		/* Sequence numbers wrap around */
+		if ((int32_t)(seq - ifl->seq_first) < 0)
+			return NULL;
+		if (seq - ifl->seq_first <= ifl->seq_last - ifl->seq_first)
+			return ifl;
+
+		nl_batch_inflight_done(bth, false);
+	}
+
+	return NULL;
+}
+
 static int nl_batch_read_resp(struct nl_batch *bth)
 {
 	struct nlmsghdr *h;
@@ -1289,9 +1415,10 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 	int status, seq;
 	struct nlsock *nl;
 	struct zebra_dplane_ctx *ctx;
+	struct nl_batch_inflight *ifl;
 	bool ignore_msg;
 
-	nl = kernel_netlink_nlsock_lookup(bth->zns->sock);
+	nl = kernel_netlink_nlsock_lookup(bth->inflight_zns->sock);
 
 	msg.msg_name = (void *)&snl;
 	msg.msg_namelen = sizeof(snl);
@@ -1311,20 +1438,28 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 		 *
 		 */
 		if (status == -1 || status == 0) {
-			while ((ctx = dplane_ctx_dequeue(&(bth->ctx_list))) !=
-			       NULL) {
-				if (status == -1)
-					dplane_ctx_set_status(
-						ctx,
-						ZEBRA_DPLANE_REQUEST_FAILURE);
-				dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
-			}
+			while (bth->inflight_cnt > 0)
+				nl_batch_inflight_done(bth, status == -1);
 			return status;
 		}
 
+		atomic_fetch_add_explicit(&nl_batch_stat_resps, 1,
+					  memory_order_relaxed);
+
 		h = (struct nlmsghdr *)nl->buf;
 		ignore_msg = false;
 		seq = h->nlmsg_seq;
+
+		ifl = nl_batch_inflight_lookup(bth, seq);
+		if (ifl == NULL) {
+			if (IS_ZEBRA_DEBUG_KERNEL)
+				zlog_debug(
+					"%s: skipping response outside of any batch, seq number %d NS %u",
+					__func__, h->nlmsg_seq,
+					bth->inflight_zns->ns_id);
+			continue;
+		}
+
 		/*
 		 * Find the corresponding context object. Received responses are
 		 * in the same order as requests we sent, so we can simply
@@ -1332,7 +1467,7 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 		 * requests at same time.
 		 */
 		while (true) {
-			ctx = dplane_ctx_get_head(&(bth->ctx_list));
+			ctx = dplane_ctx_get_head(&(ifl->ctx_list));
 			if (ctx == NULL) {
 				/*
 				 * This is a situation where we have gotten
@@ -1359,7 +1494,7 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 				break;
 			}
 
-			ctx = dplane_ctx_dequeue(&(bth->ctx_list));
+			ctx = dplane_ctx_dequeue(&(ifl->ctx_list));
 			dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
 
 			/* We have found corresponding context object. */
@@ -1380,8 +1515,8 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 			 * message for our operator to understand
 			 * what is going on
 			 */
-			int err = netlink_parse_error(nl, h, bth->zns->is_cmd,
-						      false);
+			int err = netlink_parse_error(
+				nl, h, bth->inflight_zns->is_cmd, false);
 
 			zlog_debug("%s: netlink error message seq=%d %d",
 				   __func__, h->nlmsg_seq, err);
@@ -1397,17 +1532,21 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 				zlog_debug(
 					"%s: skipping unassociated response, seq number %d NS %u",
 					__func__, h->nlmsg_seq,
-					bth->zns->ns_id);
+					bth->inflight_zns->ns_id);
 			continue;
 		}
 
 		if (h->nlmsg_type == NLMSG_ERROR) {
-			int err = netlink_parse_error(nl, h, bth->zns->is_cmd,
-						      false);
+			int err = netlink_parse_error(
+				nl, h, bth->inflight_zns->is_cmd, false);
 
-			if (err == -1)
+			if (err == -1) {
 				dplane_ctx_set_status(
 					ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+				atomic_fetch_add_explicit(&nl_batch_stat_errors,
+							  1,
+							  memory_order_relaxed);
+			}
 
 			if (IS_ZEBRA_DEBUG_KERNEL)
 				zlog_debug("%s: netlink error message seq=%d ",
@@ -1424,12 +1563,34 @@ static int nl_batch_read_resp(struct nl_batch *bth)
 			zlog_debug("%s: ignoring message type 0x%04x(%s) NS %u",
 				   __func__, h->nlmsg_type,
 				   nl_msg_type_to_str(h->nlmsg_type),
-				   bth->zns->ns_id);
+				   bth->inflight_zns->ns_id);
 	}
 
 	return 0;
 }
 
+/*
+ * Read the responses to all batches in flight and hand their contexts back
+ * to the dataplane.
+ */
+static void nl_batch_drain(struct nl_batch *bth)
+{
+	if (bth->inflight_cnt == 0)
+		return;
+
+	if (bth->inflight_msgs > 0 && bth->inflight_zns != NULL) {
+		nl_batch_read_resp(bth);
+		atomic_fetch_add_explicit(&nl_batch_stat_drains, 1,
+					  memory_order_relaxed);
+	}
+
+	/* Batches without any message sent have no responses to wait for */
+	while (bth->inflight_cnt > 0)
+		nl_batch_inflight_done(bth, false);
+
+	bth->inflight_zns = NULL;
+}
+
 static void nl_batch_reset(struct nl_batch *bth)
 {
 	bth->buf_head = bth->buf;
@@ -1442,6 +1603,8 @@ static void nl_batch_reset(struct nl_batch *bth)
 
 static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 {
+	unsigned int i;
+
 	/*
 	 * If the size of the buffer has changed, free and then allocate a new
 	 * one.
@@ -1463,45 +1626,102 @@ static void nl_batch_init(struct nl_batch *bth, struct dplane_ctx_q *ctx_out_q)
 
 	bth->ctx_out_q = ctx_out_q;
 
+	for (i = 0; i < NL_BATCH_WINDOW_MAX; i++)
+		TAILQ_INIT(&(bth->inflight[i].ctx_list));
+	bth->inflight_head = 0;
+	bth->inflight_cnt = 0;
+	bth->inflight_msgs = 0;
+	bth->inflight_zns = NULL;
+
+	bth->window =
+		atomic_load_explicit(&nl_batch_window, memory_order_relaxed);
+	bth->ack_budget = rcvbufsize / NL_ACK_TRUESIZE;
+
 	nl_batch_reset(bth);
 }
 
 static void nl_batch_send(struct nl_batch *bth)
 {
 	struct zebra_dplane_ctx *ctx;
-	bool err = false;
+	struct nl_batch_inflight *ifl;
+	uint32_t inflight_max;
+
+	ctx = dplane_ctx_get_head(&(bth->ctx_list));
+	if (ctx == NULL) {
+		nl_batch_reset(bth);
+		return;
+	}
 
 	if (bth->curlen != 0 && bth->zns != NULL) {
 		struct nlsock *nl =
 			kernel_netlink_nlsock_lookup(bth->zns->sock);
 
+		/*
+		 * The responses to the batches in flight arrive on the socket
+		 * of their namespace, read them before moving to another one.
+		 */
+		if (bth->inflight_zns != NULL
+		    && bth->inflight_zns->ns_id != bth->zns->ns_id)
+			nl_batch_drain(bth);
+
 		if (IS_ZEBRA_DEBUG_KERNEL)
-			zlog_debug("%s: %s, batch size=%zu, msg cnt=%zu",
-				   __func__, nl->name, bth->curlen,
-				   bth->msgcnt);
+			zlog_debug(
+				"%s: %s, batch size=%zu, msg cnt=%zu, in flight=%u",
+				__func__, nl->name, bth->curlen, bth->msgcnt,
+				bth->inflight_cnt);
+
+		if (netlink_send_msg(nl, bth->buf, bth->curlen) == -1) {
+			/* Keep the contexts in order on the outbound queue */
+			nl_batch_drain(bth);
 
-		if (netlink_send_msg(nl, bth->buf, bth->curlen) == -1)
-			err = true;
+			while ((ctx = dplane_ctx_dequeue(&(bth->ctx_list)))
+			       != NULL) {
+				dplane_ctx_set_status(
+					ctx, ZEBRA_DPLANE_REQUEST_FAILURE);
+				dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
+			}
 
-		if (!err) {
-			if (nl_batch_read_resp(bth) == -1)
-				err = true;
+			nl_batch_reset(bth);
+			return;
 		}
-	}
 
-	/* Move remaining contexts to the outbound queue. */
-	while (true) {
-		ctx = dplane_ctx_dequeue(&(bth->ctx_list));
-		if (ctx == NULL)
-			break;
+		bth->inflight_zns = bth->zns;
 
-		if (err)
-			dplane_ctx_set_status(ctx,
-					      ZEBRA_DPLANE_REQUEST_FAILURE);
-
-		dplane_ctx_enqueue_tail(bth->ctx_out_q, ctx);
+		atomic_fetch_add_explicit(&nl_batch_stat_sent, 1,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&nl_batch_stat_msgs, bth->msgcnt,
+					  memory_order_relaxed);
 	}
 
+	/*
+	 * Keep track of the batch until its responses are read.  'update'
+	 * contexts use the sequence number following their own as well.
+	 */
+	ifl = &bth->inflight[(bth->inflight_head + bth->inflight_cnt)
+			     % NL_BATCH_WINDOW_MAX];
+	ifl->seq_first = dplane_ctx_get_ns(ctx)->seq;
+	ctx = TAILQ_LAST(&(bth->ctx_list), dplane_ctx_q);
+	ifl->seq_last = dplane_ctx_get_ns(ctx)->seq + 1;
+	ifl->msgcnt = bth->msgcnt;
+	dplane_ctx_list_append(&(ifl->ctx_list), &(bth->ctx_list));
+
+	bth->inflight_cnt++;
+	bth->inflight_msgs += bth->msgcnt;
+
+	inflight_max = atomic_load_explicit(&nl_batch_stat_inflight_max,
+					    memory_order_relaxed);
+	if (bth->inflight_cnt > inflight_max)
+		atomic_store_explicit(&nl_batch_stat_inflight_max,
+				      bth->inflight_cnt, memory_order_relaxed);
+
+	/*
+	 * Read the responses once the window is full, or when the acks of
+	 * another batch like this one might not fit the receive buffer.
+	 */
+	if (bth->inflight_cnt >= bth->window
+	    || bth->inflight_msgs + bth->msgcnt > bth->ack_budget)
+		nl_batch_drain(bth);
+
 	nl_batch_reset(bth);
 }
 
@@ -1686,6 +1906,7 @@ void kernel_update_multi(struct dplane_ctx_q *ctx_list)
 	}
 
 	nl_batch_send(&batch);
+	nl_batch_drain(&batch);
 
 	TAILQ_INIT(ctx_list);
 	dplane_ctx_list_append(ctx_list, &handled_list);
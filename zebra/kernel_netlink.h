@@ -34,6 +34,9 @@ extern "C" {
 #define NL_RCV_PKT_BUF_SIZE     32768
 #define NL_PKT_BUF_SIZE         8192
 
+/* Maximum number of netlink batches in flight */
+#define NL_BATCH_WINDOW_MAX 16
+
 /*
  * nl_attr_put - add an attribute to the Netlink message.
  *
@@ -183,6 +186,15 @@ extern int netlink_config_write_helper(struct vty *vty);
 extern void netlink_set_batch_buffer_size(uint32_t size, uint32_t threshold,
 					  bool set);
 
+/*
+ * Configure the number of batches sent before their responses are read. If
+ * 'unset', reset to default value.
+ */
+extern void netlink_set_batch_window(uint32_t window, bool set);
+
+/* Show batching statistics */
+extern void netlink_batch_show_helper(struct vty *vty);
+
 extern struct nlsock *kernel_netlink_nlsock_lookup(int sock);
 #endif /* HAVE_NETLINK */
 
@@ -187,11 +187,46 @@ struct route_entry {
  * sub-queue 8: iBGP, eBGP
  * sub-queue 9: any other origin (if any) typically those that
  *              don't generate routes
+ *
+ * Route nodes, sub-queues 4 to 9, are queued per route table: each table
+ * with work pending has its own set of those sub-queues, and the tables take
+ * turns so that a busy VRF cannot hold up all others.  Within a table the
+ * priority of the sub-queues is kept.
  */
 #define MQ_SIZE 10
+
+PREDECL_HASH(mq_table_hash);
+PREDECL_DLIST(mq_table_list);
+
+struct meta_queue_table {
+	struct route_table *table;
+	struct list *subq[MQ_SIZE];
+	uint32_t size; /* sum of lengths of all subqueues */
+
+	/* Route nodes left to process before the next table's turn */
+	uint32_t quantum;
+
+	/* Statistics since the table last had work pending */
+	uint64_t dequeued;
+	uint32_t max_size;
+
+	struct mq_table_hash_item hash_item;
+	struct mq_table_list_item list_item;
+};
+
 struct meta_queue {
 	struct list *subq[MQ_SIZE];
 	uint32_t size; /* sum of lengths of all subqueues */
+
+	/* Tables with route nodes queued, in the order they take turns */
+	struct mq_table_hash_head tables;
+	struct mq_table_list_head turns;
+
+	/* Statistics */
+	uint64_t enqueued[MQ_SIZE];
+	uint64_t dequeued[MQ_SIZE];
+	uint32_t max_size;
+	uint32_t max_tables;
 };
 
 /*
@@ -226,6 +261,13 @@ typedef struct rib_dest_t_ {
 	 */
 	struct rnh_list_head nht;
 
+	/*
+	 * The PIC group the selected route uses, and the linkage on its
+	 * list of destinations.
+	 */
+	struct nhg_hash_entry *pic_nhe;
+	struct nhg_pic_dests_item pic_item;
+
 	/*
 	 * Linkage to put dest on the FPM processing queue.
 	 */
@@ -463,6 +505,7 @@ int zebra_rib_queue_evpn_rem_vtep_del(vrf_id_t vrf_id, vni_t vni,
 				      struct in_addr vtep_ip);
 
 extern void meta_queue_free(struct meta_queue *mq, struct zebra_vrf *zvrf);
+extern void meta_queue_show(struct vty *vty, struct meta_queue *mq);
 extern int zebra_rib_labeled_unicast(struct route_entry *re);
 extern struct route_table *rib_table_ipv6;
 
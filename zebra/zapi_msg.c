@@ -35,6 +35,7 @@
 #include "lib/vrf.h"
 #include "lib/libfrr.h"
 #include "lib/lib_errors.h"
+#include "lib/shmring.h"
 
 #include "zebra/zebra_router.h"
 #include "zebra/rib.h"
@@ -2023,10 +2024,10 @@ static void zread_nhg_add(ZAPI_HANDLER_ARGS)
 
 }
 
-static void zread_route_add(ZAPI_HANDLER_ARGS)
+/* Add a route decoded from a ZEBRA_ROUTE_ADD or ZEBRA_ROUTE_BULK_ADD message */
+static void zapi_route_add(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	struct route_entry *re;
@@ -2036,34 +2037,26 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	vrf_id_t vrf_id;
 	struct nhg_hash_entry nhe, *n = NULL;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0) {
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("%s: Unable to decode zapi_route sent",
-				   __func__);
-		return;
-	}
-
 	vrf_id = zvrf_id(zvrf);
 
 	if (IS_ZEBRA_DEBUG_RECV)
 		zlog_debug("%s: p=(%u:%u)%pFX, msg flags=0x%x, flags=0x%x",
-			   __func__, vrf_id, api.tableid, &api.prefix,
-			   (int)api.message, api.flags);
+			   __func__, vrf_id, api->tableid, &api->prefix,
+			   (int)api->message, api->flags);
 
 	/* Allocate new route. */
 	re = zebra_rib_route_entry_new(
-		vrf_id, api.type, api.instance, api.flags, api.nhgid,
-		api.tableid ? api.tableid : zvrf->table_id, api.metric, api.mtu,
-		api.distance, api.tag);
+		vrf_id, api->type, api->instance, api->flags, api->nhgid,
+		api->tableid ? api->tableid : zvrf->table_id, api->metric,
+		api->mtu, api->distance, api->tag);
 
-	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NHG)
-	    && (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
-		|| api.nexthop_num == 0)) {
+	if (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NHG)
+	    && (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP)
+		|| api->nexthop_num == 0)) {
 		flog_warn(
 			EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
 			"%s: received a route without nexthops for prefix %pFX from client %s",
-			__func__, &api.prefix,
+			__func__, &api->prefix,
 			zebra_route_string(client->proto));
 
 		XFREE(MTYPE_RE, re);
@@ -2071,23 +2064,24 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 
 	/* Report misuse of the backup flag */
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
-	    && api.backup_nexthop_num == 0) {
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_BACKUP_NEXTHOPS)
+	    && api->backup_nexthop_num == 0) {
 		if (IS_ZEBRA_DEBUG_RECV || IS_ZEBRA_DEBUG_EVENT)
 			zlog_debug(
 				"%s: client %s: BACKUP flag set but no backup nexthops, prefix %pFX",
 				__func__, zebra_route_string(client->proto),
-				&api.prefix);
+				&api->prefix);
 	}
 
 	if (!re->nhe_id
-	    && (!zapi_read_nexthops(client, &api.prefix, api.nexthops,
-				    api.flags, api.message, api.nexthop_num,
-				    api.backup_nexthop_num, &ng, NULL)
-		|| !zapi_read_nexthops(client, &api.prefix, api.backup_nexthops,
-				       api.flags, api.message,
-				       api.backup_nexthop_num,
-				       api.backup_nexthop_num, NULL, &bnhg))) {
+	    && (!zapi_read_nexthops(client, &api->prefix, api->nexthops,
+				    api->flags, api->message,
+				    api->nexthop_num, api->backup_nexthop_num,
+				    &ng, NULL)
+		|| !zapi_read_nexthops(client, &api->prefix,
+				       api->backup_nexthops, api->flags,
+				       api->message, api->backup_nexthop_num,
+				       api->backup_nexthop_num, NULL, &bnhg))) {
 
 		nexthop_group_delete(&ng);
 		zebra_nhg_backup_free(&bnhg);
@@ -2095,16 +2089,16 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		return;
 	}
 
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_OPAQUE)) {
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_OPAQUE)) {
 		re->opaque =
 			XMALLOC(MTYPE_RE_OPAQUE,
-				sizeof(struct re_opaque) + api.opaque.length);
-		re->opaque->length = api.opaque.length;
-		memcpy(re->opaque->data, api.opaque.data, re->opaque->length);
+				sizeof(struct re_opaque) + api->opaque.length);
+		re->opaque->length = api->opaque.length;
+		memcpy(re->opaque->data, api->opaque.data, re->opaque->length);
 	}
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received SRC Prefix but afi is not v6",
 			  __func__);
@@ -2114,13 +2108,13 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		XFREE(MTYPE_RE, re);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.safi != SAFI_UNICAST && api.safi != SAFI_MULTICAST) {
+	if (api->safi != SAFI_UNICAST && api->safi != SAFI_MULTICAST) {
 		flog_warn(EC_LIB_ZAPI_MISSMATCH,
 			  "%s: Received safi: %d but we can only accept UNICAST or MULTICAST",
-			  __func__, api.safi);
+			  __func__, api->safi);
 		nexthop_group_delete(&ng);
 		zebra_nhg_backup_free(&bnhg);
 		XFREE(MTYPE_RE_OPAQUE, re->opaque);
@@ -2144,7 +2138,7 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		nhe.backup_info = bnhg;
 		n = zebra_nhe_copy(&nhe, 0);
 	}
-	ret = rib_add_multipath_nhe(afi, api.safi, &api.prefix, src_p, re, n,
+	ret = rib_add_multipath_nhe(afi, api->safi, &api->prefix, src_p, re, n,
 				    false);
 
 	/*
@@ -2166,7 +2160,7 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		zebra_nhg_backup_free(&bnhg);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		if (ret == 0)
 			client->v4_route_add_cnt++;
@@ -2182,49 +2176,86 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_add(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __func__);
+		return;
+	}
+
+	zapi_route_add(client, zvrf, &api);
+}
+
+static void zread_route_bulk_add(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+	uint16_t count;
+
+	if (zapi_route_bulk_decode(msg, &api, &count) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __func__);
+		return;
+	}
+
+	while (count--) {
+		if (zapi_route_bulk_decode_prefix(msg, &api) < 0) {
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: Unable to decode prefix sent",
+					   __func__);
+			return;
+		}
+
+		zapi_route_add(client, zvrf, &api);
+	}
+}
+
 void zapi_re_opaque_free(struct re_opaque *opaque)
 {
 	XFREE(MTYPE_RE_OPAQUE, opaque);
 }
 
-static void zread_route_del(ZAPI_HANDLER_ARGS)
+/*
+ * Delete a route decoded from a ZEBRA_ROUTE_DELETE or ZEBRA_ROUTE_BULK_DELETE
+ * message
+ */
+static void zapi_route_del(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	uint32_t table_id;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0)
-		return;
-
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received a src prefix while afi is not v6",
 			  __func__);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.tableid)
-		table_id = api.tableid;
+	if (api->tableid)
+		table_id = api->tableid;
 	else
 		table_id = zvrf->table_id;
 
 	if (IS_ZEBRA_DEBUG_RECV)
 		zlog_debug("%s: p=(%u:%u)%pFX, msg flags=0x%x, flags=0x%x",
-			   __func__, zvrf_id(zvrf), table_id, &api.prefix,
-			   (int)api.message, api.flags);
+			   __func__, zvrf_id(zvrf), table_id, &api->prefix,
+			   (int)api->message, api->flags);
 
-	rib_delete(afi, api.safi, zvrf_id(zvrf), api.type, api.instance,
-		   api.flags, &api.prefix, src_p, NULL, 0, table_id, api.metric,
-		   api.distance, false);
+	rib_delete(afi, api->safi, zvrf_id(zvrf), api->type, api->instance,
+		   api->flags, &api->prefix, src_p, NULL, 0, table_id,
+		   api->metric, api->distance, false);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		client->v4_route_del_cnt++;
 		break;
@@ -2234,6 +2265,32 @@ static void zread_route_del(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_del(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0)
+		return;
+
+	zapi_route_del(client, zvrf, &api);
+}
+
+static void zread_route_bulk_del(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+	uint16_t count;
+
+	if (zapi_route_bulk_decode(msg, &api, &count) < 0)
+		return;
+
+	while (count--) {
+		if (zapi_route_bulk_decode_prefix(msg, &api) < 0)
+			return;
+
+		zapi_route_del(client, zvrf, &api);
+	}
+}
+
 /* MRIB Nexthop lookup for IPv4. */
 static void zread_nexthop_lookup_mrib(ZAPI_HANDLER_ARGS)
 {
@@ -2397,6 +2454,64 @@ stream_failure:
 	return;
 }
 
+/*
+ * The client offers a shared memory ring for its messages.  The client
+ * pthread reads it from now on, whenever it is woken up.
+ */
+static void zread_shm_ring_setup(ZAPI_HANDLER_ARGS)
+{
+	char name[ZEBRA_SHM_RING_NAMSIZ];
+	char path[MAXPATHLEN];
+	struct shmring *ring = NULL;
+	uint16_t len;
+	struct stream *s;
+
+	STREAM_GETW(msg, len);
+	if (len >= sizeof(name))
+		goto stream_failure;
+	STREAM_GET(name, msg, len);
+	name[len] = '\0';
+
+	/* Only rings the client created in our runtime directory */
+	if (strncmp(name, ZEBRA_SHM_RING_PREFIX,
+		    strlen(ZEBRA_SHM_RING_PREFIX))
+	    || strchr(name, '/')) {
+		zlog_warn("client %d offers invalid shared memory ring %s",
+			  client->sock, name);
+		goto reply;
+	}
+
+	if (client->ring)
+		goto reply;
+
+	snprintf(path, sizeof(path), "%s/%s", frr_vtydir, name);
+	ring = shmring_attach(path);
+	if (!ring) {
+		flog_err_sys(EC_LIB_SYSTEM_CALL,
+			     "%s: cannot attach to shared memory ring %s: %s",
+			     __func__, path, safe_strerror(errno));
+		goto reply;
+	}
+
+	if (IS_ZEBRA_DEBUG_EVENT)
+		zlog_debug("client %d uses shared memory ring %s",
+			   client->sock, name);
+
+	client->ring = ring;
+
+reply:
+	s = stream_new(ZEBRA_SMALL_PACKET_SIZE);
+
+	zclient_create_header(s, ZEBRA_SHM_RING_SETUP, VRF_DEFAULT);
+	stream_putc(s, ring != NULL);
+
+	stream_putw_at(s, 0, stream_get_endp(s));
+	zserv_send_message(client, s);
+
+stream_failure:
+	return;
+}
+
 /* Unregister all information in a VRF. */
 static void zread_vrf_unregister(ZAPI_HANDLER_ARGS)
 {
@@ -3768,6 +3883,9 @@ void (*const zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_CONFIGURE_ARP] = zebra_configure_arp,
 	[ZEBRA_GRE_GET] = zebra_gre_get,
 	[ZEBRA_GRE_SOURCE_SET] = zebra_gre_source_set,
+	[ZEBRA_SHM_RING_SETUP] = zread_shm_ring_setup,
+	[ZEBRA_ROUTE_BULK_ADD] = zread_route_bulk_add,
+	[ZEBRA_ROUTE_BULK_DELETE] = zread_route_bulk_del,
 };
 
 /*
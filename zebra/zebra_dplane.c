@@ -64,6 +64,12 @@ const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
+/* Max number of free contexts kept for re-use by each pthread */
+#define DPLANE_CTX_POOL_MAX 4096
+
+/* Max number of pthreads with a pool of free contexts */
+#define DPLANE_CTX_POOLS 8
+
 /* Validation check macro for context blocks */
 /* #define DPLANE_DEBUG 1 */
 
@@ -398,6 +404,10 @@ struct zebra_dplane_ctx {
 
 	/* Embedded list linkage */
 	TAILQ_ENTRY(zebra_dplane_ctx) zd_q_entries;
+
+	/* Linkage for the lock-free update queue into the dataplane */
+	struct zebra_dplane_ctx *zd_update_next;
+
 };
 
 /* Flag that can be set by a pre-kernel provider as a signal that an update
@@ -405,6 +415,9 @@ struct zebra_dplane_ctx {
  */
 #define DPLANE_CTX_FLAG_NO_KERNEL 0x01
 
+/* Context generated by the dataplane benchmark */
+#define DPLANE_CTX_FLAG_BENCHMARK 0x02
+
 
 /*
  * Registration block for one dataplane provider.
@@ -454,6 +467,28 @@ struct zebra_dplane_provider {
 	TAILQ_ENTRY(zebra_dplane_provider) dp_prov_link;
 };
 
+/*
+ * Pool of free contexts, for one pthread. A context released with
+ * dplane_ctx_fini() goes to the pool of the pthread releasing it, and is
+ * re-used by that pthread only. The mutex is only contended by 'show' and
+ * by shutdown, which closes the pool so that contexts released afterwards
+ * are freed.
+ */
+struct dplane_ctx_pool {
+	pthread_mutex_t mutex;
+
+	struct dplane_ctx_q free_q;
+	uint32_t count;
+	bool closed;
+
+	/* Allocations served from the pool and from the heap */
+	uint64_t hits;
+	uint64_t misses;
+
+	/* Contexts freed because the pool was full */
+	uint64_t overflows;
+};
+
 /* Declare types for list of zns info objects */
 PREDECL_DLIST(zns_info_list);
 
@@ -486,7 +521,15 @@ static struct zebra_dplane_globals {
 	/* Sentinel for end of shutdown */
 	volatile bool dg_run;
 
-	/* Update context queue inbound to the dataplane */
+	/* New updates inbound to the dataplane: a stack that producers push
+	 * onto without locking, linked through zd_update_next. The dataplane
+	 * pthread takes the whole stack at once and appends it, in order, to
+	 * dg_update_ctx_q; each context is only ever pushed again after it
+	 * has been through the dataplane and back, so there is no ABA issue.
+	 */
+	struct zebra_dplane_ctx *_Atomic dg_update_ctx_stack;
+
+	/* Update context queue inbound to the dataplane, under dg_mutex */
 	TAILQ_HEAD(zdg_ctx_q, zebra_dplane_ctx) dg_update_ctx_q;
 
 	/* Ordered list of providers */
@@ -575,6 +618,23 @@ static struct zebra_dplane_globals {
 	/* Event pointer for pending shutdown check loop */
 	struct thread *dg_t_shutdown_check;
 
+	/* Pools of free contexts; a pthread finds its own through the key */
+	struct dplane_ctx_pool dg_ctx_pools[DPLANE_CTX_POOLS];
+	_Atomic uint32_t dg_ctx_pools_used;
+	pthread_key_t dg_ctx_pool_key;
+	bool dg_ctx_pool_key_valid;
+
+	/* Contexts currently allocated, whether in use or pooled */
+	_Atomic uint32_t dg_ctxs_alloced;
+
+	/* Dataplane benchmark state: contexts still expected by the test
+	 * provider, start time and result of the last run.
+	 */
+	_Atomic uint32_t dg_bench_pending;
+	uint32_t dg_bench_count;
+	struct timeval dg_bench_start;
+	_Atomic uint64_t dg_bench_usecs;
+
 } zdplane_info;
 
 /* Instantiate zns list type */
@@ -624,17 +684,66 @@ struct thread_master *dplane_get_thread_master(void)
 	return zdplane_info.dg_master;
 }
 
+/*
+ * Find the context pool of the current pthread, assigning one on first use.
+ * Returns NULL if all pools are taken.
+ */
+static struct dplane_ctx_pool *dplane_ctx_pool_self(void)
+{
+	struct dplane_ctx_pool *pool;
+	uint32_t idx;
+
+	if (!zdplane_info.dg_ctx_pool_key_valid)
+		return NULL;
+
+	pool = pthread_getspecific(zdplane_info.dg_ctx_pool_key);
+	if (pool)
+		return pool;
+
+	idx = atomic_load_explicit(&zdplane_info.dg_ctx_pools_used,
+				   memory_order_relaxed);
+	do {
+		if (idx >= DPLANE_CTX_POOLS)
+			return NULL;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&zdplane_info.dg_ctx_pools_used, &idx, idx + 1,
+		memory_order_relaxed, memory_order_relaxed));
+
+	pool = &zdplane_info.dg_ctx_pools[idx];
+	pthread_setspecific(zdplane_info.dg_ctx_pool_key, pool);
+
+	return pool;
+}
+
 /*
  * Allocate a dataplane update context
  */
 struct zebra_dplane_ctx *dplane_ctx_alloc(void)
 {
-	struct zebra_dplane_ctx *p;
+	struct zebra_dplane_ctx *p = NULL;
+	struct dplane_ctx_pool *pool;
+
+	pool = dplane_ctx_pool_self();
+	if (pool) {
+		frr_with_mutex (&pool->mutex) {
+			p = TAILQ_FIRST(&pool->free_q);
+			if (p) {
+				TAILQ_REMOVE(&pool->free_q, p, zd_q_entries);
+				pool->count--;
+				pool->hits++;
+			} else
+				pool->misses++;
+		}
+	}
 
-	/* TODO -- just alloc'ing memory, but would like to maintain
-	 * a pool
-	 */
-	p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+	if (p) {
+		memset(p, 0, sizeof(*p));
+	} else {
+		p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+
+		atomic_fetch_add_explicit(&zdplane_info.dg_ctxs_alloced, 1,
+					  memory_order_relaxed);
+	}
 
 	return p;
 }
@@ -838,21 +947,46 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
  */
 static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 {
+	struct zebra_dplane_ctx *ctx;
+	struct dplane_ctx_pool *pool;
+
 	if (pctx == NULL)
 		return;
 
 	DPLANE_CTX_VALID(*pctx);
 
-	/* TODO -- just freeing memory, but would like to maintain
-	 * a pool
-	 */
+	ctx = *pctx;
+	*pctx = NULL;
 
 	/* Some internal allocations may need to be freed, depending on
 	 * the type of info captured in the ctx.
 	 */
-	dplane_ctx_free_internal(*pctx);
+	dplane_ctx_free_internal(ctx);
+
+	/* Keep the context for re-use by this pthread, unless its pool is
+	 * full or closed.
+	 */
+	pool = dplane_ctx_pool_self();
+	if (pool) {
+		frr_with_mutex (&pool->mutex) {
+			if (!pool->closed &&
+			    pool->count < DPLANE_CTX_POOL_MAX) {
+				TAILQ_INSERT_HEAD(&pool->free_q, ctx,
+						  zd_q_entries);
+				pool->count++;
+				ctx = NULL;
+			} else if (!pool->closed)
+				pool->overflows++;
+		}
 
-	XFREE(MTYPE_DP_CTX, *pctx);
+		if (ctx == NULL)
+			return;
+	}
+
+	atomic_fetch_sub_explicit(&zdplane_info.dg_ctxs_alloced, 1,
+				  memory_order_relaxed);
+
+	XFREE(MTYPE_DP_CTX, ctx);
 }
 
 /*
@@ -870,7 +1004,6 @@ void dplane_ctx_reset(struct zebra_dplane_ctx *ctx)
  */
 void dplane_ctx_fini(struct zebra_dplane_ctx **pctx)
 {
-	/* TODO -- maintain pool; for now, just free */
 	dplane_ctx_free(pctx);
 }
 
@@ -2735,7 +2868,11 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 
 #ifdef HAVE_NETLINK
 	{
-		struct nhg_hash_entry *nhe = zebra_nhg_resolve(re->nhe);
+		struct nhg_hash_entry *nhe = re->nhe;
+
+		/* Recursive groups installed for PIC are used as they are */
+		if (!CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC))
+			nhe = zebra_nhg_resolve(nhe);
 
 		ctx->u.rinfo.nhe.id = nhe->id;
 		ctx->u.rinfo.nhe.old_id = 0;
@@ -2820,9 +2957,12 @@ int dplane_ctx_nexthop_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 
 	nexthop_group_copy(&(ctx->u.rinfo.nhe.ng), &(nhe->nhg));
 
-	/* If this is a group, convert it to a grp array of ids */
+	/* If this is a group, convert it to a grp array of ids.  A recursive
+	 * one installed for PIC is the group of what it resolves to.
+	 */
 	if (!zebra_nhg_depends_is_empty(nhe)
-	    && !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RECURSIVE))
+	    && (!CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RECURSIVE)
+		|| CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC)))
 		ctx->u.rinfo.nhe.nh_grp_count = zebra_nhg_nhe2grp(
 			ctx->u.rinfo.nhe.nh_grp, nhe, MULTIPATH_NUM);
 
@@ -3358,6 +3498,33 @@ dplane_ctx_ipset_entry_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 }
 
 
+/*
+ * Take all the updates pushed onto the inbound stack and append them, in
+ * the order they were pushed, to the update queue. Caller holds the dplane
+ * lock.
+ */
+static void dplane_update_collect(void)
+{
+	struct zebra_dplane_ctx *ctx, *next;
+	struct dplane_ctx_q batch;
+
+	ctx = atomic_exchange_explicit(&zdplane_info.dg_update_ctx_stack,
+				       NULL, memory_order_acquire);
+	if (ctx == NULL)
+		return;
+
+	TAILQ_INIT(&batch);
+
+	for (; ctx; ctx = next) {
+		next = ctx->zd_update_next;
+		ctx->zd_update_next = NULL;
+
+		TAILQ_INSERT_HEAD(&batch, ctx, zd_q_entries);
+	}
+
+	TAILQ_CONCAT(&zdplane_info.dg_update_ctx_q, &batch, zd_q_entries);
+}
+
 /*
  * Enqueue a new update,
  * and ensure an event is active for the dataplane pthread.
@@ -3366,14 +3533,16 @@ static int dplane_update_enqueue(struct zebra_dplane_ctx *ctx)
 {
 	int ret = EINVAL;
 	uint32_t high, curr;
+	struct zebra_dplane_ctx *head;
 
 	/* Enqueue for processing by the dataplane pthread */
-	DPLANE_LOCK();
-	{
-		TAILQ_INSERT_TAIL(&zdplane_info.dg_update_ctx_q, ctx,
-				  zd_q_entries);
-	}
-	DPLANE_UNLOCK();
+	head = atomic_load_explicit(&zdplane_info.dg_update_ctx_stack,
+				    memory_order_relaxed);
+	do {
+		ctx->zd_update_next = head;
+	} while (!atomic_compare_exchange_weak_explicit(
+		&zdplane_info.dg_update_ctx_stack, &head, ctx,
+		memory_order_release, memory_order_relaxed));
 
 	curr = atomic_fetch_add_explicit(
 		&(zdplane_info.dg_routes_queued),
@@ -5027,6 +5196,40 @@ dplane_gre_set(struct interface *ifp, struct interface *ifp_link,
 	return result;
 }
 
+/*
+ * Context memory usage, for 'show dplane'
+ */
+static void dplane_ctx_pool_show(struct vty *vty)
+{
+	struct dplane_ctx_pool *pool;
+	uint64_t alloced, pooled = 0, hits = 0, misses = 0, overflows = 0;
+	uint32_t i, used;
+
+	alloced = atomic_load_explicit(&zdplane_info.dg_ctxs_alloced,
+				       memory_order_relaxed);
+	used = atomic_load_explicit(&zdplane_info.dg_ctx_pools_used,
+				    memory_order_relaxed);
+
+	for (i = 0; i < used && i < DPLANE_CTX_POOLS; i++) {
+		pool = &zdplane_info.dg_ctx_pools[i];
+
+		frr_with_mutex (&pool->mutex) {
+			pooled += pool->count;
+			hits += pool->hits;
+			misses += pool->misses;
+			overflows += pool->overflows;
+		}
+	}
+
+	vty_out(vty, "Contexts allocated:       %" PRIu64 " (%zu bytes each)\n",
+		alloced, sizeof(struct zebra_dplane_ctx));
+	vty_out(vty, "Contexts pooled:          %" PRIu64 " in %u pools\n",
+		pooled, used);
+	vty_out(vty, "Context pool hits:        %" PRIu64 "\n", hits);
+	vty_out(vty, "Context pool misses:      %" PRIu64 "\n", misses);
+	vty_out(vty, "Context pool overflows:   %" PRIu64 "\n", overflows);
+}
+
 /*
  * Handler for 'show dplane'
  */
@@ -5150,6 +5353,16 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 				    memory_order_relaxed);
 	vty_out(vty, "GRE set updates:       %"PRIu64"\n", incoming);
 	vty_out(vty, "GRE set errors:        %"PRIu64"\n", errs);
+
+	dplane_ctx_pool_show(vty);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_bench_usecs,
+					memory_order_relaxed);
+	if (incoming > 0)
+		vty_out(vty, "Benchmark: %u contexts in %" PRIu64 " usecs, %" PRIu64 " contexts/sec\n",
+			zdplane_info.dg_bench_count, incoming,
+			(uint64_t)zdplane_info.dg_bench_count * 1000000 /
+				incoming);
 	return CMD_SUCCESS;
 }
 
@@ -5207,6 +5420,51 @@ int dplane_config_write_helper(struct vty *vty)
 	return 0;
 }
 
+/*
+ * Handler for 'zebra dplane benchmark': push empty contexts through the
+ * dataplane pthread and the test provider, which logs the rate once it
+ * has seen all of them.
+ */
+int dplane_benchmark_helper(struct vty *vty, uint32_t count)
+{
+#ifdef DPLANE_TEST_PROVIDER
+	struct zebra_dplane_ctx *ctx;
+	uint32_t i;
+
+	if (atomic_load_explicit(&zdplane_info.dg_bench_pending,
+				 memory_order_relaxed) > 0) {
+		vty_out(vty, "%% Dataplane benchmark already running\n");
+		return CMD_WARNING;
+	}
+
+	zdplane_info.dg_bench_count = count;
+	atomic_store_explicit(&zdplane_info.dg_bench_usecs, 0,
+			      memory_order_relaxed);
+	monotime(&zdplane_info.dg_bench_start);
+	atomic_store_explicit(&zdplane_info.dg_bench_pending, count,
+			      memory_order_release);
+
+	for (i = 0; i < count; i++) {
+		ctx = dplane_ctx_alloc();
+
+		ctx->zd_op = DPLANE_OP_NONE;
+		ctx->zd_status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+		SET_FLAG(ctx->zd_flags, DPLANE_CTX_FLAG_NO_KERNEL);
+		SET_FLAG(ctx->zd_flags, DPLANE_CTX_FLAG_BENCHMARK);
+
+		dplane_update_enqueue(ctx);
+	}
+
+	vty_out(vty, "Dataplane benchmark started with %u contexts\n", count);
+
+	return CMD_SUCCESS;
+#else
+	vty_out(vty, "%% Dataplane test provider not compiled in\n");
+
+	return CMD_WARNING;
+#endif /* DPLANE_TEST_PROVIDER */
+}
+
 /*
  * Provider registration
  */
@@ -6003,6 +6261,32 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
  * Test dataplane provider plugin
  */
 
+/*
+ * Account for a context generated by the dataplane benchmark, and report
+ * the rate after the last one.
+ */
+static void test_dplane_benchmark_ctx(void)
+{
+	int64_t usecs;
+	uint32_t count;
+
+	if (atomic_fetch_sub_explicit(&zdplane_info.dg_bench_pending, 1,
+				      memory_order_acq_rel) != 1)
+		return;
+
+	usecs = monotime_since(&zdplane_info.dg_bench_start, NULL);
+	if (usecs <= 0)
+		usecs = 1;
+
+	atomic_store_explicit(&zdplane_info.dg_bench_usecs, usecs,
+			      memory_order_relaxed);
+
+	count = zdplane_info.dg_bench_count;
+	zlog_info("dplane benchmark: %u contexts in %" PRId64
+		  " usecs, %" PRIu64 " contexts/sec",
+		  count, usecs, (uint64_t)count * 1000000 / usecs);
+}
+
 /*
  * Test provider process callback
  */
@@ -6031,6 +6315,9 @@ static int test_dplane_process_func(struct zebra_dplane_provider *prov)
 
 		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
 
+		if (CHECK_FLAG(ctx->zd_flags, DPLANE_CTX_FLAG_BENCHMARK))
+			test_dplane_benchmark_ctx();
+
 		dplane_provider_enqueue_out_ctx(prov, ctx);
 	}
 
@@ -6111,9 +6398,13 @@ int dplane_clean_ctx_queue(bool (*context_cb)(struct zebra_dplane_ctx *ctx,
 	if (context_cb == NULL)
 		goto done;
 
-	/* Walk the pending context queue under the dplane lock. */
+	/* Walk the pending context queue under the dplane lock, after
+	 * collecting the updates pushed since the dataplane pthread last ran.
+	 */
 	DPLANE_LOCK();
 
+	dplane_update_collect();
+
 	TAILQ_FOREACH_SAFE(ctx, &zdplane_info.dg_update_ctx_q, zd_q_entries,
 			   temp) {
 		if (context_cb(ctx, val)) {
@@ -6195,6 +6486,10 @@ static bool dplane_work_pending(void)
 	DPLANE_LOCK();
 	{
 		ctx = TAILQ_FIRST(&zdplane_info.dg_update_ctx_q);
+		if (ctx == NULL)
+			ctx = atomic_load_explicit(
+				&zdplane_info.dg_update_ctx_stack,
+				memory_order_acquire);
 		prov = TAILQ_FIRST(&zdplane_info.dg_providers_q);
 	}
 	DPLANE_UNLOCK();
@@ -6333,6 +6628,9 @@ static void dplane_thread_loop(struct thread *event)
 	/* Locate initial registered provider */
 	prov = TAILQ_FIRST(&zdplane_info.dg_providers_q);
 
+	/* Take the updates zebra pushed since the last cycle */
+	dplane_update_collect();
+
 	/* Move new work from incoming list to temp list */
 	for (counter = 0; counter < limit; counter++) {
 		ctx = TAILQ_FIRST(&zdplane_info.dg_update_ctx_q);
@@ -6491,6 +6789,40 @@ static void dplane_thread_loop(struct thread *event)
 	TAILQ_INIT(&work_list);
 }
 
+/*
+ * Close the context pools and free the contexts kept for re-use. Contexts
+ * released afterwards are freed right away, including by a pthread that
+ * claims a pool only now, which is why all pools are closed.
+ */
+static void dplane_ctx_pools_fini(void)
+{
+	struct dplane_ctx_pool *pool;
+	struct zebra_dplane_ctx *ctx, *next;
+	struct dplane_ctx_q free_q;
+	uint32_t i;
+
+	for (i = 0; i < DPLANE_CTX_POOLS; i++) {
+		pool = &zdplane_info.dg_ctx_pools[i];
+
+		TAILQ_INIT(&free_q);
+
+		frr_with_mutex (&pool->mutex) {
+			pool->closed = true;
+
+			TAILQ_CONCAT(&free_q, &pool->free_q, zd_q_entries);
+			pool->count = 0;
+		}
+
+		TAILQ_FOREACH_SAFE (ctx, &free_q, zd_q_entries, next) {
+			TAILQ_REMOVE(&free_q, ctx, zd_q_entries);
+
+			atomic_fetch_sub_explicit(&zdplane_info.dg_ctxs_alloced,
+						  1, memory_order_relaxed);
+			XFREE(MTYPE_DP_CTX, ctx);
+		}
+	}
+}
+
 /*
  * Final phase of shutdown, after all work enqueued to dplane has been
  * processed. This is called from the zebra main pthread context.
@@ -6531,6 +6863,8 @@ void zebra_dplane_shutdown(void)
 	/* TODO -- Clean-up provider objects */
 
 	/* TODO -- Clean queue(s), free memory */
+
+	dplane_ctx_pools_fini();
 }
 
 /*
@@ -6538,6 +6872,8 @@ void zebra_dplane_shutdown(void)
  */
 static void zebra_dplane_init_internal(void)
 {
+	uint32_t i;
+
 	memset(&zdplane_info, 0, sizeof(zdplane_info));
 
 	pthread_mutex_init(&zdplane_info.dg_mutex, NULL);
@@ -6550,6 +6886,14 @@ static void zebra_dplane_init_internal(void)
 
 	zdplane_info.dg_max_queued_updates = DPLANE_DEFAULT_MAX_QUEUED;
 
+	for (i = 0; i < DPLANE_CTX_POOLS; i++) {
+		pthread_mutex_init(&zdplane_info.dg_ctx_pools[i].mutex, NULL);
+		TAILQ_INIT(&zdplane_info.dg_ctx_pools[i].free_q);
+	}
+
+	if (pthread_key_create(&zdplane_info.dg_ctx_pool_key, NULL) == 0)
+		zdplane_info.dg_ctx_pool_key_valid = true;
+
 	/* Register default kernel 'provider' during init */
 	dplane_provider_init();
 }
@@ -66,6 +66,7 @@ uint32_t id_counter;
 static bool g_nexthops_enabled = true;
 static bool proto_nexthops_only;
 static bool use_recursive_backups = true;
+static bool use_pic;
 
 static struct nhg_hash_entry *depends_find(const struct nexthop *nh, afi_t afi,
 					   int type, bool from_dplane);
@@ -77,6 +78,7 @@ depends_find_add(struct nhg_connected_tree_head *head, struct nexthop *nh,
 static struct nhg_hash_entry *
 depends_find_id_add(struct nhg_connected_tree_head *head, uint32_t id);
 static void depends_decrement_free(struct nhg_connected_tree_head *head);
+static void zebra_nhg_pic_del(struct nhg_hash_entry *nhe);
 
 static struct nhg_backup_info *
 nhg_backup_copy(const struct nhg_backup_info *orig);
@@ -1102,6 +1104,9 @@ static void zebra_nhg_release(struct nhg_hash_entry *nhe)
 
 	zebra_nhg_release_all_deps(nhe);
 
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC))
+		zebra_nhg_pic_del(nhe);
+
 	/*
 	 * If its not zebra owned, we didn't store it here and have to be
 	 * sure we don't clear one thats actually being used.
@@ -2369,6 +2374,19 @@ static int nexthop_active(struct nexthop *nexthop, struct nhg_hash_entry *nhe,
 
 			resolved = 0;
 
+			/* A group being updated in place, see
+			 * zebra_nhg_pic_update(), cannot resolve through a
+			 * route using it.
+			 */
+			if (nhe && nhe->id && match->nhe->id == nhe->id) {
+				if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+					zlog_debug(
+						"        %s: match %p (%pNG) uses the group being resolved",
+						__func__, match, match->nhe);
+
+				goto done_with_match;
+			}
+
 			/* Only useful if installed */
 			if (!CHECK_FLAG(match->status, ROUTE_ENTRY_INSTALLED)) {
 				if (IS_ZEBRA_DEBUG_RIB_DETAILED)
@@ -2952,16 +2970,442 @@ uint8_t zebra_nhg_nhe2grp(struct nh_grp *grp, struct nhg_hash_entry *nhe,
 	return zebra_nhg_nhe2grp_internal(grp, 0, nhe, max_num);
 }
 
+/*
+ * Prefix independent convergence (PIC core).
+ *
+ * Normally a recursive nhe is not installed itself, the routes using it
+ * point to what it resolves to.  When the resolution changes, every one of
+ * those routes has to be reinstalled.  With PIC, a recursive group gets a
+ * kernel id of its own containing the nexthops it resolves to, and the
+ * routes point to that id.  When a route covering one of its gateways
+ * changes, the group is re-resolved and replaced in place in the dataplane,
+ * which takes care of all the routes using it at once.
+ *
+ * The groups installed this way are indexed by their gateways in
+ * zrouter.nhgs_pic, so the ones a route change may affect can be found
+ * with a walk of the gateways covered by its prefix.  Each group also
+ * keeps the destinations whose selected route uses it: once it is
+ * updated, what resolves through those routes has to be evaluated again.
+ */
+DECLARE_DLIST(nhg_pic_dests, rib_dest_t, pic_item);
+
+static bool zebra_nhg_pic_active(void)
+{
+	return use_pic && g_nexthops_enabled && !proto_nexthops_only
+	       && zrouter.supports_nhgs && !vrf_is_backend_netns();
+}
+
+static bool zebra_nhg_pic_candidate(const struct nhg_hash_entry *nhe)
+{
+	struct nexthop *nh;
+
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC))
+		return true;
+
+	if (!zebra_nhg_pic_active() || nhe->id >= ZEBRA_NHG_PROTO_LOWER
+	    || nhe->backup_info)
+		return false;
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next)
+		if (CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE))
+			return true;
+
+	return false;
+}
+
+/* The prefix a recursive nexthop is looked up with, see nexthop_active() */
+static bool zebra_nhg_pic_gateway(const struct nexthop *nh, struct prefix *p)
+{
+	memset(p, 0, sizeof(*p));
+
+	switch (nh->type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		p->family = AF_INET;
+		p->prefixlen = IPV4_MAX_BITLEN;
+		p->u.prefix4 = nh->gate.ipv4;
+		return true;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		if (IS_MAPPED_IPV6(&nh->gate.ipv6)) {
+			p->family = AF_INET;
+			p->prefixlen = IPV4_MAX_BITLEN;
+			ipv4_mapped_ipv6_to_ipv4(&nh->gate.ipv6,
+						 &p->u.prefix4);
+		} else {
+			p->family = AF_INET6;
+			p->prefixlen = IPV6_MAX_BITLEN;
+			p->u.prefix6 = nh->gate.ipv6;
+		}
+		return true;
+	case NEXTHOP_TYPE_IFINDEX:
+	case NEXTHOP_TYPE_BLACKHOLE:
+		break;
+	}
+
+	return false;
+}
+
+static void zebra_nhg_pic_add(struct nhg_hash_entry *nhe)
+{
+	struct route_node *rn;
+	struct nexthop *nh;
+	struct prefix p;
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next) {
+		if (!CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE)
+		    || !zebra_nhg_pic_gateway(nh, &p))
+			continue;
+
+		rn = route_node_get(zrouter.nhgs_pic[family2afi(p.family)],
+				    &p);
+		if (!rn->info)
+			rn->info = list_new();
+		else
+			route_unlock_node(rn);
+
+		listnode_add(rn->info, nhe);
+	}
+
+	nhg_pic_dests_init(&nhe->pic_dests);
+	SET_FLAG(nhe->flags, NEXTHOP_GROUP_PIC);
+
+	if (IS_ZEBRA_DEBUG_NHG)
+		zlog_debug("%s: nhe %pNG installed for PIC", __func__, nhe);
+}
+
+static void zebra_nhg_pic_del(struct nhg_hash_entry *nhe)
+{
+	struct route_node *rn;
+	struct nexthop *nh;
+	struct list *nhes;
+	rib_dest_t *dest;
+	struct prefix p;
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next) {
+		if (!CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE)
+		    || !zebra_nhg_pic_gateway(nh, &p))
+			continue;
+
+		rn = route_node_lookup(zrouter.nhgs_pic[family2afi(p.family)],
+				       &p);
+		if (!rn)
+			continue;
+
+		nhes = rn->info;
+		listnode_delete(nhes, nhe);
+		if (list_isempty(nhes)) {
+			list_delete(&nhes);
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+		route_unlock_node(rn);
+	}
+
+	while ((dest = nhg_pic_dests_pop(&nhe->pic_dests)))
+		dest->pic_nhe = NULL;
+	nhg_pic_dests_fini(&nhe->pic_dests);
+
+	UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_PIC);
+}
+
+void zebra_nhg_pic_dest_update(struct route_node *rn)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(rn);
+	struct nhg_hash_entry *nhe = NULL;
+
+	if (!dest)
+		return;
+
+	if (dest->selected_fib && dest->selected_fib->nhe
+	    && CHECK_FLAG(dest->selected_fib->nhe->flags, NEXTHOP_GROUP_PIC))
+		nhe = dest->selected_fib->nhe;
+
+	if (dest->pic_nhe == nhe)
+		return;
+
+	if (dest->pic_nhe)
+		nhg_pic_dests_del(&dest->pic_nhe->pic_dests, dest);
+
+	dest->pic_nhe = nhe;
+	if (nhe)
+		nhg_pic_dests_add_tail(&nhe->pic_dests, dest);
+}
+
+/*
+ * A group was updated in place: evaluate the nexthops tracked through the
+ * routes using it, and the groups resolving through them.  The prefix of
+ * the route that changed covers neither.
+ */
+static void zebra_nhg_pic_evaluate(struct nhg_hash_entry *nhe)
+{
+	struct route_node *rn;
+	struct listnode *node;
+	struct list *rns;
+	rib_dest_t *dest;
+	uint32_t seq;
+
+	if (!nhg_pic_dests_count(&nhe->pic_dests))
+		return;
+
+	/* Hold the nodes first, the evaluation may update other groups */
+	rns = list_new();
+	frr_each(nhg_pic_dests, &nhe->pic_dests, dest)
+		if (dest->selected_fib && dest->selected_fib->nhe == nhe)
+			listnode_add(rns, route_lock_node(dest->rnode));
+
+	if (IS_ZEBRA_DEBUG_NHG_DETAIL)
+		zlog_debug("%s: nhe %pNG updated, evaluating %u routes",
+			   __func__, nhe, listcount(rns));
+
+	seq = zebra_router_get_next_sequence();
+	for (ALL_LIST_ELEMENTS_RO(rns, node, rn)) {
+		zebra_rib_evaluate_rn_nexthops(rn, seq, false);
+		route_unlock_node(rn);
+	}
+
+	list_delete(&rns);
+}
+
+static bool nexthop_resolved_same(const struct nexthop *nh1,
+				  const struct nexthop *nh2)
+{
+	const struct nexthop *r1, *r2;
+
+	for (r1 = nh1->resolved, r2 = nh2->resolved; r1 && r2;
+	     r1 = r1->next, r2 = r2->next) {
+		if (!nexthop_same(r1, r2))
+			return false;
+	}
+
+	return !r1 && !r2;
+}
+
+/*
+ * Re-resolve a group installed for PIC and, if its resolution changed,
+ * replace it in place.  Anything other than a change of the nexthops the
+ * recursive ones resolve to (one becoming inactive, or resolving through a
+ * connected route instead) is left to the usual processing of the routes.
+ */
+static bool zebra_nhg_pic_update_nhe(struct nhg_hash_entry *nhe, afi_t afi)
+{
+	struct nhg_connected_tree_head depends, old_depends;
+	struct nhg_connected *rb_node_dep;
+	struct nhg_hash_entry *new, *found;
+	struct nexthop *nh, *newnh, *resolved;
+	bool changed = false;
+	uint32_t i;
+	int ret;
+
+	if (!CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED)
+	    && !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED))
+		return false;
+
+	/* Part of another group, which would have to change as well */
+	if (!zebra_nhg_dependents_is_empty(nhe) || nhe->backup_info)
+		return false;
+
+	/* Resolve a copy, keeping the id so it cannot resolve through one of
+	 * the routes using it.
+	 */
+	new = zebra_nhe_copy(nhe, nhe->id);
+
+	for (nh = nhe->nhg.nexthop, newnh = new->nhg.nexthop; nh && newnh;
+	     nh = nh->next, newnh = newnh->next) {
+		if (!CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE))
+			continue;
+
+		if (!nexthop_active(newnh, new, NULL, nhe->type,
+				    ZEBRA_FLAG_ALLOW_RECURSION, NULL,
+				    nhe->vrf_id)
+		    || !CHECK_FLAG(newnh->flags, NEXTHOP_FLAG_RECURSIVE))
+			goto done;
+
+		if (!nexthop_resolved_same(nh, newnh))
+			changed = true;
+	}
+
+	if (!changed || new->backup_info)
+		goto done;
+
+	/* Another group may already have the new resolution */
+	new->id = 0;
+	found = hash_lookup(zrouter.nhgs, new);
+	if (found && found != nhe) {
+		if (IS_ZEBRA_DEBUG_NHG)
+			zlog_debug("%s: nhe %pNG would duplicate %pNG",
+				   __func__, nhe, found);
+		goto done;
+	}
+
+	/*
+	 * Build the new dependencies, as zebra_nhe_find() does, and move the
+	 * references of the routes using the group over to them.
+	 */
+	nhg_connected_tree_init(&depends);
+	if (!new->nhg.nexthop->next)
+		handle_recursive_depend(&depends, new->nhg.nexthop->resolved,
+					afi, nhe->type);
+	else
+		for (nh = new->nhg.nexthop; nh; nh = nh->next)
+			depends_find_add(&depends, nh, afi, nhe->type, false);
+
+	for (i = 0; i < nhe->refcnt; i++)
+		nhg_connected_tree_increment_ref(&depends);
+
+	/* The resolved nexthops are part of the hash key */
+	hash_release(zrouter.nhgs, nhe);
+
+	nexthops_free(nhe->nhg.nexthop);
+	nhe->nhg.nexthop = new->nhg.nexthop;
+	new->nhg.nexthop = NULL;
+	nexthop_group_mark_duplicates(&nhe->nhg);
+
+	/* The routes using it are still installed */
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next) {
+		if (!CHECK_FLAG(nh->flags, NEXTHOP_FLAG_FIB))
+			continue;
+
+		for (resolved = nh->resolved; resolved;
+		     resolved = resolved->next)
+			SET_FLAG(resolved->flags, NEXTHOP_FLAG_FIB);
+	}
+
+	(void)hash_get(zrouter.nhgs, nhe, hash_alloc_intern);
+
+	zebra_nhg_depends_release(nhe);
+	old_depends = nhe->nhg_depends;
+	zebra_nhg_connect_depends(nhe, &depends);
+	zebra_nhg_set_valid_if_active(nhe);
+
+	frr_each(nhg_connected_tree, &nhe->nhg_depends, rb_node_dep)
+		zebra_nhg_install_kernel(zebra_nhg_resolve(rb_node_dep->nhe));
+
+	ret = dplane_nexthop_update(nhe);
+	switch (ret) {
+	case ZEBRA_DPLANE_REQUEST_QUEUED:
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED);
+		break;
+	case ZEBRA_DPLANE_REQUEST_FAILURE:
+		flog_err(EC_ZEBRA_DP_INSTALL_FAIL,
+			 "Failed to update Nexthop ID (%pNG) in the kernel",
+			 nhe);
+		break;
+	case ZEBRA_DPLANE_REQUEST_SUCCESS:
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+		zebra_nhg_handle_install(nhe);
+		zebra_nhg_pic_evaluate(nhe);
+		break;
+	}
+
+	/* Only now that the update is queued, release the old ones */
+	for (i = 0; i < nhe->refcnt; i++)
+		nhg_connected_tree_decrement_ref(&old_depends);
+	depends_decrement_free(&old_depends);
+
+	nhe->uptime = monotime(NULL);
+	zrouter.nhg_pic_updates++;
+
+	if (IS_ZEBRA_DEBUG_NHG)
+		zlog_debug("%s: nhe %pNG updated in place, refcnt %u",
+			   __func__, nhe, nhe->refcnt);
+
+done:
+	zebra_nhg_free(new);
+	return changed;
+}
+
+/* Whether one of the gateways of a PIC group is looked up in a vrf */
+static bool zebra_nhg_pic_in_vrf(const struct nhg_hash_entry *nhe,
+				 vrf_id_t vrf_id)
+{
+	struct nexthop *nh;
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next)
+		if (CHECK_FLAG(nh->flags, NEXTHOP_FLAG_RECURSIVE)
+		    && nh->vrf_id == vrf_id)
+			return true;
+
+	return false;
+}
+
+void zebra_nhg_pic_update(struct route_node *rn)
+{
+	struct rib_table_info *info = srcdest_rnode_table_info(rn);
+	const struct prefix *p, *src_p;
+	struct route_node *top, *gn;
+	struct route_table *table;
+	struct nhg_hash_entry *nhe;
+	struct listnode *node;
+	struct list *nhes;
+
+	if (!zebra_nhg_pic_active() || info->safi != SAFI_UNICAST
+	    || info->table_id != info->zvrf->table_id)
+		return;
+
+	/* Source specific routes are not used for resolution */
+	srcdest_rnode_prefixes(rn, &p, &src_p);
+	if (src_p && src_p->prefixlen)
+		return;
+
+	table = zrouter.nhgs_pic[info->afi];
+	if (!route_table_count(table))
+		return;
+
+	/*
+	 * Collect and hold the groups first, updating one releases the
+	 * nexthops it used, which may be other groups.  The ones only kept
+	 * around are not used by any route and left alone.  The index is
+	 * shared by all vrfs, the groups resolving in other ones are not
+	 * affected by this route.
+	 */
+	nhes = list_new();
+
+	top = route_node_get(table, p);
+	for (gn = route_lock_node(top); gn; gn = route_next_until(gn, top)) {
+		if (!gn->info)
+			continue;
+
+		for (ALL_LIST_ELEMENTS_RO((struct list *)gn->info, node, nhe)) {
+			if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_KEEP_AROUND)
+			    || !zebra_nhg_pic_in_vrf(nhe, zvrf_id(info->zvrf))
+			    || listnode_lookup(nhes, nhe))
+				continue;
+
+			zebra_nhg_increment_ref(nhe);
+			listnode_add(nhes, nhe);
+		}
+	}
+	route_unlock_node(top);
+
+	for (ALL_LIST_ELEMENTS_RO(nhes, node, nhe)) {
+		if (IS_ZEBRA_DEBUG_NHG_DETAIL)
+			zlog_debug("%s: %pRN changed, checking nhe %pNG",
+				   __func__, rn, nhe);
+
+		zebra_nhg_pic_update_nhe(nhe, info->afi);
+		zebra_nhg_decrement_ref(nhe);
+	}
+
+	list_delete(&nhes);
+}
+
 void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 {
 	struct nhg_connected *rb_node_dep = NULL;
+	bool pic;
 
-	/* Resolve it first */
-	nhe = zebra_nhg_resolve(nhe);
+	/*
+	 * Resolve it first, unless it is a recursive group getting an id of
+	 * its own so it can be updated in place.
+	 */
+	pic = zebra_nhg_pic_candidate(nhe);
+	if (!pic)
+		nhe = zebra_nhg_resolve(nhe);
 
 	/* Make sure all depends are installed/queued */
 	frr_each(nhg_connected_tree, &nhe->nhg_depends, rb_node_dep) {
-		zebra_nhg_install_kernel(rb_node_dep->nhe);
+		zebra_nhg_install_kernel(zebra_nhg_resolve(rb_node_dep->nhe));
 	}
 
 	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_VALID)
@@ -2971,6 +3415,9 @@ void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe)
 		if (!ZEBRA_NHG_CREATED(nhe))
 			nhe->type = ZEBRA_ROUTE_NHG;
 
+		if (pic && !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC))
+			zebra_nhg_pic_add(nhe);
+
 		int ret = dplane_nexthop_add(nhe);
 
 		switch (ret) {
@@ -3061,6 +3508,11 @@ void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx)
 			SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
 			zebra_nhg_handle_install(nhe);
 
+			/* Updated in place, see zebra_nhg_pic_update() */
+			if (op == DPLANE_OP_NH_UPDATE
+			    && CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_PIC))
+				zebra_nhg_pic_evaluate(nhe);
+
 			/* If daemon nhg, send it an update */
 			if (PROTO_OWNED(nhe))
 				zsend_nhg_notify(nhe->type, nhe->zapi_instance,
@@ -3243,6 +3695,21 @@ bool zebra_nhg_recursive_use_backups(void)
 	return use_recursive_backups;
 }
 
+/*
+ * Global control for PIC: install recursive groups with an id of their own
+ * and update them in place, see zebra_nhg_pic_update(). Only takes effect
+ * when kernel nexthops are used. Default is off.
+ */
+void zebra_nhg_enable_pic(bool set)
+{
+	use_pic = set;
+}
+
+bool zebra_nhg_pic_enabled(void)
+{
+	return use_pic;
+}
+
 /*
  * Global control to only use kernel nexthops for protocol created NHGs.
  * There are some use cases where you may not want zebra to implicitly
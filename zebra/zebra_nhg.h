@@ -42,6 +42,7 @@ struct nh_grp {
 };
 
 PREDECL_RBTREE_UNIQ(nhg_connected_tree);
+PREDECL_DLIST(nhg_pic_dests);
 
 /*
  * Hashtables containing nhg entries is in `zebra_router`.
@@ -105,6 +106,12 @@ struct nhg_hash_entry {
 	 */
 	struct nhg_connected_tree_head nhg_depends, nhg_dependents;
 
+	/*
+	 * With PIC, the destinations whose selected route uses this group,
+	 * see zebra_nhg_pic_dest_update().
+	 */
+	struct nhg_pic_dests_head pic_dests;
+
 	struct thread *timer;
 
 /*
@@ -160,6 +167,12 @@ struct nhg_hash_entry {
  * Track FPM installation status..
  */
 #define NEXTHOP_GROUP_FPM (1 << 6)
+
+/*
+ * Recursive group installed with an id of its own, so that it can be
+ * updated in place when the routes it resolves through change (PIC).
+ */
+#define NEXTHOP_GROUP_PIC (1 << 7)
 };
 
 /* Upper 4 bits of the NHG are reserved for indicating the NHG type */
@@ -248,6 +261,10 @@ bool zebra_nhg_proto_nexthops_only(void);
 void zebra_nhg_set_recursive_use_backups(bool set);
 bool zebra_nhg_recursive_use_backups(void);
 
+/* Prefix independent convergence for recursive routes */
+void zebra_nhg_enable_pic(bool set);
+bool zebra_nhg_pic_enabled(void);
+
 /**
  * NHE abstracted tree functions.
  * Use these where possible instead of direct access.
@@ -392,6 +409,15 @@ extern void zebra_nhg_mark_keep(void);
 struct route_entry; /* Forward ref to avoid circular includes */
 extern int nexthop_active_update(struct route_node *rn, struct route_entry *re);
 
+/*
+ * The route at rn changed in the FIB, update the recursive groups
+ * resolving through it in place.
+ */
+extern void zebra_nhg_pic_update(struct route_node *rn);
+
+/* The route selected at rn changed, track the PIC group it uses */
+extern void zebra_nhg_pic_dest_update(struct route_node *rn);
+
 #ifdef _FRR_ATTRIBUTE_PRINTFRR
 #pragma FRR printfrr_ext "%pNG" (const struct nhg_hash_entry *)
 #endif
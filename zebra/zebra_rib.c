@@ -66,6 +66,7 @@ DEFINE_MTYPE(ZEBRA, RE,       "Route Entry");
 DEFINE_MTYPE_STATIC(ZEBRA, RIB_DEST,       "RIB destination");
 DEFINE_MTYPE_STATIC(ZEBRA, RIB_UPDATE_CTX, "Rib update context object");
 DEFINE_MTYPE_STATIC(ZEBRA, WQ_WRAPPER, "WQ wrapper");
+DEFINE_MTYPE_STATIC(ZEBRA, META_QUEUE_TABLE, "Meta-queue table");
 
 /*
  * Event, list, and mutex for delivery of dataplane results
@@ -692,6 +693,7 @@ void rib_install_kernel(struct route_node *rn, struct route_entry *re,
 
 	/* Update fib selection */
 	dest->selected_fib = re;
+	zebra_nhg_pic_dest_update(rn);
 
 	/*
 	 * Make sure we update the FPM any time we send new information to
@@ -814,8 +816,12 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 				    bool rt_delete)
 {
 	rib_dest_t *dest = rib_dest_from_rnode(rn);
+	struct route_node *changed = rn;
 	struct rnh *rnh;
 
+	/* Recursive groups resolving through rn are updated in place */
+	zebra_nhg_pic_update(rn);
+
 	/*
 	 * We are storing the rnh's associated withb
 	 * the tracked nexthop as a list of the rn's.
@@ -823,7 +829,9 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 	 * of the tree list.( 0.0.0.0/0 for v4 and 0::0/0 for v6 )
 	 * As such for each rn we need to walk up the tree
 	 * and see if any rnh's need to see if they
-	 * would match a more specific route
+	 * would match a more specific route.  Only those
+	 * whose tracked prefix is covered by the changed
+	 * node can, the others do not need to be evaluated.
 	 */
 	while (rn) {
 		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
@@ -880,7 +888,17 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 				continue;
 			}
 
+			if (rn != changed && !prefix_match(&changed->p, p)) {
+				if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+					zlog_debug(
+						"    Nexthop not covered by %pRN, skipping",
+						changed);
+				zrouter.nht_evals_avoided++;
+				continue;
+			}
+
 			rnh->seqno = seq;
+			zrouter.nht_evals++;
 			zebra_evaluate_rnh(zvrf, family2afi(p->family), 0, p,
 					   rnh->safi);
 		}
@@ -2919,6 +2937,7 @@ static void process_subq_early_route_delete(struct zebra_early_route *ere)
 				 * it as deleted
 				 */
 				dest->selected_fib = NULL;
+				zebra_nhg_pic_dest_update(rn);
 			} else {
 				/*
 				 * This means someone else, other than Zebra,
@@ -3056,6 +3075,99 @@ static unsigned int process_subq(struct list *subq,
 	return 1;
 }
 
+static int mq_table_cmp(const struct meta_queue_table *a,
+			const struct meta_queue_table *b)
+{
+	return numcmp((uintptr_t)a->table, (uintptr_t)b->table);
+}
+
+static uint32_t mq_table_hash(const struct meta_queue_table *mqt)
+{
+	return jhash(&mqt->table, sizeof(mqt->table), 0x6d717462);
+}
+
+DECLARE_HASH(mq_table_hash, struct meta_queue_table, hash_item, mq_table_cmp,
+	     mq_table_hash);
+DECLARE_DLIST(mq_table_list, struct meta_queue_table, list_item);
+
+static void mq_enqueued(struct meta_queue *mq, uint8_t qindex)
+{
+	mq->size++;
+	mq->enqueued[qindex]++;
+	if (mq->size > mq->max_size)
+		mq->max_size = mq->size;
+}
+
+/* Route nodes a table may process in a row before the next one's turn */
+#define MQ_TABLE_QUANTUM 32
+
+static struct meta_queue_table *meta_queue_table_get(struct meta_queue *mq,
+						     struct route_table *table)
+{
+	struct meta_queue_table ref, *mqt;
+	unsigned int i;
+
+	ref.table = table;
+	mqt = mq_table_hash_find(&mq->tables, &ref);
+	if (mqt)
+		return mqt;
+
+	mqt = XCALLOC(MTYPE_META_QUEUE_TABLE, sizeof(*mqt));
+	mqt->table = table;
+	mqt->quantum = MQ_TABLE_QUANTUM;
+	for (i = META_QUEUE_CONNECTED; i < MQ_SIZE; i++)
+		mqt->subq[i] = list_new();
+
+	mq_table_hash_add(&mq->tables, mqt);
+	mq_table_list_add_tail(&mq->turns, mqt);
+	if (mq_table_hash_count(&mq->tables) > mq->max_tables)
+		mq->max_tables = mq_table_hash_count(&mq->tables);
+
+	return mqt;
+}
+
+static void meta_queue_table_del(struct meta_queue *mq,
+				 struct meta_queue_table *mqt)
+{
+	unsigned int i;
+
+	mq_table_hash_del(&mq->tables, mqt);
+	mq_table_list_del(&mq->turns, mqt);
+	for (i = META_QUEUE_CONNECTED; i < MQ_SIZE; i++)
+		list_delete(&mqt->subq[i]);
+	XFREE(MTYPE_META_QUEUE_TABLE, mqt);
+}
+
+/*
+ * Process the next route node of a table, and let the next table have its
+ * turn once this one is done or used up its quantum.
+ */
+static void meta_queue_table_process(struct meta_queue *mq,
+				     struct meta_queue_table *mqt)
+{
+	unsigned int i;
+
+	for (i = META_QUEUE_CONNECTED; i < MQ_SIZE; i++)
+		if (process_subq(mqt->subq[i], i)) {
+			mqt->size--;
+			mqt->dequeued++;
+			mq->size--;
+			mq->dequeued[i]++;
+			break;
+		}
+
+	if (!mqt->size) {
+		meta_queue_table_del(mq, mqt);
+		return;
+	}
+
+	if (--mqt->quantum == 0) {
+		mqt->quantum = MQ_TABLE_QUANTUM;
+		mq_table_list_del(&mq->turns, mqt);
+		mq_table_list_add_tail(&mq->turns, mqt);
+	}
+}
+
 /* Dispatch the meta queue by picking and processing the next node from
  * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
  * data is pointed to the meta queue structure.
@@ -3063,6 +3175,7 @@ static unsigned int process_subq(struct list *subq,
 static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 {
 	struct meta_queue *mq = data;
+	struct meta_queue_table *mqt;
 	unsigned i;
 	uint32_t queue_len, queue_limit;
 
@@ -3082,11 +3195,17 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
+	for (i = 0; i < META_QUEUE_CONNECTED; i++)
 		if (process_subq(mq->subq[i], i)) {
 			mq->size--;
-			break;
+			mq->dequeued[i]++;
+			return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 		}
+
+	mqt = mq_table_list_first(&mq->turns);
+	if (mqt)
+		meta_queue_table_process(mq, mqt);
+
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
@@ -3115,6 +3234,7 @@ static int rib_meta_queue_add(struct meta_queue *mq, void *data)
 	struct route_node *rn = NULL;
 	struct route_entry *re = NULL, *curr_re = NULL;
 	uint8_t qindex = MQ_SIZE, curr_qindex = MQ_SIZE;
+	struct meta_queue_table *mqt;
 
 	rn = (struct route_node *)data;
 
@@ -3141,9 +3261,13 @@ static int rib_meta_queue_add(struct meta_queue *mq, void *data)
 	}
 
 	SET_FLAG(rib_dest_from_rnode(rn)->flags, RIB_ROUTE_QUEUED(qindex));
-	listnode_add(mq->subq[qindex], rn);
+	mqt = meta_queue_table_get(mq, srcdest_rnode_table(rn));
+	listnode_add(mqt->subq[qindex], rn);
 	route_lock_node(rn);
-	mq->size++;
+	mqt->size++;
+	if (mqt->size > mqt->max_size)
+		mqt->max_size = mqt->size;
+	mq_enqueued(mq, qindex);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		rnode_debug(rn, re->vrf_id, "queued rn %p into sub-queue %s",
@@ -3155,7 +3279,7 @@ static int rib_meta_queue_add(struct meta_queue *mq, void *data)
 static int early_label_meta_queue_add(struct meta_queue *mq, void *data)
 {
 	listnode_add(mq->subq[META_QUEUE_EARLY_LABEL], data);
-	mq->size++;
+	mq_enqueued(mq, META_QUEUE_EARLY_LABEL);
 	return 0;
 }
 
@@ -3176,7 +3300,7 @@ static int rib_meta_queue_nhg_ctx_add(struct meta_queue *mq, void *data)
 	w->u.ctx = ctx;
 
 	listnode_add(mq->subq[qindex], w);
-	mq->size++;
+	mq_enqueued(mq, qindex);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		zlog_debug("NHG Context id=%u queued into sub-queue %s",
@@ -3202,7 +3326,7 @@ static int rib_meta_queue_nhg_add(struct meta_queue *mq, void *data)
 	w->u.nhe = nhe;
 
 	listnode_add(mq->subq[qindex], w);
-	mq->size++;
+	mq_enqueued(mq, qindex);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		zlog_debug("NHG id=%u queued into sub-queue %s", nhe->id,
@@ -3214,7 +3338,7 @@ static int rib_meta_queue_nhg_add(struct meta_queue *mq, void *data)
 static int rib_meta_queue_evpn_add(struct meta_queue *mq, void *data)
 {
 	listnode_add(mq->subq[META_QUEUE_EVPN], data);
-	mq->size++;
+	mq_enqueued(mq, META_QUEUE_EVPN);
 
 	return 0;
 }
@@ -3530,10 +3654,13 @@ static struct meta_queue *meta_queue_new(void)
 
 	new = XCALLOC(MTYPE_WORK_QUEUE, sizeof(struct meta_queue));
 
-	for (i = 0; i < MQ_SIZE; i++) {
+	/* Route nodes are queued per table */
+	for (i = 0; i < META_QUEUE_CONNECTED; i++) {
 		new->subq[i] = list_new();
 		assert(new->subq[i]);
 	}
+	mq_table_hash_init(&new->tables);
+	mq_table_list_init(&new->turns);
 
 	return new;
 }
@@ -3618,22 +3745,30 @@ static void early_label_meta_queue_free(struct meta_queue *mq, struct list *l,
 	}
 }
 
-static void rib_meta_queue_free(struct meta_queue *mq, struct list *l,
-				struct zebra_vrf *zvrf)
+/* Drop the route nodes queued for the tables of a VRF, or of all tables */
+static void rib_meta_queue_free(struct meta_queue *mq, struct zebra_vrf *zvrf)
 {
+	struct meta_queue_table *mqt;
 	struct route_node *rnode;
 	struct listnode *node, *nnode;
+	unsigned int i;
 
-	for (ALL_LIST_ELEMENTS(l, node, nnode, rnode)) {
-		rib_dest_t *dest = rib_dest_from_rnode(rnode);
-
-		if (dest && rib_dest_vrf(dest) != zvrf)
+	frr_each_safe (mq_table_list, &mq->turns, mqt) {
+		if (zvrf && rib_table_info(mqt->table)->zvrf != zvrf)
 			continue;
 
-		route_unlock_node(rnode);
-		node->data = NULL;
-		list_delete_node(l, node);
-		mq->size--;
+		for (i = META_QUEUE_CONNECTED; i < MQ_SIZE; i++) {
+			for (ALL_LIST_ELEMENTS(mqt->subq[i], node, nnode,
+					       rnode)) {
+				if (zvrf)
+					route_unlock_node(rnode);
+				node->data = NULL;
+				list_delete_node(mqt->subq[i], node);
+				mq->size--;
+			}
+		}
+
+		meta_queue_table_del(mq, mqt);
 	}
 }
 
@@ -3658,7 +3793,9 @@ void meta_queue_free(struct meta_queue *mq, struct zebra_vrf *zvrf)
 {
 	enum meta_queue_indexes i;
 
-	for (i = 0; i < MQ_SIZE; i++) {
+	rib_meta_queue_free(mq, zvrf);
+
+	for (i = 0; i < META_QUEUE_CONNECTED; i++) {
 		/* Some subqueues may need cleanup - nhgs for example */
 		switch (i) {
 		case META_QUEUE_NHG:
@@ -3679,15 +3816,47 @@ void meta_queue_free(struct meta_queue *mq, struct zebra_vrf *zvrf)
 		case META_QUEUE_NOTBGP:
 		case META_QUEUE_BGP:
 		case META_QUEUE_OTHER:
-			rib_meta_queue_free(mq, mq->subq[i], zvrf);
 			break;
 		}
 		if (!zvrf)
 			list_delete(&mq->subq[i]);
 	}
 
-	if (!zvrf)
+	if (!zvrf) {
+		mq_table_hash_fini(&mq->tables);
+		mq_table_list_fini(&mq->turns);
 		XFREE(MTYPE_WORK_QUEUE, mq);
+	}
+}
+
+void meta_queue_show(struct vty *vty, struct meta_queue *mq)
+{
+	struct meta_queue_table *mqt;
+	struct rib_table_info *info;
+	enum meta_queue_indexes i;
+
+	vty_out(vty, "Meta-queue: %u queued (max %u), %zu tables (max %u)\n",
+		mq->size, mq->max_size, mq_table_hash_count(&mq->tables),
+		mq->max_tables);
+
+	vty_out(vty, "\n%-32s %12s %12s\n", "Sub-queue", "Enqueued",
+		"Dequeued");
+	for (i = 0; i < MQ_SIZE; i++)
+		vty_out(vty, "%-32s %12" PRIu64 " %12" PRIu64 "\n",
+			subqueue2str(i), mq->enqueued[i], mq->dequeued[i]);
+
+	if (!mq_table_list_count(&mq->turns))
+		return;
+
+	vty_out(vty, "\n%-20s %-6s %10s %10s %10s %12s\n", "VRF", "AFI",
+		"Table", "Queued", "Max", "Dequeued");
+	frr_each (mq_table_list, &mq->turns, mqt) {
+		info = rib_table_info(mqt->table);
+		vty_out(vty, "%-20s %-6s %10u %10u %10u %12" PRIu64 "\n",
+			zvrf_name(info->zvrf), afi2str(info->afi),
+			info->table_id, mqt->size, mqt->max_size,
+			mqt->dequeued);
+	}
 }
 
 /* initialise zebra rib work queue */
@@ -3708,6 +3877,7 @@ static void rib_queue_init(void)
 	zrouter.ribq->spec.max_retries = 3;
 	zrouter.ribq->spec.hold = ZEBRA_RIB_PROCESS_HOLD_TIME;
 	zrouter.ribq->spec.retry = ZEBRA_RIB_PROCESS_RETRY_TIME;
+	zrouter.ribq->spec.max_latency = THREAD_YIELD_TIME_SLOT;
 
 	if (!(zrouter.mq = meta_queue_new())) {
 		flog_err(EC_ZEBRA_WQ_NONEXISTENT,
@@ -3839,8 +4009,10 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 
 	re_list_del(&dest->routes, re);
 
-	if (dest->selected_fib == re)
+	if (dest->selected_fib == re) {
 		dest->selected_fib = NULL;
+		zebra_nhg_pic_dest_update(rn);
+	}
 
 	rib_re_nhg_free(re);
 
@@ -4026,7 +4198,7 @@ static int rib_meta_queue_early_route_add(struct meta_queue *mq, void *data)
 	struct zebra_early_route *ere = data;
 
 	listnode_add(mq->subq[META_QUEUE_EARLY_ROUTE], data);
-	mq->size++;
+	mq_enqueued(mq, META_QUEUE_EARLY_ROUTE);
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		zlog_debug(
@@ -4526,6 +4698,7 @@ void rib_close_table(struct route_table *table)
 		if (dest && dest->selected_fib) {
 			rib_uninstall_kernel(rn, dest->selected_fib);
 			dest->selected_fib = NULL;
+			zebra_nhg_pic_dest_update(rn);
 		}
 	}
 }
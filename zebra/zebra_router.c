@@ -232,6 +232,9 @@ enum multicast_mode multicast_mode_ipv4_get(void)
 void zebra_router_terminate(void)
 {
 	struct zebra_router_table *zrt, *tmp;
+	struct route_node *rn;
+	struct list *nhes;
+	afi_t afi;
 
 	THREAD_OFF(zrouter.sweeper);
 
@@ -245,6 +248,20 @@ void zebra_router_terminate(void)
 	zebra_mlag_terminate();
 	zebra_neigh_terminate();
 
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		for (rn = route_top(zrouter.nhgs_pic[afi]); rn;
+		     rn = route_next(rn)) {
+			nhes = rn->info;
+			if (!nhes)
+				continue;
+
+			list_delete(&nhes);
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+		route_table_finish(zrouter.nhgs_pic[afi]);
+	}
+
 	/* Free NHE in ID table only since it has unhashable entries as well */
 	hash_iterate(zrouter.nhgs_id, zebra_nhg_hash_free_zero_id, NULL);
 	hash_clean(zrouter.nhgs_id, zebra_nhg_hash_free);
@@ -277,6 +294,8 @@ bool zebra_router_notify_on_ack(void)
 
 void zebra_router_init(bool asic_offload, bool notify_on_ack)
 {
+	afi_t afi;
+
 	zrouter.sequence_num = 0;
 
 	zrouter.allow_delete = false;
@@ -311,6 +330,8 @@ void zebra_router_init(bool asic_offload, bool notify_on_ack)
 	zrouter.nhgs_id =
 		hash_create_size(8, zebra_nhg_id_key, zebra_nhg_hash_id_equal,
 				 "Zebra Router Nexthop Groups ID index");
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+		zrouter.nhgs_pic[afi] = route_table_init();
 
 	zrouter.asic_offloaded = asic_offload;
 	zrouter.notify_on_ack = notify_on_ack;
@@ -175,6 +175,13 @@ struct zebra_router {
 	/* A sequence number used for tracking routes */
 	_Atomic uint32_t sequence_num;
 
+	/*
+	 * Nexthop tracking evaluations triggered by route changes, and
+	 * those skipped because the change could not affect the nexthop
+	 */
+	uint64_t nht_evals;
+	uint64_t nht_evals_avoided;
+
 	/* rib work queue */
 #define ZEBRA_RIB_PROCESS_HOLD_TIME 10
 #define ZEBRA_RIB_PROCESS_RETRY_TIME 1
@@ -214,6 +221,13 @@ struct zebra_router {
 	struct hash *nhgs;
 	struct hash *nhgs_id;
 
+	/*
+	 * Recursive nexthop groups installed for PIC, indexed by their
+	 * gateways, and the number of times one was updated in place
+	 */
+	struct route_table *nhgs_pic[AFI_MAX];
+	uint64_t nhg_pic_updates;
+
 	/*
 	 * Does the underlying system provide an asic offload
 	 */
@@ -1760,6 +1760,18 @@ DEFPY_HIDDEN(backup_nexthop_recursive_use_enable,
 	return CMD_SUCCESS;
 }
 
+DEFPY (nexthop_group_pic,
+       nexthop_group_pic_cmd,
+       "[no] zebra nexthop pic",
+       NO_STR
+       ZEBRA_STR
+       "Nexthop configuration\n"
+       "Update recursive nexthop groups in place (prefix independent convergence)\n")
+{
+	zebra_nhg_enable_pic(!no);
+	return CMD_SUCCESS;
+}
+
 DEFUN (no_ip_nht_default_route,
        no_ip_nht_default_route_cmd,
        "no ip nht resolve-via-default",
@@ -3955,6 +3967,9 @@ static int config_write_protocol(struct vty *vty)
 	if (!zebra_nhg_recursive_use_backups())
 		vty_out(vty, "no zebra nexthop resolve-via-backup\n");
 
+	if (zebra_nhg_pic_enabled())
+		vty_out(vty, "zebra nexthop pic\n");
+
 	if (rnh_get_hide_backups())
 		vty_out(vty, "ip nht hide-backup-events\n");
 
@@ -4028,6 +4043,13 @@ DEFUN (show_zebra,
 		       zrouter.all_mc_forwardingv6 ? "On" : "Off");
 	ttable_add_row(table, "v6 Default MC Forwarding|%s",
 		       zrouter.default_mc_forwardingv6 ? "On" : "Off");
+	ttable_add_row(table, "NHT Evaluations|%" PRIu64, zrouter.nht_evals);
+	ttable_add_row(table, "NHT Evaluations Avoided|%" PRIu64,
+		       zrouter.nht_evals_avoided);
+	ttable_add_row(table, "NHG PIC|%s",
+		       zebra_nhg_pic_enabled() ? "On" : "Off");
+	ttable_add_row(table, "NHG PIC Updates|%" PRIu64,
+		       zrouter.nhg_pic_updates);
 
 	out = ttable_dump(table, "\n");
 	vty_out(vty, "%s\n", out);
@@ -4215,7 +4237,13 @@ DEFUN (show_dataplane_providers,
 	if (argv_find(argv, argc, "detailed", &idx))
 		detailed = true;
 
-	return dplane_show_provs_helper(vty, detailed);
+	dplane_show_provs_helper(vty, detailed);
+
+#ifdef HAVE_NETLINK
+	netlink_batch_show_helper(vty);
+#endif /* HAVE_NETLINK */
+
+	return CMD_SUCCESS;
 }
 
 /* Configure dataplane incoming queue limit */
@@ -4251,6 +4279,18 @@ DEFUN (no_zebra_dplane_queue_limit,
 	return CMD_SUCCESS;
 }
 
+/* Measure dataplane throughput, requires the test provider */
+DEFPY_HIDDEN (zebra_dplane_benchmark,
+	      zebra_dplane_benchmark_cmd,
+	      "zebra dplane benchmark (1-10000000)$count",
+	      ZEBRA_STR
+	      "Zebra dataplane\n"
+	      "Push contexts through the test dataplane provider\n"
+	      "Number of contexts\n")
+{
+	return dplane_benchmark_helper(vty, count);
+}
+
 DEFUN (zebra_show_routing_tables_summary,
        zebra_show_routing_tables_summary_cmd,
        "show zebra router table summary",
@@ -4265,6 +4305,19 @@ DEFUN (zebra_show_routing_tables_summary,
 	return CMD_SUCCESS;
 }
 
+DEFUN (show_zebra_meta_queue_statistics,
+       show_zebra_meta_queue_statistics_cmd,
+       "show zebra meta-queue statistics",
+       SHOW_STR
+       ZEBRA_STR
+       "The Zebra RIB meta-queue\n"
+       "Statistics\n")
+{
+	meta_queue_show(vty, zrouter.mq);
+
+	return CMD_SUCCESS;
+}
+
 /* Table configuration write function. */
 static int config_write_table(struct vty *vty)
 {
@@ -4381,6 +4434,38 @@ DEFUN_HIDDEN(no_zebra_kernel_netlink_batch_tx_buf,
 	return CMD_SUCCESS;
 }
 
+DEFUN_HIDDEN(zebra_kernel_netlink_batch_window,
+	     zebra_kernel_netlink_batch_window_cmd,
+	     "zebra kernel netlink batch-window (1-16)",
+	     ZEBRA_STR
+	     "Zebra kernel interface\n"
+	     "Set Netlink parameters\n"
+	     "Set number of batches sent before reading responses\n"
+	     "Number of batches\n")
+{
+	uint32_t window;
+
+	window = strtoul(argv[4]->arg, NULL, 10);
+
+	netlink_set_batch_window(window, true);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN_HIDDEN(no_zebra_kernel_netlink_batch_window,
+	     no_zebra_kernel_netlink_batch_window_cmd,
+	     "no zebra kernel netlink batch-window [(1-16)]",
+	     NO_STR ZEBRA_STR
+	     "Zebra kernel interface\n"
+	     "Set Netlink parameters\n"
+	     "Set number of batches sent before reading responses\n"
+	     "Number of batches\n")
+{
+	netlink_set_batch_window(0, false);
+
+	return CMD_SUCCESS;
+}
+
 DEFPY (zebra_protodown_bit,
        zebra_protodown_bit_cmd,
        "zebra protodown reason-bit (0-31)$bit",
@@ -4526,6 +4611,7 @@ void zebra_vty_init(void)
 	install_element(CONFIG_NODE, &nexthop_group_use_enable_cmd);
 	install_element(CONFIG_NODE, &proto_nexthop_group_only_cmd);
 	install_element(CONFIG_NODE, &backup_nexthop_recursive_use_enable_cmd);
+	install_element(CONFIG_NODE, &nexthop_group_pic_cmd);
 
 	install_element(VIEW_NODE, &show_nexthop_group_cmd);
 	install_element(VIEW_NODE, &show_interface_nexthop_group_cmd);
@@ -4602,8 +4688,10 @@ void zebra_vty_init(void)
 
 	install_element(VIEW_NODE, &show_dataplane_cmd);
 	install_element(VIEW_NODE, &show_dataplane_providers_cmd);
+	install_element(VIEW_NODE, &show_zebra_meta_queue_statistics_cmd);
 	install_element(CONFIG_NODE, &zebra_dplane_queue_limit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_dplane_queue_limit_cmd);
+	install_element(ENABLE_NODE, &zebra_dplane_benchmark_cmd);
 
 	install_element(CONFIG_NODE, &ip_table_range_cmd);
 	install_element(VRF_NODE, &ip_table_range_cmd);
@@ -4611,6 +4699,9 @@ void zebra_vty_init(void)
 #ifdef HAVE_NETLINK
 	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_tx_buf_cmd);
 	install_element(CONFIG_NODE, &no_zebra_kernel_netlink_batch_tx_buf_cmd);
+	install_element(CONFIG_NODE, &zebra_kernel_netlink_batch_window_cmd);
+	install_element(CONFIG_NODE,
+			&no_zebra_kernel_netlink_batch_window_cmd);
 	install_element(CONFIG_NODE, &zebra_protodown_bit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_protodown_bit_cmd);
 #endif /* HAVE_NETLINK */
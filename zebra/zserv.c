@@ -55,6 +55,7 @@
 #include "lib/frratomic.h"        /* for atomic_load_explicit, atomic_stor... */
 #include "lib/lib_errors.h"       /* for generic ferr ids */
 #include "lib/printfrr.h"         /* for string functions */
+#include "lib/shmring.h"          /* for shmring_get, shmring_idle */
 
 #include "zebra/debug.h"          /* for various debugging macros */
 #include "zebra/rib.h"            /* for rib_score_proto */
@@ -286,6 +287,75 @@ zwrite_fail:
 	zserv_client_fail(client);
 }
 
+/*
+ * Read messages from the client's shared memory ring onto the cache, up to
+ * *p2p of them.
+ *
+ * Returns -1 on a corrupt message, 0 once the ring is empty and we wait for
+ * the client to wake us up again, 1 if messages are left.
+ */
+static int zserv_ring_read(struct zserv *client, struct stream_fifo *cache,
+			   uint32_t *p2p, struct zmsghdr *hdr)
+{
+	struct stream *msg;
+	uint8_t buf[ZEBRA_HEADER_SIZE];
+	char errmsg[256];
+	uint16_t length;
+
+	while (true) {
+		if (*p2p == 0) {
+			client->ring_busy = true;
+			return 1;
+		}
+
+		/* The client puts whole messages only */
+		if (shmring_peek(client->ring, buf, sizeof(buf)) < sizeof(buf)) {
+			if (shmring_idle(client->ring))
+				break;
+			continue;
+		}
+
+		length = (buf[0] << 8) | buf[1];
+		if (length < ZEBRA_HEADER_SIZE
+		    || length > STREAM_SIZE(client->ibuf_work)
+		    || shmring_remain(client->ring) < length) {
+			snprintf(errmsg, sizeof(errmsg),
+				 "%s: ring message has corrupt length %u",
+				 __func__, length);
+			stream_put(client->ibuf_work, buf, sizeof(buf));
+			zserv_log_message(errmsg, client->ibuf_work, NULL);
+			return -1;
+		}
+
+		msg = stream_new(length);
+		shmring_get(client->ring, STREAM_DATA(msg), length);
+		stream_set_endp(msg, length);
+
+		if (!zapi_parse_header(msg, hdr)
+		    || hdr->marker != ZEBRA_HEADER_MARKER
+		    || hdr->version != ZSERV_VERSION) {
+			snprintf(errmsg, sizeof(errmsg),
+				 "%s: ring message has corrupt header",
+				 __func__);
+			zserv_log_message(errmsg, msg, NULL);
+			stream_free(msg);
+			return -1;
+		}
+
+		if (IS_ZEBRA_DEBUG_PACKET)
+			zlog_debug("zebra message[%s:%u:%u] comes from ring of socket [%d]",
+				   zserv_command_string(hdr->command),
+				   hdr->vrf_id, hdr->length, client->sock);
+
+		stream_set_getp(msg, 0);
+		stream_fifo_push(cache, msg);
+		(*p2p)--;
+	}
+
+	client->ring_busy = false;
+	return 0;
+}
+
 /*
  * Read and process data from a client socket.
  *
@@ -323,7 +393,12 @@ static void zserv_read(struct thread *thread)
 					memory_order_relaxed);
 	cache = stream_fifo_new();
 	p2p = p2p_orig;
-	sock = THREAD_FD(thread);
+	sock = client->sock;
+
+	/* Messages left on the ring by the last run come first */
+	if (client->ring_busy
+	    && zserv_ring_read(client, cache, &p2p, &hdr) < 0)
+		goto zread_fail;
 
 	while (p2p) {
 		ssize_t nb;
@@ -414,6 +489,14 @@ static void zserv_read(struct thread *thread)
 				   hdr.vrf_id, hdr.length,
 				   sock);
 
+		/* The client put messages on its ring */
+		if (hdr.command == ZEBRA_SHM_RING_WAKEUP && client->ring) {
+			stream_reset(client->ibuf_work);
+			if (zserv_ring_read(client, cache, &p2p, &hdr) < 0)
+				goto zread_fail;
+			continue;
+		}
+
 		stream_set_getp(client->ibuf_work, 0);
 		struct stream *msg = stream_dup(client->ibuf_work);
 
@@ -445,8 +528,12 @@ static void zserv_read(struct thread *thread)
 		zlog_debug("Read %d packets from client: %s", p2p_orig - p2p,
 			   zebra_route_string(client->proto));
 
-	/* Reschedule ourselves */
-	zserv_client_event(client, ZSERV_CLIENT_READ);
+	/* Reschedule ourselves, right away if the ring is not empty yet */
+	if (client->ring_busy)
+		thread_add_event(client->pthread->master, zserv_read, client, 0,
+				 &client->t_read);
+	else
+		zserv_client_event(client, ZSERV_CLIENT_READ);
 
 	stream_fifo_free(cache);
 
@@ -619,6 +706,8 @@ static void zserv_client_free(struct zserv *client)
 		stream_fifo_free(client->obuf_fifo);
 	if (client->wb)
 		buffer_free(client->wb);
+	if (client->ring)
+		shmring_del(client->ring);
 
 	/* Free buffer mutexes */
 	pthread_mutex_destroy(&client->obuf_mtx);
@@ -1008,6 +1097,7 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 
 	vty_out(vty, "------------------------ \n");
 	vty_out(vty, "FD: %d \n", client->sock);
+	vty_out(vty, "Shared memory ring: %s\n", client->ring ? "yes" : "no");
 
 	connect_time = (time_t) atomic_load_explicit(&client->connect_time,
 						     memory_order_relaxed);
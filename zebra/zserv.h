@@ -117,6 +117,16 @@ struct zserv {
 	/* Buffer of data waiting to be written to client. */
 	struct buffer *wb;
 
+	/*
+	 * Shared memory ring the client sends its messages through, if any.
+	 * Set by the main pthread before the client is told to use it, read
+	 * by the client pthread when the client wakes it up.
+	 */
+	struct shmring *ring;
+
+	/* The client pthread stopped reading the ring halfway */
+	bool ring_busy;
+
 	/* Threads for read/write. */
 	struct thread *t_read;
 	struct thread *t_write;